@@ -7,22 +7,32 @@
 #include "freertos/task.h"     // vTaskDelay
 #include "esp_log.h"
 #include "esp_pm.h"
+#include "esp_timer.h"
 
 #include "bno055.h"
+#include "imupair.h"
+#include "mount.h"
+#include "fusion.h"
+#include "imufilter.h"
+#include "vibration.h"
 #include "nmea_parser.h"
 #include "led.h"
+#include "ledstrip.h"
 #include "photoresist.h"
+#include "triplog.h"
+#include "decision.h"
+#include "cadence.h"
+#include "slope.h"
+#include "heading.h"
+#include "timebase.h"
+#include "geofence.h"
+#include "tripstats.h"
+#include "replay.h"
+#include "trace.h"
+#include "health.h"
 
 #include "parameters.h"
 
 static const char* TAG = "main";
 
-typedef enum stateMachine {
-    initial_state = 1,
-    threshold_angle_and_speed = 2,
-} out_of_level_t;
-
-int raw_ADC_to_LED_val(int);
-bool is_out_of_level(bno055_vec3_t*, float*);
-
 #endif //MAIN_H
\ No newline at end of file
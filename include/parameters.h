@@ -5,4 +5,71 @@ static const float threshold_angle = 5;
 static const float lower_speed = -1;
 static const float upper_speed = 10;
 
+static const float predict_horizon_ms = 0; //how far ahead the tilt is extrapolated to bring the warning on early, 0 turns prediction off. About one loop_delay_ms covers the loop's own lag.
+static const float predict_max_rate_dps = 30; //tilt changing faster than this is taken as a bump or bad sample and ignored
+static const float predict_smoothing = 0.5; //weight of the newest tilt rate, lower is steadier but slower to see the car tipping
+
+static const bool axis_limits = false; //judge pitch and roll against their own limits below instead of the combined angle against threshold_angle. Prediction isn't used with it.
+static const float pitch_upper_limit = 8; //nose up, degrees
+static const float pitch_lower_limit = -8; //nose down
+static const float pitch_hysteresis = 1; //pitch has to come this far back inside its limit before it counts as within it
+static const float pitch_lower_speed = -1; //pitch is only judged between these speeds
+static const float pitch_upper_speed = 10;
+static const int pitch_dwell_ms = 1000; //pitch has to stay out of its limits this long before the warning comes on
+static const float roll_upper_limit = 5; //right side down
+static const float roll_lower_limit = -5; //left side down
+static const float roll_hysteresis = 1;
+static const float roll_lower_speed = -1;
+static const float roll_upper_speed = 10;
+static const int roll_dwell_ms = 500;
+
+static const bool track_frame = false; //judge the pitch along the direction of travel and the roll across it, learned from the magnetic heading against GPS course. Needs the BNO055 fusion.
+static const int heading_budget_cycles = 1000; //CPU cycles one heading estimator call may take, calls over it are counted
+
+static const bool slope_compensation = false; //estimate the road grade from GPS climb over distance, and from pitch where it agrees with GPS, and judge the lean alone, so hills don't bring the warning on
+static const int slope_budget_cycles = 2000; //CPU cycles one estimator call may take, calls over it are counted
+
+static const bool geofence_zones = false; //switch the limits above by the zone the car is in, the zones are loaded from the geofence partition
+
+static const bool dual_imu = false; //second BNO055 cross checked against the first
+static const int dual_imu_sda_gpio = 10; //second IMU on its own I2C port with these pins, both are then read at the same time. -1 puts it at address B on the first IMU's bus.
+static const int dual_imu_scl_gpio = 11;
+static const float imu_agree_deg = 3; //furthest apart the two IMUs can read and still count as agreeing
+
+static const int mount_placement = 1; //P0 - P7 from the BNO055 datasheet section 3.4, how the board sits in the car
+static const bool capture_level_reference = false; //flash once with this set while the car is parked level to store the level reference in NVS
+
+static const int mcu_fusion_rate_hz = 0; //0 leaves fusion to the BNO055 (NDOF), otherwise the IMU runs in AMG and the ESP runs the filter this often
+static const bool mcu_fusion_mahony = false; //Mahony instead of Madgwick for mcu_fusion_rate_hz
+
+static const int tilt_filter = 0; //filter on the tilt angles before the decision, 0 none, 1 biquad low-pass, 2 moving median
+static const float tilt_filter_cutoff_hz = 0.5; //biquad cutoff, under half the rate the angle is read at
+static const int tilt_filter_median = 3; //median window in samples, odd and up to 9
+
+static const int vibration_rate_hz = 0; //linear acceleration samples per second for the road roughness analyzer, 0 turns it off. Only runs on the BNO055 fusion.
+static const int vibration_budget_cycles = 400000; //CPU cycles one window may take, 20 ms at the 20 MHz the power config allows
+
+static const int pps_gpio = -1; //GPIO the receiver's PPS output is wired to, -1 disciplines the timebase from NMEA sentence timing instead
+
+static const int loop_delay_ms = 600; //main loop delay, don't make it a multiple of the LED alarm period or the LED feeds back into the photocell
+static const int loop_min_delay_ms = 0; //shortest loop delay near the threshold, 0 keeps the loop at loop_delay_ms. loop_delay_ms is used level and still.
+static const float cadence_near_deg = 1; //within this of threshold_angle the loop runs at loop_min_delay_ms
+static const float cadence_far_deg = 4; //this far or further under threshold_angle the loop runs at loop_delay_ms
+static const float cadence_motion_dps = 2; //tilt changing this fast runs the loop at loop_min_delay_ms wherever it is
+
+static const bool led_pwm_output = true; //flash the single LED on GPIO 42
+static const int led_strip_gpio = -1; //data line of a WS2812 strip that flashes with the LED, driven by the RMT with DMA. -1 for no strip.
+static const int led_strip_pixels = 8; //pixels on the strip, up to 64
+static const float led_strip_severe_deg = 3; //this far over threshold_angle the strip goes from amber to red
+static const float led_strip_lean_deg = 1; //roll past this either way turns the strip into an arrow towards the low side
+
+static const float tripstats_moving_speed = 1; //slowest GPS speed that counts as moving for the trip totals, slower fixes add no distance
+static const int tripstats_period_ms = 60000; //how often the trip totals are printed and added to the trip log, 0 keeps them quiet
+
+static const bool capture_mode = false; //log every input the decision logic sees so a session can be replayed
+static const bool triplog_pack_imu = false; //delta code IMU samples into frames, about 8x less flash for them, decisions then carry their own angle
+static const int health_period_ms = 10000; //how often task and heap figures are sampled, 0 turns the sampler off
+static const bool trace_mode = false; //record stage timings to RAM so they can be exported with trace_export_chrome()
+static const int trace_export_ms = 30000; //with trace_mode, recording stops this long after boot and the rings are printed to the console as Chrome trace JSON
+
 #endif //PARAMETERS_H
\ No newline at end of file
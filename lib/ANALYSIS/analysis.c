@@ -0,0 +1,265 @@
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "analysis.h"
+#include "replay.h"
+#include "esp_log.h"
+
+typedef struct {
+    uint32_t sector;
+    uint32_t sequence;
+} analysis_sector_t;
+
+/**
+ * @brief state carried from record to record while scanning one log
+*/
+typedef struct {
+    analysis_stats_t *stats;
+    replay_inputs_t inputs; //the scan's limits as the base, a geofence zone's replace them the way they did on the device
+    triplog_imu_unpack_t unpack; //only counts packed IMU samples, decisions carry the sample they need
+    decision_state_t decision_state;
+    decision_axes_state_t axes_state;
+    bool in_session;
+    bool has_prev_decision;
+    uint32_t prev_timestamp_ms;
+    bool prev_out_of_level;
+    bool prev_logged;
+} analysis_scan_t;
+
+static int analysis_sector_compare(const void *a, const void *b)
+{
+    uint32_t sa = ((const analysis_sector_t *)a)->sequence, sb = ((const analysis_sector_t *)b)->sequence;
+    return (sa > sb) - (sa < sb);
+}
+
+static bool analysis_slot_is_erased(const uint8_t *slot)
+{
+    for(int i = 0; i < TRIPLOG_RECORD_SIZE; i++)
+    {
+        if(slot[i] != 0xFF)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @name analysis_record
+ *
+ * @brief judges one record, decisions are remade with the scan's limits and compared against what the device did.
+ * The angle and limits of each decision are rebuilt the way replay_feed() does it.
+ *
+ * @param scan scan state
+ * @param record intact record in log order
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+static void analysis_record(analysis_scan_t *scan, const triplog_record_t *record)
+{
+    analysis_stats_t *stats = scan->stats;
+    replay_decision_t decision;
+    bool decided = replay_inputs_feed(&scan->inputs, record, &decision);
+    uint32_t time[TRACECODEC_FRAME_SAMPLES];
+    int64_t gps_us[TRACECODEC_FRAME_SAMPLES];
+    int32_t values[TRACECODEC_FRAME_SAMPLES][TRACECODEC_MAX_CHANNELS];
+    uint8_t count;
+
+    triplog_imu_unpack_feed(&scan->unpack, record, time, gps_us, values, &count);
+    stats->imu_samples += count;
+
+    switch(record->type)
+    {
+        case TRIPLOG_RECORD_BOOT:
+            memset(&scan->decision_state, 0, sizeof(scan->decision_state));
+            memset(&scan->axes_state, 0, sizeof(scan->axes_state));
+            scan->in_session = true;
+            scan->has_prev_decision = false;
+            scan->prev_out_of_level = false;
+            scan->prev_logged = false;
+            stats->sessions++;
+            break;
+        case TRIPLOG_RECORD_IMU:
+            stats->imu_samples++;
+            break;
+        case TRIPLOG_RECORD_GPS:
+            stats->gps_fixes++;
+            break;
+        case TRIPLOG_RECORD_DECISION:
+            if(!decided)
+                break;
+
+            //the boot record of the oldest session has usually been overwritten by the time a log is pulled,
+            //pick the state machine up from what the device decided and start judging from the next decision
+            if(!scan->in_session)
+            {
+                scan->decision_state.state = record->payload.decision.out_of_level ? threshold_angle_and_speed : initial_state;
+                scan->in_session = true;
+                scan->has_prev_decision = true;
+                scan->prev_timestamp_ms = record->timestamp_ms;
+                scan->prev_out_of_level = record->payload.decision.out_of_level;
+                scan->prev_logged = record->payload.decision.out_of_level;
+                break;
+            }
+
+            float speed = decision.speed;
+            float combined_angle = sqrt(scan->inputs.angle.x*scan->inputs.angle.x + scan->inputs.angle.y*scan->inputs.angle.y);
+            bool out_of_level = decision.axes ?
+                decision_axes_step(&scan->axes_state, &scan->inputs.axes_params, &decision.judged, speed, record->timestamp_ms) :
+                is_out_of_level_r(&scan->decision_state, &scan->inputs.params, &decision.judged, speed);
+            bool logged = decision.logged;
+
+            stats->decisions++;
+
+            if(combined_angle > stats->max_combined_angle)
+                stats->max_combined_angle = combined_angle;
+            if(speed > stats->max_speed)
+                stats->max_speed = speed;
+
+            if(out_of_level)
+                stats->out_of_level_samples++;
+            if(out_of_level && !scan->prev_out_of_level)
+                stats->triggers++;
+            if(logged && !scan->prev_logged)
+                stats->logged_triggers++;
+            if(out_of_level != logged)
+                stats->disagreements++;
+
+            //each decision holds until the next one
+            if(scan->has_prev_decision)
+            {
+                uint32_t dt = record->timestamp_ms - scan->prev_timestamp_ms;
+                stats->recorded_ms += dt;
+                if(scan->prev_out_of_level)
+                    stats->out_of_level_ms += dt;
+            }
+
+            scan->has_prev_decision = true;
+            scan->prev_timestamp_ms = record->timestamp_ms;
+            scan->prev_out_of_level = out_of_level;
+            scan->prev_logged = logged;
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @name analysis_stats_init
+ *
+ * @brief zeroes a set of stats before scanning or merging into it
+ *
+ * @param stats stats to clear
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void analysis_stats_init(analysis_stats_t *stats)
+{
+    memset(stats, 0, sizeof(analysis_stats_t));
+}
+
+/**
+ * @name analysis_scan_image
+ *
+ * @brief runs the firmware's out of level check over a whole trip log partition image, e.g. a dump pulled off a unit and memory mapped.
+ * The image is only read and all state lives on the stack, so any number of images can be scanned at once from different threads,
+ * one unit per thread, with analysis_merge() adding the results up at the end.
+ *
+ * @param image partition image, the triplog partition byte for byte
+ * @param size size of the image in bytes
+ * @param params limits to judge the samples against outside geofence zones, per axis decisions use the limits in parameters.h
+ * @param stats stats the results are added to, cleared with analysis_stats_init() beforehand
+ *
+ * @return err variable that lets you know if the image was scanned or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t analysis_scan_image(const uint8_t *image, size_t size, const decision_params_t *params, analysis_stats_t *stats)
+{
+    uint32_t sector_count = size / TRIPLOG_SECTOR_SIZE, valid = 0, sequence;
+    analysis_sector_t *sectors;
+    analysis_scan_t scan;
+
+    if(image == NULL || sector_count == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    if((sectors = malloc(sector_count * sizeof(analysis_sector_t))) == NULL)
+        return ESP_ERR_NO_MEM;
+
+    //headers give the order the sectors were written in, the ring can start anywhere in the image
+    for(uint32_t sector = 0; sector < sector_count; sector++)
+    {
+        if(triplog_header_is_valid((const triplog_sector_header_t *)(image + sector * TRIPLOG_SECTOR_SIZE), &sequence))
+        {
+            sectors[valid].sector = sector;
+            sectors[valid].sequence = sequence;
+            valid++;
+        }
+    }
+    qsort(sectors, valid, sizeof(analysis_sector_t), analysis_sector_compare);
+
+    memset(&scan, 0, sizeof(scan));
+    replay_inputs_begin(&scan.inputs, params, NULL);
+    triplog_imu_unpack_begin(&scan.unpack);
+    scan.stats = stats;
+
+    stats->units++;
+    stats->sectors += valid;
+
+    for(uint32_t i = 0; i < valid; i++)
+    {
+        const uint8_t *base = image + sectors[i].sector * TRIPLOG_SECTOR_SIZE;
+
+        for(uint32_t slot = 1; slot <= TRIPLOG_RECORDS_PER_SECTOR; slot++)
+        {
+            const triplog_record_t *record = (const triplog_record_t *)(base + slot * TRIPLOG_RECORD_SIZE);
+
+            if(analysis_slot_is_erased((const uint8_t *)record)) //rest of the sector was never written
+                break;
+
+            if(!triplog_record_is_valid(record))
+            {
+                stats->corrupt_records++;
+                continue;
+            }
+
+            stats->records++;
+            analysis_record(&scan, record);
+        }
+    }
+
+    free(sectors);
+    return ESP_OK;
+}
+
+/**
+ * @name analysis_merge
+ *
+ * @brief adds the stats of one unit (or one worker) into a running total
+ *
+ * @param total running total
+ * @param unit stats to add
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void analysis_merge(analysis_stats_t *total, const analysis_stats_t *unit)
+{
+    total->units += unit->units;
+    total->sectors += unit->sectors;
+    total->records += unit->records;
+    total->corrupt_records += unit->corrupt_records;
+    total->sessions += unit->sessions;
+    total->imu_samples += unit->imu_samples;
+    total->gps_fixes += unit->gps_fixes;
+    total->decisions += unit->decisions;
+    total->triggers += unit->triggers;
+    total->logged_triggers += unit->logged_triggers;
+    total->disagreements += unit->disagreements;
+    total->out_of_level_samples += unit->out_of_level_samples;
+    total->out_of_level_ms += unit->out_of_level_ms;
+    total->recorded_ms += unit->recorded_ms;
+    total->max_combined_angle = fmaxf(total->max_combined_angle, unit->max_combined_angle);
+    total->max_speed = fmaxf(total->max_speed, unit->max_speed);
+}
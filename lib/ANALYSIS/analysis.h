@@ -0,0 +1,38 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+#include "triplog.h"
+#include "decision.h"
+
+static const char* ANALYSIS_TAG = "Analysis";
+
+/**
+ * @brief what one trip log (one unit) looks like when judged against a set of limits. Stats of several units can be added up with analysis_merge().
+*/
+typedef struct {
+    uint32_t units; //logs that went into these stats
+    uint32_t sectors; //sectors holding a valid header
+    uint32_t records; //records that passed their CRC
+    uint32_t corrupt_records;
+    uint32_t sessions; //power cycles
+    uint32_t imu_samples; //IMU records and samples unpacked from IMU frames
+    uint32_t gps_fixes;
+    uint32_t decisions;
+    uint32_t triggers; //times the warning would have come on with the limits given
+    uint32_t logged_triggers; //times the warning actually came on on the device
+    uint32_t disagreements; //decisions that came out different from what the device logged
+    uint32_t out_of_level_samples;
+    uint64_t out_of_level_ms; //time the warning would have been on
+    uint64_t recorded_ms; //time covered by decisions
+    float max_combined_angle;
+    float max_speed;
+} analysis_stats_t;
+
+     void analysis_stats_init(analysis_stats_t *);
+esp_err_t analysis_scan_image(const uint8_t *, size_t, const decision_params_t *, analysis_stats_t *);
+     void analysis_merge(analysis_stats_t *, const analysis_stats_t *);
+
+#endif //ANALYSIS_H
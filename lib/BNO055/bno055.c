@@ -2,12 +2,16 @@
 #include <stdio.h>
 #include <string.h> // memset()
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
 #include "driver/i2c.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 
 
 #include "bno055.h"
+#include "trace.h"
 
 typedef enum
 {
@@ -155,20 +159,285 @@ typedef enum
 #define ACK_CHECK_DIS 0x0           // I2C master will not check ack from slave 
 #define ACK_VAL 0x0                 // I2C ack value 
 #define NACK_VAL 0x1                // I2C nack value 
+
+#define I2C_SCLK_HZ (40000000)      // the S3 I2C controller runs off the 40 MHz XTAL
+#define I2C_TIMEOUT_MAX_EXP (22)    // the S3 timeout register holds a power of 2 of I2C_SCLK cycles, 2^22 = 104 ms
+#define I2C_RECOVERY_HALF_PERIOD_US (5) // SCL half period while clocking a stuck bus free, 100 kHz
+
+#define BNO055_SHADOW_REGS (16)     // configuration registers kept in the shadow, see x_shadow_regs
+#define BNO055_SHADOW_PAGE0_REGS (6) // the first ones are page 0 and have known reset values
+#define BNO055_ANY_TO_CONFIG_MS (19) // mode switching times from the datasheet, table 3-6
+#define BNO055_CONFIG_TO_ANY_MS (7)
+#define BNO055_RESET_MS (650)       // power on reset time, the chip doesn't answer until it is done
+#define BNO055_TRIGGER_MS (10)      // settle time after any other SYS_TRIGGER write (clock source switch)
+#define BNO055_SYS_TRIGGER_RST (0x20)
+#define BNO055_SYS_TRIGGER_RST_INT (0x40)
+#define BNO055_ACC_LSB_MG (3.91f)   // any/no motion threshold step at 2G, doubles with each range step
+#define BNO055_SCRIPT_BURST_MAX (16) // most bytes a configuration script writes in one transaction
+#define BNO055_TIMED_READS (16)     // Euler reads BNO055_init_conf() averages at each bus speed
     
 typedef struct
 {
+    i2c_port_t  port;           // I2C port the IMU is on
     bno055_addr_t  i2c_address; // BNO055_ADDRESS_A or BNO055_ADDRESS_B
     bool  bno_is_open;
+    i2c_config_t bus_conf;      // kept to bring the bus back up after recovering it
+    uint32_t timeout_us;
+    TickType_t cmd_timeout_ticks;
+    uint8_t retries;
+    bno055_bus_stats_t stats;
+    uint8_t shadow[BNO055_SHADOW_REGS]; // last value written to or read from each configuration register
+    uint32_t shadow_valid;      // bit per shadow slot, cleared when the register content isn't known
 } bno055_device_t;
 
 
-static bno055_device_t x_bno_dev[I2C_NUM_MAX];
+static bno055_device_t x_bno_dev[I2C_NUMBER_MAX];
+
+static SemaphoreHandle_t x_bus_lock[I2C_NUM_MAX]; // a recovery tears the driver down, nothing else can be on the bus while it does
 
-static uint8_t x_buffer[200];  // we so far are using only 20 bytes max
+// slot 0 has to stay the page register, it is the one register that sits on both pages
+static const uint16_t x_shadow_regs[BNO055_SHADOW_REGS] = {
+    BNO055_CONF_PAGE_ID, BNO055_CONF_UNIT_SEL, BNO055_CONF_OPR_MODE,
+    BNO055_CONF_PWR_MODE, BNO055_CONF_AXIS_MAP_CONFIG, BNO055_CONF_AXIS_MAP_SIGN,
+    BNO055_CONF_ACC_CONFIG, BNO055_CONF_MAG_CONFIG, BNO055_CONF_GYR_CONFIG_0, BNO055_CONF_GYR_CONFIG_1,
+    BNO055_CONF_INT_MSK, BNO055_CONF_INT_EN, BNO055_CONF_ACC_AM_THRES, BNO055_CONF_ACC_INT_SETTINGS,
+    BNO055_CONF_ACC_NM_THRES, BNO055_CONF_ACC_NM_SET
+};
+// page 0 register content after a reset, datasheet table 4-2. Page 1 stays unknown until it is read or written.
+static const uint8_t x_shadow_reset[BNO055_SHADOW_PAGE0_REGS] = {
+    0x00, 0x80, OPERATION_MODE_CONFIG,
+    POWER_MODE_NORMAL, REMAP_CONFIG_P1, REMAP_SIGN_P1
+};
 
 // Internal functions
 
+// bno055_conf_reg_t of a bus address on whatever page is selected, -1 if the page isn't known
+static int bno055_paged_reg(i2c_number_t i2c_num, uint8_t reg){
+
+    bno055_device_t *dev = &x_bno_dev[i2c_num];
+
+    if(reg == BNO055_CONF_PAGE_ID)
+        return reg;
+    if(!(dev->shadow_valid & 1))
+        return -1;
+
+    return dev->shadow[0] ? (reg | BNO055_PAGE_1) : reg;
+}
+
+static int bno055_shadow_slot(int paged_reg){
+
+    for(int i = 0; i < BNO055_SHADOW_REGS; i++) {
+        if(x_shadow_regs[i] == paged_reg)
+            return i;
+    }
+
+    return -1;
+}
+
+static bool bno055_shadow_get(i2c_number_t i2c_num, uint16_t paged_reg, uint8_t *val){
+
+    int slot = bno055_shadow_slot(paged_reg);
+    if(slot < 0 || !(x_bno_dev[i2c_num].shadow_valid & (1UL << slot)))
+        return false;
+
+    *val = x_bno_dev[i2c_num].shadow[slot];
+    return true;
+}
+
+static void bno055_shadow_set(i2c_number_t i2c_num, int paged_reg, uint8_t val){
+
+    int slot = bno055_shadow_slot(paged_reg);
+    if(slot < 0)
+        return;
+
+    x_bno_dev[i2c_num].shadow[slot] = val;
+    x_bno_dev[i2c_num].shadow_valid |= 1UL << slot;
+}
+
+static void bno055_shadow_reset(i2c_number_t i2c_num){
+
+    memcpy(x_bno_dev[i2c_num].shadow, x_shadow_reset, BNO055_SHADOW_PAGE0_REGS);
+    x_bno_dev[i2c_num].shadow_valid = (1UL << BNO055_SHADOW_PAGE0_REGS) - 1;
+}
+
+// keeps the shadow in step with a write of n_bytes starting at start_reg, a failed write leaves the registers unknown
+static void bno055_shadow_written(i2c_number_t i2c_num, uint8_t start_reg, const uint8_t *buffer, uint8_t n_bytes, esp_err_t err){
+
+    if(err != ESP_OK) {
+        x_bno_dev[i2c_num].shadow_valid = 0;
+        return;
+    }
+
+    for(int i = 0; i < n_bytes; i++) {
+        int paged_reg = bno055_paged_reg(i2c_num, start_reg + i);
+        if(paged_reg == BNO055_CONF_SYS_TRIGGER && (buffer[i] & BNO055_SYS_TRIGGER_RST))
+            bno055_shadow_reset(i2c_num);
+        else
+            bno055_shadow_set(i2c_num, paged_reg, buffer[i]);
+    }
+}
+
+// The bus lock is recursive so a configuration script can hold it across its page switches and bursts, with every
+// transaction inside still taking it. The shadow is only read or changed with the lock held.
+static void bno055_lock(i2c_number_t i2c_num){
+
+    xSemaphoreTakeRecursive(x_bus_lock[x_bno_dev[i2c_num].port], portMAX_DELAY);
+}
+
+static void bno055_unlock(i2c_number_t i2c_num){
+
+    xSemaphoreGiveRecursive(x_bus_lock[x_bno_dev[i2c_num].port]);
+}
+
+// vTaskDelay() can come back early by up to a tick, round up so the BNO055 always gets at least ms
+static void bno055_delay_ms(uint32_t ms){
+
+    vTaskDelay(ms / portTICK_PERIOD_MS + 1);
+}
+
+// The timeout is a power of 2 of source clock cycles on the S3, not a cycle count. Rounds up so the BNO055 always gets at
+// least timeout_us to stretch the clock.
+static esp_err_t bno055_set_stretch_timeout(i2c_port_t port, uint32_t timeout_us){
+
+    uint64_t cycles = (uint64_t)timeout_us * (I2C_SCLK_HZ / 1000000);
+    int exp = 1;
+
+    while(exp < I2C_TIMEOUT_MAX_EXP && (1ULL << exp) < cycles)
+        exp++;
+
+    esp_err_t err = i2c_set_timeout(port, exp);
+    ESP_LOGD(BNO055_TAG, "i2c_set_timeout(%d) returned %s", exp, esp_err_to_name(err));
+    return err;
+}
+
+static esp_err_t bno055_bus_install(i2c_number_t i2c_num){
+
+    bno055_device_t *dev = &x_bno_dev[i2c_num];
+    esp_err_t err;
+
+    err = i2c_param_config(dev->port, &dev->bus_conf);
+    ESP_LOGD(BNO055_TAG, "i2c_param_config() returned %s", esp_err_to_name(err));
+    if( err != ESP_OK ) return err;
+        
+    err = i2c_driver_install(dev->port, I2C_MODE_MASTER,
+                              I2C_MASTER_RX_BUF_DISABLE,
+                              I2C_MASTER_TX_BUF_DISABLE, 0);
+    ESP_LOGD(BNO055_TAG, "i2c_driver_install() returned %s", esp_err_to_name(err));
+    if( err != ESP_OK ) return err;
+
+    return bno055_set_stretch_timeout(dev->port, dev->timeout_us);
+}
+
+// A BNO055 cut off in the middle of a read keeps driving SDA low until it has shifted out the rest of its byte.
+// Clock SCL by hand until it lets go (9 clocks at most), send a STOP and bring the driver back up.
+static esp_err_t bno055_bus_recover(i2c_number_t i2c_num){
+
+    bno055_device_t *dev = &x_bno_dev[i2c_num];
+    gpio_num_t sda = dev->bus_conf.sda_io_num, scl = dev->bus_conf.scl_io_num;
+    esp_err_t err;
+
+    dev->stats.recoveries++;
+    ESP_LOGW(BNO055_TAG, "bno055_bus_recover(): I2C port %d timed out, clocking the bus free", dev->port);
+
+    // a hung bus can mean an IMU browned out and came back with its reset values, stop trusting the shadows
+    for(i2c_number_t i = 0; i < I2C_NUMBER_MAX; i++) {
+        if(x_bno_dev[i].port == dev->port)
+            x_bno_dev[i].shadow_valid = 0;
+    }
+
+    i2c_driver_delete(dev->port);
+
+    gpio_set_level(sda, 1);
+    gpio_set_level(scl, 1);
+    gpio_set_direction(sda, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_direction(scl, GPIO_MODE_INPUT_OUTPUT_OD);
+    esp_rom_delay_us(I2C_RECOVERY_HALF_PERIOD_US);
+
+    for(int i = 0; i < 9 && gpio_get_level(sda) == 0; i++) {
+        gpio_set_level(scl, 0);
+        esp_rom_delay_us(I2C_RECOVERY_HALF_PERIOD_US);
+        gpio_set_level(scl, 1);
+        esp_rom_delay_us(I2C_RECOVERY_HALF_PERIOD_US);
+    }
+
+    // STOP: SDA rises while SCL is high
+    gpio_set_level(scl, 0);
+    esp_rom_delay_us(I2C_RECOVERY_HALF_PERIOD_US);
+    gpio_set_level(sda, 0);
+    esp_rom_delay_us(I2C_RECOVERY_HALF_PERIOD_US);
+    gpio_set_level(scl, 1);
+    esp_rom_delay_us(I2C_RECOVERY_HALF_PERIOD_US);
+    gpio_set_level(sda, 1);
+    esp_rom_delay_us(I2C_RECOVERY_HALF_PERIOD_US);
+
+    bool released = gpio_get_level(sda) == 1;
+
+    if((err = bno055_bus_install(i2c_num)) != ESP_OK) {
+        ESP_LOGE(BNO055_TAG, "bno055_bus_recover(): bno055_bus_install returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if(!released) {
+        ESP_LOGE(BNO055_TAG, "bno055_bus_recover(): SDA still held low");
+        return BNO_ERR_BUS_STUCK;
+    }
+
+    return ESP_OK;
+}
+
+// brings the port back up at another SCL speed, the IMU's registers are left as they are
+static esp_err_t bno055_bus_set_speed(i2c_number_t i2c_num, uint32_t clk_speed){
+
+    bno055_device_t *dev = &x_bno_dev[i2c_num];
+
+    bno055_lock(i2c_num);
+    i2c_driver_delete(dev->port);
+    dev->bus_conf.master.clk_speed = clk_speed;
+    esp_err_t err = bno055_bus_install(i2c_num);
+    bno055_unlock(i2c_num);
+
+    return err;
+}
+
+// Runs a command on the IMU's bus. A NACK is tried again straight away, a timeout means the bus is stuck and it is recovered first.
+static esp_err_t bno055_cmd_begin(i2c_number_t i2c_num, i2c_cmd_handle_t cmd, trace_point_t point, uint8_t reg){
+
+    bno055_device_t *dev = &x_bno_dev[i2c_num];
+    esp_err_t err = ESP_FAIL;
+
+    bno055_lock(i2c_num);
+
+    for(int attempt = 0; attempt <= dev->retries; attempt++) {
+
+        if(attempt > 0)
+            dev->stats.retries++;
+
+        int64_t start = esp_timer_get_time();
+        trace_begin(point, reg);
+        err = i2c_master_cmd_begin(dev->port, cmd, dev->cmd_timeout_ticks);
+        trace_end(point, err);
+        uint32_t elapsed_us = esp_timer_get_time() - start;
+
+        dev->stats.transactions++;
+        dev->stats.total_us += elapsed_us;
+        if(elapsed_us > dev->stats.max_us)
+            dev->stats.max_us = elapsed_us;
+
+        if(err == ESP_OK)
+            break;
+
+        if(err == ESP_ERR_TIMEOUT && bno055_bus_recover(i2c_num) != ESP_OK)
+            break;
+    }
+
+    if(err != ESP_OK)
+        dev->stats.failures++;
+
+    bno055_unlock(i2c_num);
+
+    return err;
+}
+
 // _______________________________________________________________________
 // | start | write chip_addr + wr_bit, chk_ack | write reg_addr, chk_ack |
 // --------|-----------------------------------|-------------------------|
@@ -199,7 +468,11 @@ esp_err_t bno055_read_register(i2c_number_t i2c_num, bno055_reg_t reg, uint8_t *
     // making the command - end 
     
     // Now execute the command
-    esp_err_t err = i2c_master_cmd_begin(i2c_num, cmd, 1000 / portTICK_PERIOD_MS);
+    bno055_lock(i2c_num);
+    esp_err_t err = bno055_cmd_begin(i2c_num, cmd, TRACE_I2C_READ, reg);
+    if(err == ESP_OK)
+        bno055_shadow_set(i2c_num, bno055_paged_reg(i2c_num, reg), *p_reg_val);
+    bno055_unlock(i2c_num);
     
     i2c_cmd_link_delete(cmd);
     
@@ -241,7 +514,10 @@ esp_err_t bno055_read_register(i2c_number_t i2c_num, bno055_reg_t reg, uint8_t *
     // making the command - end 
     
     // Now execute the command
-    esp_err_t err = i2c_master_cmd_begin(i2c_num, cmd, 1000 / portTICK_PERIOD_MS);
+    bno055_lock(i2c_num);
+    esp_err_t err = bno055_cmd_begin(i2c_num, cmd, TRACE_I2C_WRITE, reg);
+    bno055_shadow_written(i2c_num, reg, &reg_val, 1, err);
+    bno055_unlock(i2c_num);
     
     i2c_cmd_link_delete(cmd);
     
@@ -258,6 +534,52 @@ esp_err_t bno055_read_register(i2c_number_t i2c_num, bno055_reg_t reg, uint8_t *
     return err;   
 }
  
+// __________________________________________________________________________________________________________
+// | start | write chip_addr + wr_bit, chk_ack | write reg_addr, chk_ack | write n bytes, chk_ack each | stop |
+// --------|-----------------------------------|-------------------------|-----------------------------|------|
+// the BNO055 increments the register address after every byte, so consecutive registers go in one transaction
+
+static esp_err_t bno055_write_data(i2c_number_t i2c_num, uint8_t start_reg, const uint8_t *buffer, uint8_t n_bytes){
+    
+    if( !x_bno_dev[i2c_num].bno_is_open) {
+        ESP_LOGE(BNO055_TAG, "bno055_write_data(): device is not open");
+        return BNO_ERR_NOT_OPEN;
+    }
+    
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    
+    // making the command - begin 
+    i2c_master_start(cmd);  // start condition
+    // device address with write bit
+    i2c_master_write_byte(cmd, (x_bno_dev[i2c_num].i2c_address << 1) | WRITE_BIT, ACK_CHECK_EN); 
+    // send the register address
+    i2c_master_write_byte(cmd, start_reg, ACK_CHECK_EN);   
+    // write the bytes, check ACK on each
+    i2c_master_write(cmd, buffer, n_bytes, ACK_CHECK_EN); 
+    i2c_master_stop(cmd);  // stop condition
+    // making the command - end 
+    
+    // Now execute the command
+    bno055_lock(i2c_num);
+    esp_err_t err = bno055_cmd_begin(i2c_num, cmd, TRACE_I2C_WRITE, start_reg);
+    bno055_shadow_written(i2c_num, start_reg, buffer, n_bytes, err);
+    bno055_unlock(i2c_num);
+    
+    i2c_cmd_link_delete(cmd);
+    
+    switch (err) {
+        case ESP_OK: 
+            break;
+        case  ESP_ERR_TIMEOUT:
+            ESP_LOGE(BNO055_TAG, "bno055_write_data(): i2c timeout");
+            break;
+        default: 
+            ESP_LOGE(BNO055_TAG, "bno055_write_data(): failed");
+    }
+    
+    return err;   
+}
+ 
 // _______________________________________________________________________
 // | start | write chip_addr + wr_bit, chk_ack | write reg_addr, chk_ack |
 // --------|-----------------------------------|-------------------------|
@@ -296,7 +618,7 @@ esp_err_t bno055_read_data(i2c_number_t i2c_num, bno055_reg_t start_reg, uint8_t
     // making the command - end 
 
     // Now execute the command
-    esp_err_t err = i2c_master_cmd_begin(i2c_num, cmd, 1000 / portTICK_PERIOD_MS);
+    esp_err_t err = bno055_cmd_begin(i2c_num, cmd, TRACE_I2C_READ, start_reg);
     
     i2c_cmd_link_delete(cmd);
     
@@ -314,17 +636,63 @@ esp_err_t bno055_read_data(i2c_number_t i2c_num, bno055_reg_t start_reg, uint8_t
 }
 
 
+// true if an IMU other than i2c_num is open on the port, the I2C driver is installed once per port and shared
+static bool bno055_port_in_use(i2c_number_t i2c_num, i2c_port_t port){
+
+    for(i2c_number_t i = 0; i < I2C_NUMBER_MAX; i++) {
+        if(i != i2c_num && x_bno_dev[i].bno_is_open && x_bno_dev[i].port == port)
+            return true;
+    }
+
+    return false;
+}
+
+// mean time of an Euler read with the bus at clk_speed, the bus is left at that speed
+static esp_err_t bno055_time_euler_reads(i2c_number_t i2c_num, uint32_t clk_speed, uint32_t *mean_us){
+
+    bno055_vec3_t euler;
+    esp_err_t err;
+
+    if((err = bno055_bus_set_speed(i2c_num, clk_speed)) != ESP_OK)
+        return err;
+
+    int64_t start = esp_timer_get_time();
+    for(int i = 0; i < BNO055_TIMED_READS; i++) {
+        if((err = bno055_get_euler(i2c_num, &euler)) != ESP_OK)
+            return err;
+    }
+    *mean_us = (esp_timer_get_time() - start) / BNO055_TIMED_READS;
+
+    return ESP_OK;
+}
+
+
+static esp_err_t bno055_select_page(i2c_number_t i2c_num, uint8_t page){
+
+    uint8_t current;
+    if(bno055_shadow_get(i2c_num, BNO055_CONF_PAGE_ID, &current) && current == page) {
+        x_bno_dev[i2c_num].stats.shadow_hits++;
+        return ESP_OK;
+    }
+
+    return bno055_write_register(i2c_num, BNO055_PAGE_ID_ADDR, page);
+}
+
+
 // Public functions
 
 esp_err_t bno055_set_default_conf(bno055_config_t * p_bno_conf){
 
+    p_bno_conf->i2c_port = I2C_NUM_0;                    // I2C port the IMU is wired to
     p_bno_conf->i2c_address = BNO055_ADDRESS_A;          // BNO055_ADDRESS_A or BNO055_ADDRESS_B 
     p_bno_conf->sda_io_num = 8;        // GPIO number for I2C sda signal 25
     p_bno_conf->sda_pullup_en = GPIO_PULLUP_ENABLE;  // Internal GPIO pull mode for I2C sda signal
     p_bno_conf->scl_io_num = 9;        // GPIO number for I2C scl signal 26 
     p_bno_conf->scl_pullup_en = GPIO_PULLUP_ENABLE;  // Internal GPIO pull mode for I2C scl signal
-    p_bno_conf->clk_speed = 100000;     // I2C clock frequency for master mode, (no higher than 1MHz for now) 
-    p_bno_conf->timeout = 10*1000*80;     // 10ms in 80 MHz ticks, should be < 0xFFFFF
+    p_bno_conf->clk_speed = 400000;     // I2C clock frequency for master mode, (no higher than 1MHz for now) 
+    p_bno_conf->timeout_us = 10*1000;     // 10ms of clock stretching, the BNO055 stretches while its fusion core is busy
+    p_bno_conf->cmd_timeout_ms = 20;      // a 20 byte read takes under 1 ms at 400 kHz
+    p_bno_conf->retries = 2;
     p_bno_conf->use_ext_oscillator = false; // Use external oscillator
 
     return ESP_OK;   
@@ -334,7 +702,7 @@ esp_err_t bno055_set_default_conf(bno055_config_t * p_bno_conf){
 
 esp_err_t bno055_open(i2c_number_t i2c_num, bno055_config_t * p_bno_conf )
 {
-    if(i2c_num >= I2C_NUMBER_MAX) return ESP_ERR_INVALID_ARG;
+    if(i2c_num >= I2C_NUMBER_MAX || p_bno_conf->i2c_port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
     
     // Check if already in use
     if(x_bno_dev[i2c_num].bno_is_open) {
@@ -343,39 +711,49 @@ esp_err_t bno055_open(i2c_number_t i2c_num, bno055_config_t * p_bno_conf )
     }
     
     x_bno_dev[i2c_num].bno_is_open = 0;
-
-    i2c_config_t conf;
-    conf.mode = I2C_MODE_MASTER;
-    conf.sda_io_num = p_bno_conf->sda_io_num;        
-    conf.sda_pullup_en = p_bno_conf->sda_pullup_en;  
-    conf.scl_io_num = p_bno_conf->scl_io_num;        
-    conf.scl_pullup_en = p_bno_conf->scl_pullup_en;  
-    conf.master.clk_speed = p_bno_conf->clk_speed;
-    conf.clk_flags = 0;
+    x_bno_dev[i2c_num].shadow_valid = 0;
+
+    i2c_config_t *conf = &x_bno_dev[i2c_num].bus_conf;
+    memset(conf, 0, sizeof(i2c_config_t));
+    conf->mode = I2C_MODE_MASTER;
+    conf->sda_io_num = p_bno_conf->sda_io_num;        
+    conf->sda_pullup_en = p_bno_conf->sda_pullup_en;  
+    conf->scl_io_num = p_bno_conf->scl_io_num;        
+    conf->scl_pullup_en = p_bno_conf->scl_pullup_en;  
+    conf->master.clk_speed = p_bno_conf->clk_speed;
+    conf->clk_flags = 0;
+
+    x_bno_dev[i2c_num].port = p_bno_conf->i2c_port;
+    x_bno_dev[i2c_num].i2c_address = p_bno_conf->i2c_address;
+    x_bno_dev[i2c_num].timeout_us = p_bno_conf->timeout_us;
+    x_bno_dev[i2c_num].cmd_timeout_ticks = pdMS_TO_TICKS(p_bno_conf->cmd_timeout_ms) > 0 ? pdMS_TO_TICKS(p_bno_conf->cmd_timeout_ms) : 1;
+    x_bno_dev[i2c_num].retries = p_bno_conf->retries;
+    memset(&x_bno_dev[i2c_num].stats, 0, sizeof(bno055_bus_stats_t));
     
     esp_err_t err;
-    
-    err = i2c_param_config(i2c_num, &conf);
-    ESP_LOGD(BNO055_TAG, "i2c_param_config() returned %s", esp_err_to_name(err));
-    if( err != ESP_OK ) return err;
-        
-    err = i2c_driver_install(i2c_num, I2C_MODE_MASTER,
-                              I2C_MASTER_RX_BUF_DISABLE,
-                              I2C_MASTER_TX_BUF_DISABLE, 0);
-    ESP_LOGD(BNO055_TAG, "i2c_driver_install() returned %s", esp_err_to_name(err));
-    if( err != ESP_OK ) return err;
-    
-    /*//CAUSES CHIP TO ERROR OUT
-    err = i2c_set_timeout(i2c_num, p_bno_conf->timeout);
-    ESP_LOGD(BNO055_TAG, "i2c_set_timeout() returned %s", esp_err_to_name(err));
-    if( err != ESP_OK ) return err;*/
 
-    x_bno_dev[i2c_num].i2c_address = p_bno_conf->i2c_address;
+    if(x_bus_lock[p_bno_conf->i2c_port] == NULL && (x_bus_lock[p_bno_conf->i2c_port] = xSemaphoreCreateRecursiveMutex()) == NULL)
+        return ESP_ERR_NO_MEM;
+    
+    // second IMU on a bus that is already running, the bus settings of the first one stay
+    if(bno055_port_in_use(i2c_num, p_bno_conf->i2c_port)) {
+        ESP_LOGD(BNO055_TAG, "bno055_open(): I2C port %d already set up, sharing it", p_bno_conf->i2c_port);
+    }
+    else {
+        // timeout is set in bno055_bus_install() as a power of 2 of clock cycles, handing it a cycle count is what used to error out
+        err = bno055_bus_install(i2c_num);
+        if( err != ESP_OK ) return err;
+    }
     
     // Read BNO055 Chip ID to make sure we have a connection
     x_bno_dev[i2c_num].bno_is_open = 1; // bno055_read_register() checks this flag
     uint8_t reg_val;
     vTaskDelay(850/ portTICK_PERIOD_MS); //Initial bootup can take 850ms apparently
+
+    // the MCU can restart without the IMU, which may still be on page 1
+    err = bno055_select_page(i2c_num, 0);
+    if(err != ESP_OK) goto errExit;
+
     err = bno055_read_register(i2c_num, BNO055_CHIP_ID_ADDR, & reg_val);
     
     if( err == ESP_OK ) {
@@ -391,33 +769,19 @@ esp_err_t bno055_open(i2c_number_t i2c_num, bno055_config_t * p_bno_conf )
     }
     
     
-     // Switch to config mode
-    err = bno055_write_register(i2c_num, BNO055_OPR_MODE_ADDR, OPERATION_MODE_CONFIG);
+    // Config mode, reset, normal power mode and the oscillator. Normal power is the reset value so the shadow skips it,
+    // the ext oscillator entry is left off the end of the script when it isn't used.
+    bno055_reg_write_t open_script[] = {
+        { BNO055_CONF_OPR_MODE, OPERATION_MODE_CONFIG },
+        { BNO055_CONF_SYS_TRIGGER, BNO055_SYS_TRIGGER_RST },
+        { BNO055_CONF_PWR_MODE, POWER_MODE_NORMAL },
+        { BNO055_CONF_SYS_TRIGGER, 0x80 },
+    };
+    err = bno055_run_script(i2c_num, open_script, p_bno_conf->use_ext_oscillator ? 4 : 3);
     if(err != ESP_OK) goto errExit;
-    vTaskDelay(30 / portTICK_PERIOD_MS);
-    ESP_LOGD(BNO055_TAG, "Set config oper. mode - Ok");
-
-    // Reset
-    err=bno055_write_register(i2c_num, BNO055_SYS_TRIGGER_ADDR, 0x20 );
-    if(err != ESP_OK) goto errExit;
-    vTaskDelay(700 / portTICK_PERIOD_MS);
-    ESP_LOGD(BNO055_TAG, "BNO055 reset - Ok");
-
-    // Set ext oscillator
-    if(p_bno_conf->use_ext_oscillator) {
-    	err=bno055_write_register(i2c_num, BNO055_SYS_TRIGGER_ADDR, 0x80);
-        if(err != ESP_OK) goto errExit;
-        vTaskDelay(20 / portTICK_PERIOD_MS);
-    }
-    ESP_LOGD(BNO055_TAG, "Set external oscillator - Ok");
+    ESP_LOGD(BNO055_TAG, "Reset, normal power mode, ext oscillator %d - Ok", p_bno_conf->use_ext_oscillator);
     
     // TODO: turn off sleep mode
-    
-    // Set power mode to normal 
-    err=bno055_write_register(i2c_num, BNO055_PWR_MODE_ADDR, POWER_MODE_NORMAL);
-    if(err != ESP_OK) goto errExit;
-    vTaskDelay(20 / portTICK_PERIOD_MS);
-    ESP_LOGD(BNO055_TAG, "Set normal power mode - Ok");
 
     return ESP_OK;   
     
@@ -431,23 +795,30 @@ errExit:
 esp_err_t bno055_close (i2c_number_t i2c_num )
 {
     x_bno_dev[i2c_num].bno_is_open = 0;
-    return i2c_driver_delete(i2c_num);
+
+    // leave the driver alone while the other IMU on the bus is still using it
+    if(bno055_port_in_use(i2c_num, x_bno_dev[i2c_num].port))
+        return ESP_OK;
+
+    return i2c_driver_delete(x_bno_dev[i2c_num].port);
   
 }
 
 esp_err_t bno055_get_chip_info(i2c_number_t i2c_num, bno055_chip_info_t* chip_inf){
     
+    uint8_t buffer[7];
+
     memset(chip_inf, 0, sizeof(bno055_chip_info_t));
     
-    esp_err_t err = bno055_read_data(i2c_num, BNO055_CHIP_ID_ADDR, x_buffer, 7);
+    esp_err_t err = bno055_read_data(i2c_num, BNO055_CHIP_ID_ADDR, buffer, 7);
     if( err != ESP_OK ) return err;
     
-    chip_inf->chip_id = x_buffer[0];
-    chip_inf->accel_id = x_buffer[1];
-    chip_inf->mag_id = x_buffer[2];
-    chip_inf->gyro_id = x_buffer[3];
-    chip_inf->sw_rev = x_buffer[4] + ((uint16_t)x_buffer[5]<<8);
-    chip_inf->bl_rev = x_buffer[6];
+    chip_inf->chip_id = buffer[0];
+    chip_inf->accel_id = buffer[1];
+    chip_inf->mag_id = buffer[2];
+    chip_inf->gyro_id = buffer[3];
+    chip_inf->sw_rev = buffer[4] + ((uint16_t)buffer[5]<<8);
+    chip_inf->bl_rev = buffer[6];
     
     return ESP_OK;
 }   
@@ -465,8 +836,15 @@ void bno055_displ_chip_info(bno055_chip_info_t chip_inf){
 
 esp_err_t bno055_set_opmode(i2c_number_t i2c_num, bno055_opmode_t mode ){
     
+    uint8_t current;
+    if(bno055_shadow_get(i2c_num, BNO055_OPR_MODE_ADDR, &current) && (current & 0x0F) == mode) {
+        x_bno_dev[i2c_num].stats.shadow_hits++;
+        return ESP_OK;
+    }
+
     esp_err_t err=bno055_write_register(i2c_num, BNO055_OPR_MODE_ADDR, mode);
-    vTaskDelay(30 / portTICK_PERIOD_MS);
+    if(err == ESP_OK)
+        bno055_delay_ms(mode == OPERATION_MODE_CONFIG ? BNO055_ANY_TO_CONFIG_MS : BNO055_CONFIG_TO_ANY_MS);
     return err;
 }
 
@@ -474,12 +852,142 @@ esp_err_t bno055_set_opmode(i2c_number_t i2c_num, bno055_opmode_t mode ){
 esp_err_t bno055_get_opmode(i2c_number_t i2c_num, bno055_opmode_t * mode ){
     
     uint8_t ui_mode;
-    esp_err_t err = bno055_read_register(i2c_num, BNO055_OPR_MODE_ADDR, &ui_mode);
+    esp_err_t err = ESP_OK;
+    if(bno055_shadow_get(i2c_num, BNO055_OPR_MODE_ADDR, &ui_mode))
+        x_bno_dev[i2c_num].stats.shadow_hits++;
+    else
+        err = bno055_read_register(i2c_num, BNO055_OPR_MODE_ADDR, &ui_mode);
     ui_mode = ui_mode & 0x0F; // upper 4 bits are reserved, lower 4 represent the mode
     * mode = ui_mode;
     return err;
 }
 
+// Note: switches to config mode and back
+esp_err_t bno055_set_powermode(i2c_number_t i2c_num, bno055_powermode_t mode ){
+
+    bno055_reg_write_t script = { BNO055_CONF_PWR_MODE, mode };
+    return bno055_run_script(i2c_num, &script, 1);
+}
+
+// the writes of bno055_run_script(), with the bus lock already held
+static esp_err_t bno055_script_steps(i2c_number_t i2c_num, const bno055_reg_write_t* script, size_t n_writes){
+
+    bno055_device_t *dev = &x_bno_dev[i2c_num];
+    bno055_opmode_t target_mode;
+    bool needs_config = false;
+    uint8_t val;
+    esp_err_t err;
+
+    if((err = bno055_get_opmode(i2c_num, &target_mode)) != ESP_OK) {
+        ESP_LOGD(BNO055_TAG, "bno055_run_script(): bno055_get_opmode returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // only OPR_MODE, the page and the interrupt enables can be written outside of CONFIGMODE
+    for(size_t i = 0; i < n_writes; i++) {
+        if(script[i].reg == BNO055_CONF_OPR_MODE)
+            target_mode = script[i].val & 0x0F;
+        else if(script[i].reg != BNO055_CONF_PAGE_ID && script[i].reg != BNO055_CONF_INT_MSK && script[i].reg != BNO055_CONF_INT_EN
+                && !(bno055_shadow_get(i2c_num, script[i].reg, &val) && val == script[i].val))
+            needs_config = true;
+    }
+
+    if(needs_config && (err = bno055_set_opmode(i2c_num, OPERATION_MODE_CONFIG)) != ESP_OK) {
+        ESP_LOGD(BNO055_TAG, "bno055_run_script(): bno055_set_opmode returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    uint8_t burst[BNO055_SCRIPT_BURST_MAX];
+    uint16_t start_reg = 0;
+    uint8_t n_burst = 0;
+
+    for(size_t i = 0; i <= n_writes; i++) {
+
+        bool last = i == n_writes;
+
+        if(!last && script[i].reg == BNO055_CONF_OPR_MODE)
+            continue;
+
+        // send what has been gathered once the next write can't extend it, a SYS_TRIGGER write always ends a burst
+        // since the chip needs time before it takes anything else
+        if(n_burst > 0 && (last || script[i].reg != start_reg + n_burst || n_burst == BNO055_SCRIPT_BURST_MAX
+                           || start_reg + n_burst - 1 == BNO055_CONF_SYS_TRIGGER)) {
+
+            if((err = bno055_select_page(i2c_num, start_reg >> 8)) != ESP_OK) {
+                ESP_LOGD(BNO055_TAG, "bno055_run_script(): bno055_select_page returned %s", esp_err_to_name(err));
+                return err;
+            }
+
+            if((err = bno055_write_data(i2c_num, start_reg & 0xFF, burst, n_burst)) != ESP_OK) {
+                ESP_LOGD(BNO055_TAG, "bno055_run_script(): bno055_write_data returned %s", esp_err_to_name(err));
+                return err;
+            }
+
+            if(start_reg + n_burst - 1 == BNO055_CONF_SYS_TRIGGER)
+                bno055_delay_ms(burst[n_burst - 1] & BNO055_SYS_TRIGGER_RST ? BNO055_RESET_MS : BNO055_TRIGGER_MS);
+
+            n_burst = 0;
+        }
+
+        if(last)
+            break;
+
+        // a redundant write is still sent when it sits inside a burst, one more byte is cheaper than another transaction
+        if(script[i].reg != BNO055_CONF_SYS_TRIGGER && bno055_shadow_get(i2c_num, script[i].reg, &val)
+           && val == script[i].val && n_burst == 0) {
+            dev->stats.shadow_hits++;
+            continue;
+        }
+
+        if(n_burst == 0)
+            start_reg = script[i].reg;
+        burst[n_burst++] = script[i].val;
+    }
+
+    // everything outside of the scripts reads page 0
+    if((err = bno055_select_page(i2c_num, 0)) != ESP_OK) {
+        ESP_LOGD(BNO055_TAG, "bno055_run_script(): bno055_select_page returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if((err = bno055_set_opmode(i2c_num, target_mode)) != ESP_OK) {
+        ESP_LOGD(BNO055_TAG, "bno055_run_script(): bno055_set_opmode returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @name bno055_run_script
+ * 
+ * @brief applies a list of configuration register writes in as few transactions as it can. Writes that match the shadow
+ * are dropped, writes to consecutive registers go out as one burst and the IMU is only put in CONFIGMODE if something
+ * left needs it. An OPR_MODE entry is the mode the IMU is left in afterwards, without one it goes back to the mode it was in.
+ * Only the mode switch and SYS_TRIGGER delays from the datasheet are waited out. The bus lock is held from the first
+ * transaction to the page 0 restore, so no other read on the port lands while page 1 is selected.
+ * 
+ * @param i2c_num IMU to configure
+ * @param script writes in the order they have to happen
+ * @param n_writes number of entries in script
+ * 
+ * @return esp_err_t
+ * 
+ * @author Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t bno055_run_script(i2c_number_t i2c_num, const bno055_reg_write_t* script, size_t n_writes){
+
+    if(i2c_num >= I2C_NUMBER_MAX) return BNO_ERR_NOT_IN_RANGE;
+    if(!x_bno_dev[i2c_num].bno_is_open) return BNO_ERR_NOT_OPEN;
+
+    bno055_lock(i2c_num);
+    esp_err_t err = bno055_script_steps(i2c_num, script, n_writes);
+    bno055_unlock(i2c_num);
+
+    return err;
+}
+
 // Note: should be in config mode to work!
 esp_err_t bno055_set_ext_crystal_use(i2c_number_t i2c_num, bool use_ext ){
     
@@ -502,6 +1010,168 @@ esp_err_t bno055_set_ext_crystal_use(i2c_number_t i2c_num, bool use_ext ){
     return err;
 }
 
+// Maps the sensor axes onto the way the board is mounted, placements P0-P7 are in the datasheet section 3.4. Done in the
+// chip so every output (euler, quaternion, gravity) comes out in the mounted frame at no cost per sample.
+esp_err_t bno055_set_axis_remap(i2c_number_t i2c_num, bno055_axis_remap_config_t remap_config, bno055_axis_remap_sign_t remap_sign){
+
+    bno055_reg_write_t script[] = {
+        { BNO055_CONF_AXIS_MAP_CONFIG, remap_config },
+        { BNO055_CONF_AXIS_MAP_SIGN, remap_sign },
+    };
+
+    return bno055_run_script(i2c_num, script, 2);
+}
+
+esp_err_t bno055_get_axis_remap(i2c_number_t i2c_num, bno055_axis_remap_config_t* remap_config, bno055_axis_remap_sign_t* remap_sign){
+
+    esp_err_t err;
+    uint8_t map_config, map_sign;
+
+    if(!bno055_shadow_get(i2c_num, BNO055_CONF_AXIS_MAP_CONFIG, &map_config)
+       && (err = bno055_read_register(i2c_num, BNO055_AXIS_MAP_CONFIG_ADDR, &map_config)) != ESP_OK)
+        return err;
+    if(!bno055_shadow_get(i2c_num, BNO055_CONF_AXIS_MAP_SIGN, &map_sign)
+       && (err = bno055_read_register(i2c_num, BNO055_AXIS_MAP_SIGN_ADDR, &map_sign)) != ESP_OK)
+        return err;
+
+    *remap_config = map_config & 0x3F;
+    *remap_sign = map_sign & 0x07;
+    return ESP_OK;
+}
+
+// reads the sensor settings from the chip, not the shadow. The page 1 shadow picks them up on the way, the bus lock is held
+// until the chip is back on page 0.
+esp_err_t bno055_get_sensor_conf(i2c_number_t i2c_num, bno055_sensor_conf_t* conf){
+
+    esp_err_t err;
+    uint8_t buffer[4];
+
+    if(i2c_num >= I2C_NUMBER_MAX) return BNO_ERR_NOT_IN_RANGE;
+    if(!x_bno_dev[i2c_num].bno_is_open) return BNO_ERR_NOT_OPEN;
+
+    bno055_lock(i2c_num);
+
+    if((err = bno055_select_page(i2c_num, 1)) != ESP_OK) {
+        bno055_unlock(i2c_num);
+        ESP_LOGD(BNO055_TAG, "bno055_get_sensor_conf(): bno055_select_page returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = bno055_read_data(i2c_num, BNO055_CONF_ACC_CONFIG & 0xFF, buffer, 4);
+
+    // back to page 0 even if the read failed
+    esp_err_t page_err = bno055_select_page(i2c_num, 0);
+    if(err == ESP_OK)
+        err = page_err;
+    if(err == ESP_OK) {
+        for(int i = 0; i < 4; i++)
+            bno055_shadow_set(i2c_num, BNO055_CONF_ACC_CONFIG + i, buffer[i]);
+    }
+
+    bno055_unlock(i2c_num);
+
+    if(err != ESP_OK) {
+        ESP_LOGD(BNO055_TAG, "bno055_get_sensor_conf(): returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    conf->acc_range = buffer[0] & 0x03;
+    conf->acc_bw = (buffer[0] >> 2) & 0x07;
+    conf->acc_pwr = (buffer[0] >> 5) & 0x07;
+    conf->mag_rate = buffer[1] & 0x07;
+    conf->mag_opr = (buffer[1] >> 3) & 0x03;
+    conf->mag_pwr = (buffer[1] >> 5) & 0x03;
+    conf->gyr_range = buffer[2] & 0x07;
+    conf->gyr_bw = (buffer[2] >> 3) & 0x07;
+    conf->gyr_pwr = buffer[3] & 0x07;
+
+    return ESP_OK;
+}
+
+// Note: the fusion modes ignore these, see bno055_sensor_conf_t
+esp_err_t bno055_set_sensor_conf(i2c_number_t i2c_num, const bno055_sensor_conf_t* conf){
+
+    bno055_reg_write_t script[] = {
+        { BNO055_CONF_ACC_CONFIG, conf->acc_range | conf->acc_bw << 2 | conf->acc_pwr << 5 },
+        { BNO055_CONF_MAG_CONFIG, conf->mag_rate | conf->mag_opr << 3 | conf->mag_pwr << 5 },
+        { BNO055_CONF_GYR_CONFIG_0, conf->gyr_range | conf->gyr_bw << 3 },
+        { BNO055_CONF_GYR_CONFIG_1, conf->gyr_pwr },
+    };
+
+    return bno055_run_script(i2c_num, script, sizeof(script) / sizeof(script[0]));
+}
+
+/**
+ * @name bno055_set_motion_int
+ * 
+ * @brief sets up the accelerometer any motion and no motion interrupts and routes them to the INT pin. The thresholds are
+ * counted in steps of the accel range so it is read first, a fusion mode always runs the accelerometer at 4G.
+ * 
+ * @param i2c_num IMU to set up
+ * @param conf which interrupts and their thresholds, both off turns the motion interrupts off
+ * 
+ * @return esp_err_t
+ * 
+ * @author Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t bno055_set_motion_int(i2c_number_t i2c_num, const bno055_motion_int_conf_t* conf){
+
+    esp_err_t err;
+    bno055_opmode_t mode;
+    uint8_t acc_config;
+
+    if(conf->am_samples < 1 || conf->am_samples > 4 || conf->nm_duration > 0x0F)
+        return BNO_ERR_NOT_IN_RANGE;
+
+    if((err = bno055_get_opmode(i2c_num, &mode)) != ESP_OK) {
+        ESP_LOGD(BNO055_TAG, "bno055_set_motion_int(): bno055_get_opmode returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    bno055_acc_range_t range = BNO055_ACC_RANGE_4G;
+    if(mode < OPERATION_MODE_IMUPLUS) {
+        bno055_sensor_conf_t sensor_conf;
+        if(bno055_shadow_get(i2c_num, BNO055_CONF_ACC_CONFIG, &acc_config))
+            range = acc_config & 0x03;
+        else if((err = bno055_get_sensor_conf(i2c_num, &sensor_conf)) == ESP_OK)
+            range = sensor_conf.acc_range;
+        else {
+            ESP_LOGD(BNO055_TAG, "bno055_set_motion_int(): bno055_get_sensor_conf returned %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    float lsb_mg = BNO055_ACC_LSB_MG * (1 << range);
+    float am_threshold = conf->am_threshold_mg / lsb_mg + 0.5f;
+    float nm_threshold = conf->nm_threshold_mg / lsb_mg + 0.5f;
+
+    uint8_t int_bits = (conf->any_motion ? BNO055_INT_ACC_AM : 0) | (conf->no_motion ? BNO055_INT_ACC_NM : 0);
+
+    // thresholds first so an interrupt never fires on the old ones, the any/no motion axis enables share bits 2-4
+    bno055_reg_write_t script[] = {
+        { BNO055_CONF_ACC_AM_THRES, am_threshold > 255 ? 255 : (uint8_t)am_threshold },
+        { BNO055_CONF_ACC_INT_SETTINGS, (conf->am_samples - 1) | (conf->axes & 0x07) << 2 },
+        { BNO055_CONF_ACC_NM_THRES, nm_threshold > 255 ? 255 : (uint8_t)nm_threshold },
+        { BNO055_CONF_ACC_NM_SET, 0x01 | conf->nm_duration << 1 }, // bit 0 picks no motion over slow motion
+        { BNO055_CONF_INT_MSK, int_bits },
+        { BNO055_CONF_INT_EN, int_bits },
+    };
+
+    return bno055_run_script(i2c_num, script, sizeof(script) / sizeof(script[0]));
+}
+
+esp_err_t bno055_get_int_status(i2c_number_t i2c_num, uint8_t *int_status){
+
+    return bno055_read_register(i2c_num, BNO055_INTR_STAT_ADDR, int_status);
+}
+
+// drops the INT pin and clears INT_STA, the interrupts stay set up
+esp_err_t bno055_clear_int(i2c_number_t i2c_num){
+
+    return bno055_write_register(i2c_num, BNO055_SYS_TRIGGER_ADDR, BNO055_SYS_TRIGGER_RST_INT);
+}
+
 esp_err_t bno055_get_system_status(i2c_number_t i2c_num,uint8_t *system_status){
 
 	esp_err_t err;
@@ -576,10 +1246,11 @@ esp_err_t _bno055_buf_to_quaternion(uint8_t *buffer, bno055_quaternion_t* quat)
 
 esp_err_t bno055_get_quaternion(i2c_number_t i2c_num, bno055_quaternion_t* quat) {
 
-    esp_err_t err = bno055_read_data(i2c_num, BNO055_QUATERNION_DATA_W_LSB_ADDR, x_buffer, 8);
+    uint8_t buffer[8];
+    esp_err_t err = bno055_read_data(i2c_num, BNO055_QUATERNION_DATA_W_LSB_ADDR, buffer, 8);
     if( err != ESP_OK ) return err;
 
-    return _bno055_buf_to_quaternion(x_buffer, quat);
+    return _bno055_buf_to_quaternion(buffer, quat);
 }
 
 esp_err_t _bno055_buf_to_lin_accel(uint8_t *buffer, bno055_vec3_t* lin_accel) {
@@ -600,10 +1271,11 @@ esp_err_t _bno055_buf_to_lin_accel(uint8_t *buffer, bno055_vec3_t* lin_accel) {
 
 esp_err_t bno055_get_lin_accel(i2c_number_t i2c_num, bno055_vec3_t* lin_accel) {
 
-    esp_err_t err = bno055_read_data(i2c_num, BNO055_LINEAR_ACCEL_DATA_X_LSB_ADDR, x_buffer, 6);
+    uint8_t buffer[6];
+    esp_err_t err = bno055_read_data(i2c_num, BNO055_LINEAR_ACCEL_DATA_X_LSB_ADDR, buffer, 6);
     if( err != ESP_OK ) return err;
     
-    return _bno055_buf_to_lin_accel(x_buffer, lin_accel);
+    return _bno055_buf_to_lin_accel(buffer, lin_accel);
 }
 
 esp_err_t _bno055_buf_to_gravity(uint8_t *buffer, bno055_vec3_t* gravity) {
@@ -623,20 +1295,22 @@ esp_err_t _bno055_buf_to_gravity(uint8_t *buffer, bno055_vec3_t* gravity) {
 }
 
 esp_err_t bno055_get_gravity(i2c_number_t i2c_num, bno055_vec3_t* gravity){
-    esp_err_t err = bno055_read_data(i2c_num, BNO055_GRAVITY_DATA_X_LSB_ADDR, x_buffer, 6);
+    uint8_t buffer[6];
+    esp_err_t err = bno055_read_data(i2c_num, BNO055_GRAVITY_DATA_X_LSB_ADDR, buffer, 6);
     if( err != ESP_OK ) return err;
     
-    return _bno055_buf_to_gravity(x_buffer, gravity);
+    return _bno055_buf_to_gravity(buffer, gravity);
 }
 
 esp_err_t bno055_get_fusion_data(i2c_number_t i2c_num, bno055_quaternion_t* quat, bno055_vec3_t* lin_accel, bno055_vec3_t* gravity){
 
-    esp_err_t err = bno055_read_data(i2c_num, BNO055_QUATERNION_DATA_W_LSB_ADDR, x_buffer, 20);
+    uint8_t buffer[20];
+    esp_err_t err = bno055_read_data(i2c_num, BNO055_QUATERNION_DATA_W_LSB_ADDR, buffer, 20);
     if( err != ESP_OK ) return err;
     
-    _bno055_buf_to_quaternion(x_buffer, quat);
-    _bno055_buf_to_lin_accel(x_buffer+8, lin_accel);
-    _bno055_buf_to_gravity(x_buffer+14, gravity);
+    _bno055_buf_to_quaternion(buffer, quat);
+    _bno055_buf_to_lin_accel(buffer+8, lin_accel);
+    _bno055_buf_to_gravity(buffer+14, gravity);
     
     return ESP_OK;
 }
@@ -659,11 +1333,41 @@ esp_err_t _bno055_buf_to_euler(uint8_t* buffer, bno055_vec3_t* euler)
 
 esp_err_t bno055_get_euler(i2c_number_t i2c_num, bno055_vec3_t* euler)
 {
+    uint8_t buffer[6];
 
-    esp_err_t err = bno055_read_data(i2c_num, BNO055_EULER_H_LSB_ADDR, x_buffer, 6);
+    esp_err_t err = bno055_read_data(i2c_num, BNO055_EULER_H_LSB_ADDR, buffer, 6);
     if( err != ESP_OK) return err;
 
-    _bno055_buf_to_euler(x_buffer, euler);
+    _bno055_buf_to_euler(buffer, euler);
+
+    return ESP_OK;
+}
+
+esp_err_t bno055_get_bus_stats(i2c_number_t i2c_num, bno055_bus_stats_t* stats)
+{
+    if(i2c_num >= I2C_NUMBER_MAX) return BNO_ERR_NOT_IN_RANGE;
+    if(x_bus_lock[x_bno_dev[i2c_num].port] == NULL) return ESP_ERR_INVALID_STATE; // the port was never opened
+
+    bno055_lock(i2c_num);
+    *stats = x_bno_dev[i2c_num].stats;
+    bno055_unlock(i2c_num);
+
+    return ESP_OK;
+}
+
+// accel, mag and gyro data registers sit back to back (0x08 - 0x19) so all three come in one 18 byte burst
+esp_err_t bno055_get_amg_raw(i2c_number_t i2c_num, bno055_amg_raw_t* amg)
+{
+    uint8_t buffer[18];
+
+    esp_err_t err = bno055_read_data(i2c_num, BNO055_ACCEL_DATA_X_LSB_ADDR, buffer, 18);
+    if( err != ESP_OK) return err;
+
+    for(int i = 0; i < 3; i++) {
+        amg->accel[i] = (int16_t)((((uint16_t)buffer[2*i + 1]) << 8) | buffer[2*i]);
+        amg->mag[i] = (int16_t)((((uint16_t)buffer[2*i + 7]) << 8) | buffer[2*i + 6]);
+        amg->gyro[i] = (int16_t)((((uint16_t)buffer[2*i + 13]) << 8) | buffer[2*i + 12]);
+    }
 
     return ESP_OK;
 }
@@ -679,7 +1383,8 @@ esp_err_t bno055_get_euler(i2c_number_t i2c_num, bno055_vec3_t* euler)
  * SCL: GPIO 20
  * PULLUP: Disabled
  * CLK: 400 kHz
- * timeout: 10ms
+ * clock stretch timeout: 10ms
+ * transaction timeout: 20ms, tried 2 more times, the bus is clocked free if it times out
  * ext oscillator: false
  * 
  * @param i2c_num Holds the I2C number that the ESP will use for communicating with the BNO055
@@ -693,11 +1398,6 @@ esp_err_t bno055_get_euler(i2c_number_t i2c_num, bno055_vec3_t* euler)
 */
 esp_err_t BNO055_init(i2c_number_t *i2c_num)
 {
-    ESP_LOGI(BNO055_TAG, "\n\n\n"
-        "*******************\n"
-        "    BNO055 initialization\n"
-        "*******************\n");
-    
     bno055_config_t bno_conf;
     *i2c_num = I2C_NUMBER_0;
     
@@ -706,8 +1406,33 @@ esp_err_t BNO055_init(i2c_number_t *i2c_num)
     esp_err_t err;
     err = bno055_set_default_conf(&bno_conf); 
     ESP_LOGI(BNO055_TAG, "bno055_set_default_conf() returned %s \n", esp_err_to_name(err));
+
+    return BNO055_init_conf(*i2c_num, &bno_conf);
+}
+
+/**
+ * @name BNO055_init_conf
+ * 
+ * @brief same as BNO055_init() for any IMU slot and wiring, used to bring up a second IMU on its own port or at address B
+ * 
+ * @param i2c_num IMU slot to bring up
+ * @param p_bno_conf port, address, pins and bus settings of the IMU
+ * 
+ * @return esp_err_t
+ * 
+ * @author Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t BNO055_init_conf(i2c_number_t i2c_num, bno055_config_t *p_bno_conf)
+{
+    ESP_LOGI(BNO055_TAG, "\n\n\n"
+        "*******************\n"
+        "    BNO055 initialization\n"
+        "*******************\n");
+
+    esp_err_t err;
     
-    err = bno055_open(*i2c_num, &bno_conf);
+    err = bno055_open(i2c_num, p_bno_conf);
     ESP_LOGI(BNO055_TAG, "bno055_open() returned %s \n", esp_err_to_name(err));
     
     if(err != ESP_OK) 
@@ -728,12 +1453,12 @@ esp_err_t BNO055_init(i2c_number_t *i2c_num)
      * and has the BNO055 combine the data to give us:
      * Absolute orientation
     */
-    err = bno055_set_opmode(*i2c_num, OPERATION_MODE_NDOF);
+    err = bno055_set_opmode(i2c_num, OPERATION_MODE_NDOF);
     ESP_LOGI(BNO055_TAG, "bno055_set_opmode(OPERATION_MODE_NDOF) returned %s \n", esp_err_to_name(err));
     vTaskDelay(1000 / portTICK_PERIOD_MS);
 
     uint8_t system_status;
-    err = bno055_get_system_status(*i2c_num, &system_status);
+    err = bno055_get_system_status(i2c_num, &system_status);
     if(err != ESP_OK) 
     {
         ESP_LOGW(BNO055_TAG, "Program terminated!\n");
@@ -742,7 +1467,7 @@ esp_err_t BNO055_init(i2c_number_t *i2c_num)
     ESP_LOGI(BNO055_TAG, "System status: 0x%02X \n", system_status);
 
     uint8_t self_test_result;
-    err = bno055_get_self_test_result(*i2c_num, &self_test_result);
+    err = bno055_get_self_test_result(i2c_num, &self_test_result);
     if(err != ESP_OK) 
     {
         ESP_LOGW(BNO055_TAG, "Program terminated!\n");
@@ -751,7 +1476,7 @@ esp_err_t BNO055_init(i2c_number_t *i2c_num)
     ESP_LOGI(BNO055_TAG, "Self test result: 0x%02X \n", self_test_result);
 
     uint8_t system_error;
-    err = bno055_get_system_error(*i2c_num, &system_error);
+    err = bno055_get_system_error(i2c_num, &system_error);
     if(err != ESP_OK) 
     {
         ESP_LOGW(BNO055_TAG, "Program terminated!\n");
@@ -759,5 +1484,34 @@ esp_err_t BNO055_init(i2c_number_t *i2c_num)
     }
     ESP_LOGI(BNO055_TAG, "System error: 0x%02X \n", system_error);
 
+    // time the Euler read at both bus speeds so what 400 kHz buys is measured on the board, then go back to the configured
+    // speed. A port shared with an IMU brought up earlier was timed then and is left alone.
+    if(bno055_port_in_use(i2c_num, p_bno_conf->i2c_port)) {
+        ESP_LOGD(BNO055_TAG, "BNO055_init_conf(): I2C port %d was timed with the first IMU on it", p_bno_conf->i2c_port);
+        return ESP_OK;
+    }
+
+    uint32_t read_us_100k = 0, read_us_400k = 0;
+    err = bno055_time_euler_reads(i2c_num, 100000, &read_us_100k);
+    if(err == ESP_OK)
+        err = bno055_time_euler_reads(i2c_num, 400000, &read_us_400k);
+
+    // back to the configured speed even if a read failed
+    esp_err_t speed_err = bno055_bus_set_speed(i2c_num, p_bno_conf->clk_speed);
+    if(err == ESP_OK)
+        err = speed_err;
+    if(err != ESP_OK) {
+        ESP_LOGD(BNO055_TAG, "BNO055_init_conf(): timing the Euler read returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    bno055_lock(i2c_num);
+    x_bno_dev[i2c_num].stats.euler_read_us_100k = read_us_100k;
+    x_bno_dev[i2c_num].stats.euler_read_us_400k = read_us_400k;
+    bno055_unlock(i2c_num);
+
+    ESP_LOGI(BNO055_TAG, "Euler read: %lu us at 100 kHz, %lu us at 400 kHz, running at %lu Hz \n", (unsigned long)read_us_100k,
+             (unsigned long)read_us_400k, (unsigned long)p_bno_conf->clk_speed);
+
     return err;
 }
\ No newline at end of file
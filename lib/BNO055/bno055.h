@@ -3,10 +3,13 @@
 #define _BNO055_H_
 
 #include "driver/gpio.h"  // gpio_num_t, gpio_pullup_t
+#include "driver/i2c.h"   // i2c_port_t
 
+// IMU slot, every function below takes one. Each slot sits on the I2C port set in bno055_config_t.i2c_port,
+// by default slot 0 is on port 0 and two slots can share a port at addresses A and B
 typedef enum{
-    I2C_NUMBER_0 = 0,  // I2C port 0
-    I2C_NUMBER_1 ,     // I2C port 1
+    I2C_NUMBER_0 = 0,  // IMU 0
+    I2C_NUMBER_1 ,     // IMU 1
     I2C_NUMBER_MAX
 } i2c_number_t;
 
@@ -24,6 +27,7 @@ typedef enum
 #define BNO_ERR_ALREADY_OPEN     (0xB05502)
 #define BNO_ERR_NOT_IN_RANGE     (0xB05503)
 #define BNO_ERR_WRONG_OPMODE     (0xB05504)
+#define BNO_ERR_BUS_STUCK        (0xB05505)  // SDA still held low after clocking the bus free
 
 static const char* BNO055_TAG = "BNO055";
 
@@ -76,6 +80,165 @@ typedef enum
     REMAP_SIGN_P7                = 0x05
 } bno055_axis_remap_sign_t;
 
+#define BNO055_PAGE_1            (0x100)  // or'd into a register address to mean the page 1 register
+
+// Configuration registers the driver keeps a shadow of. SYS_TRIGGER is an action register, it is never shadowed and a
+// write to it is never skipped. Page 1 registers are BNO055_PAGE_1 + their address, the page is switched for them.
+typedef enum
+{
+    BNO055_CONF_PAGE_ID          = 0x07,  // on both pages
+    BNO055_CONF_UNIT_SEL         = 0x3B,
+    BNO055_CONF_OPR_MODE         = 0x3D,
+    BNO055_CONF_PWR_MODE         = 0x3E,
+    BNO055_CONF_SYS_TRIGGER      = 0x3F,
+    BNO055_CONF_AXIS_MAP_CONFIG  = 0x41,
+    BNO055_CONF_AXIS_MAP_SIGN    = 0x42,
+
+    BNO055_CONF_ACC_CONFIG       = BNO055_PAGE_1 | 0x08,
+    BNO055_CONF_MAG_CONFIG       = BNO055_PAGE_1 | 0x09,
+    BNO055_CONF_GYR_CONFIG_0     = BNO055_PAGE_1 | 0x0A,
+    BNO055_CONF_GYR_CONFIG_1     = BNO055_PAGE_1 | 0x0B,
+    BNO055_CONF_INT_MSK          = BNO055_PAGE_1 | 0x0F,  // interrupts routed to the INT pin
+    BNO055_CONF_INT_EN           = BNO055_PAGE_1 | 0x10,
+    BNO055_CONF_ACC_AM_THRES     = BNO055_PAGE_1 | 0x11,
+    BNO055_CONF_ACC_INT_SETTINGS = BNO055_PAGE_1 | 0x12,
+    BNO055_CONF_ACC_NM_THRES     = BNO055_PAGE_1 | 0x15,
+    BNO055_CONF_ACC_NM_SET       = BNO055_PAGE_1 | 0x16
+} bno055_conf_reg_t;
+
+// one step of a configuration script, see bno055_run_script()
+typedef struct
+{
+    uint16_t reg;                 // bno055_conf_reg_t
+    uint8_t val;
+} bno055_reg_write_t;
+
+// Page 1 sensor settings. The fusion modes set the sensors up themselves and ignore these, they apply in the
+// non-fusion modes (ACCONLY to AMG).
+typedef enum
+{
+    BNO055_ACC_RANGE_2G          = 0x00,
+    BNO055_ACC_RANGE_4G          = 0x01,  // what the fusion modes use
+    BNO055_ACC_RANGE_8G          = 0x02,
+    BNO055_ACC_RANGE_16G         = 0x03
+} bno055_acc_range_t;
+
+typedef enum
+{
+    BNO055_ACC_BW_7_81HZ         = 0x00,
+    BNO055_ACC_BW_15_63HZ        = 0x01,
+    BNO055_ACC_BW_31_25HZ        = 0x02,
+    BNO055_ACC_BW_62_5HZ         = 0x03,
+    BNO055_ACC_BW_125HZ          = 0x04,
+    BNO055_ACC_BW_250HZ          = 0x05,
+    BNO055_ACC_BW_500HZ          = 0x06,
+    BNO055_ACC_BW_1000HZ         = 0x07
+} bno055_acc_bw_t;
+
+typedef enum
+{
+    BNO055_ACC_PWR_NORMAL        = 0x00,
+    BNO055_ACC_PWR_SUSPEND       = 0x01,
+    BNO055_ACC_PWR_LOW_POWER_1   = 0x02,
+    BNO055_ACC_PWR_STANDBY       = 0x03,
+    BNO055_ACC_PWR_LOW_POWER_2   = 0x04,
+    BNO055_ACC_PWR_DEEP_SUSPEND  = 0x05
+} bno055_acc_pwr_t;
+
+typedef enum
+{
+    BNO055_GYR_RANGE_2000DPS     = 0x00,
+    BNO055_GYR_RANGE_1000DPS     = 0x01,
+    BNO055_GYR_RANGE_500DPS      = 0x02,
+    BNO055_GYR_RANGE_250DPS      = 0x03,
+    BNO055_GYR_RANGE_125DPS      = 0x04
+} bno055_gyr_range_t;
+
+typedef enum
+{
+    BNO055_GYR_BW_523HZ          = 0x00,
+    BNO055_GYR_BW_230HZ          = 0x01,
+    BNO055_GYR_BW_116HZ          = 0x02,
+    BNO055_GYR_BW_47HZ           = 0x03,
+    BNO055_GYR_BW_23HZ           = 0x04,
+    BNO055_GYR_BW_12HZ           = 0x05,
+    BNO055_GYR_BW_64HZ           = 0x06,
+    BNO055_GYR_BW_32HZ           = 0x07
+} bno055_gyr_bw_t;
+
+typedef enum
+{
+    BNO055_GYR_PWR_NORMAL             = 0x00,
+    BNO055_GYR_PWR_FAST_POWER_UP      = 0x01,
+    BNO055_GYR_PWR_DEEP_SUSPEND       = 0x02,
+    BNO055_GYR_PWR_SUSPEND            = 0x03,
+    BNO055_GYR_PWR_ADVANCED_POWERSAVE = 0x04
+} bno055_gyr_pwr_t;
+
+typedef enum
+{
+    BNO055_MAG_RATE_2HZ          = 0x00,
+    BNO055_MAG_RATE_6HZ          = 0x01,
+    BNO055_MAG_RATE_8HZ          = 0x02,
+    BNO055_MAG_RATE_10HZ         = 0x03,
+    BNO055_MAG_RATE_15HZ         = 0x04,
+    BNO055_MAG_RATE_20HZ         = 0x05,
+    BNO055_MAG_RATE_25HZ         = 0x06,
+    BNO055_MAG_RATE_30HZ         = 0x07
+} bno055_mag_rate_t;
+
+typedef enum
+{
+    BNO055_MAG_OPR_LOW_POWER        = 0x00,
+    BNO055_MAG_OPR_REGULAR          = 0x01,
+    BNO055_MAG_OPR_ENHANCED_REGULAR = 0x02,
+    BNO055_MAG_OPR_HIGH_ACCURACY    = 0x03
+} bno055_mag_opr_t;
+
+typedef enum
+{
+    BNO055_MAG_PWR_NORMAL        = 0x00,
+    BNO055_MAG_PWR_SLEEP         = 0x01,
+    BNO055_MAG_PWR_SUSPEND       = 0x02,
+    BNO055_MAG_PWR_FORCE         = 0x03
+} bno055_mag_pwr_t;
+
+typedef struct
+{
+    bno055_acc_range_t acc_range;
+    bno055_acc_bw_t acc_bw;
+    bno055_acc_pwr_t acc_pwr;
+    bno055_gyr_range_t gyr_range;
+    bno055_gyr_bw_t gyr_bw;
+    bno055_gyr_pwr_t gyr_pwr;
+    bno055_mag_rate_t mag_rate;
+    bno055_mag_opr_t mag_opr;
+    bno055_mag_pwr_t mag_pwr;
+} bno055_sensor_conf_t;
+
+// INT_STA / INT_EN / INT_MSK bits
+#define BNO055_INT_GYR_AM        (0x04)
+#define BNO055_INT_GYR_HIGH_RATE (0x08)
+#define BNO055_INT_ACC_HIGH_G    (0x20)
+#define BNO055_INT_ACC_AM        (0x40)   // any motion
+#define BNO055_INT_ACC_NM        (0x80)   // no motion
+
+#define BNO055_AXIS_X            (0x01)
+#define BNO055_AXIS_Y            (0x02)
+#define BNO055_AXIS_Z            (0x04)
+
+// Accelerometer motion interrupts, they work in every operation mode and raise the INT pin
+typedef struct
+{
+    bool any_motion;              // slope over am_threshold_mg for am_samples samples in a row
+    bool no_motion;               // slope under nm_threshold_mg for nm_duration
+    float am_threshold_mg;        // rounded to the step of the accel range, 3.91 mg at 2G up to 31.25 mg at 16G
+    uint8_t am_samples;           // 1 to 4
+    float nm_threshold_mg;
+    uint8_t nm_duration;          // ACC_NM_SET duration field, 0 to 15 is 1 to 16 s
+    uint8_t axes;                 // BNO055_AXIS_X | BNO055_AXIS_Y | BNO055_AXIS_Z
+} bno055_motion_int_conf_t;
+
 typedef struct
 {
     int16_t accel_offset_x;
@@ -93,13 +256,16 @@ typedef struct
 } bno055_offsets_t;
 
 typedef struct {
+    i2c_port_t i2c_port;          // I2C port the IMU is wired to
     uint8_t i2c_address;          // BNO055_ADDRESS_A or BNO055_ADDRESS_B 
     gpio_num_t sda_io_num;        // GPIO number for I2C sda signal 
     gpio_pullup_t sda_pullup_en;  // Internal GPIO pull mode for I2C sda signal
     gpio_num_t scl_io_num;        // GPIO number for I2C scl signal 
     gpio_pullup_t scl_pullup_en;  // Internal GPIO pull mode for I2C scl signal
     uint32_t clk_speed;           // I2C clock frequency: 100000 or 400000
-    int timeout;                  // in 80 MHz ticks, should be <= 0xFFFFF
+    uint32_t timeout_us;          // longest the BNO055 may stretch SCL before the transfer is failed, up to 104 ms
+    uint32_t cmd_timeout_ms;      // longest a whole transaction may take before the bus is recovered
+    uint8_t retries;              // times a failed transaction is tried again
     bool use_ext_oscillator;      // Use external oscillator
 } bno055_config_t;
 
@@ -125,6 +291,25 @@ typedef struct {
     double  z;
 } bno055_vec3_t;
 
+// raw sensor registers with the reset UNIT_SEL: 100 LSB per m/s^2, 16 LSB per uT, 16 LSB per dps
+typedef struct {
+    int16_t accel[3];
+    int16_t mag[3];
+    int16_t gyro[3];
+} bno055_amg_raw_t;
+
+typedef struct {
+    uint32_t transactions;        // i2c_master_cmd_begin() calls including retries
+    uint32_t retries;
+    uint32_t recoveries;          // times the bus was clocked free
+    uint32_t failures;            // transactions that still failed after every retry
+    uint64_t total_us;            // time spent in transactions
+    uint32_t max_us;
+    uint32_t shadow_hits;         // register reads and writes answered from the shadow instead of the bus
+    uint32_t euler_read_us_100k;  // mean Euler read timed by BNO055_init_conf() at 100 kHz, 0 if it wasn't timed
+    uint32_t euler_read_us_400k;  // and at 400 kHz
+} bno055_bus_stats_t;
+
 
 esp_err_t bno055_set_default_conf(bno055_config_t * p_bno_conf);
 
@@ -135,6 +320,15 @@ esp_err_t bno055_get_chip_info(i2c_number_t i2c_num, bno055_chip_info_t* chip_in
 esp_err_t bno055_set_opmode(i2c_number_t i2c_num, bno055_opmode_t mode );
 esp_err_t bno055_get_opmode(i2c_number_t i2c_num, bno055_opmode_t * mode );
 esp_err_t bno055_set_ext_crystal_use(i2c_number_t i2c_num, bool use_ext );
+esp_err_t bno055_set_powermode(i2c_number_t i2c_num, bno055_powermode_t mode );
+esp_err_t bno055_run_script(i2c_number_t i2c_num, const bno055_reg_write_t* script, size_t n_writes);
+esp_err_t bno055_set_axis_remap(i2c_number_t i2c_num, bno055_axis_remap_config_t remap_config, bno055_axis_remap_sign_t remap_sign);
+esp_err_t bno055_get_axis_remap(i2c_number_t i2c_num, bno055_axis_remap_config_t* remap_config, bno055_axis_remap_sign_t* remap_sign);
+esp_err_t bno055_get_sensor_conf(i2c_number_t i2c_num, bno055_sensor_conf_t* conf);
+esp_err_t bno055_set_sensor_conf(i2c_number_t i2c_num, const bno055_sensor_conf_t* conf);
+esp_err_t bno055_set_motion_int(i2c_number_t i2c_num, const bno055_motion_int_conf_t* conf);
+esp_err_t bno055_get_int_status(i2c_number_t i2c_num, uint8_t* int_status);
+esp_err_t bno055_clear_int(i2c_number_t i2c_num);
 esp_err_t bno055_get_temperature(i2c_number_t i2c_num, uint8_t* temperature);
 
 //   System Status
@@ -189,9 +383,14 @@ esp_err_t bno055_get_lin_accel(i2c_number_t i2c_num, bno055_vec3_t* lin_accel);
 esp_err_t bno055_get_gravity(i2c_number_t i2c_num, bno055_vec3_t* gravity);
 esp_err_t bno055_get_euler(i2c_number_t i2c_num, bno055_vec3_t* euler);
 
+esp_err_t bno055_get_amg_raw(i2c_number_t i2c_num, bno055_amg_raw_t* amg);
+
 esp_err_t bno055_get_fusion_data(i2c_number_t i2c_num, bno055_quaternion_t* quat, bno055_vec3_t* lin_accel, bno055_vec3_t* gravity);
 
+esp_err_t bno055_get_bus_stats(i2c_number_t i2c_num, bno055_bus_stats_t* stats);
+
 esp_err_t BNO055_init(i2c_number_t *i2c_num);
+esp_err_t BNO055_init_conf(i2c_number_t i2c_num, bno055_config_t *p_bno_conf);
 
 #endif // _BNO055_H_
 
@@ -0,0 +1,138 @@
+#include <string.h>
+#include <math.h>
+#include "cadence.h"
+#include "esp_log.h"
+
+static float cadence_clamp01(float v)
+{
+    return v < 0 ? 0 : (v > 1 ? 1 : v);
+}
+
+/**
+ * @name cadence_init
+ *
+ * @brief sets up the loop scheduler, the first loop runs at min_delay_ms until there is a rate to go by
+ *
+ * @param cadence scheduler to set up
+ * @param params delay limits
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t cadence_init(cadence_t *cadence, const cadence_params_t *params)
+{
+    memset(cadence, 0, sizeof(cadence_t));
+
+    if(params->min_delay_ms == 0 || params->min_delay_ms > params->max_delay_ms || params->far_deg <= params->near_deg ||
+       params->motion_dps <= 0 || params->tick_ms == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    //stepping a tick at a time has to be able to get off a multiple of the period
+    if(params->avoid_period_ms && params->tick_ms % params->avoid_period_ms == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    cadence->params = *params;
+    cadence->prev_delay_ms = params->min_delay_ms;
+
+    return ESP_OK;
+}
+
+/**
+ * @name cadence_next
+ *
+ * @brief picks the delay before the next loop. Closeness to the threshold and how fast the tilt is changing each give an
+ * urgency from 0 to 1, the higher of the two places the delay between max_delay_ms and min_delay_ms.
+ *
+ * @param cadence scheduler
+ * @param combined_angle combined angle the decision was just made on
+ * @param threshold threshold the decision is made against
+ *
+ * @return delay in ms to hand to vTaskDelay()
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+uint32_t cadence_next(cadence_t *cadence, float combined_angle, float threshold)
+{
+    const cadence_params_t *params = &cadence->params;
+    float margin = threshold - combined_angle;
+
+    //rate over the delay that was just waited out
+    if(cadence->has_prev)
+    {
+        float rate = fabsf(combined_angle - cadence->prev_angle) * 1000.0f / cadence->prev_delay_ms;
+        cadence->motion_dps += CADENCE_SMOOTHING * (rate - cadence->motion_dps);
+    }
+    cadence->has_prev = true;
+    cadence->prev_angle = combined_angle;
+
+    float proximity = cadence_clamp01((params->far_deg - margin) / (params->far_deg - params->near_deg));
+    float motion = cadence_clamp01(cadence->motion_dps / params->motion_dps);
+    float urgency = proximity > motion ? proximity : motion;
+
+    uint32_t delay_ms = params->max_delay_ms - (uint32_t)(urgency * (params->max_delay_ms - params->min_delay_ms));
+    delay_ms = (delay_ms + params->tick_ms / 2) / params->tick_ms * params->tick_ms;
+    if(delay_ms < params->min_delay_ms)
+        delay_ms = params->min_delay_ms;
+
+    //a delay that is a multiple of the LED alarm period lines every read up with the same point of the flashing
+    while(params->avoid_period_ms && delay_ms % params->avoid_period_ms == 0)
+        delay_ms += params->tick_ms;
+
+    cadence->prev_delay_ms = delay_ms;
+
+    cadence->stats.loops++;
+    cadence->stats.elapsed_ms += delay_ms;
+    cadence->stats.last_delay_ms = delay_ms;
+    if(urgency >= 1)
+        cadence->stats.min_loops++;
+    if(urgency <= 0)
+        cadence->stats.max_loops++;
+    if(margin <= params->near_deg)
+    {
+        cadence->stats.near_loops++;
+        cadence->stats.near_delay_ms += delay_ms;
+    }
+
+    if(cadence->stats.elapsed_ms - cadence->reported_ms >= CADENCE_REPORT_MS)
+    {
+        cadence->reported_ms = cadence->stats.elapsed_ms;
+        cadence_print(cadence);
+    }
+
+    return delay_ms;
+}
+
+void cadence_get_stats(const cadence_t *cadence, cadence_stats_t *stats)
+{
+    *stats = cadence->stats;
+}
+
+/**
+ * @name cadence_print
+ *
+ * @brief prints the reads per second against running flat out or at the slowest all the time, and the delay seen near the
+ * threshold where it decides how late the warning is
+ *
+ * @param cadence scheduler to report on
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void cadence_print(const cadence_t *cadence)
+{
+    const cadence_stats_t *stats = &cadence->stats;
+
+    if(stats->loops == 0 || stats->elapsed_ms == 0)
+        return;
+
+    float reads_per_s = stats->loops * 1000.0f / stats->elapsed_ms;
+    float fastest_per_s = 1000.0f / cadence->params.min_delay_ms;
+
+    ESP_LOGI(CADENCE_TAG, "%.2f IMU reads/s (%.0f%% of running at %lu ms), %lu%% of loops fastest, %lu%% slowest, %.0f ms average delay near the threshold \n",
+             reads_per_s, 100.0f * reads_per_s / fastest_per_s, (unsigned long)cadence->params.min_delay_ms,
+             (unsigned long)(100 * stats->min_loops / stats->loops), (unsigned long)(100 * stats->max_loops / stats->loops),
+             stats->near_loops ? (float)stats->near_delay_ms / stats->near_loops : 0.0f);
+}
@@ -0,0 +1,53 @@
+#ifndef CADENCE_H
+#define CADENCE_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+static const char* CADENCE_TAG = "Cadence";
+
+#define CADENCE_REPORT_MS (60000) //how often the counters are printed
+#define CADENCE_SMOOTHING (0.5f) //weight of the newest motion sample
+
+/**
+ * @brief limits the main loop delay is picked between
+*/
+typedef struct {
+    uint32_t min_delay_ms; //used near the threshold or while the car is moving about
+    uint32_t max_delay_ms; //used level and still
+    float near_deg; //margin to the threshold at and under which the loop runs flat out
+    float far_deg; //margin to the threshold from which the loop runs at its slowest
+    float motion_dps; //tilt rate at and above which the loop runs flat out
+    uint32_t avoid_period_ms; //delays that are a multiple of this are nudged off it, the LED alarm period
+    uint32_t tick_ms; //delays are rounded to this, vTaskDelay() can't do better
+} cadence_params_t;
+
+/**
+ * @brief power and latency figures. IMU reads per second stands in for power, the delay for how late a change is seen.
+*/
+typedef struct {
+    uint32_t loops;
+    uint64_t elapsed_ms; //total of the delays handed out
+    uint32_t min_loops; //loops at min_delay_ms
+    uint32_t max_loops; //loops at max_delay_ms
+    uint32_t near_loops; //loops with the angle inside near_deg of the threshold
+    uint64_t near_delay_ms; //total delay of those, the latency that matters
+    uint32_t last_delay_ms;
+} cadence_stats_t;
+
+typedef struct {
+    cadence_params_t params;
+    bool has_prev;
+    float prev_angle;
+    uint32_t prev_delay_ms;
+    float motion_dps; //smoothed rate of change of the combined angle
+    uint64_t reported_ms;
+    cadence_stats_t stats;
+} cadence_t;
+
+esp_err_t cadence_init(cadence_t *, const cadence_params_t *);
+ uint32_t cadence_next(cadence_t *, float, float);
+     void cadence_get_stats(const cadence_t *, cadence_stats_t *);
+     void cadence_print(const cadence_t *);
+
+#endif //CADENCE_H
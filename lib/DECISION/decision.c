@@ -0,0 +1,403 @@
+#include <math.h>
+#include "decision.h"
+
+#include "parameters.h"
+
+static decision_state_t x_out_of_level_state; //state of the live loop, static so it starts at 0 and decision_reset() can put it back there
+static decision_params_t x_params; //limits of the live loop when x_has_params is set, parameters.h otherwise
+static bool x_has_params;
+
+/**
+ * @name raw_ADC_to_percent
+ *
+ * @brief function takes in a calibrated ADC voltage reading and converts it to a int value between 0 - 1023
+ *
+ * @param raw_ADC_reading integer value with a range of 150 - 2450 (most liekly) pulled from the ADC and calibrated
+ *
+ * @return int value with a range of 0 - 1023
+ *
+ * @authors Ryan Leahy
+ * @date 02/28/2023
+*/
+int raw_ADC_to_LED_val(int raw_ADC_reading)
+{
+    //TODO: refine formula
+    float intermediate = (raw_ADC_reading - 500)/2598.0; //reduces the raw adc value range down to 0.0 - 1.0
+
+    if(intermediate > 1) //make sure that we can't get more than 1.0
+        intermediate = 1;
+
+    if(intermediate < 0.1) //make sure we have a minimum on value of 10%
+        intermediate = 0.1;
+
+    return intermediate*1023; //scale it back up to 0 - 1023
+}
+
+/**
+ * @name is_out_of_level
+ *
+ * @brief function analyzes input values to determine if the device is out of level
+ *
+ * @param angle bno055_vect3_t structure pointer holding the current angle data
+ * @param speed float pointer holding the current speed data
+ *
+ * @return bool indicating if the device is out of level
+ *
+ * @authors Ryan Leahy
+ * @date 02/28/2023
+*/
+bool is_out_of_level(bno055_vec3_t* angle, float* speed)
+{
+    decision_params_t params;
+
+    if(x_has_params)
+        params = x_params;
+    else
+        decision_default_params(&params);
+
+    return is_out_of_level_r(&x_out_of_level_state, &params, angle, *speed);
+}
+
+/**
+ * @name decision_set_params
+ *
+ * @brief swaps the limits is_out_of_level() judges against, e.g. for the geofence zone the car is in. The state machine carries on as it was.
+ * Only call it from the task that calls is_out_of_level().
+ *
+ * @param params limits to use from the next sample on, NULL goes back to the ones in parameters.h
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void decision_set_params(const decision_params_t *params)
+{
+    x_has_params = params != NULL;
+    if(params != NULL)
+        x_params = *params;
+}
+
+/**
+ * @name is_out_of_level_r
+ *
+ * @brief same check as is_out_of_level() with the state and limits handed in, so any number of streams can be judged side by side
+ * (replay, trace analysis) without touching the live state machine
+ *
+ * @param state state machine for this stream, zeroed before the first sample
+ * @param params limits to judge against
+ * @param angle current angle data
+ * @param speed current speed
+ *
+ * @return bool indicating if the device is out of level
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+bool is_out_of_level_r(decision_state_t *state, const decision_params_t *params, const bno055_vec3_t *angle, float speed)
+{
+    bool out_of_level = false;
+    float combined_angle = decision_combined_angle(angle);
+
+    //first time entering this function state will be initialized to 0
+    if(state->state == 0)
+        state->state = initial_state;
+
+    switch(state->state)
+    {
+        case initial_state: //nothing is on
+            if(combined_angle >= params->threshold_angle && (speed >= params->lower_speed && speed <= params->upper_speed)) //if the angle and speed are in the ranges, led turns on
+            {
+                state->state = threshold_angle_and_speed;
+                out_of_level = true;
+            }
+            else //if no state change occurs, keep led off
+                out_of_level = false;
+            break;
+        case threshold_angle_and_speed:
+            if(combined_angle < params->threshold_angle && (speed < params->lower_speed && speed > params->upper_speed)) //both the angle and speed need to return to normal to turn led off and return to initial state
+            {
+                state->state = initial_state;
+                out_of_level = false;
+            }
+            else //if no state change occurs, keep led on
+                out_of_level = true;
+            break;
+        default:
+            out_of_level = false;
+    }
+
+    return out_of_level;
+}
+
+/**
+ * @name decision_combined_angle
+ *
+ * @brief pitch and roll combined into one tilt angle, exactly as is_out_of_level_r() works it out
+ *
+ * @param angle angle data
+ *
+ * @return combined angle in degrees
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+float decision_combined_angle(const bno055_vec3_t *angle)
+{
+    float x = angle->x, y = angle->y;
+    return sqrt((double)x*x + (double)y*y); //squaring by hand is exact, pow() isn't guaranteed to round the same on every libm and replay has to match the device
+}
+
+/**
+ * @name decision_default_params
+ *
+ * @brief fills in the limits from parameters.h
+ *
+ * @param params limits to fill in
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void decision_default_params(decision_params_t *params)
+{
+    params->threshold_angle = threshold_angle;
+    params->lower_speed = lower_speed;
+    params->upper_speed = upper_speed;
+}
+
+/**
+ * @name decision_default_predict_params
+ *
+ * @brief fills in the prediction horizon, rate limit and smoothing from parameters.h
+ *
+ * @param params prediction limits to fill in
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void decision_default_predict_params(predict_params_t *params)
+{
+    params->horizon_ms = predict_horizon_ms;
+    params->max_rate_dps = predict_max_rate_dps;
+    params->smoothing = predict_smoothing;
+}
+
+/**
+ * @name decision_predict
+ *
+ * @brief extrapolates the combined angle horizon_ms ahead from how fast it has been changing, so the out of level check can
+ * come on before the angle actually gets to the threshold. Only ever moves the angle further from level, a car coming back
+ * level is judged on where it is.
+ *
+ * @param state rate carried between samples, zeroed before the first one
+ * @param params how far ahead to look
+ * @param angle current angle data
+ * @param time_ms time the angle was read
+ * @param predicted angle to hand to is_out_of_level_r(), angle scaled out along the same direction
+ *
+ * @return predicted combined angle in degrees
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+float decision_predict(predict_state_t *state, const predict_params_t *params, const bno055_vec3_t *angle, uint32_t time_ms, bno055_vec3_t *predicted)
+{
+    float combined_angle = decision_combined_angle(angle);
+
+    *predicted = *angle;
+
+    if(state->has_prev && time_ms > state->prev_ms)
+    {
+        float rate = (combined_angle - state->prev_angle) * 1000.0f / (time_ms - state->prev_ms);
+
+        //a jump like this is a glitch, keep the rate from before it rather than letting it arm the warning
+        if(fabsf(rate) <= params->max_rate_dps)
+            state->rate_dps += params->smoothing * (rate - state->rate_dps);
+    }
+
+    state->has_prev = true;
+    state->prev_ms = time_ms;
+    state->prev_angle = combined_angle;
+
+    if(params->horizon_ms <= 0 || state->rate_dps <= 0 || combined_angle <= 0)
+        return combined_angle;
+
+    float ahead = combined_angle + state->rate_dps * params->horizon_ms / 1000.0f;
+    float scale = ahead / combined_angle;
+    predicted->x = angle->x * scale;
+    predicted->y = angle->y * scale;
+
+    return ahead;
+}
+
+/**
+ * @name decision_reset
+ *
+ * @brief puts the live out of level state machine back to where it is at boot
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void decision_reset(void)
+{
+    x_out_of_level_state.state = 0;
+}
+
+/**
+ * @name led_blink_step
+ *
+ * @brief works out what the LED does on a timer alarm. Kept apart from the timer handler so the flashing can be replayed off the device.
+ *
+ * @param state flashing state carried between alarms
+ * @param led_on whether main wants the LED flashing
+ * @param led_on_val brightness to use when the LED is on
+ * @param is_led_on set to whether the LED ends up lit, main uses this to keep the LED out of the photoresistor reading
+ *
+ * @return int duty value to hand to the LEDC
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+int led_blink_step(led_blink_state_t *state, bool led_on, int led_on_val, bool *is_led_on)
+{
+    int duty = 0;
+    bool lit = false;
+
+    //if the toggle is zero this is the first time running this handler, initialize it
+    if(state->toggle == 0)
+    {
+        state->toggle = 1; //were going to use the first bit as an indicator that the variable has been initialized and the second bit as the actual toggle bit
+    }
+
+    if(led_on) //Toggle PWM
+    {
+        if(state->toggle >> 1) //if the second bit is a 1 then turn the led on
+        {
+            lit = true;
+            duty = led_on_val;
+        }
+
+        state->toggle = state->toggle ^ 0x02; //xor the second bit causing it to toggle states.
+    }
+
+    *is_led_on = lit; //indicate back to main whether the led is on
+    return duty;
+}
+
+/**
+ * @name decision_default_axes_params
+ *
+ * @brief fills in the per axis limits from parameters.h
+ *
+ * @param params limits to fill in
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void decision_default_axes_params(decision_axes_params_t *params)
+{
+    params->axis[DECISION_AXIS_PITCH] = (decision_axis_limits_t){
+        .upper = pitch_upper_limit,
+        .lower = pitch_lower_limit,
+        .hysteresis = pitch_hysteresis,
+        .lower_speed = pitch_lower_speed,
+        .upper_speed = pitch_upper_speed,
+        .dwell_ms = pitch_dwell_ms,
+    };
+    params->axis[DECISION_AXIS_ROLL] = (decision_axis_limits_t){
+        .upper = roll_upper_limit,
+        .lower = roll_lower_limit,
+        .hysteresis = roll_hysteresis,
+        .lower_speed = roll_lower_speed,
+        .upper_speed = roll_upper_speed,
+        .dwell_ms = roll_dwell_ms,
+    };
+}
+
+/**
+ * @name decision_axes_block
+ *
+ * @brief judges a block of samples against separate pitch and roll limits. The first pass works out for every sample whether
+ * each axis is past its limit, back inside it by the hysteresis and inside its speed range. It has no state so the compiler
+ * can vectorize it. The second pass carries the hysteresis and dwell from sample to sample with selects instead of branches.
+ *
+ * @param state state for this stream, zeroed before the first sample
+ * @param params limits to judge against
+ * @param pitch pitch of each sample in degrees
+ * @param roll roll of each sample in degrees
+ * @param speed speed of each sample
+ * @param time_ms time of each sample
+ * @param out set to 1 for samples where the warning is on, 0 otherwise
+ * @param count samples in the block
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void decision_axes_block(decision_axes_state_t *state, const decision_axes_params_t *params, const float *pitch, const float *roll,
+                         const float *speed, const uint32_t *time_ms, uint8_t *out, uint32_t count)
+{
+    uint8_t beyond[DECISION_AXIS_COUNT][DECISION_BLOCK];
+    uint8_t inside[DECISION_AXIS_COUNT][DECISION_BLOCK];
+
+    for(uint32_t start = 0; start < count; start += DECISION_BLOCK)
+    {
+        uint32_t n = count - start < DECISION_BLOCK ? count - start : DECISION_BLOCK;
+
+        for(int a = 0; a < DECISION_AXIS_COUNT; a++)
+        {
+            const decision_axis_limits_t *limits = &params->axis[a];
+            const float *angle = (a == DECISION_AXIS_PITCH ? pitch : roll) + start;
+            const float *v = speed + start;
+
+            for(uint32_t i = 0; i < n; i++)
+            {
+                uint8_t gate = (v[i] >= limits->lower_speed) & (v[i] <= limits->upper_speed);
+                beyond[a][i] = gate & ((angle[i] >= limits->upper) | (angle[i] <= limits->lower));
+                inside[a][i] = (1 - gate) | ((angle[i] < limits->upper - limits->hysteresis) & (angle[i] > limits->lower + limits->hysteresis));
+            }
+        }
+
+        for(uint32_t i = 0; i < n; i++)
+        {
+            uint32_t t = time_ms[start + i];
+            uint8_t on = 0;
+
+            for(int a = 0; a < DECISION_AXIS_COUNT; a++)
+            {
+                uint8_t was_over = state->over[a];
+                uint8_t over = beyond[a][i] | (was_over & (1 - inside[a][i]));
+                uint32_t keep = 0u - (uint32_t)was_over; //all ones while the axis was already over
+
+                state->over_since_ms[a] = (state->over_since_ms[a] & keep) | (t & ~keep);
+                state->over[a] = over;
+                on |= over & (t - state->over_since_ms[a] >= params->axis[a].dwell_ms);
+            }
+
+            out[start + i] = on;
+        }
+    }
+}
+
+/**
+ * @name decision_axes_step
+ *
+ * @brief decision_axes_block() for a single sample, what the live loop calls
+ *
+ * @param state state for this stream
+ * @param params limits to judge against
+ * @param angle current angle data, x is pitch and y roll
+ * @param speed current speed
+ * @param time_ms time of the sample
+ *
+ * @return bool indicating if the device is out of level
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+bool decision_axes_step(decision_axes_state_t *state, const decision_axes_params_t *params, const bno055_vec3_t *angle, float speed, uint32_t time_ms)
+{
+    float pitch = angle->x, roll = angle->y;
+    uint8_t out;
+
+    decision_axes_block(state, params, &pitch, &roll, &speed, &time_ms, &out, 1);
+
+    return out;
+}
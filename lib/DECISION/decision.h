@@ -0,0 +1,101 @@
+#ifndef DECISION_H
+#define DECISION_H
+
+#include "esp_types.h"
+
+#include "bno055.h"
+
+typedef enum stateMachine {
+    initial_state = 1,
+    threshold_angle_and_speed = 2,
+} out_of_level_t;
+
+/**
+ * @brief limits the out of level check runs against, the live loop uses the ones in parameters.h
+*/
+typedef struct {
+    float threshold_angle;
+    float lower_speed;
+    float upper_speed;
+} decision_params_t;
+
+/**
+ * @brief out of level state machine, one per stream of samples being judged
+*/
+typedef struct {
+    uint8_t state; //out_of_level_t, 0 until the first sample
+} decision_state_t;
+
+/**
+ * @brief how the combined angle is extrapolated ahead of time, the live loop uses the ones in parameters.h
+*/
+typedef struct {
+    float horizon_ms; //how far ahead the angle is extrapolated, 0 turns prediction off
+    float max_rate_dps; //faster changes than this are a bad sample or a bump, not the car tipping
+    float smoothing; //weight of the newest rate in the running average, 1 for none
+} predict_params_t;
+
+/**
+ * @brief rate of change of the combined angle, differenced from one sample to the next
+*/
+typedef struct {
+    bool has_prev;
+    uint32_t prev_ms;
+    float prev_angle; //combined angle of the last sample
+    float rate_dps; //smoothed, positive while tipping further
+} predict_state_t;
+
+#define DECISION_BLOCK (32) //samples the axis kernel handles per pass, its scratch arrays live on the stack
+
+typedef enum {
+    DECISION_AXIS_PITCH = 0, //x, nose up is positive
+    DECISION_AXIS_ROLL, //y
+    DECISION_AXIS_COUNT,
+} decision_axis_t;
+
+/**
+ * @brief limits of one axis. A grade and a lean don't call for the same limit, and up and down don't have to match either.
+*/
+typedef struct {
+    float upper; //limit on the positive side, degrees
+    float lower; //limit on the negative side, a negative number
+    float hysteresis; //how far back inside a limit the angle has to come before it counts as within it
+    float lower_speed; //axis is only judged with the speed between these, outside them it is taken as within its limits
+    float upper_speed;
+    uint32_t dwell_ms; //how long the axis has to stay out of its limits before the warning comes on
+} decision_axis_limits_t;
+
+typedef struct {
+    decision_axis_limits_t axis[DECISION_AXIS_COUNT];
+} decision_axes_params_t;
+
+/**
+ * @brief state of the per axis decision, one per stream of samples being judged
+*/
+typedef struct {
+    uint8_t over[DECISION_AXIS_COUNT]; //axis is out of its limits, hysteresis applied
+    uint32_t over_since_ms[DECISION_AXIS_COUNT];
+} decision_axes_state_t;
+
+/**
+ * @brief state of the LED flashing, advanced once per LED timer alarm
+*/
+typedef struct {
+    uint8_t toggle; //first bit marks it as initialized, second bit is the actual toggle bit
+} led_blink_state_t;
+
+int raw_ADC_to_LED_val(int);
+bool is_out_of_level(bno055_vec3_t*, float*);
+bool is_out_of_level_r(decision_state_t *, const decision_params_t *, const bno055_vec3_t *, float);
+void decision_default_params(decision_params_t *);
+void decision_set_params(const decision_params_t *);
+float decision_combined_angle(const bno055_vec3_t *);
+void decision_default_predict_params(predict_params_t *);
+float decision_predict(predict_state_t *, const predict_params_t *, const bno055_vec3_t *, uint32_t, bno055_vec3_t *);
+void decision_reset(void);
+void decision_default_axes_params(decision_axes_params_t *);
+void decision_axes_block(decision_axes_state_t *, const decision_axes_params_t *, const float *, const float *, const float *, const uint32_t *, uint8_t *, uint32_t);
+bool decision_axes_step(decision_axes_state_t *, const decision_axes_params_t *, const bno055_vec3_t *, float, uint32_t);
+int led_blink_step(led_blink_state_t *, bool, int, bool *);
+
+#endif //DECISION_H
@@ -0,0 +1,542 @@
+#include <string.h>
+#include <math.h>
+#include "fusion.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define FUSION_DEG_TO_RAD (0.017453292f)
+#define FUSION_RAD_TO_DEG (57.29577951f)
+
+typedef struct {
+    fusion_t filter;
+    i2c_number_t i2c_num;
+    uint32_t period_us;
+    bool running;
+    TaskHandle_t task;
+    esp_timer_handle_t timer;
+    int64_t last_read_us;
+    portMUX_TYPE lock; //guards latest and stats, the filter itself is only touched by the fusion task
+    bool has_latest;
+    bno055_vec3_t latest;
+    int64_t latest_us; //esp_timer time the samples behind latest were read
+    fusion_stats_t stats;
+    imufilter_t *post_filter; //run over the tilt angles a block at a time before they are published, NULL for none
+    float block[IMUFILTER_AXES][FUSION_FILTER_BLOCK];
+    float block_out[IMUFILTER_AXES][FUSION_FILTER_BLOCK];
+    uint32_t block_fill;
+} fusion_pipeline_t;
+
+static fusion_pipeline_t x_fusion = { .lock = portMUX_INITIALIZER_UNLOCKED };
+
+//the quaternion and gradient are handled as 4 lane arrays, the loops below are straight line multiply-adds the compiler
+//can keep in registers or vectorize where the target has float SIMD
+static void fusion_normalize4(float *v)
+{
+    float norm = v[0]*v[0] + v[1]*v[1] + v[2]*v[2] + v[3]*v[3];
+
+    if(norm == 0.0f)
+        return;
+
+    norm = 1.0f / sqrtf(norm);
+    for(int i = 0; i < 4; i++)
+        v[i] *= norm;
+}
+
+static bool fusion_normalize3(const float *in, float *out)
+{
+    float norm = in[0]*in[0] + in[1]*in[1] + in[2]*in[2];
+
+    if(norm == 0.0f) //free fall or a bad read, nothing to correct against
+        return false;
+
+    norm = 1.0f / sqrtf(norm);
+    for(int i = 0; i < 3; i++)
+        out[i] = in[i] * norm;
+
+    return true;
+}
+
+//gyro rate as a quaternion derivative, q' = 0.5 q x (0, g)
+static void fusion_rate(const float *q, const float *g, float *q_dot)
+{
+    q_dot[0] = 0.5f * (-q[1]*g[0] - q[2]*g[1] - q[3]*g[2]);
+    q_dot[1] = 0.5f * ( q[0]*g[0] + q[2]*g[2] - q[3]*g[1]);
+    q_dot[2] = 0.5f * ( q[0]*g[1] - q[1]*g[2] + q[3]*g[0]);
+    q_dot[3] = 0.5f * ( q[0]*g[2] + q[1]*g[1] - q[2]*g[0]);
+}
+
+//Madgwick, "An efficient orientation filter for inertial and inertial/magnetic sensor arrays", IMU variant
+static void fusion_madgwick(fusion_t *fusion, const float *g, const float *accel, float dt)
+{
+    float *q = fusion->q;
+    float q_dot[4], a[3];
+
+    fusion_rate(q, g, q_dot);
+
+    if(fusion_normalize3(accel, a))
+    {
+        float q0q0 = q[0]*q[0], q1q1 = q[1]*q[1], q2q2 = q[2]*q[2], q3q3 = q[3]*q[3];
+
+        //gradient of the gap between measured gravity and gravity as q sees it
+        float s[4] = {
+            4.0f*q[0]*q2q2 + 2.0f*q[2]*a[0] + 4.0f*q[0]*q1q1 - 2.0f*q[1]*a[1],
+            4.0f*q[1]*q3q3 - 2.0f*q[3]*a[0] + 4.0f*q0q0*q[1] - 2.0f*q[0]*a[1] - 4.0f*q[1] + 8.0f*q[1]*q1q1 + 8.0f*q[1]*q2q2 + 4.0f*q[1]*a[2],
+            4.0f*q0q0*q[2] + 2.0f*q[0]*a[0] + 4.0f*q[2]*q3q3 - 2.0f*q[3]*a[1] - 4.0f*q[2] + 8.0f*q[2]*q1q1 + 8.0f*q[2]*q2q2 + 4.0f*q[2]*a[2],
+            4.0f*q1q1*q[3] - 2.0f*q[1]*a[0] + 4.0f*q2q2*q[3] - 2.0f*q[2]*a[1],
+        };
+
+        fusion_normalize4(s);
+        for(int i = 0; i < 4; i++)
+            q_dot[i] -= fusion->gain * s[i];
+    }
+
+    for(int i = 0; i < 4; i++)
+        q[i] += q_dot[i] * dt;
+
+    fusion_normalize4(q);
+}
+
+//Mahony, "Nonlinear complementary filters on the special orthogonal group", IMU variant
+static void fusion_mahony(fusion_t *fusion, const float *gyro, const float *accel, float dt)
+{
+    float *q = fusion->q;
+    float g[3] = {gyro[0], gyro[1], gyro[2]}, a[3], q_dot[4];
+
+    if(fusion_normalize3(accel, a))
+    {
+        //half of gravity as q sees it, crossed with the measured direction gives the error to steer out
+        float v[3] = {
+            q[1]*q[3] - q[0]*q[2],
+            q[0]*q[1] + q[2]*q[3],
+            q[0]*q[0] - 0.5f + q[3]*q[3],
+        };
+        float e[3] = {
+            a[1]*v[2] - a[2]*v[1],
+            a[2]*v[0] - a[0]*v[2],
+            a[0]*v[1] - a[1]*v[0],
+        };
+
+        for(int i = 0; i < 3; i++)
+        {
+            if(fusion->ki > 0.0f)
+            {
+                fusion->integral[i] += 2.0f * fusion->ki * e[i] * dt;
+                g[i] += fusion->integral[i];
+            }
+            g[i] += 2.0f * fusion->gain * e[i];
+        }
+    }
+
+    fusion_rate(q, g, q_dot);
+    for(int i = 0; i < 4; i++)
+        q[i] += q_dot[i] * dt;
+
+    fusion_normalize4(q);
+}
+
+static float fusion_angle_diff(float a, float b)
+{
+    float diff = fmodf(a - b, 360.0f);
+
+    if(diff > 180.0f)
+        diff -= 360.0f;
+    if(diff < -180.0f)
+        diff += 360.0f;
+
+    return diff;
+}
+
+/**
+ * @name fusion_init
+ *
+ * @brief sets a filter back to level with no history
+ *
+ * @param fusion filter to set up
+ * @param algo FUSION_MADGWICK or FUSION_MAHONY
+ * @param gain beta for Madgwick (FUSION_MADGWICK_BETA), kp for Mahony (FUSION_MAHONY_KP)
+ * @param ki Mahony integral gain, ignored by Madgwick
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void fusion_init(fusion_t *fusion, fusion_algo_t algo, float gain, float ki)
+{
+    memset(fusion, 0, sizeof(fusion_t));
+    fusion->algo = algo;
+    fusion->gain = gain;
+    fusion->ki = ki;
+    fusion->q[0] = 1.0f;
+}
+
+/**
+ * @name fusion_align
+ *
+ * @brief starts the filter at the tilt the accelerometer shows instead of letting it converge from level, heading is left at 0
+ *
+ * @param fusion filter to align
+ * @param accel accelerometer reading in any unit, taken while still
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void fusion_align(fusion_t *fusion, const float *accel)
+{
+    float roll = atan2f(accel[1], accel[2]);
+    float pitch = atan2f(-accel[0], sqrtf(accel[1]*accel[1] + accel[2]*accel[2]));
+    float cr = cosf(roll * 0.5f), sr = sinf(roll * 0.5f), cp = cosf(pitch * 0.5f), sp = sinf(pitch * 0.5f);
+
+    fusion->q[0] = cp*cr;
+    fusion->q[1] = cp*sr;
+    fusion->q[2] = sp*cr;
+    fusion->q[3] = -sp*sr;
+}
+
+/**
+ * @name fusion_update
+ *
+ * @brief runs the filter one step
+ *
+ * @param fusion filter to step
+ * @param gyro rotation rate in rad/s
+ * @param accel acceleration in any unit, only its direction is used
+ * @param dt seconds since the last step
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void fusion_update(fusion_t *fusion, const float *gyro, const float *accel, float dt)
+{
+    if(fusion->algo == FUSION_MAHONY)
+        fusion_mahony(fusion, gyro, accel, dt);
+    else
+        fusion_madgwick(fusion, gyro, accel, dt);
+
+    fusion->updates++;
+}
+
+//averages the gyro over the first FUSION_BIAS_SECONDS the car sits still, any movement starts the run again
+static void fusion_estimate_bias(fusion_t *fusion, const float *gyro, const float *accel, float dt)
+{
+    float rate = sqrtf(gyro[0]*gyro[0] + gyro[1]*gyro[1] + gyro[2]*gyro[2]) * FUSION_RAD_TO_DEG;
+    float g = sqrtf(accel[0]*accel[0] + accel[1]*accel[1] + accel[2]*accel[2]);
+
+    if(rate > FUSION_BIAS_STILL_DPS || fabsf(g - 9.81f) > FUSION_BIAS_STILL_ACC)
+    {
+        memset(fusion->bias_sum, 0, sizeof(fusion->bias_sum));
+        fusion->bias_time = 0.0f;
+        return;
+    }
+
+    for(int i = 0; i < 3; i++)
+        fusion->bias_sum[i] += gyro[i] * dt;
+    fusion->bias_time += dt;
+
+    if(fusion->bias_time < FUSION_BIAS_SECONDS)
+        return;
+
+    //the Mahony integral has been holding the bias off meanwhile, it keeps only what is left over
+    for(int i = 0; i < 3; i++)
+    {
+        fusion->gyro_bias[i] = fusion->bias_sum[i] / fusion->bias_time;
+        fusion->integral[i] += fusion->gyro_bias[i];
+    }
+    fusion->has_bias = true;
+}
+
+//same as fusion_update() straight from the BNO055 registers, the first sample aligns the filter. AMG mode gives the gyro
+//with its bias still in, it is estimated while the car is still and taken off from then on.
+void fusion_update_raw(fusion_t *fusion, const bno055_amg_raw_t *amg, float dt)
+{
+    float accel[3], gyro[3];
+
+    for(int i = 0; i < 3; i++)
+    {
+        accel[i] = amg->accel[i] * (1.0f / FUSION_ACC_LSB);
+        gyro[i] = amg->gyro[i] * (FUSION_DEG_TO_RAD / FUSION_GYR_LSB);
+    }
+
+    if(fusion->updates == 0)
+        fusion_align(fusion, accel);
+
+    if(!fusion->has_bias)
+        fusion_estimate_bias(fusion, gyro, accel, dt);
+    for(int i = 0; i < 3; i++)
+        gyro[i] -= fusion->gyro_bias[i];
+
+    fusion_update(fusion, gyro, accel, dt);
+}
+
+/**
+ * @name fusion_get_euler
+ *
+ * @brief orientation in degrees laid out like bno055_get_euler(): x is the rotation about the sensor x axis (+-180), y about
+ * the y axis (+-90) and z the heading (0 - 360), so the result can go straight into is_out_of_level()
+ *
+ * @param fusion filter to read
+ * @param euler filled with the angles
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void fusion_get_euler(const fusion_t *fusion, bno055_vec3_t *euler)
+{
+    const float *q = fusion->q;
+    float sin_y = 2.0f * (q[0]*q[2] - q[3]*q[1]);
+
+    if(sin_y > 1.0f)
+        sin_y = 1.0f;
+    if(sin_y < -1.0f)
+        sin_y = -1.0f;
+
+    float heading = -FUSION_RAD_TO_DEG * atan2f(2.0f * (q[0]*q[3] + q[1]*q[2]), 1.0f - 2.0f * (q[2]*q[2] + q[3]*q[3]));
+
+    euler->x = FUSION_RAD_TO_DEG * atan2f(2.0f * (q[0]*q[1] + q[2]*q[3]), 1.0f - 2.0f * (q[1]*q[1] + q[2]*q[2]));
+    euler->y = FUSION_RAD_TO_DEG * asinf(sin_y);
+    euler->z = heading < 0.0f ? heading + 360.0f : heading;
+}
+
+/**
+ * @name fusion_accuracy
+ *
+ * @brief runs a filter over recorded raw samples and compares its tilt with a reference taken at the same time, the
+ * on-chip NDOF output or a simulated ground truth. Runs the same on the host as on the device.
+ *
+ * @param fusion filter to run, fusion_init() it first
+ * @param samples raw readings in order
+ * @param reference euler angles for each sample
+ * @param count number of samples
+ * @param dt seconds between samples
+ * @param accuracy filled with the tilt error
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void fusion_accuracy(fusion_t *fusion, const bno055_amg_raw_t *samples, const bno055_vec3_t *reference, size_t count, float dt, fusion_accuracy_t *accuracy)
+{
+    bno055_vec3_t euler;
+    double sum_sq = 0;
+
+    memset(accuracy, 0, sizeof(fusion_accuracy_t));
+
+    for(size_t i = 0; i < count; i++)
+    {
+        fusion_update_raw(fusion, &samples[i], dt);
+        fusion_get_euler(fusion, &euler);
+
+        float dx = fusion_angle_diff(euler.x, reference[i].x), dy = fusion_angle_diff(euler.y, reference[i].y);
+        float err = sqrtf(dx*dx + dy*dy);
+
+        sum_sq += err*err;
+        if(err > accuracy->max_deg)
+            accuracy->max_deg = err;
+    }
+
+    accuracy->samples = count;
+    accuracy->rms_deg = count ? sqrt(sum_sq / count) : 0;
+}
+
+static void fusion_timer_callback(void *arg)
+{
+    xTaskNotifyGive(x_fusion.task);
+}
+
+static void fusion_task_entry(void *arg)
+{
+    bno055_amg_raw_t amg;
+    bno055_vec3_t euler;
+
+    while(true)
+    {
+        uint32_t pending = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        int64_t start = esp_timer_get_time();
+        esp_err_t err = bno055_get_amg_raw(x_fusion.i2c_num, &amg);
+        uint32_t read_us = esp_timer_get_time() - start;
+
+        if(err != ESP_OK)
+        {
+            portENTER_CRITICAL(&x_fusion.lock);
+            x_fusion.stats.read_failures++;
+            portEXIT_CRITICAL(&x_fusion.lock);
+            continue;
+        }
+
+        //dt from when the samples were actually read, the timer task can run late
+        float dt = x_fusion.last_read_us ? (start - x_fusion.last_read_us) * 1e-6f : x_fusion.period_us * 1e-6f;
+        x_fusion.last_read_us = start;
+
+        esp_cpu_cycle_count_t cycles = esp_cpu_get_cycle_count();
+        fusion_update_raw(&x_fusion.filter, &amg, dt);
+        cycles = esp_cpu_get_cycle_count() - cycles;
+
+        fusion_get_euler(&x_fusion.filter, &euler);
+
+        //the post filter gets whole blocks so the biquad runs its vector kernel, the newest filtered sample is published
+        if(x_fusion.post_filter != NULL)
+        {
+            x_fusion.block[0][x_fusion.block_fill] = euler.x;
+            x_fusion.block[1][x_fusion.block_fill] = euler.y;
+            if(++x_fusion.block_fill < FUSION_FILTER_BLOCK)
+                continue;
+
+            x_fusion.block_fill = 0;
+            for(int axis = 0; axis < IMUFILTER_AXES; axis++)
+                imufilter_process(x_fusion.post_filter, axis, x_fusion.block[axis], x_fusion.block_out[axis], FUSION_FILTER_BLOCK);
+            euler.x = x_fusion.block_out[0][FUSION_FILTER_BLOCK - 1];
+            euler.y = x_fusion.block_out[1][FUSION_FILTER_BLOCK - 1];
+        }
+        uint32_t latency_us = esp_timer_get_time() - start;
+
+        portENTER_CRITICAL(&x_fusion.lock);
+        x_fusion.latest = euler;
+        x_fusion.latest_us = start;
+        x_fusion.has_latest = true;
+        x_fusion.stats.updates++;
+        x_fusion.stats.overruns += pending - 1;
+        x_fusion.stats.update_cycles += cycles;
+        if(cycles > x_fusion.stats.max_update_cycles)
+            x_fusion.stats.max_update_cycles = cycles;
+        x_fusion.stats.read_us += read_us;
+        if(read_us > x_fusion.stats.max_read_us)
+            x_fusion.stats.max_read_us = read_us;
+        x_fusion.stats.latency_us = latency_us;
+        if(latency_us > x_fusion.stats.max_latency_us)
+            x_fusion.stats.max_latency_us = latency_us;
+        portEXIT_CRITICAL(&x_fusion.lock);
+    }
+}
+
+/**
+ * @name fusion_start
+ *
+ * @brief switches the IMU from on-chip fusion to AMG and runs the filter on the ESP at rate_hz. The sensors are set to
+ * output faster than rate_hz (accel 250 Hz, gyro 400 Hz) so each burst read gets a fresh sample.
+ *
+ * @param i2c_num IMU to read, already brought up with BNO055_init()
+ * @param algo filter to run
+ * @param rate_hz filter updates per second, 1 - 400
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t fusion_start(i2c_number_t i2c_num, fusion_algo_t algo, uint32_t rate_hz)
+{
+    bno055_sensor_conf_t sensor_conf;
+    esp_err_t err;
+
+    if(x_fusion.running)
+        return ESP_ERR_INVALID_STATE;
+    if(rate_hz == 0 || rate_hz > 400)
+        return ESP_ERR_INVALID_ARG;
+
+    if((err = bno055_get_sensor_conf(i2c_num, &sensor_conf)) != ESP_OK)
+    {
+        ESP_LOGD(FUSION_TAG, "fusion_start(): bno055_get_sensor_conf returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    sensor_conf.acc_range = BNO055_ACC_RANGE_4G;
+    sensor_conf.acc_bw = BNO055_ACC_BW_125HZ;
+    sensor_conf.acc_pwr = BNO055_ACC_PWR_NORMAL;
+    sensor_conf.gyr_range = BNO055_GYR_RANGE_500DPS;
+    sensor_conf.gyr_bw = BNO055_GYR_BW_47HZ;
+    sensor_conf.gyr_pwr = BNO055_GYR_PWR_NORMAL;
+
+    if((err = bno055_set_sensor_conf(i2c_num, &sensor_conf)) != ESP_OK)
+    {
+        ESP_LOGD(FUSION_TAG, "fusion_start(): bno055_set_sensor_conf returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if((err = bno055_set_opmode(i2c_num, OPERATION_MODE_AMG)) != ESP_OK)
+    {
+        ESP_LOGD(FUSION_TAG, "fusion_start(): bno055_set_opmode returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    fusion_init(&x_fusion.filter, algo, algo == FUSION_MAHONY ? FUSION_MAHONY_KP : FUSION_MADGWICK_BETA, FUSION_MAHONY_KI);
+    memset(&x_fusion.stats, 0, sizeof(fusion_stats_t));
+    x_fusion.i2c_num = i2c_num;
+    x_fusion.period_us = 1000000 / rate_hz;
+    x_fusion.last_read_us = 0;
+    x_fusion.has_latest = false;
+    x_fusion.block_fill = 0;
+
+    if(xTaskCreate(fusion_task_entry, "fusion", FUSION_TASK_STACK_SIZE, NULL, FUSION_TASK_PRIORITY, &x_fusion.task) != pdPASS)
+        return ESP_ERR_NO_MEM;
+
+    //the FreeRTOS tick is 10 ms, an esp_timer is the only way to run faster than 100 Hz
+    esp_timer_create_args_t timer_args = {
+        .callback = fusion_timer_callback,
+        .name = "fusion",
+        .skip_unhandled_events = true,
+    };
+
+    if((err = esp_timer_create(&timer_args, &x_fusion.timer)) != ESP_OK || (err = esp_timer_start_periodic(x_fusion.timer, x_fusion.period_us)) != ESP_OK)
+    {
+        ESP_LOGD(FUSION_TAG, "fusion_start(): starting the timer returned %s", esp_err_to_name(err));
+        vTaskDelete(x_fusion.task); //never got a tick, it is still waiting and holds no bus lock
+        return err;
+    }
+
+    x_fusion.running = true;
+    ESP_LOGI(FUSION_TAG, "%s running at %lu Hz \n", algo == FUSION_MAHONY ? "Mahony" : "Madgwick", (unsigned long)rate_hz);
+
+    return ESP_OK;
+}
+
+/**
+ * @name fusion_set_filter
+ *
+ * @brief puts a filter stage on the tilt angles before they are published. With a filter the angle is published every
+ * FUSION_FILTER_BLOCK updates. Has to be called before fusion_start().
+ *
+ * @param filter stage set up for the fusion rate, NULL takes it off
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t fusion_set_filter(imufilter_t *filter)
+{
+    if(x_fusion.running)
+        return ESP_ERR_INVALID_STATE;
+
+    x_fusion.post_filter = filter;
+
+    return ESP_OK;
+}
+
+//newest angle and the esp_timer time its samples were read at, time_us can be NULL
+esp_err_t fusion_get_latest(bno055_vec3_t *euler, int64_t *time_us)
+{
+    esp_err_t err = ESP_OK;
+
+    portENTER_CRITICAL(&x_fusion.lock);
+    if(x_fusion.has_latest)
+    {
+        *euler = x_fusion.latest;
+        if(time_us != NULL)
+            *time_us = x_fusion.latest_us;
+    }
+    else
+        err = ESP_ERR_INVALID_STATE;
+    portEXIT_CRITICAL(&x_fusion.lock);
+
+    return err;
+}
+
+esp_err_t fusion_get_stats(fusion_stats_t *stats)
+{
+    portENTER_CRITICAL(&x_fusion.lock);
+    *stats = x_fusion.stats;
+    portEXIT_CRITICAL(&x_fusion.lock);
+
+    return ESP_OK;
+}
@@ -0,0 +1,83 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+#include "bno055.h"
+#include "imufilter.h"
+
+static const char* FUSION_TAG = "Fusion";
+
+#define FUSION_TASK_STACK_SIZE (3072)
+#define FUSION_TASK_PRIORITY (6) //above the IMU pair worker, a late update skews dt for the next one
+
+#define FUSION_MADGWICK_BETA (0.1f) //gradient descent step, higher follows the accelerometer faster and lets more vibration in
+#define FUSION_MAHONY_KP (1.0f)
+#define FUSION_MAHONY_KI (0.05f) //AMG mode hands over the gyro uncompensated, this follows what the startup estimate misses
+
+#define FUSION_BIAS_SECONDS (1.0f) //still time averaged for the gyro bias before it is taken out
+#define FUSION_BIAS_STILL_DPS (3.0f) //gyro rate under which the car counts as still
+#define FUSION_BIAS_STILL_ACC (0.5f) //m/s^2 off 1 g the accelerometer may read and the car still count as still
+
+#define FUSION_FILTER_BLOCK (8) //updates handed to the post filter at once, the angle is published once per block
+
+#define FUSION_ACC_LSB (100.0f) //LSB per m/s^2, see bno055_amg_raw_t
+#define FUSION_GYR_LSB (16.0f) //LSB per dps
+
+typedef enum {
+    FUSION_MADGWICK = 0,
+    FUSION_MAHONY,
+} fusion_algo_t;
+
+/**
+ * @brief accel/gyro orientation filter. Everything is single precision, the S3 FPU has no double precision and a
+ * promoted double drops into a soft-float call on every operation.
+*/
+typedef struct {
+    fusion_algo_t algo;
+    float q[4]; //w x y z, sensor frame to earth frame
+    float gain; //beta for Madgwick, kp for Mahony
+    float ki; //Mahony only
+    float integral[3]; //Mahony integral feedback
+    float gyro_bias[3]; //rad/s, taken off every raw sample once the startup estimate is done
+    float bias_sum[3]; //gyro summed over the still run so far
+    float bias_time; //seconds of still run so far
+    bool has_bias;
+    uint32_t updates;
+} fusion_t;
+
+typedef struct {
+    uint32_t updates;
+    uint32_t read_failures;
+    uint32_t overruns; //timer periods skipped because the previous update was still running
+    uint64_t update_cycles; //CPU cycles spent in the filter, frequency independent so DFS doesn't skew it
+    uint32_t max_update_cycles;
+    uint64_t read_us; //time spent on the burst read
+    uint32_t max_read_us;
+    uint32_t latency_us; //last update, from starting the read to the new angle being available
+    uint32_t max_latency_us;
+} fusion_stats_t;
+
+/**
+ * @brief filter output against a reference over a recorded run, tilt only since heading drifts without the magnetometer
+*/
+typedef struct {
+    uint32_t samples;
+    float rms_deg;
+    float max_deg;
+} fusion_accuracy_t;
+
+     void fusion_init(fusion_t *, fusion_algo_t, float, float);
+     void fusion_align(fusion_t *, const float *);
+     void fusion_update(fusion_t *, const float *, const float *, float);
+     void fusion_update_raw(fusion_t *, const bno055_amg_raw_t *, float);
+     void fusion_get_euler(const fusion_t *, bno055_vec3_t *);
+     void fusion_accuracy(fusion_t *, const bno055_amg_raw_t *, const bno055_vec3_t *, size_t, float, fusion_accuracy_t *);
+
+esp_err_t fusion_start(i2c_number_t, fusion_algo_t, uint32_t);
+esp_err_t fusion_set_filter(imufilter_t *);
+esp_err_t fusion_get_latest(bno055_vec3_t *, int64_t *);
+esp_err_t fusion_get_stats(fusion_stats_t *);
+
+#endif //FUSION_H
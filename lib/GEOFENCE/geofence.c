@@ -0,0 +1,739 @@
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "geofence.h"
+#include "triplog.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+
+_Static_assert(sizeof(geofence_header_t) == 32, "geofence header layout changed, bump GEOFENCE_VERSION");
+_Static_assert(sizeof(geofence_zone_t) == 24, "geofence zone layout changed, bump GEOFENCE_VERSION");
+_Static_assert(sizeof(geofence_polygon_t) == 28, "geofence polygon layout changed, bump GEOFENCE_VERSION");
+
+typedef struct {
+    bool initialized;
+    portMUX_TYPE lock; //fixes come in on the NMEA task, the main loop reads the zone
+    geofence_t fence; //never changes after geofence_init(), looked up without the lock
+    esp_partition_mmap_handle_t mmap_handle;
+    int32_t active; //zone index, -1 outside every zone
+    int32_t candidate; //zone the last fixes were in, waiting on GEOFENCE_CONFIRM_FIXES
+    uint32_t candidate_fixes;
+    geofence_stats_t stats;
+} geofence_state_t;
+
+/**
+ * @brief polygon box center, only used to sort the polygons while the tree is packed
+*/
+typedef struct {
+    int32_t lat;
+    int32_t lon;
+    uint16_t polygon;
+} geofence_entry_t;
+
+static geofence_state_t x_geofence = { .lock = portMUX_INITIALIZER_UNLOCKED, .active = -1, .candidate = -1 };
+
+static bool geofence_box_contains(const geofence_box_t *box, geofence_point_t point)
+{
+    return point.lat >= box->min.lat && point.lat <= box->max.lat && point.lon >= box->min.lon && point.lon <= box->max.lon;
+}
+
+static void geofence_box_extend(geofence_box_t *box, const geofence_box_t *other)
+{
+    if(other->min.lat < box->min.lat) box->min.lat = other->min.lat;
+    if(other->min.lon < box->min.lon) box->min.lon = other->min.lon;
+    if(other->max.lat > box->max.lat) box->max.lat = other->max.lat;
+    if(other->max.lon > box->max.lon) box->max.lon = other->max.lon;
+}
+
+static int geofence_compare_lon(const void *a, const void *b)
+{
+    int32_t la = ((const geofence_entry_t *)a)->lon, lb = ((const geofence_entry_t *)b)->lon;
+    return (la > lb) - (la < lb);
+}
+
+static int geofence_compare_lat(const void *a, const void *b)
+{
+    int32_t la = ((const geofence_entry_t *)a)->lat, lb = ((const geofence_entry_t *)b)->lat;
+    return (la > lb) - (la < lb);
+}
+
+/**
+ * @name geofence_point_in_polygon
+ *
+ * @brief crossing number test in integers. An edge that straddles the point's latitude flips the result if it crosses east of the point,
+ * which comes down to the sign of a cross product. Points on the south and west edges count as inside, the north and east ones don't,
+ * so two polygons sharing an edge never both claim a point on it.
+ *
+ * @param vertices polygon, the last vertex joins back to the first
+ * @param count number of vertices
+ * @param point point to test, inside the polygon's box so no difference is wider than GEOFENCE_MAX_SPAN
+ *
+ * @return bool indicating if the point is inside
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+bool geofence_point_in_polygon(const geofence_point_t *vertices, uint32_t count, geofence_point_t point)
+{
+    bool inside = false;
+
+    for(uint32_t i = 0, j = count - 1; i < count; j = i++)
+    {
+        const geofence_point_t *a = &vertices[j], *b = &vertices[i];
+
+        if((b->lat > point.lat) != (a->lat > point.lat))
+        {
+            //both terms are under 2^62 with the spans limited, their difference fits
+            int64_t cross = ((int64_t)b->lon - a->lon) * ((int64_t)point.lat - a->lat) - ((int64_t)point.lon - a->lon) * ((int64_t)b->lat - a->lat);
+
+            if(b->lat > a->lat ? cross > 0 : cross < 0)
+                inside = !inside;
+        }
+    }
+
+    return inside;
+}
+
+/**
+ * @name geofence_image_size
+ *
+ * @brief bytes an image with these tables takes
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+size_t geofence_image_size(uint16_t zone_count, uint32_t polygon_count, uint32_t vertex_count)
+{
+    return sizeof(geofence_header_t) + zone_count * sizeof(geofence_zone_t) + polygon_count * sizeof(geofence_polygon_t) +
+           vertex_count * sizeof(geofence_point_t);
+}
+
+/**
+ * @name geofence_image_build
+ *
+ * @brief lays out an image for the geofence partition, for the host tool that writes the partition and for the benchmark.
+ * Polygon boxes are worked out here, the polygons' vertices follow each other in the vertex table.
+ *
+ * @param zones zone table
+ * @param zone_count number of zones
+ * @param polygon_zones zone index of each polygon
+ * @param polygon_vertices vertex count of each polygon
+ * @param polygon_count number of polygons
+ * @param vertices every polygon's vertices, one polygon after the other
+ * @param vertex_count total number of vertices
+ * @param image buffer the image is built in
+ * @param size size of the buffer, at least geofence_image_size()
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if the buffer is too small or the polygon vertex counts don't add up to vertex_count
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t geofence_image_build(const geofence_zone_t *zones, uint16_t zone_count, const uint16_t *polygon_zones, const uint32_t *polygon_vertices,
+                               uint32_t polygon_count, const geofence_point_t *vertices, uint32_t vertex_count, uint8_t *image, size_t size)
+{
+    size_t used = geofence_image_size(zone_count, polygon_count, vertex_count);
+    geofence_header_t *header = (geofence_header_t *)image;
+    geofence_zone_t *zone_table = (geofence_zone_t *)(image + sizeof(geofence_header_t));
+    geofence_polygon_t *polygon_table = (geofence_polygon_t *)(zone_table + zone_count);
+    geofence_point_t *vertex_table = (geofence_point_t *)(polygon_table + polygon_count);
+    uint32_t first = 0;
+
+    if(image == NULL || size < used)
+        return ESP_ERR_INVALID_SIZE;
+
+    memset(image, 0, used);
+    memcpy(zone_table, zones, zone_count * sizeof(geofence_zone_t));
+    memcpy(vertex_table, vertices, vertex_count * sizeof(geofence_point_t));
+
+    for(uint32_t p = 0; p < polygon_count; p++)
+    {
+        geofence_polygon_t *polygon = &polygon_table[p];
+
+        if(polygon_vertices[p] == 0 || (uint64_t)first + polygon_vertices[p] > vertex_count)
+            return ESP_ERR_INVALID_SIZE;
+
+        polygon->zone = polygon_zones[p];
+        polygon->first_vertex = first;
+        polygon->vertex_count = polygon_vertices[p];
+        polygon->box.min = polygon->box.max = vertices[first];
+        for(uint32_t v = first; v < first + polygon_vertices[p]; v++)
+        {
+            geofence_box_t point = { .min = vertices[v], .max = vertices[v] };
+            geofence_box_extend(&polygon->box, &point);
+        }
+        first += polygon_vertices[p];
+    }
+
+    if(first != vertex_count)
+        return ESP_ERR_INVALID_SIZE;
+
+    header->magic = GEOFENCE_MAGIC;
+    header->version = GEOFENCE_VERSION;
+    header->zone_count = zone_count;
+    header->polygon_count = polygon_count;
+    header->vertex_count = vertex_count;
+    header->crc = esp_rom_crc32_le(0, image + sizeof(geofence_header_t), used - sizeof(geofence_header_t));
+
+    return ESP_OK;
+}
+
+//checks a polygon's table entry against its vertices, the lookup trusts the box and the span limit
+static bool geofence_polygon_is_valid(const geofence_t *fence, const geofence_polygon_t *polygon)
+{
+    if(polygon->zone >= fence->zone_count || polygon->vertex_count < 3 ||
+       (uint64_t)polygon->first_vertex + polygon->vertex_count > fence->vertex_count)
+        return false;
+
+    if((int64_t)polygon->box.max.lat - polygon->box.min.lat >= GEOFENCE_MAX_SPAN ||
+       (int64_t)polygon->box.max.lon - polygon->box.min.lon >= GEOFENCE_MAX_SPAN ||
+       polygon->box.max.lat < polygon->box.min.lat || polygon->box.max.lon < polygon->box.min.lon)
+        return false;
+
+    for(uint32_t v = polygon->first_vertex; v < polygon->first_vertex + polygon->vertex_count; v++)
+    {
+        if(!geofence_box_contains(&polygon->box, fence->vertices[v]))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @name geofence_pack
+ *
+ * @brief bulk loads the R-tree with sort-tile-recursive: the box centers are cut into vertical slices by longitude, sorted by latitude
+ * within each slice and packed GEOFENCE_FANOUT to a node, then every level above packs the one below the same way in order.
+ * Nodes come out full and close to square, so a lookup only walks a handful of them whatever the number of polygons.
+ *
+ * @param fence fence with its tables set, order and nodes get allocated
+ *
+ * @return ESP_OK or ESP_ERR_NO_MEM
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+static esp_err_t geofence_pack(geofence_t *fence)
+{
+    uint32_t count = fence->polygon_count, total = 0, level_count = count;
+    uint32_t leaves = (count + GEOFENCE_FANOUT - 1) / GEOFENCE_FANOUT;
+    uint32_t slices = (uint32_t)ceil(sqrt((double)leaves));
+    uint32_t slice_size = slices * GEOFENCE_FANOUT;
+    geofence_entry_t *entries;
+
+    fence->levels = 0;
+    do
+    {
+        level_count = (level_count + GEOFENCE_FANOUT - 1) / GEOFENCE_FANOUT;
+        fence->level_start[fence->levels++] = total;
+        total += level_count;
+    } while(level_count > 1);
+    fence->level_start[fence->levels] = total;
+
+    if((entries = malloc(count * sizeof(geofence_entry_t))) == NULL)
+        return ESP_ERR_NO_MEM;
+
+    fence->order = malloc(count * sizeof(uint16_t));
+    fence->nodes = malloc(total * sizeof(geofence_box_t));
+    if(fence->order == NULL || fence->nodes == NULL)
+    {
+        free(entries);
+        return ESP_ERR_NO_MEM;
+    }
+    fence->index_bytes = count * sizeof(uint16_t) + total * sizeof(geofence_box_t);
+
+    for(uint32_t p = 0; p < count; p++)
+    {
+        const geofence_box_t *box = &fence->polygons[p].box;
+        entries[p].lat = (int32_t)(((int64_t)box->min.lat + box->max.lat) / 2);
+        entries[p].lon = (int32_t)(((int64_t)box->min.lon + box->max.lon) / 2);
+        entries[p].polygon = p;
+    }
+
+    qsort(entries, count, sizeof(geofence_entry_t), geofence_compare_lon);
+    for(uint32_t start = 0; start < count; start += slice_size)
+        qsort(&entries[start], start + slice_size > count ? count - start : slice_size, sizeof(geofence_entry_t), geofence_compare_lat);
+
+    for(uint32_t p = 0; p < count; p++)
+        fence->order[p] = entries[p].polygon;
+    free(entries);
+
+    //level 0 covers the polygon boxes, each level above covers the one below
+    for(uint32_t level = 0; level < fence->levels; level++)
+    {
+        uint32_t children = level == 0 ? count : fence->level_start[level] - fence->level_start[level - 1];
+
+        for(uint32_t node = 0; node < fence->level_start[level + 1] - fence->level_start[level]; node++)
+        {
+            geofence_box_t *box = &fence->nodes[fence->level_start[level] + node];
+            uint32_t end = (node + 1) * GEOFENCE_FANOUT > children ? children : (node + 1) * GEOFENCE_FANOUT;
+
+            for(uint32_t child = node * GEOFENCE_FANOUT; child < end; child++)
+            {
+                const geofence_box_t *child_box = level == 0 ? &fence->polygons[fence->order[child]].box :
+                                                               &fence->nodes[fence->level_start[level - 1] + child];
+                if(child == node * GEOFENCE_FANOUT)
+                    *box = *child_box;
+                else
+                    geofence_box_extend(box, child_box);
+            }
+        }
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @name geofence_load
+ *
+ * @brief checks an image and builds its index. The image has to stay where it is for as long as the fence is used, only the index is copied.
+ *
+ * @param fence fence to load into
+ * @param image image as geofence_image_build() lays it out, 4 byte aligned
+ * @param size size of the image or of the partition holding it
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if there is no image, ESP_ERR_INVALID_SIZE or ESP_ERR_INVALID_CRC if it is damaged,
+ * ESP_ERR_INVALID_ARG if a polygon doesn't check out, ESP_ERR_NO_MEM
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t geofence_load(geofence_t *fence, const uint8_t *image, size_t size)
+{
+    const geofence_header_t *header = (const geofence_header_t *)image;
+    esp_err_t err;
+    size_t used;
+
+    memset(fence, 0, sizeof(geofence_t));
+
+    if(image == NULL || size < sizeof(geofence_header_t))
+        return ESP_ERR_INVALID_ARG;
+
+    //an erased partition reads back as 0xFF, same as no fences at all
+    if(header->magic != GEOFENCE_MAGIC || header->version != GEOFENCE_VERSION)
+        return ESP_ERR_NOT_FOUND;
+
+    if(header->zone_count == 0 || header->polygon_count == 0 || header->polygon_count > GEOFENCE_MAX_POLYGONS ||
+       header->vertex_count > size / sizeof(geofence_point_t))
+        return ESP_ERR_INVALID_SIZE;
+
+    if((used = geofence_image_size(header->zone_count, header->polygon_count, header->vertex_count)) > size)
+        return ESP_ERR_INVALID_SIZE;
+
+    if(header->crc != esp_rom_crc32_le(0, image + sizeof(geofence_header_t), used - sizeof(geofence_header_t)))
+        return ESP_ERR_INVALID_CRC;
+
+    fence->zone_count = header->zone_count;
+    fence->polygon_count = header->polygon_count;
+    fence->vertex_count = header->vertex_count;
+    fence->zones = (const geofence_zone_t *)(image + sizeof(geofence_header_t));
+    fence->polygons = (const geofence_polygon_t *)(fence->zones + fence->zone_count);
+    fence->vertices = (const geofence_point_t *)(fence->polygons + fence->polygon_count);
+
+    for(uint32_t z = 0; z < fence->zone_count; z++)
+    {
+        if(fence->zones[z].id == GEOFENCE_NO_ZONE)
+            return ESP_ERR_INVALID_ARG;
+    }
+
+    for(uint32_t p = 0; p < fence->polygon_count; p++)
+    {
+        if(!geofence_polygon_is_valid(fence, &fence->polygons[p]))
+        {
+            ESP_LOGD(GEOFENCE_TAG, "geofence_load(): polygon %lu doesn't match its vertices", (unsigned long)p);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    if((err = geofence_pack(fence)) != ESP_OK)
+    {
+        ESP_LOGD(GEOFENCE_TAG, "geofence_load(): geofence_pack returned %s", esp_err_to_name(err));
+        geofence_free(fence);
+        return err;
+    }
+
+    return ESP_OK;
+}
+
+void geofence_free(geofence_t *fence)
+{
+    free(fence->order);
+    free(fence->nodes);
+    memset(fence, 0, sizeof(geofence_t));
+}
+
+/**
+ * @name geofence_lookup
+ *
+ * @brief finds the zone a point is in. Only nodes whose box holds the point are walked and only polygons whose box holds it get the
+ * edge test, which is skipped as well when the polygon's zone couldn't beat the best one found so far.
+ *
+ * @param fence loaded fence
+ * @param point position in 1e-7 degrees
+ * @param node_visits if not NULL, set to the number of tree nodes checked
+ * @param polygon_tests if not NULL, set to the number of polygons the edge test ran on
+ *
+ * @return zone index, -1 outside every zone. Where zones overlap the highest priority wins, then the lowest index.
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+int32_t geofence_lookup(const geofence_t *fence, geofence_point_t point, uint32_t *node_visits, uint32_t *polygon_tests)
+{
+    uint32_t stack[GEOFENCE_FANOUT * GEOFENCE_MAX_LEVELS]; //level in the top byte, node below it. A level adds at most GEOFENCE_FANOUT - 1.
+    uint32_t depth = 0, visits = 0, tests = 0;
+    int32_t best = -1;
+
+    if(fence->levels > 0 && geofence_box_contains(&fence->nodes[fence->level_start[fence->levels - 1]], point))
+        stack[depth++] = (fence->levels - 1) << 24;
+
+    while(depth > 0)
+    {
+        uint32_t level = stack[--depth] >> 24, node = stack[depth] & 0xFFFFFF;
+        uint32_t first = node * GEOFENCE_FANOUT;
+        visits++;
+
+        if(level == 0)
+        {
+            uint32_t end = first + GEOFENCE_FANOUT > fence->polygon_count ? fence->polygon_count : first + GEOFENCE_FANOUT;
+
+            for(uint32_t i = first; i < end; i++)
+            {
+                const geofence_polygon_t *polygon = &fence->polygons[fence->order[i]];
+
+                if(!geofence_box_contains(&polygon->box, point))
+                    continue;
+
+                if(best >= 0 && (fence->zones[polygon->zone].priority < fence->zones[best].priority ||
+                   (fence->zones[polygon->zone].priority == fence->zones[best].priority && polygon->zone >= best)))
+                    continue;
+
+                tests++;
+                if(geofence_point_in_polygon(&fence->vertices[polygon->first_vertex], polygon->vertex_count, point))
+                    best = polygon->zone;
+            }
+        }
+        else
+        {
+            uint32_t children = fence->level_start[level] - fence->level_start[level - 1];
+            uint32_t end = first + GEOFENCE_FANOUT > children ? children : first + GEOFENCE_FANOUT;
+
+            for(uint32_t child = first; child < end; child++)
+            {
+                if(geofence_box_contains(&fence->nodes[fence->level_start[level - 1] + child], point))
+                    stack[depth++] = ((level - 1) << 24) | child;
+            }
+        }
+    }
+
+    if(node_visits != NULL)
+        *node_visits = visits;
+    if(polygon_tests != NULL)
+        *polygon_tests = tests;
+
+    return best;
+}
+
+/**
+ * @name geofence_bench
+ *
+ * @brief looks up random points in the boxes of random leaf nodes, so the points land among the polygons even with the sites a continent apart.
+ * Runs the same anywhere geofence_load() does, on the host against a made up image or on the device against the partition.
+ *
+ * @param fence loaded fence
+ * @param points number of lookups, GEOFENCE_BENCH_POINTS is a good start
+ * @param seed seed for the points, the same seed gives the same points
+ * @param bench filled with the timings
+ *
+ * @return ESP_OK or ESP_ERR_INVALID_ARG if the fence is empty
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t geofence_bench(const geofence_t *fence, uint32_t points, uint32_t seed, geofence_bench_t *bench)
+{
+    uint32_t leaves;
+    uint64_t visits = 0, tests = 0;
+    int64_t start;
+
+    if(fence->levels == 0 || points == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    leaves = fence->level_start[1] - fence->level_start[0];
+    memset(bench, 0, sizeof(geofence_bench_t));
+    bench->points = points;
+
+    //two passes over the same points, the first timed as a whole for the average and the second one lookup at a time for the worst case
+    for(int pass = 0; pass < 2; pass++)
+    {
+        uint32_t state = seed != 0 ? seed : 1;
+        start = esp_timer_get_time();
+
+        for(uint32_t i = 0; i < points; i++)
+        {
+            geofence_point_t point;
+            uint32_t node_visits, polygon_tests;
+
+            //xorshift32, scaled onto a random leaf's box without a division
+            state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+            const geofence_box_t *box = &fence->nodes[((uint64_t)state * leaves) >> 32];
+            state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+            point.lat = (int32_t)(box->min.lat + (int64_t)(((uint64_t)state * ((int64_t)box->max.lat - box->min.lat + 1)) >> 32));
+            state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+            point.lon = (int32_t)(box->min.lon + (int64_t)(((uint64_t)state * ((int64_t)box->max.lon - box->min.lon + 1)) >> 32));
+
+            if(pass == 0)
+            {
+                if(geofence_lookup(fence, point, &node_visits, &polygon_tests) >= 0)
+                    bench->hits++;
+                visits += node_visits;
+                tests += polygon_tests;
+            }
+            else
+            {
+                int64_t lookup_start = esp_timer_get_time();
+                geofence_lookup(fence, point, NULL, NULL);
+                uint32_t lookup_us = (uint32_t)(esp_timer_get_time() - lookup_start);
+                if(lookup_us > bench->max_us)
+                    bench->max_us = lookup_us;
+            }
+        }
+
+        if(pass == 0)
+            bench->avg_ns = (esp_timer_get_time() - start) * 1000.0f / points;
+    }
+
+    bench->avg_node_visits = (float)visits / points;
+    bench->avg_polygon_tests = (float)tests / points;
+
+    ESP_LOGI(GEOFENCE_TAG, "%lu polygons, %lu random points: %.0f ns/lookup, worst %lu us, %.1f nodes and %.1f polygons per lookup, %lu inside a zone \n",
+             (unsigned long)fence->polygon_count, (unsigned long)points, bench->avg_ns, (unsigned long)bench->max_us, bench->avg_node_visits,
+             bench->avg_polygon_tests, (unsigned long)bench->hits);
+
+    return ESP_OK;
+}
+
+/**
+ * @name geofence_apply_zone
+ *
+ * @brief puts a zone's limits in place of the ones they cover, the rest (hysteresis, dwell) stay as they are
+ *
+ * @param zone zone the car is in
+ * @param params combined angle limits
+ * @param axes_params per axis limits
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void geofence_apply_zone(const geofence_zone_t *zone, decision_params_t *params, decision_axes_params_t *axes_params)
+{
+    params->threshold_angle = zone->threshold / 16.0f;
+    params->lower_speed = zone->lower_speed;
+    params->upper_speed = zone->upper_speed;
+
+    axes_params->axis[DECISION_AXIS_PITCH].upper = zone->pitch_upper / 16.0f;
+    axes_params->axis[DECISION_AXIS_PITCH].lower = zone->pitch_lower / 16.0f;
+    axes_params->axis[DECISION_AXIS_ROLL].upper = zone->roll_upper / 16.0f;
+    axes_params->axis[DECISION_AXIS_ROLL].lower = zone->roll_lower / 16.0f;
+
+    for(int axis = 0; axis < DECISION_AXIS_COUNT; axis++)
+    {
+        axes_params->axis[axis].lower_speed = zone->lower_speed;
+        axes_params->axis[axis].upper_speed = zone->upper_speed;
+    }
+}
+
+/**
+ * @name geofence_init
+ *
+ * @brief maps the geofence partition and indexes it. The tables are read through the flash cache where they are, only the index
+ * takes RAM.
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND without a partition or an image in it, otherwise the err from geofence_load()
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t geofence_init(void)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, GEOFENCE_PARTITION_SUBTYPE, GEOFENCE_PARTITION_LABEL);
+    esp_partition_mmap_handle_t handle;
+    const void *image;
+    esp_err_t err;
+
+    if(x_geofence.initialized)
+        return ESP_ERR_INVALID_STATE;
+
+    if(partition == NULL)
+    {
+        ESP_LOGD(GEOFENCE_TAG, "geofence_init(): esp_partition_find_first could not find the %s partition", GEOFENCE_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if((err = esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &image, &handle)) != ESP_OK)
+    {
+        ESP_LOGD(GEOFENCE_TAG, "geofence_init(): esp_partition_mmap returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if((err = geofence_load(&x_geofence.fence, image, partition->size)) != ESP_OK)
+    {
+        ESP_LOGD(GEOFENCE_TAG, "geofence_init(): geofence_load returned %s", esp_err_to_name(err));
+        esp_partition_munmap(handle);
+        return err;
+    }
+
+    ESP_LOGI(GEOFENCE_TAG, "%u zones, %lu polygons, %lu vertices, %lu bytes of index \n", x_geofence.fence.zone_count,
+             (unsigned long)x_geofence.fence.polygon_count, (unsigned long)x_geofence.fence.vertex_count, (unsigned long)x_geofence.fence.index_bytes);
+
+    portENTER_CRITICAL(&x_geofence.lock);
+    x_geofence.mmap_handle = handle;
+    x_geofence.active = -1;
+    x_geofence.candidate = -1;
+    x_geofence.candidate_fixes = 0;
+    memset(&x_geofence.stats, 0, sizeof(geofence_stats_t));
+    x_geofence.initialized = true;
+    portEXIT_CRITICAL(&x_geofence.lock);
+
+    return ESP_OK;
+}
+
+/**
+ * @name geofence_gps_fix
+ *
+ * @brief takes a fix from the NMEA parser and works out the zone it is in. A new zone has to come back GEOFENCE_CONFIRM_FIXES times in a row
+ * before it becomes the active one, and fixes without a position leave the zone as it is. Does nothing before geofence_init().
+ *
+ * @param gps fix as posted by the NMEA parser
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void geofence_gps_fix(const gps_t *gps)
+{
+    if(!x_geofence.initialized)
+        return;
+
+    //same rounding the trip log does, so a logged drive looks the zones up the same way
+    geofence_point_t point = {
+        .lat = (int32_t)lroundf(gps->latitude * 1e7f),
+        .lon = (int32_t)lroundf(gps->longitude * 1e7f),
+    };
+    bool usable = gps->fix != GPS_FIX_INVALID;
+    uint32_t polygon_tests = 0;
+    int32_t zone = -1;
+    int64_t start = esp_timer_get_time();
+
+    if(usable)
+        zone = geofence_lookup(&x_geofence.fence, point, NULL, &polygon_tests);
+    uint32_t lookup_us = (uint32_t)(esp_timer_get_time() - start);
+
+    portENTER_CRITICAL(&x_geofence.lock);
+    x_geofence.stats.fixes++;
+    if(usable)
+    {
+        x_geofence.stats.lookups++;
+        x_geofence.stats.lookup_us += lookup_us;
+        if(lookup_us > x_geofence.stats.max_lookup_us)
+            x_geofence.stats.max_lookup_us = lookup_us;
+        if(polygon_tests > x_geofence.stats.max_polygon_tests)
+            x_geofence.stats.max_polygon_tests = polygon_tests;
+
+        if(zone == x_geofence.active)
+            x_geofence.candidate_fixes = 0;
+        else
+        {
+            if(zone != x_geofence.candidate)
+            {
+                x_geofence.candidate = zone;
+                x_geofence.candidate_fixes = 0;
+            }
+
+            if(++x_geofence.candidate_fixes >= GEOFENCE_CONFIRM_FIXES)
+            {
+                x_geofence.active = zone;
+                x_geofence.candidate_fixes = 0;
+                x_geofence.stats.switches++;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&x_geofence.lock);
+}
+
+/**
+ * @name geofence_get_active
+ *
+ * @brief zone the car is in
+ *
+ * @param zone set to the active zone, id GEOFENCE_NO_ZONE outside every zone
+ *
+ * @return ESP_OK or ESP_ERR_INVALID_STATE before geofence_init()
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t geofence_get_active(geofence_zone_t *zone)
+{
+    int32_t active;
+
+    if(!x_geofence.initialized)
+        return ESP_ERR_INVALID_STATE;
+
+    portENTER_CRITICAL(&x_geofence.lock);
+    active = x_geofence.active;
+    portEXIT_CRITICAL(&x_geofence.lock);
+
+    //the zone table is in flash, read it outside the critical section
+    if(active < 0)
+    {
+        memset(zone, 0, sizeof(geofence_zone_t));
+        zone->id = GEOFENCE_NO_ZONE;
+    }
+    else
+        *zone = x_geofence.fence.zones[active];
+
+    return ESP_OK;
+}
+
+esp_err_t geofence_get_stats(geofence_stats_t *stats)
+{
+    portENTER_CRITICAL(&x_geofence.lock);
+    *stats = x_geofence.stats;
+    portEXIT_CRITICAL(&x_geofence.lock);
+
+    return ESP_OK;
+}
+
+/**
+ * @name geofence_log
+ *
+ * @brief writes the limits the decision switched to into the trip log, logged where they take effect so replay switches at the same record
+ *
+ * @param zone zone switched to, id GEOFENCE_NO_ZONE for the limits in parameters.h
+ *
+ * @return err variable from triplog_append()
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t geofence_log(const geofence_zone_t *zone)
+{
+    triplog_record_t record;
+
+    memset(&record, 0, sizeof(record));
+    record.timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    record.type = TRIPLOG_RECORD_ZONE;
+    record.payload.zone.id = zone->id;
+    record.payload.zone.threshold = zone->threshold;
+    record.payload.zone.pitch_upper = zone->pitch_upper;
+    record.payload.zone.pitch_lower = zone->pitch_lower;
+    record.payload.zone.roll_upper = zone->roll_upper;
+    record.payload.zone.roll_lower = zone->roll_lower;
+    record.payload.zone.lower_speed = zone->lower_speed;
+    record.payload.zone.upper_speed = zone->upper_speed;
+
+    return triplog_append(&record);
+}
@@ -0,0 +1,131 @@
+#ifndef GEOFENCE_H
+#define GEOFENCE_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+#include "nmea_parser.h"
+#include "decision.h"
+
+static const char* GEOFENCE_TAG = "Geofence";
+
+#define GEOFENCE_PARTITION_LABEL "geofence"
+#define GEOFENCE_PARTITION_SUBTYPE (0x41) //custom data subtype, has to match partitions.csv
+
+#define GEOFENCE_MAGIC (0x45434647) //"GFCE" little endian
+#define GEOFENCE_VERSION (1)
+#define GEOFENCE_NO_ZONE (0xFFFF) //zone id while the car is outside every zone, the limits in parameters.h apply
+#define GEOFENCE_MAX_POLYGONS (0xFFFF) //polygon indices are 16 bit in the index
+#define GEOFENCE_MAX_SPAN ((int64_t)INT32_MAX) //widest a polygon may be in 1e-7 degrees, keeps the crossing products inside 64 bits
+#define GEOFENCE_FANOUT (16) //boxes per R-tree node
+#define GEOFENCE_MAX_LEVELS (5) //16^5 entries is past GEOFENCE_MAX_POLYGONS
+#define GEOFENCE_CONFIRM_FIXES (2) //fixes in a row that have to agree on a new zone before it is switched to, GPS wanders across a boundary
+#define GEOFENCE_BENCH_POINTS (10000)
+
+/**
+ * @brief position in 1e-7 degrees, the way the trip log keeps it. Everything the fence does with positions is integer math.
+*/
+typedef struct {
+    int32_t lat;
+    int32_t lon;
+} geofence_point_t;
+
+typedef struct {
+    geofence_point_t min;
+    geofence_point_t max;
+} geofence_box_t;
+
+/**
+ * @brief image header at the start of the geofence partition, followed by the zone table, the polygon table and the vertices
+*/
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t zone_count;
+    uint32_t polygon_count;
+    uint32_t vertex_count;
+    uint32_t crc; //crc32 of everything after the header
+    uint8_t reserved[12];
+} geofence_header_t;
+
+/**
+ * @brief limits that apply inside a zone. Angles are 1 degree = 16 LSB like the BNO055 euler registers, so the trip log can hold
+ * them exactly and replay judges with the same limits the device had.
+*/
+typedef struct {
+    uint16_t id; //reported in the trip log, GEOFENCE_NO_ZONE isn't allowed
+    uint8_t priority; //where zones overlap the highest one wins
+    uint8_t reserved;
+    int16_t threshold; //combined angle limit
+    int16_t pitch_upper; //per axis limits, used with axis_limits
+    int16_t pitch_lower;
+    int16_t roll_upper;
+    int16_t roll_lower;
+    uint16_t reserved2;
+    float lower_speed; //same units as lower_speed in parameters.h, applies to the combined angle and both axes
+    float upper_speed;
+} geofence_zone_t;
+
+/**
+ * @brief one polygon of a zone, a zone can have any number of them. The box is checked against the vertices on load.
+*/
+typedef struct {
+    uint16_t zone; //index into the zone table
+    uint16_t reserved;
+    uint32_t first_vertex; //index into the vertex table
+    uint32_t vertex_count; //at least 3, the last vertex joins back to the first
+    geofence_box_t box;
+} geofence_polygon_t;
+
+/**
+ * @brief a loaded image. The tables are read in place, from the memory mapped partition on the device, and only the index lives in RAM.
+ * Internal nodes of a packed R-tree are built over the polygon boxes on load, the leaves are the boxes in the polygon table.
+*/
+typedef struct {
+    const geofence_zone_t *zones;
+    const geofence_polygon_t *polygons;
+    const geofence_point_t *vertices;
+    uint16_t zone_count;
+    uint32_t polygon_count;
+    uint32_t vertex_count;
+    uint16_t *order; //polygons in leaf order, GEOFENCE_FANOUT of them under each level 0 node
+    geofence_box_t *nodes; //every level of the tree, level 0 first, the root last
+    uint32_t level_start[GEOFENCE_MAX_LEVELS + 1]; //first node of each level in nodes
+    uint32_t levels;
+    size_t index_bytes; //RAM the index takes
+} geofence_t;
+
+typedef struct {
+    uint32_t fixes;
+    uint32_t lookups; //fixes good enough to look up
+    uint32_t switches;
+    uint64_t lookup_us;
+    uint32_t max_lookup_us;
+    uint32_t max_polygon_tests; //most polygons one lookup had to walk the edges of
+} geofence_stats_t;
+
+typedef struct {
+    uint32_t points;
+    uint32_t hits; //points inside some zone
+    float avg_ns; //per lookup
+    uint32_t max_us;
+    float avg_node_visits;
+    float avg_polygon_tests;
+} geofence_bench_t;
+
+esp_err_t geofence_load(geofence_t *, const uint8_t *, size_t);
+     void geofence_free(geofence_t *);
+  int32_t geofence_lookup(const geofence_t *, geofence_point_t, uint32_t *, uint32_t *);
+     bool geofence_point_in_polygon(const geofence_point_t *, uint32_t, geofence_point_t);
+   size_t geofence_image_size(uint16_t, uint32_t, uint32_t);
+esp_err_t geofence_image_build(const geofence_zone_t *, uint16_t, const uint16_t *, const uint32_t *, uint32_t, const geofence_point_t *, uint32_t, uint8_t *, size_t);
+esp_err_t geofence_bench(const geofence_t *, uint32_t, uint32_t, geofence_bench_t *);
+     void geofence_apply_zone(const geofence_zone_t *, decision_params_t *, decision_axes_params_t *);
+
+esp_err_t geofence_init(void);
+     void geofence_gps_fix(const gps_t *);
+esp_err_t geofence_get_active(geofence_zone_t *);
+esp_err_t geofence_get_stats(geofence_stats_t *);
+esp_err_t geofence_log(const geofence_zone_t *);
+
+#endif //GEOFENCE_H
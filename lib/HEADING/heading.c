@@ -0,0 +1,216 @@
+#include <string.h>
+#include <math.h>
+#include "heading.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#define HEADING_DEG_TO_RAD (0.01745329252f)
+
+typedef struct {
+    bool initialized;
+    portMUX_TYPE lock; //fixes come in on the NMEA task, IMU samples on the main loop
+    uint32_t budget_cycles;
+    bool has_mag;
+    float mag; //last magnetic heading from the IMU, before the variation
+    uint32_t mag_ms;
+    bool has_prev_fix;
+    float prev_fix_mag; //magnetic heading at the last fix that was moving, for the turn rate
+    uint32_t prev_fix_ms;
+    heading_estimate_t estimate;
+} heading_state_t;
+
+static heading_state_t x_heading = { .lock = portMUX_INITIALIZER_UNLOCKED };
+
+//any angle to -180 up to 180
+float heading_wrap180(float angle)
+{
+    return angle - 360.0f * floorf((angle + 180.0f) / 360.0f);
+}
+
+static float heading_wrap360(float angle)
+{
+    return angle - 360.0f * floorf(angle / 360.0f);
+}
+
+static void heading_account(esp_cpu_cycle_count_t start)
+{
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+
+    x_heading.estimate.calls++;
+    x_heading.estimate.total_cycles += cycles;
+    if(cycles > x_heading.estimate.max_cycles)
+        x_heading.estimate.max_cycles = cycles;
+    if(x_heading.budget_cycles && cycles > x_heading.budget_cycles)
+        x_heading.estimate.over_budget++;
+}
+
+/**
+ * @name heading_rotate
+ *
+ * @brief turns pitch and roll of the board into grade along the direction of travel and lean across it. Pitch is nose up and roll right
+ * side down, and the offset is how far the direction of travel is clockwise of where the board points.
+ *
+ * @param angle pitch (x) and roll (y) of the board
+ * @param offset direction of travel minus board heading, degrees
+ * @param track set to the grade along the track (x) and the lean across it, right side down (y). z is copied.
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void heading_rotate(const bno055_vec3_t *angle, float offset, bno055_vec3_t *track)
+{
+    float s = sinf(offset * HEADING_DEG_TO_RAD), c = cosf(offset * HEADING_DEG_TO_RAD);
+    float pitch = angle->x, roll = angle->y;
+
+    track->x = pitch * c - roll * s;
+    track->y = pitch * s + roll * c;
+    track->z = angle->z;
+}
+
+/**
+ * @name heading_init
+ *
+ * @brief starts the heading estimator with the offset unknown, nothing is rotated until the car has driven straight for a fix
+ *
+ * @param budget_cycles CPU cycles a call may take, calls over it are counted. 0 for no budget.
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t heading_init(uint32_t budget_cycles)
+{
+    portENTER_CRITICAL(&x_heading.lock);
+    memset(&x_heading.estimate, 0, sizeof(heading_estimate_t));
+    x_heading.budget_cycles = budget_cycles;
+    x_heading.has_mag = false;
+    x_heading.has_prev_fix = false;
+    x_heading.initialized = true;
+    portEXIT_CRITICAL(&x_heading.lock);
+
+    return ESP_OK;
+}
+
+/**
+ * @name heading_gps_fix
+ *
+ * @brief takes a fix from the NMEA parser. While moving in a straight enough line the course against the last magnetic heading
+ * is a measure of the offset, a share of it is taken in each fix. Does nothing before heading_init().
+ *
+ * @param gps fix as posted by the NMEA parser
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void heading_gps_fix(const gps_t *gps)
+{
+    if(!x_heading.initialized)
+        return;
+
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    portENTER_CRITICAL(&x_heading.lock);
+
+    if(gps->fix == GPS_FIX_INVALID)
+    {
+        x_heading.has_prev_fix = false;
+        heading_account(start);
+        portEXIT_CRITICAL(&x_heading.lock);
+        return;
+    }
+
+    x_heading.estimate.variation = gps->variation;
+
+    //course is only the direction of travel when there is travel, and it has to be compared against a heading from the same moment
+    if(gps->speed < HEADING_MIN_SPEED || !x_heading.has_mag || now_ms - x_heading.mag_ms > HEADING_MAX_AGE_MS)
+    {
+        x_heading.has_prev_fix = false;
+        heading_account(start);
+        portEXIT_CRITICAL(&x_heading.lock);
+        return;
+    }
+
+    bool turning = false;
+    if(x_heading.has_prev_fix && now_ms > x_heading.prev_fix_ms)
+    {
+        float rate = fabsf(heading_wrap180(x_heading.mag - x_heading.prev_fix_mag)) * 1000.0f / (now_ms - x_heading.prev_fix_ms);
+        turning = rate > HEADING_MAX_TURN_DPS;
+    }
+    x_heading.has_prev_fix = true;
+    x_heading.prev_fix_mag = x_heading.mag;
+    x_heading.prev_fix_ms = now_ms;
+
+    if(turning)
+        x_heading.estimate.turning++;
+    else
+    {
+        float measured = heading_wrap180(gps->cog - (x_heading.mag + gps->variation));
+
+        if(!x_heading.estimate.calibrated)
+            x_heading.estimate.offset = measured;
+        else
+            x_heading.estimate.offset = heading_wrap180(x_heading.estimate.offset + HEADING_GAIN * heading_wrap180(measured - x_heading.estimate.offset));
+        x_heading.estimate.calibrated = true;
+        x_heading.estimate.gps_updates++;
+    }
+
+    heading_account(start);
+    portEXIT_CRITICAL(&x_heading.lock);
+}
+
+/**
+ * @name heading_update
+ *
+ * @brief takes the magnetic heading of a new IMU sample. Constant work and no trig, cheap enough to run on every sample.
+ *
+ * @param angle euler angles from the BNO055 fusion, z is the magnetic heading
+ * @param time_ms time of the sample
+ * @param offset set to the direction of travel minus the board heading, 0 until it has been measured
+ *
+ * @return whether the offset has been measured
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+bool heading_update(const bno055_vec3_t *angle, uint32_t time_ms, float *offset)
+{
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    bool calibrated;
+
+    *offset = 0;
+    if(!x_heading.initialized)
+        return false;
+
+    portENTER_CRITICAL(&x_heading.lock);
+
+    x_heading.has_mag = true;
+    x_heading.mag = angle->z;
+    x_heading.mag_ms = time_ms;
+    x_heading.estimate.mag_heading = heading_wrap360(angle->z + x_heading.estimate.variation);
+    x_heading.estimate.heading = heading_wrap360(x_heading.estimate.mag_heading + x_heading.estimate.offset);
+
+    calibrated = x_heading.estimate.calibrated;
+    if(calibrated)
+        *offset = x_heading.estimate.offset;
+
+    heading_account(start);
+    portEXIT_CRITICAL(&x_heading.lock);
+
+    return calibrated;
+}
+
+esp_err_t heading_get(heading_estimate_t *estimate)
+{
+    if(!x_heading.initialized)
+        return ESP_ERR_INVALID_STATE;
+
+    portENTER_CRITICAL(&x_heading.lock);
+    *estimate = x_heading.estimate;
+    portEXIT_CRITICAL(&x_heading.lock);
+
+    return ESP_OK;
+}
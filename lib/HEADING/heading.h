@@ -0,0 +1,45 @@
+#ifndef HEADING_H
+#define HEADING_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+#include "bno055.h"
+#include "nmea_parser.h"
+
+static const char* HEADING_TAG = "Heading";
+
+#define HEADING_MIN_SPEED (3.0f) //m/s, slower than this course over ground wanders too much to say where the car is going
+#define HEADING_GAIN (0.1f) //share of each course measurement taken into the offset, about 10 fixes to settle
+#define HEADING_MAX_TURN_DPS (10.0f) //course lags the magnetometer in a turn, fixes taken turning faster than this are left out
+#define HEADING_MAX_AGE_MS (2000) //magnetic heading older than this when a fix comes in isn't compared against it
+
+/**
+ * @brief where the car is pointed and where it is going. The magnetometer gives the heading of the board on every IMU sample,
+ * GPS course over ground gives the direction of travel once a second while moving. The offset between the two is the yaw of the
+ * board against the direction of travel plus whatever the magnetometer is off by, and it is what turns pitch and roll into
+ * grade along the track and lean across it.
+*/
+typedef struct {
+    float mag_heading; //deg from true north, magnetic heading with the variation from the last fix added
+    float heading; //deg from true north, direction of travel: magnetic heading plus the offset
+    float offset; //deg, course minus magnetic heading as learned while moving, -180 to 180
+    bool calibrated; //offset has been measured against GPS at least once
+    float variation; //deg, east positive, from the last fix
+    uint32_t gps_updates;
+    uint32_t turning; //fixes left out because the car was turning
+    uint32_t max_cycles; //slowest call into the estimator
+    uint64_t total_cycles;
+    uint32_t calls;
+    uint32_t over_budget; //calls that took more than the cycle budget
+} heading_estimate_t;
+
+     float heading_wrap180(float);
+     void heading_rotate(const bno055_vec3_t *, float, bno055_vec3_t *);
+
+esp_err_t heading_init(uint32_t);
+     void heading_gps_fix(const gps_t *);
+     bool heading_update(const bno055_vec3_t *, uint32_t, float *);
+esp_err_t heading_get(heading_estimate_t *);
+
+#endif //HEADING_H
@@ -0,0 +1,324 @@
+#include <string.h>
+#include "health.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "triplog.h"
+
+typedef struct {
+    TaskHandle_t handle;
+    uint32_t run_time;
+} health_run_time_t;
+
+typedef struct {
+    SemaphoreHandle_t lock;
+    uint32_t period_ms;
+    health_t latest;
+    TaskStatus_t status[HEALTH_MAX_TASKS]; //kept here rather than on the sampling task's stack
+    health_run_time_t prev[HEALTH_MAX_TASKS]; //run time counters at the last sample, CPU use is the difference
+    uint32_t prev_count;
+    uint32_t prev_total;
+    uint32_t samples;
+} health_state_t;
+
+static health_state_t x_health;
+
+static uint32_t health_prev_run_time(TaskHandle_t handle, bool *found)
+{
+    for(uint32_t i = 0; i < x_health.prev_count; i++)
+    {
+        if(x_health.prev[i].handle == handle)
+        {
+            *found = true;
+            return x_health.prev[i].run_time;
+        }
+    }
+
+    *found = false;
+    return 0;
+}
+
+static uint16_t health_permille(uint32_t part, uint32_t whole)
+{
+    if(whole == 0)
+        return 0;
+
+    if(part > whole)
+        return 1000;
+
+    return (uint16_t)(((uint64_t)part * 1000) / whole);
+}
+
+/**
+ * @name health_sample_locked
+ *
+ * @brief takes a sample, x_health.lock has to be held
+ *
+ * @param health filled with the sample
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+static void health_sample_locked(health_t *health)
+{
+    uint32_t total = 0, count, elapsed;
+    TaskHandle_t idle[2] = {xTaskGetIdleTaskHandleForCPU(0), xTaskGetIdleTaskHandleForCPU(1)};
+
+    memset(health, 0, sizeof(health_t));
+    health->sample = ++x_health.samples;
+    health->time_us = esp_timer_get_time();
+
+    health->heap_free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    health->heap_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    health->heap_largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    health->heap_fragmentation_permille = health->heap_free ? 1000 - health_permille(health->heap_largest_block, health->heap_free) : 0;
+
+    health->task_count = uxTaskGetNumberOfTasks();
+    count = uxTaskGetSystemState(x_health.status, HEALTH_MAX_TASKS, &total);
+    if(count == 0)
+    {
+        ESP_LOGW(HEALTH_TAG, "%lu tasks running, only room for %d, task figures skipped", (unsigned long)health->task_count, HEALTH_MAX_TASKS);
+        return;
+    }
+
+    //run time is counted in esp_timer microseconds and the counters wrap after 71 minutes, unsigned differences take care of that
+    elapsed = total - x_health.prev_total;
+    health->min_stack_free = UINT32_MAX;
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        const TaskStatus_t *status = &x_health.status[i];
+        health_task_t *task = &health->tasks[i];
+        bool found;
+        uint32_t prev = health_prev_run_time(status->xHandle, &found);
+        uint32_t used = status->ulRunTimeCounter - prev;
+
+        strncpy(task->name, status->pcTaskName, HEALTH_TASK_NAME_LEN - 1);
+        task->priority = status->uxCurrentPriority;
+        task->stack_free = status->usStackHighWaterMark; //StackType_t is a byte on the ESP32 so this is already in bytes
+        task->cpu_permille = found ? health_permille(used, elapsed * portNUM_PROCESSORS) : 0;
+
+        for(int core = 0; core < 2; core++)
+        {
+            if(found && status->xHandle == idle[core])
+                health->idle_permille[core] = health_permille(used, elapsed);
+        }
+
+        if(task->stack_free < health->min_stack_free)
+        {
+            health->min_stack_free = task->stack_free;
+            strncpy(health->min_stack_task, task->name, HEALTH_TASK_NAME_LEN - 1);
+        }
+
+        x_health.prev[i].handle = status->xHandle;
+        x_health.prev[i].run_time = status->ulRunTimeCounter;
+    }
+
+    x_health.prev_count = count;
+    x_health.prev_total = total;
+}
+
+/**
+ * @name health_task_entry
+ *
+ * @brief samples, prints and logs the system health every period
+ *
+ * @param arg unused
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+static void health_task_entry(void *arg)
+{
+    health_t health;
+
+    while(true)
+    {
+        if(health_sample(&health) == ESP_OK)
+        {
+            health_print(&health);
+            health_log(&health);
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(x_health.period_ms));
+    }
+}
+
+/**
+ * @name health_init
+ *
+ * @brief sets up the health sampler and starts sampling in its own task
+ *
+ * @param period_ms time between samples, 0 sets up the sampler without the task so health_sample() can be called by hand
+ *
+ * @return err variable that lets you know if the sampler is running or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t health_init(uint32_t period_ms)
+{
+    health_t health;
+
+    if(x_health.lock != NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    if((x_health.lock = xSemaphoreCreateMutex()) == NULL)
+    {
+        ESP_LOGD(HEALTH_TAG, "health_init(): xSemaphoreCreateMutex failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    x_health.period_ms = period_ms;
+
+    //first sample sets the run time baseline, CPU figures start with the next one
+    health_sample(&health);
+
+    if(period_ms == 0)
+        return ESP_OK;
+
+    if(xTaskCreate(health_task_entry, "health", HEALTH_TASK_STACK_SIZE, NULL, HEALTH_TASK_PRIORITY, NULL) != pdPASS)
+    {
+        ESP_LOGD(HEALTH_TAG, "health_init(): xTaskCreate failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @name health_sample
+ *
+ * @brief takes a sample now. CPU figures cover the time since the previous sample, whoever took it.
+ *
+ * @param health filled with the sample
+ *
+ * @return err variable that lets you know if a sample was taken or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t health_sample(health_t *health)
+{
+    if(x_health.lock == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(x_health.lock, portMAX_DELAY);
+    health_sample_locked(health);
+    x_health.latest = *health;
+    xSemaphoreGive(x_health.lock);
+
+    return ESP_OK;
+}
+
+/**
+ * @name health_get
+ *
+ * @brief copies out the last sample without taking a new one
+ *
+ * @param health filled with the last sample
+ *
+ * @return err variable that lets you know if there is a sample or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t health_get(health_t *health)
+{
+    if(x_health.lock == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(x_health.lock, portMAX_DELAY);
+    *health = x_health.latest;
+    xSemaphoreGive(x_health.lock);
+
+    return ESP_OK;
+}
+
+/**
+ * @name health_print
+ *
+ * @brief prints a sample to the console, one line for the system and one per task
+ *
+ * @param health sample to print
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void health_print(const health_t *health)
+{
+    ESP_LOGI(HEALTH_TAG, "heap free %lu min %lu largest %lu (%u.%u%% fragmented), idle %u.%u%% / %u.%u%%, least stack %lu (%s)",
+        (unsigned long)health->heap_free, (unsigned long)health->heap_min_free, (unsigned long)health->heap_largest_block,
+        health->heap_fragmentation_permille / 10, health->heap_fragmentation_permille % 10,
+        health->idle_permille[0] / 10, health->idle_permille[0] % 10, health->idle_permille[1] / 10, health->idle_permille[1] % 10,
+        (unsigned long)health->min_stack_free, health->min_stack_task);
+
+    for(uint32_t i = 0; i < health->task_count && i < HEALTH_MAX_TASKS; i++)
+    {
+        const health_task_t *task = &health->tasks[i];
+
+        if(task->name[0] == '\0')
+            break;
+
+        ESP_LOGI(HEALTH_TAG, "  %-16s prio %2u cpu %3u.%u%% stack free %lu", task->name, task->priority,
+            task->cpu_permille / 10, task->cpu_permille % 10, (unsigned long)task->stack_free);
+    }
+}
+
+/**
+ * @name health_log
+ *
+ * @brief writes a sample to the trip log, the system wide figures first and then a record per task, so a log dump shows
+ * what the console did
+ *
+ * @param health sample to log
+ *
+ * @return err variable from the first triplog_append() that failed
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t health_log(const health_t *health)
+{
+    esp_err_t err;
+    triplog_record_t record;
+    uint32_t task_count = health->task_count > HEALTH_MAX_TASKS ? 0 : health->task_count;
+
+    memset(&record, 0, sizeof(record));
+    record.timestamp_ms = (uint32_t)(health->time_us / 1000);
+    record.type = TRIPLOG_RECORD_HEALTH;
+    record.flags = task_count;
+    record.payload.health.heap_free = health->heap_free;
+    record.payload.health.heap_min_free = health->heap_min_free;
+    record.payload.health.heap_largest_block = health->heap_largest_block;
+    record.payload.health.min_stack_free = health->min_stack_free > UINT16_MAX ? UINT16_MAX : health->min_stack_free;
+    record.payload.health.idle_permille[0] = health->idle_permille[0];
+    record.payload.health.idle_permille[1] = health->idle_permille[1];
+    record.payload.health.heap_fragmentation_permille = health->heap_fragmentation_permille;
+
+    if((err = triplog_append(&record)) != ESP_OK)
+        return err;
+
+    for(uint32_t i = 0; i < task_count; i++)
+    {
+        const health_task_t *task = &health->tasks[i];
+
+        memset(&record, 0, sizeof(record));
+        record.timestamp_ms = (uint32_t)(health->time_us / 1000);
+        record.type = TRIPLOG_RECORD_HEALTH_TASK;
+        memcpy(record.payload.health_task.name, task->name, strnlen(task->name, sizeof(record.payload.health_task.name)));
+        record.payload.health_task.index = i;
+        record.payload.health_task.priority = task->priority;
+        record.payload.health_task.cpu_permille = task->cpu_permille;
+        record.payload.health_task.stack_free = task->stack_free;
+
+        if((err = triplog_append(&record)) != ESP_OK)
+            return err;
+    }
+
+    return ESP_OK;
+}
@@ -0,0 +1,44 @@
+#ifndef HEALTH_H
+#define HEALTH_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+static const char* HEALTH_TAG = "Health";
+
+#define HEALTH_MAX_TASKS (16) //has to cover every task running, FreeRTOS hands back nothing if the array is too small
+#define HEALTH_TASK_NAME_LEN (16) //CONFIG_FREERTOS_MAX_TASK_NAME_LEN
+#define HEALTH_TASK_STACK_SIZE (3072)
+#define HEALTH_TASK_PRIORITY (1)
+
+typedef struct {
+    char name[HEALTH_TASK_NAME_LEN];
+    uint8_t priority;
+    uint32_t stack_free; //bytes of stack the task has never touched
+    uint16_t cpu_permille; //share of both cores the task used since the last sample
+} health_task_t;
+
+/**
+ * @brief one snapshot of the system. Fixed size so it can be copied around and logged without touching the heap.
+*/
+typedef struct {
+    uint32_t sample; //samples taken since boot
+    int64_t time_us;
+    uint32_t task_count; //tasks that exist, tasks[] is empty if this is more than HEALTH_MAX_TASKS
+    health_task_t tasks[HEALTH_MAX_TASKS];
+    uint16_t idle_permille[2]; //idle time of each core since the last sample
+    uint32_t heap_free;
+    uint32_t heap_min_free; //lowest free heap since boot
+    uint32_t heap_largest_block;
+    uint16_t heap_fragmentation_permille; //free heap that isn't part of the largest block
+    uint32_t min_stack_free; //least stack headroom of any task
+    char min_stack_task[HEALTH_TASK_NAME_LEN];
+} health_t;
+
+esp_err_t health_init(uint32_t);
+esp_err_t health_sample(health_t *);
+esp_err_t health_get(health_t *);
+     void health_print(const health_t *);
+esp_err_t health_log(const health_t *);
+
+#endif //HEALTH_H
@@ -0,0 +1,238 @@
+#include <string.h>
+#include <math.h>
+#include "imufilter.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+
+//esp-dsp comes in through src/idf_component.yml, its biquad has an ESP32-S3 kernel. Anything else (the host) gets the
+//scalar loop below, which is the same direct form II esp-dsp's ANSI version runs.
+#if defined(ESP_PLATFORM) && __has_include("dsps_biquad.h")
+#include "dsps_biquad.h"
+#define IMUFILTER_ESP_DSP 1
+#else
+#define IMUFILTER_ESP_DSP 0
+#endif
+
+static void imufilter_biquad(const float *in, float *out, int len, const float *coeffs, float *w)
+{
+#if IMUFILTER_ESP_DSP
+    dsps_biquad_f32(in, out, len, (float *)coeffs, w);
+#else
+    for(int i = 0; i < len; i++)
+    {
+        float d0 = in[i] - coeffs[3] * w[0] - coeffs[4] * w[1];
+        out[i] = coeffs[0] * d0 + coeffs[1] * w[0] + coeffs[2] * w[1];
+        w[1] = w[0];
+        w[0] = d0;
+    }
+#endif
+}
+
+//RBJ cookbook low-pass, what dsps_biquad_gen_lpf_f32() makes
+static void imufilter_lowpass(float *coeffs, float sample_hz, float cutoff_hz)
+{
+    float w0 = 2.0f * (float)M_PI * cutoff_hz / sample_hz;
+    float c = cosf(w0), alpha = sinf(w0) / (2.0f * IMUFILTER_BIQUAD_Q);
+    float a0 = 1.0f + alpha;
+
+    coeffs[0] = (1.0f - c) / 2.0f / a0;
+    coeffs[1] = (1.0f - c) / a0;
+    coeffs[2] = coeffs[0];
+    coeffs[3] = -2.0f * c / a0;
+    coeffs[4] = (1.0f - alpha) / a0;
+}
+
+static void imufilter_median(imufilter_t *filter, int axis, const float *in, float *out, int len)
+{
+    float *window = filter->window[axis];
+    float sorted[IMUFILTER_MEDIAN_MAX];
+
+    for(int i = 0; i < len; i++)
+    {
+        window[filter->window_pos[axis]] = in[i];
+        filter->window_pos[axis] = (filter->window_pos[axis] + 1) % filter->window_len;
+        if(filter->window_fill[axis] < filter->window_len)
+            filter->window_fill[axis]++;
+
+        //insertion sort, the window is at most 9 long
+        uint8_t n = filter->window_fill[axis];
+        for(int j = 0; j < n; j++)
+        {
+            float v = window[j];
+            int k = j;
+            for(; k > 0 && sorted[k - 1] > v; k--)
+                sorted[k] = sorted[k - 1];
+            sorted[k] = v;
+        }
+
+        out[i] = n & 1 ? sorted[n / 2] : 0.5f * (sorted[n / 2 - 1] + sorted[n / 2]);
+    }
+}
+
+/**
+ * @name imufilter_init
+ *
+ * @brief sets up a filter stage
+ *
+ * @param filter stage to set up
+ * @param type IMUFILTER_NONE, IMUFILTER_BIQUAD or IMUFILTER_MEDIAN
+ * @param sample_hz rate samples reach the stage at
+ * @param cutoff_hz biquad cutoff, under half of sample_hz
+ * @param median_len median window, odd and up to IMUFILTER_MEDIAN_MAX
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t imufilter_init(imufilter_t *filter, imufilter_type_t type, float sample_hz, float cutoff_hz, uint8_t median_len)
+{
+    memset(filter, 0, sizeof(imufilter_t));
+    filter->type = type;
+
+    if(type == IMUFILTER_BIQUAD)
+        return imufilter_set_cutoff(filter, sample_hz, cutoff_hz);
+    else if(type == IMUFILTER_MEDIAN)
+    {
+        if(median_len < 1 || median_len > IMUFILTER_MEDIAN_MAX)
+            return ESP_ERR_INVALID_ARG;
+
+        filter->window_len = median_len;
+    }
+    else if(type != IMUFILTER_NONE)
+        return ESP_ERR_INVALID_ARG;
+
+    return ESP_OK;
+}
+
+/**
+ * @name imufilter_set_cutoff
+ *
+ * @brief moves the cutoff of a biquad stage. The delay line is kept so the output carries on from where it was.
+ *
+ * @param filter biquad stage
+ * @param sample_hz rate samples reach the stage at
+ * @param cutoff_hz new cutoff, under half of sample_hz
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t imufilter_set_cutoff(imufilter_t *filter, float sample_hz, float cutoff_hz)
+{
+    if(filter->type != IMUFILTER_BIQUAD)
+        return ESP_ERR_INVALID_STATE;
+    if(sample_hz <= 0 || cutoff_hz <= 0 || cutoff_hz >= sample_hz / 2)
+        return ESP_ERR_INVALID_ARG;
+
+    imufilter_lowpass(filter->coeffs, sample_hz, cutoff_hz);
+
+    return ESP_OK;
+}
+
+/**
+ * @name imufilter_process
+ *
+ * @brief filters a block of samples of one axis
+ *
+ * @param filter stage to run
+ * @param axis 0 for x, 1 for y
+ * @param in samples in order, oldest first
+ * @param out filtered samples, can't overlap in
+ * @param len samples in the block
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t imufilter_process(imufilter_t *filter, int axis, const float *in, float *out, int len)
+{
+    if(axis < 0 || axis >= IMUFILTER_AXES || len < 0)
+        return ESP_ERR_INVALID_ARG;
+    if(len == 0)
+        return ESP_OK;
+
+    switch(filter->type)
+    {
+        case IMUFILTER_BIQUAD:
+            //start the delay line where a constant input would have left it, as if the board had always sat at this angle
+            if(!filter->primed[axis])
+            {
+                float d = in[0] / (1.0f + filter->coeffs[3] + filter->coeffs[4]);
+                filter->w[axis][0] = d;
+                filter->w[axis][1] = d;
+                filter->primed[axis] = true;
+            }
+            imufilter_biquad(in, out, len, filter->coeffs, filter->w[axis]);
+            break;
+        case IMUFILTER_MEDIAN:
+            imufilter_median(filter, axis, in, out, len);
+            break;
+        default:
+            memcpy(out, in, len * sizeof(float));
+    }
+
+    return ESP_OK;
+}
+
+//one sample through the stage, for the main loop where samples come one at a time
+void imufilter_apply(imufilter_t *filter, bno055_vec3_t *angle)
+{
+    float in[IMUFILTER_AXES] = {angle->x, angle->y}, out[IMUFILTER_AXES];
+
+    for(int axis = 0; axis < IMUFILTER_AXES; axis++)
+        imufilter_process(filter, axis, &in[axis], &out[axis], 1);
+
+    angle->x = out[0];
+    angle->y = out[1];
+}
+
+/**
+ * @name imufilter_bench
+ *
+ * @brief times every kernel over a block of made up tilt samples
+ *
+ * @param len samples per block, up to IMUFILTER_BENCH_LEN
+ * @param bench filled with cycles per sample
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t imufilter_bench(uint32_t len, imufilter_bench_t *bench)
+{
+    static float in[IMUFILTER_BENCH_LEN], out[IMUFILTER_BENCH_LEN]; //kept off the caller's stack
+    imufilter_t filter;
+    esp_cpu_cycle_count_t cycles;
+
+    if(len == 0 || len > IMUFILTER_BENCH_LEN)
+        return ESP_ERR_INVALID_ARG;
+
+    //a few degrees of tilt with vibration on top
+    for(uint32_t i = 0; i < len; i++)
+        in[i] = 3.0f + 0.5f * sinf(i * 0.9f) + 0.2f * sinf(i * 2.3f);
+
+    memset(bench, 0, sizeof(imufilter_bench_t));
+    bench->len = len;
+    bench->esp_dsp = IMUFILTER_ESP_DSP;
+
+    imufilter_init(&filter, IMUFILTER_BIQUAD, 200, 5, 0);
+    imufilter_process(&filter, 0, in, out, len); //primes the delay line and warms the cache
+    cycles = esp_cpu_get_cycle_count();
+    imufilter_process(&filter, 0, in, out, len);
+    bench->biquad_cycles = (float)(esp_cpu_get_cycle_count() - cycles) / len;
+
+    imufilter_init(&filter, IMUFILTER_MEDIAN, 200, 0, 5);
+    imufilter_process(&filter, 0, in, out, len);
+    cycles = esp_cpu_get_cycle_count();
+    imufilter_process(&filter, 0, in, out, len);
+    bench->median_cycles = (float)(esp_cpu_get_cycle_count() - cycles) / len;
+
+    ESP_LOGI(IMUFILTER_TAG, "%lu sample blocks: biquad (%s) %.1f cycles/sample, median of 5 %.1f cycles/sample \n",
+             (unsigned long)len, bench->esp_dsp ? "esp-dsp" : "scalar", bench->biquad_cycles, bench->median_cycles);
+
+    return ESP_OK;
+}
@@ -0,0 +1,50 @@
+#ifndef IMUFILTER_H
+#define IMUFILTER_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+#include "bno055.h"
+
+static const char* IMUFILTER_TAG = "IMU filter";
+
+#define IMUFILTER_AXES (2) //x and y, the tilt axes. Heading wraps at 360 and the decision doesn't look at it.
+#define IMUFILTER_MEDIAN_MAX (9)
+#define IMUFILTER_BIQUAD_Q (0.7071f) //Butterworth, flat pass band, overshoots a step by about 4%
+#define IMUFILTER_BENCH_LEN (256)
+
+typedef enum {
+    IMUFILTER_NONE = 0,
+    IMUFILTER_BIQUAD, //2nd order low-pass, takes out road vibration
+    IMUFILTER_MEDIAN, //moving median, takes out single bad samples without smearing a real change
+} imufilter_type_t;
+
+/**
+ * @brief filter stage between the IMU and the decision, one delay line per tilt axis. Samples are processed a block of one
+ * axis at a time so the biquad can run on esp-dsp's vector kernel.
+*/
+typedef struct {
+    imufilter_type_t type;
+    float coeffs[5]; //b0 b1 b2 a1 a2, normalised by a0, the layout esp-dsp takes
+    float w[IMUFILTER_AXES][2]; //biquad delay line
+    float window[IMUFILTER_AXES][IMUFILTER_MEDIAN_MAX]; //median ring, oldest sample is overwritten
+    uint8_t window_len;
+    uint8_t window_pos[IMUFILTER_AXES];
+    uint8_t window_fill[IMUFILTER_AXES];
+    bool primed[IMUFILTER_AXES]; //delay line set from the first sample so the output doesn't climb up from 0
+} imufilter_t;
+
+typedef struct {
+    uint32_t len; //samples per block
+    float biquad_cycles; //cycles per sample per axis
+    float median_cycles;
+    bool esp_dsp; //biquad ran on esp-dsp
+} imufilter_bench_t;
+
+esp_err_t imufilter_init(imufilter_t *, imufilter_type_t, float, float, uint8_t);
+esp_err_t imufilter_set_cutoff(imufilter_t *, float, float);
+esp_err_t imufilter_process(imufilter_t *, int, const float *, float *, int);
+     void imufilter_apply(imufilter_t *, bno055_vec3_t *);
+esp_err_t imufilter_bench(uint32_t, imufilter_bench_t *);
+
+#endif //IMUFILTER_H
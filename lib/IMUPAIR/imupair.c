@@ -0,0 +1,226 @@
+#include <string.h>
+#include <math.h>
+#include "imupair.h"
+#include "esp_log.h"
+
+//difference between two angles in degrees, -180 - 180 so heading going past 360 doesn't look like a jump
+static double imupair_angle_diff(double a, double b)
+{
+    double diff = fmod(a - b, 360.0);
+
+    if(diff > 180.0)
+        diff -= 360.0;
+    if(diff < -180.0)
+        diff += 360.0;
+
+    return diff;
+}
+
+static double imupair_distance(const bno055_vec3_t *a, const bno055_vec3_t *b)
+{
+    double x = imupair_angle_diff(a->x, b->x), y = imupair_angle_diff(a->y, b->y), z = imupair_angle_diff(a->z, b->z);
+    return sqrt(x*x + y*y + z*z);
+}
+
+static void imupair_worker_entry(void *arg)
+{
+    imupair_t *pair = (imupair_t *)arg;
+
+    while(true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        //read into its own copy, main may have given up on this request and be voting on reading[1] already
+        uint32_t request = pair->requested;
+        bno055_vec3_t reading;
+        esp_err_t err = bno055_get_euler(pair->imu[1], &reading);
+
+        portENTER_CRITICAL(&pair->lock);
+        pair->worker_reading = reading;
+        pair->worker_err = err;
+        pair->completed = request;
+        portEXIT_CRITICAL(&pair->lock);
+
+        xTaskNotifyGive(pair->waiter);
+    }
+}
+
+/**
+ * @name imupair_init
+ *
+ * @brief sets up reading one or two IMUs that have already been brought up with BNO055_init()/BNO055_init_conf()
+ *
+ * @param pair pair to set up
+ * @param primary IMU used when the two disagree and there is nothing to go on
+ * @param secondary second IMU, I2C_NUMBER_MAX when there is only one
+ * @param parallel true when the IMUs are on separate I2C ports so both can be read at the same time
+ * @param agree_deg furthest apart the two readings can be and still count as agreeing
+ *
+ * @return err variable that lets you know if the pair is ready or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t imupair_init(imupair_t *pair, i2c_number_t primary, i2c_number_t secondary, bool parallel, float agree_deg)
+{
+    memset(pair, 0, sizeof(imupair_t));
+    portMUX_INITIALIZE(&pair->lock);
+    pair->imu[0] = primary;
+    pair->imu[1] = secondary;
+    pair->dual = secondary < I2C_NUMBER_MAX && secondary != primary;
+    pair->parallel = pair->dual && parallel;
+    pair->agree_deg = agree_deg;
+
+    if(!pair->parallel)
+        return ESP_OK;
+
+    //on its own port the second IMU can be read while main reads the first, the pair then costs the same time as one IMU
+    if(xTaskCreate(imupair_worker_entry, "imupair", IMUPAIR_TASK_STACK_SIZE, pair, IMUPAIR_TASK_PRIORITY, &pair->worker) != pdPASS)
+    {
+        ESP_LOGW(IMUPAIR_TAG, "imupair_init(): xTaskCreate failed, reading the IMUs one after the other");
+        pair->parallel = false;
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @name imupair_vote
+ *
+ * @brief combines two readings into one angle
+ *
+ * @param a first IMU reading
+ * @param err_a error from reading the first IMU
+ * @param b second IMU reading
+ * @param err_b error from reading the second IMU
+ * @param last last angle handed out, NULL if there isn't one
+ * @param agree_deg furthest apart the readings can be and still count as agreeing
+ * @param angle set to the combined angle, left alone if neither reading is usable
+ *
+ * @return imupair_source_t telling where the angle came from
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+imupair_source_t imupair_vote(const bno055_vec3_t *a, esp_err_t err_a, const bno055_vec3_t *b, esp_err_t err_b, const bno055_vec3_t *last, float agree_deg, bno055_vec3_t *angle)
+{
+    if(err_a != ESP_OK && err_b != ESP_OK)
+        return IMUPAIR_NONE;
+
+    if(err_b != ESP_OK)
+    {
+        *angle = *a;
+        return IMUPAIR_PRIMARY_ONLY;
+    }
+
+    if(err_a != ESP_OK)
+    {
+        *angle = *b;
+        return IMUPAIR_SECONDARY_ONLY;
+    }
+
+    if(imupair_distance(a, b) <= agree_deg)
+    {
+        //halfway along the shorter way round, then back into the ranges the BNO055 uses: -180 - 180 for pitch and roll, 0 - 360 for heading
+        angle->x = imupair_angle_diff(a->x + imupair_angle_diff(b->x, a->x) / 2.0, 0);
+        angle->y = imupair_angle_diff(a->y + imupair_angle_diff(b->y, a->y) / 2.0, 0);
+        angle->z = fmod(a->z + imupair_angle_diff(b->z, a->z) / 2.0 + 360.0, 360.0);
+        return IMUPAIR_BOTH;
+    }
+
+    //a fusion glitch is a sudden jump, go with the one closest to where we were
+    if(last != NULL && imupair_distance(b, last) < imupair_distance(a, last))
+        *angle = *b;
+    else
+        *angle = *a;
+
+    return IMUPAIR_DISAGREE;
+}
+
+/**
+ * @name imupair_get_euler
+ *
+ * @brief reads the IMUs and hands back one angle
+ *
+ * @param pair pair set up by imupair_init()
+ * @param angle set to the angle, left alone if no IMU could be read
+ * @param source set to where the angle came from, can be NULL
+ *
+ * @return err variable, ESP_OK if at least one IMU was read
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t imupair_get_euler(imupair_t *pair, bno055_vec3_t *angle, imupair_source_t *source)
+{
+    imupair_source_t from;
+    uint32_t request;
+
+    pair->reads++;
+
+    if(!pair->dual)
+    {
+        pair->err[0] = bno055_get_euler(pair->imu[0], &pair->reading[0]);
+        pair->err[1] = ESP_ERR_NOT_SUPPORTED;
+    }
+    else if(pair->parallel)
+    {
+        pair->waiter = xTaskGetCurrentTaskHandle();
+        request = ++pair->requested;
+        xTaskNotifyGive(pair->worker);
+
+        pair->err[0] = bno055_get_euler(pair->imu[0], &pair->reading[0]);
+
+        //wait for the worker, a notification or an answer left over from a request that timed out doesn't count
+        TickType_t start = xTaskGetTickCount();
+        bool done = false;
+        while(true)
+        {
+            portENTER_CRITICAL(&pair->lock);
+            if((done = pair->completed == request))
+            {
+                pair->reading[1] = pair->worker_reading;
+                pair->err[1] = pair->worker_err;
+            }
+            portEXIT_CRITICAL(&pair->lock);
+
+            if(done || (xTaskGetTickCount() - start) >= pdMS_TO_TICKS(IMUPAIR_READ_TIMEOUT_MS))
+                break;
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IMUPAIR_READ_TIMEOUT_MS));
+        }
+
+        if(!done)
+            pair->err[1] = ESP_ERR_TIMEOUT;
+    }
+    else
+    {
+        //same bus, the transactions can't overlap anyway
+        pair->err[0] = bno055_get_euler(pair->imu[0], &pair->reading[0]);
+        pair->err[1] = bno055_get_euler(pair->imu[1], &pair->reading[1]);
+    }
+
+    if(pair->err[0] != ESP_OK)
+        pair->failures[0]++;
+    if(pair->dual && pair->err[1] != ESP_OK)
+        pair->failures[1]++;
+
+    from = imupair_vote(&pair->reading[0], pair->err[0], &pair->reading[1], pair->err[1], pair->has_last ? &pair->last : NULL, pair->agree_deg, angle);
+
+    if(from == IMUPAIR_DISAGREE)
+    {
+        pair->disagreements++;
+        ESP_LOGW(IMUPAIR_TAG, "IMUs disagree: x %.1f/%.1f y %.1f/%.1f z %.1f/%.1f", pair->reading[0].x, pair->reading[1].x,
+            pair->reading[0].y, pair->reading[1].y, pair->reading[0].z, pair->reading[1].z);
+    }
+
+    if(source != NULL)
+        *source = from;
+
+    if(from == IMUPAIR_NONE)
+        return pair->err[0];
+
+    pair->last = *angle;
+    pair->has_last = true;
+
+    return ESP_OK;
+}
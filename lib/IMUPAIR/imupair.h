@@ -0,0 +1,53 @@
+#ifndef IMUPAIR_H
+#define IMUPAIR_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "bno055.h"
+
+static const char* IMUPAIR_TAG = "IMU pair";
+
+#define IMUPAIR_TASK_STACK_SIZE (2048)
+#define IMUPAIR_TASK_PRIORITY (5) //above main so the second read starts as soon as it is asked for
+#define IMUPAIR_READ_TIMEOUT_MS (50) //longest main waits on the second IMU before going on without it
+
+typedef enum {
+    IMUPAIR_BOTH = 0, //both IMUs agree, the angle is their average
+    IMUPAIR_PRIMARY_ONLY, //second IMU failed to read or isn't fitted
+    IMUPAIR_SECONDARY_ONLY, //first IMU failed to read
+    IMUPAIR_DISAGREE, //both read but are further apart than agree_deg, the angle is the one that jumped the least
+    IMUPAIR_NONE, //neither read, the angle is left alone
+} imupair_source_t;
+
+/**
+ * @brief one or two BNO055s read as a single sensor. With two, a fusion glitch on one shows up as a jump the other doesn't make.
+*/
+typedef struct {
+    i2c_number_t imu[2];
+    bool dual;
+    bool parallel; //IMUs on separate ports, the second one is read by a worker task while main reads the first
+    float agree_deg;
+    TaskHandle_t worker;
+    TaskHandle_t waiter;
+    portMUX_TYPE lock; //guards the worker's answer
+    volatile uint32_t requested; //id of the last read request handed to the worker
+    uint32_t completed; //id of the request the worker's answer is for, a late answer to a timed out request is ignored
+    bno055_vec3_t worker_reading; //worker's answer, only copied into reading[1] when it is for the request being waited on
+    esp_err_t worker_err;
+    bno055_vec3_t reading[2];
+    esp_err_t err[2];
+    bool has_last;
+    bno055_vec3_t last; //last angle handed out
+    uint32_t reads;
+    uint32_t disagreements;
+    uint32_t failures[2];
+} imupair_t;
+
+esp_err_t imupair_init(imupair_t *, i2c_number_t, i2c_number_t, bool, float);
+esp_err_t imupair_get_euler(imupair_t *, bno055_vec3_t *, imupair_source_t *);
+imupair_source_t imupair_vote(const bno055_vec3_t *, esp_err_t, const bno055_vec3_t *, esp_err_t, const bno055_vec3_t *, float, bno055_vec3_t *);
+
+#endif //IMUPAIR_H
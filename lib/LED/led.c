@@ -1,69 +1,89 @@
 #include "led.h"
 #include "esp_log.h"
+#include "decision.h"
+#include "replay.h"
+#include "trace.h"
+#include "ledstrip.h"
 
-#define ALARM_TIME (2000) //amount of time in milliseconds the timer will run before the alarm is triggered
 #define PWM_FREQ (5*10e3) //the frequency at which the PWM signal operates at
 #define LED_GPIO (42)
 
+static uint8_t x_led_outputs; //LED_OUTPUT_ flags the alarm handler drives
+
 static bool led_alarm_handler(gptimer_handle_t timer_handle, const gptimer_alarm_event_data_t *event_data, void* user_args)
 {
     esp_err_t err;
-    static uint8_t led_toggle; //leverage the fact that static variables get initialized to 0 as a check if its ever been initialized
-
-    //if the toggle is zero this is the first time running this handler, initialize it
-    if(led_toggle == 0)
-    {
-        led_toggle = 1; //were going to use the first bit as an indicator that the variable has been initialized and the second bit as the actual toggle bit
-    }
+    static led_blink_state_t blink_state; //leverage the fact that static variables get initialized to 0 as a check if its ever been initialized
 
     //pulls the passed in data from the initializer out of a structure
     timer_event_handler_args_t *args = (timer_event_handler_args_t *)user_args;
-    bool *is_led_on = args->is_led_on;
-    bool *led_on = args->led_on;
-    int *led_on_val = args->led_on_val;
+    trace_begin(TRACE_LED_ALARM, 0);
+    bool led_on = *args->led_on;
+    int led_on_val = *args->led_on_val;
 
-    if(*led_on) //Toggle PWM
-    {
-        if(led_toggle >> 1) //if the second bit is a 1 then turn the led on. Use the percentage and multiply it by the max duty resolution value to scale it.
-        {
-            *is_led_on = true; //indicate back to main that the led is on
-            err = ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, *led_on_val);
-            ESP_LOGD(LED_TAG, "led_alarm_handler(): ledc_set_duty turning on the led returned %s", esp_err_to_name(err));
-            ESP_ERROR_CHECK(err);
-
-            err = ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0);
-            ESP_LOGD(LED_TAG, "led_alarm_handler(): ledc_update_duty turning on the led returned %s", esp_err_to_name(err));
-            ESP_ERROR_CHECK(err);
-            
-        }
-        else //turn off led if the second bit is not 1
-        {
-            *is_led_on = false; //indicate back to main that the led is off
-            err = ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, 0);
-            ESP_LOGD(LED_TAG, "led_alarm_handler(): ledc_set_duty turning off the led returned %s", esp_err_to_name(err));
-            ESP_ERROR_CHECK(err);
-
-            err = ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0);
-            ESP_LOGD(LED_TAG, "led_alarm_handler(): ledc_update_duty turning off the led returned %s", esp_err_to_name(err));
-            ESP_ERROR_CHECK(err);
-        }
-        led_toggle = led_toggle ^ 0x02; //xor the second bit causing it to toggle states.
-    }
-    else //Disable PWM
+    //work out if the led is on for this alarm, flashing logic lives in decision.c so it can be replayed
+    int duty = led_blink_step(&blink_state, led_on, led_on_val, args->is_led_on);
+
+    if(x_led_outputs & LED_OUTPUT_PWM)
     {
-        *is_led_on = false; //indicate back to main that the led is off
-        err = ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, 0);
-        ESP_LOGD(LED_TAG, "led_alarm_handler(): ledc_set_duty disabling the led returned %s", esp_err_to_name(err));
+        err = ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, duty);
+        ESP_LOGD(LED_TAG, "led_alarm_handler(): ledc_set_duty returned %s", esp_err_to_name(err));
         ESP_ERROR_CHECK(err);
 
         err = ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0);
-        ESP_LOGD(LED_TAG, "led_alarm_handler(): ledc_update_duty disabling the led returned %s", esp_err_to_name(err));
+        ESP_LOGD(LED_TAG, "led_alarm_handler(): ledc_update_duty returned %s", esp_err_to_name(err));
         ESP_ERROR_CHECK(err);
     }
 
+    //the strip goes dark on the same alarms as the LED so it stays out of the photoresistor reading too
+    if(x_led_outputs & LED_OUTPUT_STRIP)
+        ledstrip_show_from_isr(*args->is_led_on, led_on_val);
+
+    //hand the inputs and outcome of this alarm to the capture, does nothing unless capture mode is on
+    replay_capture_tick(led_on, led_on_val, duty, *args->is_led_on);
+
+    trace_end(TRACE_LED_ALARM, duty);
     return true;
 }
 
+//sets up the LEDC channel for the single LED
+static esp_err_t led_pwm_init(void)
+{
+    esp_err_t err;
+
+    ledc_timer_config_t led_timer_config = {
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .timer_num = LEDC_TIMER_0,
+        .duty_resolution = LEDC_TIMER_10_BIT, 
+        .freq_hz = PWM_FREQ,
+        .clk_cfg = LEDC_AUTO_CLK,
+    };
+
+    if((err = ledc_timer_config(&led_timer_config)) != ESP_OK)
+    {
+        ESP_LOGD(LED_TAG, "led_pwm_init(): ledc_timer_config returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    ledc_channel_config_t led_channel_config = {
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .channel = LEDC_CHANNEL_0,
+        .timer_sel = LEDC_TIMER_0,
+        .intr_type = LEDC_INTR_DISABLE,
+        .gpio_num = LED_GPIO,
+        .duty = 0, //initially the LED will be off
+        .hpoint = 0,
+    };
+
+    if((err = ledc_channel_config(&led_channel_config)) != ESP_OK)
+    {
+        ESP_LOGD(LED_TAG, "led_pwm_init(): ledc_channel_config returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    return err;
+}
+
 /**
  * @name led_init
  * 
@@ -72,6 +92,7 @@ static bool led_alarm_handler(gptimer_handle_t timer_handle, const gptimer_alarm
  * @param timer_handle holds the handle for the timer to be used in setting up the timer and handing it off to the alarm handler
  * @param led_on used in the alarm handler to turn on the LED or not
  * @param led_on_pct used in the alarm handler to control the brightness of the LED
+ * @param outputs LED_OUTPUT_ flags, which outputs flash. The PWM is only set up with LED_OUTPUT_PWM.
  * 
  * @return err variable that lets you know if everything was successfully initialized or not
  * 
@@ -81,14 +102,16 @@ static bool led_alarm_handler(gptimer_handle_t timer_handle, const gptimer_alarm
  * @cite https://docs.espressif.com/projects/esp-idf/en/v5.0/esp32s3/api-reference/peripherals/gptimer.html
  * @cite https://docs.espressif.com/projects/esp-idf/en/v5.0/esp32s3/api-reference/peripherals/ledc.html
 */
-esp_err_t led_init(gptimer_handle_t *timer_handle, timer_event_handler_args_t *event_handler_args)
+esp_err_t led_init(gptimer_handle_t *timer_handle, timer_event_handler_args_t *event_handler_args, uint8_t outputs)
 {
     esp_err_t err;
 
+    x_led_outputs = outputs;
+
     gptimer_config_t config = {
       .clk_src = GPTIMER_CLK_SRC_DEFAULT,
       .direction = GPTIMER_COUNT_UP,
-      .resolution_hz = 1 * 10e3, //1kHz, 1 tick = 1 ms  
+      .resolution_hz = LED_TIMER_RESOLUTION_HZ, //10kHz, 1 tick = 0.1 ms
     };
 
     if((err = gptimer_new_timer(&config, timer_handle)) != ESP_OK)
@@ -127,33 +150,9 @@ esp_err_t led_init(gptimer_handle_t *timer_handle, timer_event_handler_args_t *e
     }
 
     //Before starting the timer. Setup the LED.
-    ledc_timer_config_t led_timer_config = {
-        .speed_mode = LEDC_LOW_SPEED_MODE,
-        .timer_num = LEDC_TIMER_0,
-        .duty_resolution = LEDC_TIMER_10_BIT, 
-        .freq_hz = PWM_FREQ,
-        .clk_cfg = LEDC_AUTO_CLK,
-    };
-
-    if((err = ledc_timer_config(&led_timer_config)) != ESP_OK)
-    {
-        ESP_LOGD(LED_TAG, "led_init(): ledc_timer_config returned %s", esp_err_to_name(err));
-        return err;
-    }
-
-    ledc_channel_config_t led_channel_config = {
-        .speed_mode = LEDC_LOW_SPEED_MODE,
-        .channel = LEDC_CHANNEL_0,
-        .timer_sel = LEDC_TIMER_0,
-        .intr_type = LEDC_INTR_DISABLE,
-        .gpio_num = LED_GPIO,
-        .duty = 0, //initially the LED will be off
-        .hpoint = 0,
-    };
-
-    if((err = ledc_channel_config(&led_channel_config)) != ESP_OK)
+    if((outputs & LED_OUTPUT_PWM) && (err = led_pwm_init()) != ESP_OK)
     {
-        ESP_LOGD(LED_TAG, "led_init(): ledc_channel_config returned %s", esp_err_to_name(err));
+        ESP_LOGD(LED_TAG, "led_init(): led_pwm_init returned %s", esp_err_to_name(err));
         return err;
     }
 
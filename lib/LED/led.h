@@ -9,13 +9,19 @@
 
 static const char* LED_TAG = "LED";
 
+#define ALARM_TIME (2000) //amount of timer ticks the timer will run before the alarm is triggered
+#define LED_TIMER_RESOLUTION_HZ (1 * 10e3) //10kHz, 1 tick = 0.1 ms
+#define LED_ALARM_PERIOD_MS ((uint32_t)(ALARM_TIME * 1000 / LED_TIMER_RESOLUTION_HZ)) //200 ms between alarms
+#define LED_OUTPUT_PWM (0x01) //the single LED on LED_GPIO, driven by the LEDC
+#define LED_OUTPUT_STRIP (0x02) //WS2812 strip on the RMT, ledstrip_init() has to have been called
+
 typedef struct {
     bool *is_led_on;
     bool *led_on;
     int *led_on_val;
 } timer_event_handler_args_t;
 
-esp_err_t led_init(gptimer_handle_t *, timer_event_handler_args_t *);
+esp_err_t led_init(gptimer_handle_t *, timer_event_handler_args_t *, uint8_t);
 esp_err_t led_deinit(gptimer_handle_t );
 
 #endif
\ No newline at end of file
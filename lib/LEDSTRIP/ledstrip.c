@@ -0,0 +1,371 @@
+#include <string.h>
+#include "ledstrip.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+//full brightness colour of each severity, in the order the pixels go out on the wire
+static const uint8_t x_severity_grb[LEDSTRIP_SEVERITY_MAX][LEDSTRIP_BYTES_PER_PIXEL] = {
+    [LEDSTRIP_WARN] = {0x60, 0xFF, 0x00}, //amber
+    [LEDSTRIP_SEVERE] = {0x00, 0xFF, 0x00}, //red
+};
+
+typedef struct {
+    bool initialized;
+    portMUX_TYPE lock; //state comes from the main loop, the blink from the LED timer ISR and the strip task reads both
+    rmt_channel_handle_t channel;
+    rmt_encoder_handle_t encoder;
+    TaskHandle_t task;
+    uint32_t pixel_count;
+    ledstrip_frame_t frame;
+    uint8_t *pixels; //DMA capable, rendered in place and read by the encoder
+    ledstrip_stats_t stats;
+} ledstrip_state_t;
+
+static ledstrip_state_t x_ledstrip = { .lock = portMUX_INITIALIZER_UNLOCKED };
+
+static const rmt_transmit_config_t x_transmit_config = {
+    .loop_count = 0, //once per frame
+};
+
+/**
+ * @name ledstrip_render
+ *
+ * @brief draws a frame into a pixel buffer. Integer math only, so it costs the same on the device and the host. Without a lean the
+ * whole strip is lit, with one the half on the low side is lit and ramps up towards its end so it reads as an arrow.
+ *
+ * @param frame what to show
+ * @param pixels LEDSTRIP_BYTES_PER_PIXEL bytes per pixel in wire order, written in full
+ * @param pixel_count pixels on the strip
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void ledstrip_render(const ledstrip_frame_t *frame, uint8_t *pixels, uint32_t pixel_count)
+{
+    memset(pixels, 0, pixel_count * LEDSTRIP_BYTES_PER_PIXEL);
+    if(!frame->lit || frame->severity >= LEDSTRIP_SEVERITY_MAX)
+        return;
+
+    const uint8_t *colour = x_severity_grb[frame->severity];
+    uint32_t brightness = frame->brightness < 0 ? 0 : frame->brightness > 1023 ? 1023 : frame->brightness;
+    uint32_t half = pixel_count / 2, span = pixel_count - half; //an odd middle pixel belongs to the arrow
+
+    for(uint32_t i = 0; i < pixel_count; i++)
+    {
+        uint32_t step = frame->lean == LEDSTRIP_LEAN_LEFT ? pixel_count - 1 - i : i; //pixels from the side that stays dark
+        uint32_t weight = 256; //8.8 fixed point
+
+        if(frame->lean != LEDSTRIP_LEAN_NONE)
+            weight = step < half ? 0 : ((step - half + 1) * 256) / span;
+
+        uint32_t scale = (weight * (brightness + 1)) >> 8; //0 - 1024
+        for(uint32_t c = 0; c < LEDSTRIP_BYTES_PER_PIXEL; c++)
+            pixels[i * LEDSTRIP_BYTES_PER_PIXEL + c] = (colour[c] * scale) >> 10;
+    }
+}
+
+static void ledstrip_task(void *args)
+{
+    esp_err_t err;
+    ledstrip_frame_t frame;
+
+    while(true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        portENTER_CRITICAL(&x_ledstrip.lock);
+        frame = x_ledstrip.frame;
+        portEXIT_CRITICAL(&x_ledstrip.lock);
+
+        //the last frame is long gone at one per LED alarm, this only keeps a stuck channel from having its buffer written under it
+        if((err = rmt_tx_wait_all_done(x_ledstrip.channel, LEDSTRIP_TX_TIMEOUT_MS)) != ESP_OK)
+        {
+            ESP_LOGD(LEDSTRIP_TAG, "ledstrip_task(): rmt_tx_wait_all_done returned %s", esp_err_to_name(err));
+            portENTER_CRITICAL(&x_ledstrip.lock);
+            x_ledstrip.stats.tx_errors++;
+            portEXIT_CRITICAL(&x_ledstrip.lock);
+            continue;
+        }
+
+        esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+        ledstrip_render(&frame, x_ledstrip.pixels, x_ledstrip.pixel_count);
+
+        //the DMA buffer holds the whole frame, so it is encoded once in here and goes out on the wire without the CPU
+        err = rmt_transmit(x_ledstrip.channel, x_ledstrip.encoder, x_ledstrip.pixels, x_ledstrip.pixel_count * LEDSTRIP_BYTES_PER_PIXEL, &x_transmit_config);
+        uint32_t cycles = esp_cpu_get_cycle_count() - start;
+        if(err != ESP_OK)
+            ESP_LOGD(LEDSTRIP_TAG, "ledstrip_task(): rmt_transmit returned %s", esp_err_to_name(err));
+
+        portENTER_CRITICAL(&x_ledstrip.lock);
+        if(err != ESP_OK)
+            x_ledstrip.stats.tx_errors++;
+        x_ledstrip.stats.frames++;
+        x_ledstrip.stats.last_cycles = cycles;
+        x_ledstrip.stats.total_cycles += cycles;
+        if(cycles > x_ledstrip.stats.max_cycles)
+            x_ledstrip.stats.max_cycles = cycles;
+        portEXIT_CRITICAL(&x_ledstrip.lock);
+    }
+}
+
+/**
+ * @name ledstrip_init
+ *
+ * @brief sets up an RMT TX channel with DMA for a WS2812 strip and the task that sends its frames. The pixel buffer and the DMA
+ * buffer are sized for the whole strip here, nothing is allocated per frame.
+ *
+ * @param gpio data line of the strip
+ * @param pixel_count pixels on the strip, up to LEDSTRIP_MAX_PIXELS
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+ *
+ * @cite https://docs.espressif.com/projects/esp-idf/en/v5.0/esp32s3/api-reference/peripherals/rmt.html
+*/
+esp_err_t ledstrip_init(int gpio, uint32_t pixel_count)
+{
+    esp_err_t err;
+
+    if(x_ledstrip.initialized)
+        return ESP_ERR_INVALID_STATE;
+    if(pixel_count == 0 || pixel_count > LEDSTRIP_MAX_PIXELS)
+        return ESP_ERR_INVALID_ARG;
+
+    if((x_ledstrip.pixels = heap_caps_calloc(pixel_count, LEDSTRIP_BYTES_PER_PIXEL, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL)) == NULL)
+    {
+        ESP_LOGD(LEDSTRIP_TAG, "ledstrip_init(): heap_caps_calloc returned NULL");
+        return ESP_ERR_NO_MEM;
+    }
+    x_ledstrip.pixel_count = pixel_count;
+
+    //XTAL clock so the channel doesn't hold the APB frequency lock and light sleep still happens between frames
+    rmt_tx_channel_config_t channel_config = {
+        .gpio_num = gpio,
+        .clk_src = RMT_CLK_SRC_XTAL,
+        .resolution_hz = LEDSTRIP_RESOLUTION_HZ,
+        .mem_block_symbols = LEDSTRIP_SYMBOLS(pixel_count), //size of the DMA buffer with DMA on, the whole frame fits
+        .trans_queue_depth = 4,
+        .flags.with_dma = true,
+    };
+
+    if((err = rmt_new_tx_channel(&channel_config, &x_ledstrip.channel)) != ESP_OK)
+    {
+        ESP_LOGD(LEDSTRIP_TAG, "ledstrip_init(): rmt_new_tx_channel returned %s", esp_err_to_name(err));
+        ledstrip_deinit();
+        return err;
+    }
+
+    rmt_bytes_encoder_config_t encoder_config = {
+        .bit0 = { .level0 = 1, .duration0 = LEDSTRIP_T0H, .level1 = 0, .duration1 = LEDSTRIP_T0L },
+        .bit1 = { .level0 = 1, .duration0 = LEDSTRIP_T1H, .level1 = 0, .duration1 = LEDSTRIP_T1L },
+        .flags.msb_first = 1,
+    };
+
+    if((err = rmt_new_bytes_encoder(&encoder_config, &x_ledstrip.encoder)) != ESP_OK)
+    {
+        ESP_LOGD(LEDSTRIP_TAG, "ledstrip_init(): rmt_new_bytes_encoder returned %s", esp_err_to_name(err));
+        ledstrip_deinit();
+        return err;
+    }
+
+    if((err = rmt_enable(x_ledstrip.channel)) != ESP_OK)
+    {
+        ESP_LOGD(LEDSTRIP_TAG, "ledstrip_init(): rmt_enable returned %s", esp_err_to_name(err));
+        ledstrip_deinit();
+        return err;
+    }
+
+    portENTER_CRITICAL(&x_ledstrip.lock);
+    memset(&x_ledstrip.frame, 0, sizeof(ledstrip_frame_t));
+    memset(&x_ledstrip.stats, 0, sizeof(ledstrip_stats_t));
+    portEXIT_CRITICAL(&x_ledstrip.lock);
+
+    if(xTaskCreate(ledstrip_task, "LED strip", LEDSTRIP_TASK_STACK_SIZE, NULL, LEDSTRIP_TASK_PRIORITY, &x_ledstrip.task) != pdPASS)
+    {
+        ESP_LOGD(LEDSTRIP_TAG, "ledstrip_init(): xTaskCreate failed");
+        ledstrip_deinit();
+        return ESP_ERR_NO_MEM;
+    }
+
+    x_ledstrip.initialized = true;
+    ESP_LOGI(LEDSTRIP_TAG, "%lu pixels on GPIO %d, %lu us on the wire per frame", (unsigned long)pixel_count, gpio,
+             (unsigned long)(LEDSTRIP_SYMBOLS(pixel_count) * LEDSTRIP_BIT_NS / 1000));
+
+    return ESP_OK;
+}
+
+/**
+ * @name ledstrip_deinit
+ *
+ * @brief stops the strip task and frees the channel, encoder and buffers. Also cleans up after an ledstrip_init() that failed part way.
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t ledstrip_deinit(void)
+{
+    esp_err_t err = ESP_OK;
+
+    x_ledstrip.initialized = false;
+
+    if(x_ledstrip.task != NULL)
+    {
+        vTaskDelete(x_ledstrip.task);
+        x_ledstrip.task = NULL;
+    }
+
+    if(x_ledstrip.channel != NULL)
+    {
+        rmt_tx_wait_all_done(x_ledstrip.channel, LEDSTRIP_TX_TIMEOUT_MS);
+        rmt_disable(x_ledstrip.channel); //fails if it was never enabled, which is fine here
+        if((err = rmt_del_channel(x_ledstrip.channel)) != ESP_OK)
+            ESP_LOGD(LEDSTRIP_TAG, "ledstrip_deinit(): rmt_del_channel returned %s", esp_err_to_name(err));
+        x_ledstrip.channel = NULL;
+    }
+
+    if(x_ledstrip.encoder != NULL)
+    {
+        rmt_del_encoder(x_ledstrip.encoder);
+        x_ledstrip.encoder = NULL;
+    }
+
+    heap_caps_free(x_ledstrip.pixels);
+    x_ledstrip.pixels = NULL;
+    x_ledstrip.pixel_count = 0;
+
+    return err;
+}
+
+/**
+ * @name ledstrip_set_state
+ *
+ * @brief sets what the next lit frames show, called from the main loop with each decision
+ *
+ * @param severity colour of the frame
+ * @param lean side the arrow points to
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void ledstrip_set_state(ledstrip_severity_t severity, ledstrip_lean_t lean)
+{
+    portENTER_CRITICAL(&x_ledstrip.lock);
+    x_ledstrip.frame.severity = severity;
+    x_ledstrip.frame.lean = lean;
+    portEXIT_CRITICAL(&x_ledstrip.lock);
+}
+
+/**
+ * @name ledstrip_show_from_isr
+ *
+ * @brief takes the outcome of an LED timer alarm and wakes the strip task to send a frame. Safe to call from the alarm handler,
+ * the rendering and the RMT driver calls happen on the task.
+ *
+ * @param lit whether the LED is on for this alarm
+ * @param brightness duty the single LED would get, 0 - 1023
+ *
+ * @return whether a higher priority task was woken
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+bool ledstrip_show_from_isr(bool lit, int brightness)
+{
+    BaseType_t woken = pdFALSE;
+
+    if(!x_ledstrip.initialized)
+        return false;
+
+    portENTER_CRITICAL_ISR(&x_ledstrip.lock);
+    x_ledstrip.frame.lit = lit;
+    x_ledstrip.frame.brightness = brightness;
+    portEXIT_CRITICAL_ISR(&x_ledstrip.lock);
+
+    vTaskNotifyGiveFromISR(x_ledstrip.task, &woken);
+    return woken == pdTRUE;
+}
+
+esp_err_t ledstrip_get_stats(ledstrip_stats_t *stats)
+{
+    if(!x_ledstrip.initialized)
+        return ESP_ERR_INVALID_STATE;
+
+    portENTER_CRITICAL(&x_ledstrip.lock);
+    *stats = x_ledstrip.stats;
+    portEXIT_CRITICAL(&x_ledstrip.lock);
+
+    return ESP_OK;
+}
+
+/**
+ * @name ledstrip_bench
+ *
+ * @brief times rendering every severity and lean into a strip of the given length. With the strip running it also times
+ * rmt_transmit() on dark frames, the CPU share of sending a frame.
+ *
+ * @param pixel_count pixels per frame, up to LEDSTRIP_MAX_PIXELS
+ * @param bench filled with cycles per frame
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t ledstrip_bench(uint32_t pixel_count, ledstrip_bench_t *bench)
+{
+    static uint8_t pixels[LEDSTRIP_MAX_PIXELS * LEDSTRIP_BYTES_PER_PIXEL]; //kept off the caller's stack
+    ledstrip_frame_t frame = { .lit = true, .brightness = 1023 };
+    esp_cpu_cycle_count_t cycles;
+    esp_err_t err;
+
+    if(pixel_count == 0 || pixel_count > LEDSTRIP_MAX_PIXELS)
+        return ESP_ERR_INVALID_ARG;
+
+    memset(bench, 0, sizeof(ledstrip_bench_t));
+    bench->pixels = pixel_count;
+    bench->wire_us = LEDSTRIP_SYMBOLS(pixel_count) * LEDSTRIP_BIT_NS / 1000 + LEDSTRIP_RESET_US;
+
+    ledstrip_render(&frame, pixels, pixel_count); //warms the cache
+    cycles = esp_cpu_get_cycle_count();
+    for(uint32_t i = 0; i < LEDSTRIP_BENCH_FRAMES; i++)
+    {
+        frame.severity = i % LEDSTRIP_SEVERITY_MAX;
+        frame.lean = i % 3;
+        ledstrip_render(&frame, pixels, pixel_count);
+    }
+    bench->render_cycles = (float)(esp_cpu_get_cycle_count() - cycles) / LEDSTRIP_BENCH_FRAMES;
+
+    if(x_ledstrip.initialized && pixel_count <= x_ledstrip.pixel_count)
+    {
+        uint64_t total = 0;
+
+        memset(pixels, 0, pixel_count * LEDSTRIP_BYTES_PER_PIXEL);
+        for(uint32_t i = 0; i < LEDSTRIP_BENCH_FRAMES; i++)
+        {
+            cycles = esp_cpu_get_cycle_count();
+            err = rmt_transmit(x_ledstrip.channel, x_ledstrip.encoder, pixels, pixel_count * LEDSTRIP_BYTES_PER_PIXEL, &x_transmit_config);
+            total += esp_cpu_get_cycle_count() - cycles;
+
+            if(err == ESP_OK)
+                err = rmt_tx_wait_all_done(x_ledstrip.channel, LEDSTRIP_TX_TIMEOUT_MS);
+            if(err != ESP_OK)
+            {
+                ESP_LOGD(LEDSTRIP_TAG, "ledstrip_bench(): sending a frame returned %s", esp_err_to_name(err));
+                return err;
+            }
+        }
+        bench->transmit_cycles = (float)total / LEDSTRIP_BENCH_FRAMES;
+    }
+
+    ESP_LOGI(LEDSTRIP_TAG, "%lu pixel frames: render %.0f cycles/frame, rmt_transmit %.0f cycles/frame, %lu us on the wire \n",
+             (unsigned long)pixel_count, bench->render_cycles, bench->transmit_cycles, (unsigned long)bench->wire_us);
+
+    return ESP_OK;
+}
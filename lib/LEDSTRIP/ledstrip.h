@@ -0,0 +1,72 @@
+#ifndef LEDSTRIP_H
+#define LEDSTRIP_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+#include "driver/rmt_tx.h"
+
+static const char* LEDSTRIP_TAG = "LED strip";
+
+#define LEDSTRIP_MAX_PIXELS (64)
+#define LEDSTRIP_BYTES_PER_PIXEL (3) //WS2812 takes green, red, blue
+#define LEDSTRIP_SYMBOLS(pixels) ((pixels) * LEDSTRIP_BYTES_PER_PIXEL * 8) //one RMT symbol per bit
+#define LEDSTRIP_RESOLUTION_HZ (10000000) //10 MHz, 1 tick = 0.1 us
+#define LEDSTRIP_T0H (4) //ticks, WS2812B 0 bit is 0.4 us high then 0.85 us low, +-150 ns
+#define LEDSTRIP_T0L (8)
+#define LEDSTRIP_T1H (8) //1 bit is 0.8 us high then 0.45 us low
+#define LEDSTRIP_T1L (4)
+#define LEDSTRIP_BIT_NS (1250) //either bit, high and low together
+#define LEDSTRIP_RESET_US (300) //low this long latches the frame on newer WS2812B, the line idles low between frames
+#define LEDSTRIP_TX_TIMEOUT_MS (10) //a 64 pixel frame is on the wire for under 2.5 ms
+#define LEDSTRIP_TASK_STACK_SIZE (2048)
+#define LEDSTRIP_TASK_PRIORITY (4)
+#define LEDSTRIP_BENCH_FRAMES (100)
+
+typedef enum {
+    LEDSTRIP_WARN = 0, //over the limit
+    LEDSTRIP_SEVERE, //well over it, ledstrip_severe_deg in parameters.h
+    LEDSTRIP_SEVERITY_MAX,
+} ledstrip_severity_t;
+
+typedef enum {
+    LEDSTRIP_LEAN_NONE = 0, //whole strip lit
+    LEDSTRIP_LEAN_LEFT, //arrow towards the first pixel, left side down
+    LEDSTRIP_LEAN_RIGHT, //arrow towards the last pixel, right side down
+} ledstrip_lean_t;
+
+/**
+ * @brief what one frame shows. Frames are only lit on the LED timer's on alarms, the strip is dark whenever the photoresistor
+ * is read the same as the single LED is.
+*/
+typedef struct {
+    bool lit;
+    ledstrip_severity_t severity;
+    ledstrip_lean_t lean;
+    int brightness; //0 - 1023, the duty the photoresistor gives the single LED
+} ledstrip_frame_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t tx_errors; //frames the RMT channel didn't take or didn't finish in time
+    uint32_t last_cycles; //CPU cycles to render the last frame and hand it to the RMT channel
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+} ledstrip_stats_t;
+
+typedef struct {
+    uint32_t pixels;
+    float render_cycles; //per frame
+    float transmit_cycles; //rmt_transmit() encoding the frame into the DMA buffer, 0 if the strip isn't running
+    uint32_t wire_us; //time the frame is on the wire, the DMA does this with no CPU
+} ledstrip_bench_t;
+
+     void ledstrip_render(const ledstrip_frame_t *, uint8_t *, uint32_t);
+esp_err_t ledstrip_bench(uint32_t, ledstrip_bench_t *);
+
+esp_err_t ledstrip_init(int, uint32_t);
+esp_err_t ledstrip_deinit(void);
+     void ledstrip_set_state(ledstrip_severity_t, ledstrip_lean_t);
+     bool ledstrip_show_from_isr(bool, int);
+esp_err_t ledstrip_get_stats(ledstrip_stats_t *);
+
+#endif //LEDSTRIP_H
@@ -12,6 +12,13 @@
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "nmea_parser.h"
+#include "triplog.h"
+#include "slope.h"
+#include "timebase.h"
+#include "geofence.h"
+#include "tripstats.h"
+#include "heading.h"
+#include "trace.h"
 
 /**
  * @brief enabled parsers for different NMEA 0183 command groups
@@ -32,6 +39,7 @@
 #define NMEA_PARSER_RUNTIME_BUFFER_SIZE (CONFIG_NMEA_PARSER_RING_BUFFER_SIZE / 2)
 #define NMEA_MAX_STATEMENT_ITEM_LENGTH (16)
 #define NMEA_EVENT_LOOP_QUEUE_SIZE (16)
+#define NMEA_KNOTS_TO_MS (0.514444f) //1852 m per nautical mile over 3600 s
 
 /**
  * @brief Define of NMEA Parser Event base
@@ -100,11 +108,15 @@ static void parse_utc_time(esp_gps_t *esp_gps)
     esp_gps->parent.tim.hour = convert_two_digit2number(esp_gps->item_str + 0);
     esp_gps->parent.tim.minute = convert_two_digit2number(esp_gps->item_str + 2);
     esp_gps->parent.tim.second = convert_two_digit2number(esp_gps->item_str + 4);
+    esp_gps->parent.tim.thousand = 0;
     if (esp_gps->item_str[6] == '.') {
+        /* fraction of a second, ".5" is 500 ms and anything past the third digit is dropped */
         uint16_t tmp = 0;
+        uint16_t scale = 100;
         uint8_t i = 7;
-        while (esp_gps->item_str[i]) {
-            tmp = 10 * tmp + esp_gps->item_str[i] - '0';
+        while (esp_gps->item_str[i] >= '0' && esp_gps->item_str[i] <= '9' && scale > 0) {
+            tmp += scale * (esp_gps->item_str[i] - '0');
+            scale /= 10;
             i++;
         }
         esp_gps->parent.tim.thousand = tmp;
@@ -274,8 +286,8 @@ static void parse_rmc(esp_gps_t *esp_gps)
             esp_gps->parent.longitude *= -1;
         }
         break;
-    case 7: /* Process ground speed in unit m/s */
-        esp_gps->parent.speed = strtof(esp_gps->item_str, NULL) * 1.852;
+    case 7: /* Process ground speed, sent in knots */
+        esp_gps->parent.speed = strtof(esp_gps->item_str, NULL) * NMEA_KNOTS_TO_MS;
         break;
     case 8: /* Process true course over ground */
         esp_gps->parent.cog = strtof(esp_gps->item_str, NULL);
@@ -288,6 +300,11 @@ static void parse_rmc(esp_gps_t *esp_gps)
     case 10: /* Process magnetic variation */
         esp_gps->parent.variation = strtof(esp_gps->item_str, NULL);
         break;
+    case 11: /* Magnetic variation east(1)/west(-1) information */
+        if (esp_gps->item_str[0] == 'W' || esp_gps->item_str[0] == 'w') {
+            esp_gps->parent.variation *= -1;
+        }
+        break;
     default:
         break;
     }
@@ -344,13 +361,16 @@ static void parse_vtg(esp_gps_t *esp_gps)
     case 1: /* Process true course over ground */
         esp_gps->parent.cog = strtof(esp_gps->item_str, NULL);
         break;
-    case 3:/* Process magnetic variation */
-        esp_gps->parent.variation = strtof(esp_gps->item_str, NULL);
+    case 3:/* Magnetic course, true course minus it is the variation. Left empty by receivers without a magnetic model. */
+        if (esp_gps->item_str[0] != '\0') {
+            esp_gps->parent.variation = esp_gps->parent.cog - strtof(esp_gps->item_str, NULL);
+            esp_gps->parent.variation -= 360.0f * floorf((esp_gps->parent.variation + 180.0f) / 360.0f);
+        }
         break;
-    case 5:/* Process ground speed in unit m/s */
-        esp_gps->parent.speed = strtof(esp_gps->item_str, NULL) * 1.852;//knots to m/s
+    case 5:/* Process ground speed, sent in knots */
+        esp_gps->parent.speed = strtof(esp_gps->item_str, NULL) * NMEA_KNOTS_TO_MS;
         break;
-    case 7:/* Process ground speed in unit m/s */
+    case 7:/* Process ground speed, sent in km/h */
         esp_gps->parent.speed = strtof(esp_gps->item_str, NULL) / 3.6;//km/h to m/s
         break;
     default:
@@ -579,13 +599,17 @@ static void esp_handle_uart_pattern(esp_gps_t *esp_gps)
     int pos = uart_pattern_pop_pos(esp_gps->uart_port);
     if (pos != -1) {
         /* read one line(include '\n') */
+        trace_begin(TRACE_NMEA_READ, pos + 1);
         int read_len = uart_read_bytes(esp_gps->uart_port, esp_gps->buffer, pos + 1, 100 / portTICK_PERIOD_MS);
+        trace_end(TRACE_NMEA_READ, read_len);
         /* make sure the line is a standard string */
         esp_gps->buffer[read_len] = '\0';
         /* Send new line to handle */
+        trace_begin(TRACE_NMEA_DECODE, read_len);
         if (gps_decode(esp_gps, read_len + 1) != ESP_OK) {
             ESP_LOGW(GPS_TAG, "GPS decode line failed");
         }
+        trace_end(TRACE_NMEA_DECODE, esp_gps->cur_statement);
     } else {
         ESP_LOGW(GPS_TAG, "Pattern Queue Size too small");
         uart_flush_input(esp_gps->uart_port);
@@ -634,7 +658,9 @@ static void nmea_parser_task_entry(void *arg)
             }
         }
         /* Drive the event loop */
+        trace_begin(TRACE_NMEA_EVENT, 0);
         esp_event_loop_run(esp_gps->event_loop_hdl, pdMS_TO_TICKS(50));
+        trace_end(TRACE_NMEA_EVENT, 0);
     }
     vTaskDelete(NULL);
 }
@@ -833,3 +859,60 @@ esp_err_t M20048_init(nmea_parser_handle_t *event_handle, float *speedptr)
     return nmea_parser_add_handler(*event_handle, M20048_event_handler, (void *)speedptr);
 }
 
+
+
+/**
+ * @name M20048 event handler
+ * 
+ * @brief This is the event handler for the nmea parser event loop. It gets triggered every time the UART1 interface detects a pattern.
+ * 
+ * @param event_handler_arg In our case we use this void * to store our speeds address and dereference it and update the speed using the event_data
+ * @param event_base I will quote the event_base documentation here, it is a "unique pointer to a subsystem that exposes events"
+ * @param event_id Each event within an event loop has a unique id to better determine what kind of event it is amongst the group
+ * @param event_data The actual data associated to the specific event that occurred. When a GPS_UPDATE occurs, the event data will be a gps_t pointer
+ * 
+ * @authors Ryan Leahy
+ * @date 02/14/2023
+ * 
+ * @cite https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/esp_event.html   
+*/
+void M20048_event_handler(void *event_handler_arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    gps_t *M20048 = NULL;
+
+    switch (event_id) 
+    {
+        case GPS_UPDATE:
+            M20048 = (gps_t *)event_data;
+
+            //When we added the handler to the event loop, we passed in the address to the speed value in main. 
+            //We use this address combined with some typecasting and dereferencing to set the speed value in main from the handler function.
+            *((float *) event_handler_arg) = M20048->speed; 
+
+            //keep every fix in the trip log, does nothing if the log isn't open
+            triplog_log_gps(M20048);
+
+            //lines esp_timer up with GPS time, does nothing if the timebase isn't running
+            timebase_gps_fix(M20048);
+
+            //climb over distance for the grade estimator, does nothing if it isn't running
+            slope_gps_fix(M20048);
+
+            //zone the fix is in, does nothing if there are no geofences loaded
+            geofence_gps_fix(M20048);
+
+            //distance and moving time for the trip totals, does nothing if they aren't running
+            tripstats_gps_fix(M20048);
+
+            //course against the magnetic heading for the track frame, does nothing if the estimator isn't running
+            heading_gps_fix(M20048);
+
+            break;
+        case GPS_UNKNOWN:
+            /* print unknown statements */
+            ESP_LOGW(M20048_TAG, "Unknown statement:%s", (char *)event_data);
+            break;
+        default:
+            break;
+    }
+}
@@ -235,28 +235,7 @@ esp_err_t M20048_init(nmea_parser_handle_t *event_handle, float *speedptr);
  * 
  * @cite https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/esp_event.html   
 */
-static void M20048_event_handler(void *event_handler_arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
-{
-    gps_t *M20048 = NULL;
-
-    switch (event_id) 
-    {
-        case GPS_UPDATE:
-            M20048 = (gps_t *)event_data;
-
-            //When we added the handler to the event loop, we passed in the address to the speed value in main. 
-            //We use this address combined with some typecasting and dereferencing to set the speed value in main from the handler function.
-            *((float *) event_handler_arg) = M20048->speed; 
-
-            break;
-        case GPS_UNKNOWN:
-            /* print unknown statements */
-            ESP_LOGW(M20048_TAG, "Unknown statement:%s", (char *)event_data);
-            break;
-        default:
-            break;
-    }
-}
+void M20048_event_handler(void *event_handler_arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
 
 #ifdef __cplusplus
 }
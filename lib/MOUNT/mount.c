@@ -0,0 +1,337 @@
+#include <string.h>
+#include <math.h>
+#include "mount.h"
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define MOUNT_DEG_TO_RAD (M_PI / 180.0)
+
+//what is kept in NVS, the reference quaternion in MOUNT_QUAT_LSB steps
+typedef struct {
+    uint8_t version;
+    uint8_t placement; //placement the reference was captured under, it means nothing under another one
+    int16_t q[4]; //w x y z
+} mount_nvs_t;
+
+//AXIS_MAP_CONFIG and AXIS_MAP_SIGN for P0 - P7
+static const bno055_axis_remap_config_t x_remap_config[8] = {
+    REMAP_CONFIG_P0, REMAP_CONFIG_P1, REMAP_CONFIG_P2, REMAP_CONFIG_P3,
+    REMAP_CONFIG_P4, REMAP_CONFIG_P5, REMAP_CONFIG_P6, REMAP_CONFIG_P7
+};
+static const bno055_axis_remap_sign_t x_remap_sign[8] = {
+    REMAP_SIGN_P0, REMAP_SIGN_P1, REMAP_SIGN_P2, REMAP_SIGN_P3,
+    REMAP_SIGN_P4, REMAP_SIGN_P5, REMAP_SIGN_P6, REMAP_SIGN_P7
+};
+
+//rounds to the 1/16 degree the BNO055 and the trip log work in, a corrected reading is put back on that grid
+static double mount_quantise(double angle)
+{
+    return lround(angle * 16.0) / 16.0;
+}
+
+//the rotation an euler reading stands for, laid out like fusion_get_euler() reads one back: heading clockwise about z, then
+//y, then x
+static void mount_euler_to_quat(const bno055_vec3_t *euler, bno055_quaternion_t *q)
+{
+    double cx = cos(euler->x * MOUNT_DEG_TO_RAD / 2), sx = sin(euler->x * MOUNT_DEG_TO_RAD / 2);
+    double cy = cos(euler->y * MOUNT_DEG_TO_RAD / 2), sy = sin(euler->y * MOUNT_DEG_TO_RAD / 2);
+    double cz = cos(-euler->z * MOUNT_DEG_TO_RAD / 2), sz = sin(-euler->z * MOUNT_DEG_TO_RAD / 2);
+
+    q->w = cz*cy*cx + sz*sy*sx;
+    q->x = cz*cy*sx - sz*sy*cx;
+    q->y = cz*sy*cx + sz*cy*sx;
+    q->z = sz*cy*cx - cz*sy*sx;
+}
+
+static void mount_quat_to_euler(const bno055_quaternion_t *q, bno055_vec3_t *euler)
+{
+    double sin_y = 2.0 * (q->w*q->y - q->z*q->x);
+
+    if(sin_y > 1.0)
+        sin_y = 1.0;
+    if(sin_y < -1.0)
+        sin_y = -1.0;
+
+    double heading = -atan2(2.0 * (q->w*q->z + q->x*q->y), 1.0 - 2.0 * (q->y*q->y + q->z*q->z)) / MOUNT_DEG_TO_RAD;
+
+    euler->x = atan2(2.0 * (q->w*q->x + q->y*q->z), 1.0 - 2.0 * (q->x*q->x + q->y*q->y)) / MOUNT_DEG_TO_RAD;
+    euler->y = asin(sin_y) / MOUNT_DEG_TO_RAD;
+    euler->z = heading < 0.0 ? heading + 360.0 : heading;
+}
+
+//a then b, both sensor to earth
+static void mount_quat_mul(const bno055_quaternion_t *a, const bno055_quaternion_t *b, bno055_quaternion_t *out)
+{
+    bno055_quaternion_t q = {
+        .w = a->w*b->w - a->x*b->x - a->y*b->y - a->z*b->z,
+        .x = a->w*b->x + a->x*b->w + a->y*b->z - a->z*b->y,
+        .y = a->w*b->y - a->x*b->z + a->y*b->w + a->z*b->x,
+        .z = a->w*b->z + a->x*b->y - a->y*b->x + a->z*b->w,
+    };
+
+    *out = q;
+}
+
+//the reference as applied is rebuilt from the stored steps alone, so a captured one and one loaded at the next boot are
+//the same to the last bit and the corrections replay the same
+static void mount_set_reference(mount_t *mount, const int16_t *steps)
+{
+    double w = steps[0] / MOUNT_QUAT_LSB, x = steps[1] / MOUNT_QUAT_LSB, y = steps[2] / MOUNT_QUAT_LSB, z = steps[3] / MOUNT_QUAT_LSB;
+    double norm = sqrt(w*w + x*x + y*y + z*z);
+
+    mount->reference.w = w / norm;
+    mount->reference.x = x / norm;
+    mount->reference.y = y / norm;
+    mount->reference.z = z / norm;
+    mount->has_reference = true;
+}
+
+//the stored steps of the reference, the rebuilt quaternion is a unit one so they round back to what was stored
+static void mount_reference_steps(const mount_t *mount, int16_t *steps)
+{
+    steps[0] = (int16_t)lround(mount->reference.w * MOUNT_QUAT_LSB);
+    steps[1] = (int16_t)lround(mount->reference.x * MOUNT_QUAT_LSB);
+    steps[2] = (int16_t)lround(mount->reference.y * MOUNT_QUAT_LSB);
+    steps[3] = (int16_t)lround(mount->reference.z * MOUNT_QUAT_LSB);
+}
+
+static esp_err_t mount_save(const mount_t *mount)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+
+    mount_nvs_t blob = {
+        .version = MOUNT_NVS_VERSION,
+        .placement = mount->placement,
+    };
+    mount_reference_steps(mount, blob.q);
+
+    if((err = nvs_open(MOUNT_NVS_NAMESPACE, NVS_READWRITE, &handle)) != ESP_OK)
+    {
+        ESP_LOGD(MOUNT_TAG, "mount_save(): nvs_open returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if(mount->has_reference)
+        err = nvs_set_blob(handle, MOUNT_NVS_KEY, &blob, sizeof(mount_nvs_t));
+    else if((err = nvs_erase_key(handle, MOUNT_NVS_KEY)) == ESP_ERR_NVS_NOT_FOUND)
+        err = ESP_OK;
+
+    if(err == ESP_OK)
+        err = nvs_commit(handle);
+    else
+        ESP_LOGD(MOUNT_TAG, "mount_save(): writing %s returned %s", MOUNT_NVS_KEY, esp_err_to_name(err));
+
+    nvs_close(handle);
+    return err;
+}
+
+/**
+ * @name mount_init
+ *
+ * @brief brings up NVS and loads the level reference captured for this placement, if there is one
+ *
+ * @param mount filled with the placement and the stored reference
+ * @param placement P0 - P7, how the board sits in the car
+ *
+ * @return esp_err_t, ESP_OK with has_reference false when nothing has been captured yet
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t mount_init(mount_t *mount, uint8_t placement)
+{
+    nvs_handle_t handle;
+    mount_nvs_t blob;
+    size_t size = sizeof(mount_nvs_t);
+    esp_err_t err;
+
+    memset(mount, 0, sizeof(mount_t));
+
+    if(placement > 7)
+        return ESP_ERR_INVALID_ARG;
+    mount->placement = placement;
+
+    //the partition is only wiped when NVS itself can't use it as is, which is what IDF expects of every app
+    err = nvs_flash_init();
+    if(err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_LOGW(MOUNT_TAG, "mount_init(): nvs_flash_init returned %s, erasing NVS", esp_err_to_name(err));
+        if((err = nvs_flash_erase()) == ESP_OK)
+            err = nvs_flash_init();
+    }
+    if(err != ESP_OK)
+    {
+        ESP_LOGD(MOUNT_TAG, "mount_init(): nvs_flash_init returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = nvs_open(MOUNT_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if(err == ESP_ERR_NVS_NOT_FOUND) //namespace is made on the first capture
+        return ESP_OK;
+    if(err != ESP_OK)
+    {
+        ESP_LOGD(MOUNT_TAG, "mount_init(): nvs_open returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = nvs_get_blob(handle, MOUNT_NVS_KEY, &blob, &size);
+    nvs_close(handle);
+
+    if(err == ESP_ERR_NVS_NOT_FOUND)
+        return ESP_OK;
+    if(err != ESP_OK)
+    {
+        ESP_LOGD(MOUNT_TAG, "mount_init(): nvs_get_blob returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if(size != sizeof(mount_nvs_t) || blob.version != MOUNT_NVS_VERSION)
+    {
+        ESP_LOGW(MOUNT_TAG, "mount_init(): stored level reference is from another firmware, ignoring it");
+        return ESP_OK;
+    }
+
+    if(blob.placement != placement)
+    {
+        ESP_LOGW(MOUNT_TAG, "mount_init(): level reference was captured for P%d, mounted as P%d, capture it again", blob.placement, placement);
+        return ESP_OK;
+    }
+
+    mount_set_reference(mount, blob.q);
+
+    ESP_LOGI(MOUNT_TAG, "Level reference w = %f x = %f y = %f z = %f \n", mount->reference.w, mount->reference.x,
+             mount->reference.y, mount->reference.z);
+
+    return ESP_OK;
+}
+
+/**
+ * @name mount_remap_imu
+ *
+ * @brief applies the placement in the IMU so it reports in the car's frame. Called for every IMU on the board.
+ *
+ * @param mount placement to apply
+ * @param i2c_num IMU to remap
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t mount_remap_imu(const mount_t *mount, i2c_number_t i2c_num)
+{
+    return bno055_set_axis_remap(i2c_num, x_remap_config[mount->placement], x_remap_sign[mount->placement]);
+}
+
+/**
+ * @name mount_capture_reference
+ *
+ * @brief averages MOUNT_CAPTURE_SAMPLES readings while the car sits level and keeps the tilt they show in NVS as the level
+ * reference quaternion. The heading the car happened to face is taken out, and the quaternion is rounded to MOUNT_QUAT_LSB
+ * steps before it is used. Takes MOUNT_CAPTURE_SAMPLES * MOUNT_CAPTURE_PERIOD_MS, the IMU has to be in a fusion mode.
+ *
+ * @param mount gets the new reference
+ * @param i2c_num IMU to capture from, already remapped
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t mount_capture_reference(mount_t *mount, i2c_number_t i2c_num)
+{
+    bno055_opmode_t mode;
+    bno055_vec3_t euler;
+    bno055_quaternion_t q, first, sum = {0};
+    int16_t steps[4];
+    esp_err_t err;
+
+    if((err = bno055_get_opmode(i2c_num, &mode)) != ESP_OK)
+    {
+        ESP_LOGD(MOUNT_TAG, "mount_capture_reference(): bno055_get_opmode returned %s", esp_err_to_name(err));
+        return err;
+    }
+    if(mode < OPERATION_MODE_IMUPLUS)
+        return BNO_ERR_WRONG_OPMODE;
+
+    for(int i = 0; i < MOUNT_CAPTURE_SAMPLES; i++)
+    {
+        if((err = bno055_get_euler(i2c_num, &euler)) != ESP_OK)
+        {
+            ESP_LOGD(MOUNT_TAG, "mount_capture_reference(): reading the IMU returned %s", esp_err_to_name(err));
+            return err;
+        }
+
+        //q and -q are the same rotation, keep every sample on the side of the first so they don't cancel out
+        mount_euler_to_quat(&euler, &q);
+        if(i == 0)
+            first = q;
+        double sign = q.w*first.w + q.x*first.x + q.y*first.y + q.z*first.z < 0 ? -1.0 : 1.0;
+        sum.w += sign * q.w;
+        sum.x += sign * q.x;
+        sum.y += sign * q.y;
+        sum.z += sign * q.z;
+
+        vTaskDelay(MOUNT_CAPTURE_PERIOD_MS / portTICK_PERIOD_MS);
+    }
+
+    //the heading is outermost in the euler order, dropping it leaves the tilt of the board alone
+    double norm = sqrt(sum.w*sum.w + sum.x*sum.x + sum.y*sum.y + sum.z*sum.z);
+    sum.w /= norm;
+    sum.x /= norm;
+    sum.y /= norm;
+    sum.z /= norm;
+    mount_quat_to_euler(&sum, &euler);
+    euler.z = 0;
+    mount_euler_to_quat(&euler, &mount->reference);
+    mount_reference_steps(mount, steps);
+    mount_set_reference(mount, steps);
+
+    ESP_LOGI(MOUNT_TAG, "Captured level reference x = %f y = %f, w = %f x = %f y = %f z = %f \n", euler.x, euler.y,
+             mount->reference.w, mount->reference.x, mount->reference.y, mount->reference.z);
+
+    return mount_save(mount);
+}
+
+esp_err_t mount_clear_reference(mount_t *mount)
+{
+    mount->has_reference = false;
+    memset(&mount->reference, 0, sizeof(bno055_quaternion_t));
+
+    return mount_save(mount);
+}
+
+/**
+ * @name mount_apply
+ *
+ * @brief rotates the level reference out of an euler reading. The board's tilt turns with the car, so it is taken off on
+ * the board's side of the rotation, which holds however far the car itself leans and whichever way it faces. The result is
+ * rounded back to 1/16 degree, so what the trip log keeps is what was decided on and replays to the same decision.
+ *
+ * @param mount reference to take off, nothing is done without one
+ * @param angle reading from bno055_get_euler()/imupair_get_euler(), corrected in place
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void mount_apply(const mount_t *mount, bno055_vec3_t *angle)
+{
+    bno055_quaternion_t q, inverse = { mount->reference.w, -mount->reference.x, -mount->reference.y, -mount->reference.z };
+
+    if(!mount->has_reference)
+        return;
+
+    mount_euler_to_quat(angle, &q);
+    mount_quat_mul(&q, &inverse, &q);
+    mount_quat_to_euler(&q, angle);
+
+    angle->x = mount_quantise(angle->x);
+    angle->y = mount_quantise(angle->y);
+    angle->z = mount_quantise(angle->z);
+    if(angle->z >= 360.0)
+        angle->z -= 360.0;
+}
@@ -0,0 +1,34 @@
+#ifndef MOUNT_H
+#define MOUNT_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+#include "bno055.h"
+
+static const char* MOUNT_TAG = "Mount";
+
+#define MOUNT_NVS_NAMESPACE "mount"
+#define MOUNT_NVS_KEY "level_ref"
+#define MOUNT_NVS_VERSION (3) //bump when mount_nvs_t changes, an old blob is then ignored
+#define MOUNT_QUAT_LSB (16384.0) //the reference is kept in NVS in the 1/2^14 steps of the BNO055 quaternion output
+#define MOUNT_CAPTURE_SAMPLES (32)
+#define MOUNT_CAPTURE_PERIOD_MS (20) //fusion output runs at 100 Hz, two periods apart so no sample is read twice
+
+/**
+ * @brief how the board sits in the car. The placement is applied in the BNO055 so its outputs come out in the car's frame,
+ * the level reference is whatever tilt is left once the board is bolted in and is rotated out of every sample.
+*/
+typedef struct {
+    uint8_t placement; //P0 - P7 from the BNO055 datasheet section 3.4, P1 is the chip default
+    bool has_reference;
+    bno055_quaternion_t reference; //board to car rotation captured while the car sat level, heading taken out, exactly what NVS holds
+} mount_t;
+
+esp_err_t mount_init(mount_t *, uint8_t);
+esp_err_t mount_remap_imu(const mount_t *, i2c_number_t);
+esp_err_t mount_capture_reference(mount_t *, i2c_number_t);
+esp_err_t mount_clear_reference(mount_t *);
+     void mount_apply(const mount_t *, bno055_vec3_t *);
+
+#endif //MOUNT_H
@@ -0,0 +1,624 @@
+#include <string.h>
+#include "replay.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+    uint32_t timestamp_ms;
+    bool led_on;
+    bool is_led_on;
+    int led_on_val;
+    int duty;
+    uint8_t dropped_before; //alarms lost between the previous queued alarm and this one
+} replay_tick_t;
+
+/**
+ * @brief LED alarms queued by the timer ISR. The ISR can't take the trip log mutex so alarms wait here until app_main drains them.
+*/
+typedef struct {
+    bool enabled;
+    portMUX_TYPE lock;
+    uint8_t head;
+    uint8_t count;
+    uint8_t dropped;
+    replay_tick_t ticks[REPLAY_TICK_QUEUE_SIZE];
+} replay_capture_t;
+
+static replay_capture_t x_capture = {
+    .lock = portMUX_INITIALIZER_UNLOCKED,
+};
+
+/**
+ * @name replay_capture_enable
+ *
+ * @brief turns capture mode on or off. With it on every LED timer alarm is logged on top of the records the trip log always keeps.
+ *
+ * @param enable true to capture
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void replay_capture_enable(bool enable)
+{
+    portENTER_CRITICAL(&x_capture.lock);
+    x_capture.enabled = enable;
+    x_capture.count = 0;
+    x_capture.dropped = 0;
+    portEXIT_CRITICAL(&x_capture.lock);
+}
+
+/**
+ * @name replay_capture_tick
+ *
+ * @brief queues an LED timer alarm, safe to call from the timer ISR
+ *
+ * @param led_on led_on as the alarm handler read it
+ * @param led_on_val led_on_val as the alarm handler read it
+ * @param duty duty the handler set
+ * @param is_led_on whether the handler left the LED lit
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void replay_capture_tick(bool led_on, int led_on_val, int duty, bool is_led_on)
+{
+    if(!x_capture.enabled)
+        return;
+
+    portENTER_CRITICAL_ISR(&x_capture.lock);
+    if(x_capture.count < REPLAY_TICK_QUEUE_SIZE)
+    {
+        replay_tick_t *tick = &x_capture.ticks[(x_capture.head + x_capture.count) % REPLAY_TICK_QUEUE_SIZE];
+        tick->timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        tick->led_on = led_on;
+        tick->led_on_val = led_on_val;
+        tick->duty = duty;
+        tick->is_led_on = is_led_on;
+        tick->dropped_before = x_capture.dropped;
+        x_capture.dropped = 0;
+        x_capture.count++;
+    }
+    else if(x_capture.dropped < UINT8_MAX)
+        x_capture.dropped++;
+    portEXIT_CRITICAL_ISR(&x_capture.lock);
+}
+
+/**
+ * @name replay_capture_drain
+ *
+ * @brief moves queued LED alarms into the trip log, called from the main loop
+ *
+ * @return err variable from the last triplog_append()
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t replay_capture_drain(void)
+{
+    esp_err_t err = ESP_OK;
+    replay_tick_t tick;
+    triplog_record_t record;
+
+    while(true)
+    {
+        portENTER_CRITICAL(&x_capture.lock);
+        if(x_capture.count == 0)
+        {
+            portEXIT_CRITICAL(&x_capture.lock);
+            break;
+        }
+        tick = x_capture.ticks[x_capture.head];
+        x_capture.head = (x_capture.head + 1) % REPLAY_TICK_QUEUE_SIZE;
+        x_capture.count--;
+        portEXIT_CRITICAL(&x_capture.lock);
+
+        memset(&record, 0, sizeof(record));
+        record.timestamp_ms = tick.timestamp_ms;
+        record.type = TRIPLOG_RECORD_LED_TICK;
+        record.flags = tick.dropped_before; //alarms lost before this one, replay resyncs the flashing when it sees this
+        record.payload.led_tick.led_on = tick.led_on;
+        record.payload.led_tick.is_led_on = tick.is_led_on;
+        record.payload.led_tick.led_on_val = tick.led_on_val;
+        record.payload.led_tick.duty = tick.duty;
+
+        err = triplog_append(&record);
+    }
+
+    return err;
+}
+
+/**
+ * @name replay_inputs_begin
+ *
+ * @brief clears the inputs for a new log, the limits start out as the base ones the way the device boots outside every zone
+ *
+ * @param inputs inputs to clear
+ * @param params limits outside every zone, NULL for the ones in parameters.h
+ * @param axes_params per axis limits outside every zone, NULL for the ones in parameters.h
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void replay_inputs_begin(replay_inputs_t *inputs, const decision_params_t *params, const decision_axes_params_t *axes_params)
+{
+    memset(inputs, 0, sizeof(replay_inputs_t));
+
+    if(params != NULL)
+        inputs->base_params = *params;
+    else
+        decision_default_params(&inputs->base_params);
+
+    if(axes_params != NULL)
+        inputs->base_axes_params = *axes_params;
+    else
+        decision_default_axes_params(&inputs->base_axes_params);
+
+    inputs->params = inputs->base_params;
+    inputs->axes_params = inputs->base_axes_params;
+    inputs->zone_id = GEOFENCE_NO_ZONE;
+}
+
+/**
+ * @name replay_inputs_feed
+ *
+ * @brief takes in one record and hands back the next decision with the angle and limits the device used for it.
+ * Boot, zone and IMU records only change the inputs.
+ *
+ * @param inputs inputs set up by replay_inputs_begin()
+ * @param record next record in log order
+ * @param decision filled in when the record is a decision with an IMU sample ahead of it
+ *
+ * @return true if decision was filled in
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+bool replay_inputs_feed(replay_inputs_t *inputs, const triplog_record_t *record, replay_decision_t *decision)
+{
+    geofence_zone_t zone;
+
+    switch(record->type)
+    {
+        case TRIPLOG_RECORD_BOOT:
+            //the device boots outside every zone until the fixes say otherwise
+            inputs->has_imu = false;
+            inputs->params = inputs->base_params;
+            inputs->axes_params = inputs->base_axes_params;
+            inputs->zone_id = GEOFENCE_NO_ZONE;
+            return false;
+        case TRIPLOG_RECORD_ZONE:
+            //the record sits where the device switched, every decision after it was made with these limits
+            zone = (geofence_zone_t){
+                .id = record->payload.zone.id,
+                .threshold = record->payload.zone.threshold,
+                .pitch_upper = record->payload.zone.pitch_upper,
+                .pitch_lower = record->payload.zone.pitch_lower,
+                .roll_upper = record->payload.zone.roll_upper,
+                .roll_lower = record->payload.zone.roll_lower,
+                .lower_speed = record->payload.zone.lower_speed,
+                .upper_speed = record->payload.zone.upper_speed,
+            };
+
+            inputs->params = inputs->base_params;
+            inputs->axes_params = inputs->base_axes_params;
+            if(zone.id != GEOFENCE_NO_ZONE)
+                geofence_apply_zone(&zone, &inputs->params, &inputs->axes_params);
+            inputs->zone_id = zone.id;
+            return false;
+        case TRIPLOG_RECORD_IMU:
+            //same conversion bno055_get_euler() does, so the angle is bit for bit what the device had
+            inputs->angle.x = ((double)record->payload.imu.x) / 16.0;
+            inputs->angle.y = ((double)record->payload.imu.y) / 16.0;
+            inputs->angle.z = ((double)record->payload.imu.z) / 16.0;
+            inputs->has_imu = true;
+            return false;
+        case TRIPLOG_RECORD_DECISION:
+            //with IMU packing the sample is in the decision record, z isn't kept and nothing the decision does uses it
+            if(record->flags & TRIPLOG_FLAG_ANGLE)
+            {
+                inputs->angle.x = ((double)record->payload.decision.angle_x) / 16.0;
+                inputs->angle.y = ((double)record->payload.decision.angle_y) / 16.0;
+                inputs->angle.z = 0;
+                inputs->has_imu = true;
+            }
+            if(!inputs->has_imu)
+                return false;
+
+            //turned into the direction of travel, then the grade taken off, in the order main does it.
+            //With prediction on the device judged the extrapolated angle, which only the decision record holds.
+            decision->judged = inputs->angle;
+            if(record->flags & TRIPLOG_FLAG_TRACK)
+                heading_rotate(&inputs->angle, ((double)record->payload.decision.track_offset) / 16.0, &decision->judged);
+            if(record->flags & TRIPLOG_FLAG_GRADE)
+                decision->judged.x -= ((double)record->payload.decision.grade) / 16.0;
+            if(record->flags & TRIPLOG_FLAG_PREDICTED)
+                decision->judged = (bno055_vec3_t){ .x = record->payload.decision.combined_angle };
+
+            decision->speed = record->payload.decision.speed;
+            decision->axes = record->flags & TRIPLOG_FLAG_AXES;
+            decision->logged = record->payload.decision.out_of_level;
+            inputs->has_imu = false;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @name replay_begin
+ *
+ * @brief clears a replay. The replay judges samples with its own state machine and the limits from parameters.h, change
+ * replay->inputs.base_params after this to see how a capture would have played out with other limits.
+ *
+ * @param replay replay to clear
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void replay_begin(replay_t *replay)
+{
+    memset(replay, 0, sizeof(replay_t));
+    replay_inputs_begin(&replay->inputs, NULL, NULL);
+}
+
+/**
+ * @name replay_feed
+ *
+ * @brief runs one trip log record through the decision logic and compares what it gives back to what the device logged.
+ *
+ * Inputs and the outputs checked against them:
+ * Light: raw_ADC_to_LED_val(adc_mv) has to give back led_val
+ * IMU + decision: is_out_of_level_r() or decision_axes_step() on the IMU sample as replay_inputs_feed() rebuilds it has to give back out_of_level
+ * LED tick: led_blink_step() on the logged led_on/led_on_val has to give back the duty and LED state
+ *
+ * @param replay replay state set up by replay_begin()
+ * @param record next record in log order
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void replay_feed(replay_t *replay, const triplog_record_t *record)
+{
+    replay_decision_t decision;
+    bool decided = replay_inputs_feed(&replay->inputs, record, &decision);
+
+    replay->records++;
+
+    if(record->type == TRIPLOG_RECORD_BOOT)
+    {
+        memset(&replay->decision_state, 0, sizeof(replay->decision_state));
+        memset(&replay->axes_state, 0, sizeof(replay->axes_state));
+        memset(&replay->blink_state, 0, sizeof(replay->blink_state));
+        replay->blink_known = true;
+        replay->has_timebase = false;
+        replay->in_session = true;
+        replay->sessions++;
+        return;
+    }
+
+    //the mapping only holds within a power cycle, it goes with the boot record's reset above
+    if(record->type == TRIPLOG_RECORD_TIMEBASE)
+    {
+        replay->has_timebase = true;
+        replay->timebase_local_us = record->payload.timebase.local_us;
+        replay->timebase_gps_us = record->payload.timebase.gps_us;
+        replay->timebase_rate_ppb = record->payload.timebase.rate_ppb;
+        return;
+    }
+
+    //taken in by replay_inputs_feed() whether or not a session has started
+    if(record->type == TRIPLOG_RECORD_ZONE)
+        return;
+
+    if(!replay->in_session)
+    {
+        replay->skipped++;
+        return;
+    }
+
+    switch(record->type)
+    {
+        case TRIPLOG_RECORD_LIGHT:
+            replay->lights_checked++;
+            if(raw_ADC_to_LED_val(record->payload.light.adc_mv) != record->payload.light.led_val)
+            {
+                replay->light_mismatches++;
+                ESP_LOGW(REPLAY_TAG, "record %u: light %ld mV mapped to %d, device had %ld", record->sequence, (long)record->payload.light.adc_mv,
+                    raw_ADC_to_LED_val(record->payload.light.adc_mv), (long)record->payload.light.led_val);
+            }
+            break;
+        case TRIPLOG_RECORD_DECISION:
+            if(!decided)
+            {
+                replay->skipped++;
+                break;
+            }
+            bool out_of_level = decision.axes ?
+                decision_axes_step(&replay->axes_state, &replay->inputs.axes_params, &decision.judged, decision.speed, record->timestamp_ms) :
+                is_out_of_level_r(&replay->decision_state, &replay->inputs.params, &decision.judged, decision.speed);
+            replay->decisions_checked++;
+            if(out_of_level != decision.logged)
+            {
+                replay->decision_mismatches++;
+                ESP_LOGW(REPLAY_TAG, "record %u: decision %d, device had %d", record->sequence, out_of_level, decision.logged);
+            }
+            break;
+        case TRIPLOG_RECORD_LED_TICK:
+            if(record->flags != 0)
+            {
+                replay->ticks_dropped += record->flags;
+                replay->blink_known = false;
+            }
+
+            bool is_led_on;
+            int duty = led_blink_step(&replay->blink_state, record->payload.led_tick.led_on, record->payload.led_tick.led_on_val, &is_led_on);
+
+            if(!replay->blink_known)
+            {
+                //can't check this one, but a flashing alarm tells us where the toggle ended up
+                if(record->payload.led_tick.led_on)
+                {
+                    replay->blink_state.toggle = record->payload.led_tick.is_led_on ? 0x01 : 0x03;
+                    replay->blink_known = true;
+                }
+                break;
+            }
+
+            replay->ticks_checked++;
+            if(duty != record->payload.led_tick.duty || is_led_on != (bool)record->payload.led_tick.is_led_on)
+            {
+                replay->tick_mismatches++;
+                ESP_LOGW(REPLAY_TAG, "record %u: LED duty %d lit %d, device had %ld lit %d", record->sequence, duty, is_led_on,
+                    (long)record->payload.led_tick.duty, record->payload.led_tick.is_led_on);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @name replay_run_triplog
+ *
+ * @brief replays everything in the open trip log. Runs as fast as the log can be read, on the host this is the log opened on a
+ * triplog_sim_t image loaded with a partition dump.
+ *
+ * @param replay filled with the outcome
+ *
+ * @return err variable that lets you know if the whole log was read or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t replay_run_triplog(replay_t *replay)
+{
+    esp_err_t err;
+    triplog_iter_t iter;
+    triplog_record_t record;
+
+    replay_begin(replay);
+
+    if((err = triplog_iter_begin(&iter)) != ESP_OK)
+    {
+        ESP_LOGD(REPLAY_TAG, "replay_run_triplog(): triplog_iter_begin returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    while((err = triplog_iter_next(&iter, &record)) == ESP_OK)
+        replay_feed(replay, &record);
+
+    if(err != ESP_ERR_NOT_FOUND)
+    {
+        ESP_LOGD(REPLAY_TAG, "replay_run_triplog(): triplog_iter_next returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    ESP_LOGI(REPLAY_TAG, "Replayed %lu records over %lu sessions: %lu/%lu decisions, %lu/%lu light, %lu/%lu LED ticks matched",
+        (unsigned long)replay->records, (unsigned long)replay->sessions,
+        (unsigned long)(replay->decisions_checked - replay->decision_mismatches), (unsigned long)replay->decisions_checked,
+        (unsigned long)(replay->lights_checked - replay->light_mismatches), (unsigned long)replay->lights_checked,
+        (unsigned long)(replay->ticks_checked - replay->tick_mismatches), (unsigned long)replay->ticks_checked);
+
+    return ESP_OK;
+}
+
+/**
+ * @name replay_gps_time
+ *
+ * @brief GPS time of a record. IMU and light records carry the time they were read, everything else is worked out from its
+ * timestamp and the last timebase record fed to the replay, to the millisecond. A GPS record gets the epoch the fix is for,
+ * its time of day put on the day its timestamp works out to.
+ *
+ * @param replay replay the records are being fed to
+ * @param record record to time, fed to the replay already
+ * @param gps_us set to the GPS time of the record
+ *
+ * @return ESP_ERR_NOT_FOUND before the device had GPS time
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t replay_gps_time(const replay_t *replay, const triplog_record_t *record, int64_t *gps_us)
+{
+    if(record->type == TRIPLOG_RECORD_IMU && record->payload.imu.gps_us != 0)
+        *gps_us = record->payload.imu.gps_us;
+    else if(record->type == TRIPLOG_RECORD_LIGHT && record->payload.light.gps_us != 0)
+        *gps_us = record->payload.light.gps_us;
+    else if(replay->has_timebase)
+    {
+        int64_t local_us = (int64_t)record->timestamp_ms * 1000 - replay->timebase_local_us;
+        *gps_us = replay->timebase_gps_us + local_us + local_us * replay->timebase_rate_ppb / 1000000000LL;
+
+        //the fix came in a moment after its epoch, the nearest one with its time of day is on the right day across midnight too
+        if(record->type == TRIPLOG_RECORD_GPS)
+        {
+            int64_t epoch_us = *gps_us - *gps_us % REPLAY_DAY_US + (int64_t)record->payload.gps.epoch_ms * 1000;
+
+            if(epoch_us - *gps_us > REPLAY_DAY_US / 2)
+                epoch_us -= REPLAY_DAY_US;
+            else if(*gps_us - epoch_us > REPLAY_DAY_US / 2)
+                epoch_us += REPLAY_DAY_US;
+            *gps_us = epoch_us;
+        }
+    }
+    else
+        return ESP_ERR_NOT_FOUND;
+
+    return ESP_OK;
+}
+
+/**
+ * @name replay_predict_begin
+ *
+ * @brief clears a prediction benchmark. Run one per set of limits over the same log to see lead time against false alarms.
+ *
+ * @param bench benchmark to clear
+ * @param predict prediction limits to judge, the out of level limits come from parameters.h
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void replay_predict_begin(replay_predict_t *bench, const predict_params_t *predict)
+{
+    memset(bench, 0, sizeof(replay_predict_t));
+    bench->predict = *predict;
+    decision_default_params(&bench->params);
+}
+
+//moves the predictor on to a sample, in 1/16 degree
+static void replay_predict_sample(replay_predict_t *bench, int16_t x, int16_t y, int16_t z, uint32_t time_ms)
+{
+    bench->angle.x = ((double)x) / 16.0;
+    bench->angle.y = ((double)y) / 16.0;
+    bench->angle.z = ((double)z) / 16.0;
+    bench->imu_ms = time_ms;
+    decision_predict(&bench->predict_state, &bench->predict, &bench->angle, bench->imu_ms, &bench->predicted);
+    bench->has_imu = true;
+}
+
+//ends a predicted run, a run the measured angle never confirmed was a false alarm
+static void replay_predict_end_run(replay_predict_t *bench, uint32_t time_ms)
+{
+    if(!bench->predicted_on)
+        return;
+
+    if(!bench->run_confirmed)
+    {
+        bench->false_alarms++;
+        bench->false_alarm_ms += time_ms - bench->predicted_since_ms;
+    }
+    bench->predicted_on = false;
+}
+
+/**
+ * @name replay_predict_feed
+ *
+ * @brief runs the predictor over one trip log record. IMU records move the predictor on at the time they were logged, the
+ * decision record after each one supplies the speed it is judged with. A decision carrying a packed sample does both.
+ *
+ * @param bench benchmark set up by replay_predict_begin()
+ * @param record next record in log order
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void replay_predict_feed(replay_predict_t *bench, const triplog_record_t *record)
+{
+    switch(record->type)
+    {
+        case TRIPLOG_RECORD_BOOT:
+            replay_predict_end_run(bench, bench->imu_ms);
+            memset(&bench->predict_state, 0, sizeof(predict_state_t));
+            bench->actual_on = false;
+            bench->has_imu = false;
+            break;
+        case TRIPLOG_RECORD_IMU:
+            replay_predict_sample(bench, record->payload.imu.x, record->payload.imu.y, record->payload.imu.z, record->timestamp_ms);
+            break;
+        case TRIPLOG_RECORD_DECISION:
+            if(record->flags & TRIPLOG_FLAG_ANGLE) //packed IMU sample, moved on at the time of the decision
+                replay_predict_sample(bench, record->payload.decision.angle_x, record->payload.decision.angle_y, 0, record->timestamp_ms);
+            if(!bench->has_imu)
+                break;
+            bench->has_imu = false;
+            bench->samples++;
+
+            float speed = record->payload.decision.speed;
+            bool speed_ok = speed >= bench->params.lower_speed && speed <= bench->params.upper_speed;
+            bool actual = speed_ok && decision_combined_angle(&bench->angle) >= bench->params.threshold_angle;
+            bool predicted = speed_ok && decision_combined_angle(&bench->predicted) >= bench->params.threshold_angle;
+
+            if(predicted && !bench->predicted_on)
+            {
+                bench->alarms++;
+                bench->predicted_on = true;
+                bench->run_confirmed = false;
+                bench->predicted_since_ms = bench->imu_ms;
+            }
+
+            if(actual && !bench->actual_on)
+            {
+                bench->events++;
+                if(bench->predicted_on && bench->imu_ms > bench->predicted_since_ms)
+                {
+                    uint32_t lead = bench->imu_ms - bench->predicted_since_ms;
+                    bench->early++;
+                    bench->lead_ms += lead;
+                    if(lead > bench->max_lead_ms)
+                        bench->max_lead_ms = lead;
+                }
+            }
+
+            if(actual)
+                bench->run_confirmed = true;
+            if(!predicted)
+                replay_predict_end_run(bench, bench->imu_ms);
+            bench->actual_on = actual;
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @name replay_predict_run_triplog
+ *
+ * @brief runs the prediction benchmark over everything in the open trip log
+ *
+ * @param bench benchmark set up by replay_predict_begin(), filled with the outcome
+ *
+ * @return err variable that lets you know if the whole log was read or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t replay_predict_run_triplog(replay_predict_t *bench)
+{
+    esp_err_t err;
+    triplog_iter_t iter;
+    triplog_record_t record;
+
+    if((err = triplog_iter_begin(&iter)) != ESP_OK)
+    {
+        ESP_LOGD(REPLAY_TAG, "replay_predict_run_triplog(): triplog_iter_begin returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    while((err = triplog_iter_next(&iter, &record)) == ESP_OK)
+        replay_predict_feed(bench, &record);
+
+    if(err != ESP_ERR_NOT_FOUND)
+    {
+        ESP_LOGD(REPLAY_TAG, "replay_predict_run_triplog(): triplog_iter_next returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    replay_predict_end_run(bench, bench->imu_ms);
+
+    ESP_LOGI(REPLAY_TAG, "Horizon %.0f ms: %lu/%lu events early by %.0f ms on average, %lu of %lu alarms false",
+        bench->predict.horizon_ms, (unsigned long)bench->early, (unsigned long)bench->events,
+        bench->early ? (double)bench->lead_ms / bench->early : 0.0, (unsigned long)bench->false_alarms, (unsigned long)bench->alarms);
+
+    return ESP_OK;
+}
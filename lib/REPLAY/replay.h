@@ -0,0 +1,112 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+#include "triplog.h"
+#include "decision.h"
+#include "geofence.h"
+#include "heading.h"
+
+static const char* REPLAY_TAG = "Replay";
+
+#define REPLAY_TICK_QUEUE_SIZE (8) //LED alarms waiting to be moved from the timer ISR into the trip log
+#define REPLAY_DAY_US (86400000000LL) //GPS records only carry the time of day
+
+/**
+ * @brief the inputs to each logged decision rebuilt from the records before it: the IMU sample, the track turn, grade and
+ * prediction the decision record carries, and the limits of the geofence zone the device was in. Replay, analysis and the
+ * sweep all go through this so they judge the angle the device judged.
+*/
+typedef struct {
+    bool has_imu; //IMU sample waiting for the decision record that follows it
+    bno055_vec3_t angle;
+    decision_params_t base_params; //limits outside every zone, a zone's limits replace these while the device is in it
+    decision_axes_params_t base_axes_params;
+    decision_params_t params; //limits the next decision was made with
+    decision_axes_params_t axes_params; //used for decisions the device made with the per axis limits
+    uint16_t zone_id; //geofence zone whose limits params and axes_params hold, GEOFENCE_NO_ZONE for the base ones
+} replay_inputs_t;
+
+/**
+ * @brief one logged decision with what went into it
+*/
+typedef struct {
+    bno055_vec3_t judged; //angle the device decided on
+    float speed;
+    bool axes; //made by decision_axes_step() with axes_params, otherwise by is_out_of_level_r() with params
+    bool logged; //what the device decided
+} replay_decision_t;
+
+/**
+ * @brief state of a replay, fed one trip log record at a time
+*/
+typedef struct {
+    bool in_session; //a boot record has been seen, the decision state is known from here on
+    replay_inputs_t inputs;
+    decision_state_t decision_state;
+    decision_axes_state_t axes_state;
+    led_blink_state_t blink_state;
+    bool blink_known; //false after the device dropped alarms, until a flashing alarm shows where the toggle is
+    bool has_timebase; //a timebase record has been seen, record times can be turned into GPS time
+    int64_t timebase_local_us;
+    int64_t timebase_gps_us;
+    int32_t timebase_rate_ppb;
+
+    uint32_t records;
+    uint32_t sessions;
+    uint32_t skipped; //records before the first boot record, their state can't be known
+    uint32_t decisions_checked;
+    uint32_t decision_mismatches;
+    uint32_t lights_checked;
+    uint32_t light_mismatches;
+    uint32_t ticks_checked;
+    uint32_t tick_mismatches;
+    uint32_t ticks_dropped; //capture ran out of queue space, reported by the device in the tick record flags
+} replay_t;
+
+/**
+ * @brief how a set of prediction limits does over a recorded drive. Both sides are judged on the threshold alone without the
+ * state machine's latch, so every time the tilt crosses is an event of its own.
+*/
+typedef struct {
+    predict_params_t predict;
+    decision_params_t params;
+    predict_state_t predict_state;
+    bool has_imu;
+    uint32_t imu_ms;
+    bno055_vec3_t angle;
+    bno055_vec3_t predicted;
+    bool actual_on; //measured angle is over the threshold
+    bool predicted_on; //predicted angle is over the threshold
+    bool run_confirmed; //measured angle got over the threshold during this predicted run
+    uint32_t predicted_since_ms;
+
+    uint32_t samples;
+    uint32_t events; //times the measured angle crossed the threshold
+    uint32_t early; //events the prediction was already on for
+    uint64_t lead_ms; //total time the prediction came on ahead of the events
+    uint32_t max_lead_ms;
+    uint32_t alarms; //times the prediction came on
+    uint32_t false_alarms; //prediction came on and went off again without the angle getting to the threshold
+    uint64_t false_alarm_ms; //time spent on for nothing
+} replay_predict_t;
+
+     void replay_capture_enable(bool);
+     void replay_capture_tick(bool, int, int, bool);
+esp_err_t replay_capture_drain(void);
+
+     void replay_inputs_begin(replay_inputs_t *, const decision_params_t *, const decision_axes_params_t *);
+     bool replay_inputs_feed(replay_inputs_t *, const triplog_record_t *, replay_decision_t *);
+
+     void replay_begin(replay_t *);
+     void replay_feed(replay_t *, const triplog_record_t *);
+esp_err_t replay_run_triplog(replay_t *);
+esp_err_t replay_gps_time(const replay_t *, const triplog_record_t *, int64_t *);
+
+     void replay_predict_begin(replay_predict_t *, const predict_params_t *);
+     void replay_predict_feed(replay_predict_t *, const triplog_record_t *);
+esp_err_t replay_predict_run_triplog(replay_predict_t *);
+
+#endif //REPLAY_H
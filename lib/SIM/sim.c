@@ -0,0 +1,278 @@
+#include <string.h>
+#include <math.h>
+#include "sim.h"
+#include "esp_log.h"
+#include "led.h"
+#include "trace.h"
+
+#include "parameters.h"
+
+//lower number runs first when events land on the same microsecond, the alarm is an ISR so it gets in ahead of the tasks
+typedef enum {
+    SIM_EVENT_ALARM = 0,
+    SIM_EVENT_GPS = 1,
+    SIM_EVENT_LOOP = 2,
+    SIM_EVENT_LIGHT = 3,
+    SIM_EVENT_COUNT = 4,
+} sim_event_t;
+
+/**
+ * @name sim_default_config
+ *
+ * @brief fills in the timing the firmware actually runs with
+ *
+ * @param config config to fill in
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void sim_default_config(sim_config_t *config)
+{
+    memset(config, 0, sizeof(sim_config_t));
+    decision_default_params(&config->params);
+    config->loop_delay_ms = loop_delay_ms;
+    config->loop_work_us = 0;
+    config->light_read_us = 50;
+    config->tick_hz = 100; //CONFIG_FREERTOS_HZ
+    config->alarm_period_us = (uint32_t)(ALARM_TIME * 1000000.0 / LED_TIMER_RESOLUTION_HZ); //ALARM_TIME counts timer ticks, not milliseconds
+    config->gps_period_ms = 1000;
+    config->gps_burst_bytes = 500; //GGA, GSA, 3 GSV, RMC and VTG
+    config->gps_baud = 9600;
+    config->led_feedback_mv = 400;
+}
+
+/**
+ * @name sim_init
+ *
+ * @brief sets up a simulation starting at virtual time 0 with the LED off and the state machines as they are at boot
+ *
+ * @param sim simulation to set up
+ * @param config timing and limits to simulate
+ * @param world_fn drive being simulated
+ * @param world_ctx handed to world_fn
+ *
+ * @return err variable that lets you know if the config is usable or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t sim_init(sim_t *sim, const sim_config_t *config, sim_world_fn_t world_fn, void *world_ctx)
+{
+    if(world_fn == NULL || config->tick_hz == 0 || config->alarm_period_us == 0 || config->gps_period_ms == 0 || config->gps_baud == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    memset(sim, 0, sizeof(sim_t));
+    sim->config = *config;
+    sim->world_fn = world_fn;
+    sim->world_ctx = world_ctx;
+
+    sim->next_us[SIM_EVENT_LOOP] = 0;
+    sim->next_us[SIM_EVENT_ALARM] = config->alarm_period_us;
+    sim->next_us[SIM_EVENT_GPS] = (int64_t)config->gps_burst_bytes * 10 * 1000000 / config->gps_baud; //8N1, 10 bits a byte
+    sim->next_us[SIM_EVENT_LIGHT] = INT64_MAX;
+
+    return ESP_OK;
+}
+
+/**
+ * @brief scores the LED against the true state of the world, called before every event
+*/
+static void sim_check_tilt(sim_t *sim, const sim_world_t *world)
+{
+    const decision_params_t *params = &sim->config.params;
+    float combined_angle = sqrt(world->angle.x*world->angle.x + world->angle.y*world->angle.y);
+    bool tilt = combined_angle >= params->threshold_angle && world->speed >= params->lower_speed && world->speed <= params->upper_speed;
+
+    if(tilt && !sim->tilt)
+    {
+        sim->stats.tilt_events++;
+        if(sim->is_led_on)
+            sim->stats.tilt_detected++;
+        else
+        {
+            sim->tilt_pending = true;
+            sim->tilt_since_us = sim->now_us;
+        }
+    }
+    else if(!tilt && sim->tilt_pending)
+    {
+        sim->stats.tilt_missed++;
+        sim->tilt_pending = false;
+    }
+
+    sim->tilt = tilt;
+}
+
+/**
+ * @brief bottom half of the main loop: IMU read, decision and vTaskDelay()
+*/
+static void sim_loop_finish(sim_t *sim, const sim_world_t *world)
+{
+    bno055_vec3_t angle;
+    float current_speed = sim->speed;
+    int64_t tick_us = 1000000 / sim->config.tick_hz;
+    int64_t delay_ticks = (int64_t)sim->config.loop_delay_ms * sim->config.tick_hz / 1000;
+
+    //the BNO055 hands out euler angles in 1/16 degree steps
+    angle.x = round(world->angle.x * 16.0) / 16.0;
+    angle.y = round(world->angle.y * 16.0) / 16.0;
+    angle.z = round(world->angle.z * 16.0) / 16.0;
+
+    sim->led_on = is_out_of_level_r(&sim->decision_state, &sim->config.params, &angle, current_speed);
+    sim->stats.loops++;
+    trace_record(TRACE_MAIN_LOOP, TRACE_PHASE_END, sim->now_us + sim->config.loop_work_us, 0, SIM_TRACK_MAIN, sim->led_on);
+
+    //vTaskDelay() counts from the tick the task blocks on and wakes on a tick interrupt
+    sim->next_us[SIM_EVENT_LOOP] = ((sim->now_us + sim->config.loop_work_us) / tick_us + delay_ticks) * tick_us;
+}
+
+static void sim_event_loop(sim_t *sim, const sim_world_t *world)
+{
+    trace_record(TRACE_MAIN_LOOP, TRACE_PHASE_BEGIN, sim->now_us, 0, SIM_TRACK_MAIN, 0);
+
+    if(sim->is_led_on == false) //same check as main, the ADC sample lands light_read_us later
+    {
+        trace_record(TRACE_LIGHT_READ, TRACE_PHASE_BEGIN, sim->now_us, 0, SIM_TRACK_MAIN, 0);
+        sim->next_us[SIM_EVENT_LOOP] = INT64_MAX;
+        sim->next_us[SIM_EVENT_LIGHT] = sim->now_us + sim->config.light_read_us;
+        return;
+    }
+
+    sim_loop_finish(sim, world);
+}
+
+static void sim_event_light(sim_t *sim, const sim_world_t *world)
+{
+    int light_mv = world->ambient_mv;
+    int64_t gap_ms = (sim->now_us - sim->last_light_us) / 1000;
+
+    //the alarm can light the LED between the check in main and the ADC sample
+    if(sim->is_led_on)
+    {
+        light_mv += sim->config.led_feedback_mv * sim->duty / 1023;
+        sim->stats.feedback_reads++;
+    }
+
+    sim->led_on_val = raw_ADC_to_LED_val(light_mv);
+    trace_record(TRACE_LIGHT_READ, TRACE_PHASE_END, sim->now_us, 0, SIM_TRACK_MAIN, light_mv);
+    sim->stats.light_reads++;
+    if(gap_ms > sim->stats.max_light_gap_ms)
+        sim->stats.max_light_gap_ms = gap_ms;
+    sim->last_light_us = sim->now_us;
+
+    sim->next_us[SIM_EVENT_LIGHT] = INT64_MAX;
+    sim_loop_finish(sim, world);
+}
+
+static void sim_event_alarm(sim_t *sim)
+{
+    bool was_lit = sim->is_led_on;
+
+    sim->duty = led_blink_step(&sim->blink_state, sim->led_on, sim->led_on_val, &sim->is_led_on);
+    sim->stats.alarms++;
+    trace_record(TRACE_LED_ALARM, TRACE_PHASE_INSTANT, sim->now_us, 0, TRACE_TRACK_ISR, sim->duty);
+
+    if(sim->is_led_on && !was_lit)
+        sim->lit_since_us = sim->now_us;
+    if(!sim->is_led_on && was_lit)
+        sim->stats.led_lit_ms += (sim->now_us - sim->lit_since_us) / 1000;
+
+    if(sim->is_led_on && sim->tilt_pending)
+    {
+        uint32_t latency_ms = (sim->now_us - sim->tilt_since_us) / 1000;
+        sim->stats.tilt_detected++;
+        sim->stats.detect_latency_ms += latency_ms;
+        if(latency_ms > sim->stats.max_detect_latency_ms)
+            sim->stats.max_detect_latency_ms = latency_ms;
+        sim->tilt_pending = false;
+    }
+
+    sim->next_us[SIM_EVENT_ALARM] += sim->config.alarm_period_us; //auto reload
+}
+
+static void sim_event_gps(sim_t *sim)
+{
+    sim_world_t fix;
+    int64_t burst_us = (int64_t)sim->config.gps_burst_bytes * 10 * 1000000 / sim->config.gps_baud;
+
+    //the speed is the one from when the fix was taken, the NMEA task only hands it over once the whole burst is in
+    sim->world_fn(sim->world_ctx, sim->now_us - burst_us, &fix);
+    sim->speed = fix.speed;
+    sim->stats.gps_updates++;
+    trace_record(TRACE_NMEA_READ, TRACE_PHASE_BEGIN, sim->now_us - burst_us, 0, SIM_TRACK_NMEA, sim->config.gps_burst_bytes);
+    trace_record(TRACE_NMEA_READ, TRACE_PHASE_END, sim->now_us, 0, SIM_TRACK_NMEA, sim->config.gps_burst_bytes);
+
+    sim->next_us[SIM_EVENT_GPS] += (int64_t)sim->config.gps_period_ms * 1000;
+}
+
+/**
+ * @name sim_run
+ *
+ * @brief runs the firmware for an amount of virtual time. Events are handled in time order as fast as the host can go,
+ * the same config and drive always give the same result. Can be called again to carry on from where it stopped.
+ *
+ * @param sim simulation set up by sim_init()
+ * @param duration_ms virtual time to run for
+ *
+ * @return err variable that lets you know if the simulation ran or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t sim_run(sim_t *sim, uint32_t duration_ms)
+{
+    int64_t end_us = sim->now_us + (int64_t)duration_ms * 1000;
+    sim_world_t world;
+
+    if(sim->world_fn == NULL)
+        return ESP_ERR_INVALID_STATE;
+
+    while(true)
+    {
+        int next = 0;
+        for(int i = 1; i < SIM_EVENT_COUNT; i++)
+        {
+            if(sim->next_us[i] < sim->next_us[next])
+                next = i;
+        }
+
+        if(sim->next_us[next] > end_us)
+            break;
+
+        sim->now_us = sim->next_us[next];
+        sim->world_fn(sim->world_ctx, sim->now_us, &world);
+        sim_check_tilt(sim, &world);
+
+        switch(next)
+        {
+            case SIM_EVENT_ALARM:
+                sim_event_alarm(sim);
+                break;
+            case SIM_EVENT_GPS:
+                sim_event_gps(sim);
+                break;
+            case SIM_EVENT_LOOP:
+                sim_event_loop(sim, &world);
+                break;
+            case SIM_EVENT_LIGHT:
+                sim_event_light(sim, &world);
+                break;
+        }
+
+        sim->stats.events++;
+    }
+
+    //count the LED time up to the end of the run without ending the lit stretch
+    if(sim->is_led_on)
+    {
+        sim->stats.led_lit_ms += (end_us - sim->lit_since_us) / 1000;
+        sim->lit_since_us = end_us;
+    }
+    sim->now_us = end_us;
+
+    ESP_LOGI(SIM_TAG, "%lu loops, %lu alarms, %lu light reads (%lu with the LED lit), %lu/%lu tilts caught",
+        (unsigned long)sim->stats.loops, (unsigned long)sim->stats.alarms, (unsigned long)sim->stats.light_reads,
+        (unsigned long)sim->stats.feedback_reads, (unsigned long)sim->stats.tilt_detected, (unsigned long)sim->stats.tilt_events);
+
+    return ESP_OK;
+}
@@ -0,0 +1,91 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+#include "bno055.h"
+#include "decision.h"
+
+static const char* SIM_TAG = "Sim";
+
+//tracks the simulated tasks show up on in a trace export, the alarm goes on the ISR track like it does on the device
+#define SIM_TRACK_MAIN (1)
+#define SIM_TRACK_NMEA (2)
+
+/**
+ * @brief what the world looks like to the sensors at one instant
+*/
+typedef struct {
+    bno055_vec3_t angle; //true orientation in degrees
+    float speed; //true speed in the units the NMEA handler reports
+    int ambient_mv; //photoresistor voltage with the LED off
+} sim_world_t;
+
+/**
+ * @brief fills in the world at a virtual time, this is the drive being simulated
+*/
+typedef void (*sim_world_fn_t)(void *ctx, int64_t time_us, sim_world_t *world);
+
+typedef struct {
+    decision_params_t params;
+    uint32_t loop_delay_ms; //vTaskDelay() at the bottom of the main loop
+    uint32_t loop_work_us; //time the rest of the loop body takes
+    uint32_t light_read_us; //time from the is_led_on check to the ADC sample
+    uint32_t tick_hz; //FreeRTOS tick, vTaskDelay() wakes on tick boundaries
+    uint32_t alarm_period_us; //LED timer alarm period
+    uint32_t gps_period_ms; //time between fixes
+    uint32_t gps_burst_bytes; //NMEA bytes sent per fix, the speed is only seen once the burst has been parsed
+    uint32_t gps_baud;
+    int led_feedback_mv; //extra photoresistor voltage with the LED lit at full duty
+} sim_config_t;
+
+typedef struct {
+    uint64_t events;
+    uint32_t loops;
+    uint32_t alarms;
+    uint32_t gps_updates;
+    uint32_t light_reads;
+    uint32_t feedback_reads; //light read while the LED was lit
+    uint32_t max_light_gap_ms; //longest time the brightness went without an update
+    uint32_t tilt_events; //times the true angle and speed went out of level
+    uint32_t tilt_detected; //tilt events the LED came on for
+    uint32_t tilt_missed; //tilt events that ended before the LED came on
+    uint64_t detect_latency_ms; //total time from a tilt event to the LED lighting up
+    uint32_t max_detect_latency_ms;
+    uint64_t led_lit_ms;
+} sim_stats_t;
+
+/**
+ * @brief the firmware reduced to its inputs, outputs and timing. Main loop, NMEA task and LED alarm are events on one virtual
+ * clock and call the same decision code the device runs.
+*/
+typedef struct {
+    sim_config_t config;
+    sim_world_fn_t world_fn;
+    void *world_ctx;
+    int64_t now_us;
+    int64_t next_us[4]; //next time of each sim event, INT64_MAX when not scheduled
+    //app_main
+    float speed; //written by the NMEA "task"
+    bool led_on;
+    bool is_led_on;
+    int led_on_val;
+    int duty;
+    decision_state_t decision_state;
+    //LED alarm
+    led_blink_state_t blink_state;
+    int64_t lit_since_us;
+    //scoring
+    bool tilt;
+    bool tilt_pending;
+    int64_t tilt_since_us;
+    int64_t last_light_us;
+    sim_stats_t stats;
+} sim_t;
+
+     void sim_default_config(sim_config_t *);
+esp_err_t sim_init(sim_t *, const sim_config_t *, sim_world_fn_t, void *);
+esp_err_t sim_run(sim_t *, uint32_t);
+
+#endif //SIM_H
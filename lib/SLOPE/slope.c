@@ -0,0 +1,214 @@
+#include <string.h>
+#include <math.h>
+#include "slope.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "freertos/FreeRTOS.h"
+
+#define SLOPE_RAD_TO_DEG (57.29577951f)
+
+typedef struct {
+    bool initialized;
+    portMUX_TYPE lock; //fixes come in on the NMEA task, samples on the main loop
+    uint32_t budget_cycles;
+    slope_fix_t fixes[SLOPE_BASELINE + 1]; //ring, the baseline runs from the oldest to the newest
+    uint32_t fix_head;
+    uint32_t fix_count;
+    bool has_prev;
+    uint32_t prev_ms;
+    slope_estimate_t estimate;
+} slope_state_t;
+
+static slope_state_t x_slope = { .lock = portMUX_INITIALIZER_UNLOCKED };
+
+//scalar Kalman update of the grade, the lock has to be held
+static void slope_measure(float grade, float variance)
+{
+    float k = x_slope.estimate.variance / (x_slope.estimate.variance + variance);
+
+    x_slope.estimate.grade += k * (grade - x_slope.estimate.grade);
+    x_slope.estimate.variance *= 1.0f - k;
+}
+
+static void slope_account(esp_cpu_cycle_count_t start)
+{
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+
+    x_slope.estimate.calls++;
+    x_slope.estimate.total_cycles += cycles;
+    if(cycles > x_slope.estimate.max_cycles)
+        x_slope.estimate.max_cycles = cycles;
+    if(x_slope.budget_cycles && cycles > x_slope.budget_cycles)
+        x_slope.estimate.over_budget++;
+    //the pitch only counts once GPS has measured the grade, nothing is taken off the pitch before that
+    x_slope.estimate.confident = x_slope.estimate.gps_updates > 0 && x_slope.estimate.variance < SLOPE_CONFIDENT_DEG * SLOPE_CONFIDENT_DEG;
+}
+
+/**
+ * @name slope_init
+ *
+ * @brief starts the grade estimator with no idea of the grade, nothing is taken off the pitch until GPS and driving have pinned it down
+ *
+ * @param budget_cycles CPU cycles a call may take, calls over it are counted. 0 for no budget.
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t slope_init(uint32_t budget_cycles)
+{
+    portENTER_CRITICAL(&x_slope.lock);
+    memset(&x_slope.estimate, 0, sizeof(slope_estimate_t));
+    x_slope.estimate.variance = SLOPE_INITIAL_VAR;
+    x_slope.budget_cycles = budget_cycles;
+    x_slope.fix_head = 0;
+    x_slope.fix_count = 0;
+    x_slope.has_prev = false;
+    x_slope.initialized = true;
+    portEXIT_CRITICAL(&x_slope.lock);
+
+    return ESP_OK;
+}
+
+/**
+ * @name slope_gps_fix
+ *
+ * @brief takes a fix from the NMEA parser. The climb over the last SLOPE_BASELINE fixes against the distance driven in them
+ * is a measure of the grade, noisier the shorter the distance. Does nothing before slope_init().
+ *
+ * @param gps fix as posted by the NMEA parser
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void slope_gps_fix(const gps_t *gps)
+{
+    if(!x_slope.initialized)
+        return;
+
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    slope_fix_t fix = {
+        .altitude = gps->altitude,
+        .speed = gps->speed,
+        .time_s = gps->tim.hour * 3600.0f + gps->tim.minute * 60.0f + gps->tim.second + gps->tim.thousand / 1000.0f,
+    };
+
+    portENTER_CRITICAL(&x_slope.lock);
+
+    //altitude needs a 3D fix, a gap in the fixes would make the baseline longer than it looks so start over
+    if(gps->fix == GPS_FIX_INVALID || gps->fix_mode != GPS_MODE_3D)
+    {
+        x_slope.fix_count = 0;
+        portEXIT_CRITICAL(&x_slope.lock);
+        return;
+    }
+
+    x_slope.fixes[x_slope.fix_head] = fix;
+    x_slope.fix_head = (x_slope.fix_head + 1) % (SLOPE_BASELINE + 1);
+    if(x_slope.fix_count < SLOPE_BASELINE + 1)
+        x_slope.fix_count++;
+
+    if(x_slope.fix_count == SLOPE_BASELINE + 1)
+    {
+        float distance = 0;
+        const slope_fix_t *oldest = &x_slope.fixes[x_slope.fix_head];
+        const slope_fix_t *prev = oldest;
+
+        for(int i = 1; i <= SLOPE_BASELINE; i++)
+        {
+            const slope_fix_t *cur = &x_slope.fixes[(x_slope.fix_head + i) % (SLOPE_BASELINE + 1)];
+            float dt = cur->time_s - prev->time_s;
+            if(dt < 0)
+                dt += 86400.0f; //midnight UTC
+            distance += 0.5f * (cur->speed + prev->speed) * dt;
+            prev = cur;
+        }
+
+        if(distance >= SLOPE_MIN_DISTANCE && fix.speed >= SLOPE_MIN_SPEED)
+        {
+            float grade = atan2f(fix.altitude - oldest->altitude, distance) * SLOPE_RAD_TO_DEG;
+            float sigma = 1.41421356f * SLOPE_ALT_SIGMA_M / distance * SLOPE_RAD_TO_DEG; //two altitudes go into the climb
+
+            slope_measure(grade, sigma * sigma);
+            x_slope.estimate.last_gps_grade = grade;
+            x_slope.estimate.gps_updates++;
+        }
+    }
+
+    slope_account(start);
+    portEXIT_CRITICAL(&x_slope.lock);
+}
+
+/**
+ * @name slope_update
+ *
+ * @brief moves the estimate on to a new pitch sample. The grade is let wander in proportion to the distance driven since the
+ * last sample. While driving, a pitch within SLOPE_PITCH_GATE_DEG of the last GPS grade is taken as a measure of the grade,
+ * so the estimate follows the road between fixes. A pitch further off is lean, a car held over at a steady lean would
+ * otherwise have the lean taken off as grade and never warn. Nothing goes in before GPS has measured a grade.
+ * Constant work and no trig, cheap enough to run on every IMU sample.
+ *
+ * @param pitch pitch in degrees, nose up positive, after the level reference
+ * @param speed ground speed in m/s
+ * @param time_ms time of the sample
+ * @param grade set to the grade to take off the pitch, 0 while the estimate isn't confident
+ *
+ * @return whether the estimate is confident
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+bool slope_update(float pitch, float speed, uint32_t time_ms, float *grade)
+{
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    bool confident;
+
+    *grade = 0;
+    if(!x_slope.initialized)
+        return false;
+
+    portENTER_CRITICAL(&x_slope.lock);
+
+    if(x_slope.has_prev && time_ms > x_slope.prev_ms)
+    {
+        float dt = (time_ms - x_slope.prev_ms) / 1000.0f;
+        float v = fabsf(speed);
+
+        x_slope.estimate.variance += SLOPE_GRADE_VAR_PER_M * v * dt;
+
+        if(v >= SLOPE_MIN_SPEED && x_slope.estimate.gps_updates > 0)
+        {
+            if(fabsf(pitch - x_slope.estimate.last_gps_grade) <= SLOPE_PITCH_GATE_DEG)
+            {
+                slope_measure(pitch, SLOPE_IMU_VAR / dt);
+                x_slope.estimate.imu_updates++;
+            }
+            else
+                x_slope.estimate.imu_gated++;
+        }
+    }
+    x_slope.has_prev = true;
+    x_slope.prev_ms = time_ms;
+
+    slope_account(start);
+    confident = x_slope.estimate.confident;
+    if(confident)
+        *grade = x_slope.estimate.grade;
+
+    portEXIT_CRITICAL(&x_slope.lock);
+
+    return confident;
+}
+
+esp_err_t slope_get(slope_estimate_t *estimate)
+{
+    if(!x_slope.initialized)
+        return ESP_ERR_INVALID_STATE;
+
+    portENTER_CRITICAL(&x_slope.lock);
+    *estimate = x_slope.estimate;
+    portEXIT_CRITICAL(&x_slope.lock);
+
+    return ESP_OK;
+}
@@ -0,0 +1,54 @@
+#ifndef SLOPE_H
+#define SLOPE_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+#include "nmea_parser.h"
+
+static const char* SLOPE_TAG = "Slope";
+
+#define SLOPE_BASELINE (5) //fixes the climb is measured over, one fix worth of altitude noise is metres
+#define SLOPE_MIN_SPEED (2.0f) //m/s, slower than this climb over distance says nothing and pitch is all lean
+#define SLOPE_MIN_DISTANCE (10.0f) //m driven over the baseline before the GPS grade is used
+#define SLOPE_ALT_SIGMA_M (1.5f) //altitude noise of one fix
+#define SLOPE_INITIAL_VAR (100.0f) //deg^2, nothing is known about the grade at boot
+#define SLOPE_GRADE_VAR_PER_M (0.05f) //deg^2 the road grade can change by per metre driven
+#define SLOPE_IMU_VAR (25.0f) //deg^2 * s, pitch as a measure of grade while driving, squat and dive under throttle and braking
+#define SLOPE_PITCH_GATE_DEG (1.0f) //pitch is only a measure of grade within this of the last GPS grade, further off it is lean
+#define SLOPE_CONFIDENT_DEG (1.5f) //grade is only taken off the pitch once its standard deviation is under this
+
+/**
+ * @brief one GPS fix as the estimator keeps it
+*/
+typedef struct {
+    float altitude; //m
+    float speed; //m/s
+    float time_s; //UTC seconds of the day
+} slope_fix_t;
+
+/**
+ * @brief road grade under the car, nose up positive like the pitch. The IMU pitch is grade plus lean and can't tell the two
+ * apart, so GPS measures the grade and the pitch only fills in between fixes while it agrees with what GPS last measured.
+ * A steady lean keeps the pitch off the GPS grade and never gets into the estimate.
+*/
+typedef struct {
+    float grade; //deg
+    float variance; //deg^2
+    bool confident; //GPS has measured the grade and the variance is under SLOPE_CONFIDENT_DEG squared
+    float last_gps_grade; //grade the last GPS baseline measured
+    uint32_t gps_updates;
+    uint32_t imu_updates; //pitch samples taken as a measure of grade
+    uint32_t imu_gated; //pitch samples left out for being too far off the GPS grade
+    uint32_t max_cycles; //slowest call into the estimator
+    uint64_t total_cycles;
+    uint32_t calls;
+    uint32_t over_budget; //calls that took more than the cycle budget
+} slope_estimate_t;
+
+esp_err_t slope_init(uint32_t);
+     void slope_gps_fix(const gps_t *);
+     bool slope_update(float, float, uint32_t, float *);
+esp_err_t slope_get(slope_estimate_t *);
+
+#endif //SLOPE_H
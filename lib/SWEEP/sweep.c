@@ -0,0 +1,351 @@
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "sweep.h"
+#include "esp_log.h"
+
+/**
+ * @name sweep_init
+ *
+ * @brief allocates a sweep for a number of parameter sets, the sets start out as the limits in parameters.h
+ *
+ * @param sweep sweep to set up
+ * @param count number of parameter sets
+ *
+ * @return err variable that lets you know if the sweep was allocated or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t sweep_init(sweep_t *sweep, uint32_t count)
+{
+    decision_params_t params;
+
+    memset(sweep, 0, sizeof(sweep_t));
+    replay_inputs_begin(&sweep->inputs, NULL, NULL);
+
+    if(count == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    sweep->count = count;
+    sweep->threshold_angle = malloc(count * sizeof(float));
+    sweep->lower_speed = malloc(count * sizeof(float));
+    sweep->upper_speed = malloc(count * sizeof(float));
+    sweep->on = malloc(count * sizeof(uint8_t));
+    sweep->false_positives = malloc(count * sizeof(uint32_t));
+    sweep->false_negatives = malloc(count * sizeof(uint32_t));
+    sweep->pending_since_ms = malloc(count * sizeof(uint32_t));
+    sweep->pending = malloc(count * sizeof(uint8_t));
+    sweep->latency_ms = malloc(count * sizeof(uint64_t));
+    sweep->detected = malloc(count * sizeof(uint32_t));
+    sweep->missed = malloc(count * sizeof(uint32_t));
+
+    if(sweep->threshold_angle == NULL || sweep->lower_speed == NULL || sweep->upper_speed == NULL || sweep->on == NULL ||
+        sweep->false_positives == NULL || sweep->false_negatives == NULL || sweep->pending_since_ms == NULL || sweep->pending == NULL ||
+        sweep->latency_ms == NULL || sweep->detected == NULL || sweep->missed == NULL)
+    {
+        ESP_LOGD(SWEEP_TAG, "sweep_init(): couldn't allocate %lu parameter sets", (unsigned long)count);
+        sweep_deinit(sweep);
+        return ESP_ERR_NO_MEM;
+    }
+
+    decision_default_params(&params);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        sweep->threshold_angle[i] = params.threshold_angle;
+        sweep->lower_speed[i] = params.lower_speed;
+        sweep->upper_speed[i] = params.upper_speed;
+    }
+
+    memset(sweep->false_positives, 0, count * sizeof(uint32_t));
+    memset(sweep->false_negatives, 0, count * sizeof(uint32_t));
+    memset(sweep->latency_ms, 0, count * sizeof(uint64_t));
+    memset(sweep->detected, 0, count * sizeof(uint32_t));
+    memset(sweep->missed, 0, count * sizeof(uint32_t));
+    memset(sweep->pending, 0, count * sizeof(uint8_t));
+    sweep_reset_state(sweep);
+
+    return ESP_OK;
+}
+
+/**
+ * @name sweep_init_grid
+ *
+ * @brief allocates a sweep covering every combination of a grid of limits
+ *
+ * @param sweep sweep to set up
+ * @param first limits of the first grid point
+ * @param step how much each limit grows per grid step
+ * @param angle_steps number of threshold angles
+ * @param lower_steps number of lower speeds
+ * @param upper_steps number of upper speeds
+ *
+ * @return err variable that lets you know if the sweep was allocated or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t sweep_init_grid(sweep_t *sweep, const decision_params_t *first, const decision_params_t *step, uint16_t angle_steps, uint16_t lower_steps, uint16_t upper_steps)
+{
+    esp_err_t err;
+    uint32_t i = 0;
+
+    if((err = sweep_init(sweep, (uint32_t)angle_steps * lower_steps * upper_steps)) != ESP_OK)
+    {
+        ESP_LOGD(SWEEP_TAG, "sweep_init_grid(): sweep_init returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    for(uint16_t a = 0; a < angle_steps; a++)
+    {
+        for(uint16_t l = 0; l < lower_steps; l++)
+        {
+            for(uint16_t u = 0; u < upper_steps; u++)
+            {
+                sweep->threshold_angle[i] = first->threshold_angle + a * step->threshold_angle;
+                sweep->lower_speed[i] = first->lower_speed + l * step->lower_speed;
+                sweep->upper_speed[i] = first->upper_speed + u * step->upper_speed;
+                i++;
+            }
+        }
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @name sweep_deinit
+ *
+ * @brief frees everything sweep_init() allocated
+ *
+ * @param sweep sweep to free
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void sweep_deinit(sweep_t *sweep)
+{
+    free(sweep->threshold_angle);
+    free(sweep->lower_speed);
+    free(sweep->upper_speed);
+    free(sweep->on);
+    free(sweep->false_positives);
+    free(sweep->false_negatives);
+    free(sweep->pending_since_ms);
+    free(sweep->pending);
+    free(sweep->latency_ms);
+    free(sweep->detected);
+    free(sweep->missed);
+    memset(sweep, 0, sizeof(sweep_t));
+}
+
+/**
+ * @name sweep_set
+ *
+ * @brief sets the limits of one parameter set
+ *
+ * @param sweep sweep holding the set
+ * @param index set to change
+ * @param params limits to use
+ *
+ * @return err variable that lets you know if the set exists or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t sweep_set(sweep_t *sweep, uint32_t index, const decision_params_t *params)
+{
+    if(index >= sweep->count)
+        return ESP_ERR_INVALID_ARG;
+
+    sweep->threshold_angle[index] = params->threshold_angle;
+    sweep->lower_speed[index] = params->lower_speed;
+    sweep->upper_speed[index] = params->upper_speed;
+
+    return ESP_OK;
+}
+
+/**
+ * @name sweep_reset_state
+ *
+ * @brief puts every state machine back to where it is at boot, counters are kept so several traces can be added up
+ *
+ * @param sweep sweep to reset
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void sweep_reset_state(sweep_t *sweep)
+{
+    //an event still pending when the trace ends was never caught
+    for(uint32_t i = 0; i < sweep->count; i++)
+        sweep->missed[i] += sweep->pending[i];
+
+    memset(sweep->on, 0, sweep->count * sizeof(uint8_t));
+    memset(sweep->pending, 0, sweep->count * sizeof(uint8_t));
+    memset(sweep->pending_since_ms, 0, sweep->count * sizeof(uint32_t));
+    sweep->reference = false;
+    sweep->inputs.has_imu = false;
+}
+
+/**
+ * @name sweep_feed
+ *
+ * @brief judges one sample with every parameter set and scores each set against the reference.
+ * The state machine is the one in is_out_of_level_r() written without branches, so the loop over the sets vectorizes;
+ * the combined angle is worked out once per sample instead of once per set.
+ *
+ * @param sweep sweep to feed
+ * @param angle current angle data
+ * @param speed current speed
+ * @param timestamp_ms time of the sample, used for latency
+ * @param reference whether the sample really is out of level, e.g. a hand label or what the device decided
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void sweep_feed(sweep_t *sweep, const bno055_vec3_t *angle, float speed, uint32_t timestamp_ms, bool reference)
+{
+    float x = angle->x, y = angle->y;
+    float combined_angle = sqrt((double)x*x + (double)y*y); //same as is_out_of_level_r() so sets match the device bit for bit
+    uint8_t ref = reference, rising = reference && !sweep->reference;
+    uint32_t count = sweep->count;
+
+    const float *restrict threshold = sweep->threshold_angle;
+    const float *restrict lower = sweep->lower_speed;
+    const float *restrict upper = sweep->upper_speed;
+    uint8_t *restrict on = sweep->on;
+    uint8_t *restrict pending = sweep->pending;
+    uint32_t *restrict pending_since = sweep->pending_since_ms;
+    uint32_t *restrict false_positives = sweep->false_positives;
+    uint32_t *restrict false_negatives = sweep->false_negatives;
+    uint32_t *restrict detected = sweep->detected;
+    uint32_t *restrict missed = sweep->missed;
+    uint64_t *restrict latency = sweep->latency_ms;
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        uint8_t enter = (combined_angle >= threshold[i]) & (speed >= lower[i]) & (speed <= upper[i]);
+        uint8_t leave = (combined_angle < threshold[i]) & (speed < lower[i]) & (speed > upper[i]);
+        uint8_t now = (on[i] & (leave ^ 1)) | ((on[i] ^ 1) & enter);
+        uint8_t start = rising & (now ^ 1); //reference came on ahead of the set
+        uint8_t caught = pending[i] & now;
+
+        false_positives[i] += now & (ref ^ 1);
+        false_negatives[i] += (now ^ 1) & ref;
+
+        //the set came on with or before the reference: caught with no delay
+        detected[i] += (rising & now) + caught;
+        latency[i] += caught ? (uint64_t)(timestamp_ms - pending_since[i]) : 0;
+        missed[i] += pending[i] & (now ^ 1) & (ref ^ 1);
+
+        pending_since[i] = start ? timestamp_ms : pending_since[i];
+        pending[i] = start | (pending[i] & (now ^ 1) & ref);
+        on[i] = now;
+    }
+
+    sweep->samples++;
+    sweep->reference_samples += ref;
+    sweep->events += rising;
+    sweep->reference = reference;
+}
+
+/**
+ * @name sweep_feed_record
+ *
+ * @brief feeds trip log records, each IMU and decision pair is one sample scored against what the device decided.
+ * The sample is the angle the device judged, rebuilt the way replay_feed() does it. Decisions made inside a geofence zone
+ * are left out, the zone's limits replaced the ones being swept so they say nothing about them.
+ *
+ * @param sweep sweep to feed
+ * @param record next record in log order
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void sweep_feed_record(sweep_t *sweep, const triplog_record_t *record)
+{
+    replay_decision_t decision;
+
+    if(record->type == TRIPLOG_RECORD_BOOT)
+        sweep_reset_state(sweep);
+
+    if(!replay_inputs_feed(&sweep->inputs, record, &decision))
+        return;
+
+    if(sweep->inputs.zone_id != GEOFENCE_NO_ZONE)
+        sweep->zone_decisions++;
+    else
+        sweep_feed(sweep, &decision.judged, decision.speed, record->timestamp_ms, decision.logged);
+}
+
+/**
+ * @name sweep_get_result
+ *
+ * @brief works out the rates and latency of one parameter set
+ *
+ * @param sweep sweep that has been fed
+ * @param index set to look at
+ * @param result filled with the outcome
+ *
+ * @return err variable that lets you know if the set exists or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t sweep_get_result(const sweep_t *sweep, uint32_t index, sweep_result_t *result)
+{
+    uint32_t negatives = sweep->samples - sweep->reference_samples;
+
+    if(index >= sweep->count)
+        return ESP_ERR_INVALID_ARG;
+
+    result->params.threshold_angle = sweep->threshold_angle[index];
+    result->params.lower_speed = sweep->lower_speed[index];
+    result->params.upper_speed = sweep->upper_speed[index];
+    result->false_positive_rate = negatives ? (float)sweep->false_positives[index] / negatives : 0;
+    result->false_negative_rate = sweep->reference_samples ? (float)sweep->false_negatives[index] / sweep->reference_samples : 0;
+    result->mean_latency_ms = sweep->detected[index] ? (float)sweep->latency_ms[index] / sweep->detected[index] : 0;
+    result->detected = sweep->detected[index];
+    result->missed = sweep->missed[index] + sweep->pending[index];
+
+    return ESP_OK;
+}
+
+/**
+ * @name sweep_best
+ *
+ * @brief picks the set that misses the least while staying under a false positive rate, ties go to the lower latency
+ *
+ * @param sweep sweep that has been fed
+ * @param max_false_positive_rate highest false positive rate allowed, 0 - 1
+ * @param index set to the best set
+ *
+ * @return err variable, ESP_ERR_NOT_FOUND if no set stays under the limit
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t sweep_best(const sweep_t *sweep, float max_false_positive_rate, uint32_t *index)
+{
+    sweep_result_t result, best;
+    bool found = false;
+
+    for(uint32_t i = 0; i < sweep->count; i++)
+    {
+        sweep_get_result(sweep, i, &result);
+
+        if(result.false_positive_rate > max_false_positive_rate)
+            continue;
+
+        if(!found || result.false_negative_rate < best.false_negative_rate ||
+            (result.false_negative_rate == best.false_negative_rate && result.mean_latency_ms < best.mean_latency_ms))
+        {
+            best = result;
+            *index = i;
+            found = true;
+        }
+    }
+
+    return found ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
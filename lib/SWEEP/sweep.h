@@ -0,0 +1,58 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+#include "bno055.h"
+#include "triplog.h"
+#include "decision.h"
+#include "replay.h"
+
+static const char* SWEEP_TAG = "Sweep";
+
+/**
+ * @brief many sets of out of level limits judged side by side over the same samples. Everything is kept as one array per field
+ * so a sample is run against every set in one tight loop the compiler can vectorize.
+*/
+typedef struct {
+    uint32_t count; //parameter sets
+    float *threshold_angle;
+    float *lower_speed;
+    float *upper_speed;
+    uint8_t *on; //state machine of each set, 1 while it is reporting out of level
+    uint32_t *false_positives; //samples the set was on while the reference was off
+    uint32_t *false_negatives; //samples the set was off while the reference was on
+    uint32_t *pending_since_ms; //time the reference came on, the set hasn't caught up yet
+    uint8_t *pending;
+    uint64_t *latency_ms; //total time from the reference coming on to the set coming on
+    uint32_t *detected; //reference events the set caught
+    uint32_t *missed; //reference events that ended before the set came on
+    uint32_t samples;
+    uint32_t reference_samples; //samples where the reference was on
+    uint32_t events; //times the reference came on
+    bool reference; //reference value of the last sample
+    replay_inputs_t inputs; //used by sweep_feed_record() to rebuild the angle each decision was made on
+    uint32_t zone_decisions; //decisions sweep_feed_record() left out because a geofence zone's limits made them
+} sweep_t;
+
+typedef struct {
+    decision_params_t params;
+    float false_positive_rate; //false positives over samples where the reference was off
+    float false_negative_rate; //false negatives over samples where the reference was on
+    float mean_latency_ms; //average over the events the set caught
+    uint32_t detected;
+    uint32_t missed;
+} sweep_result_t;
+
+esp_err_t sweep_init(sweep_t *, uint32_t);
+esp_err_t sweep_init_grid(sweep_t *, const decision_params_t *, const decision_params_t *, uint16_t, uint16_t, uint16_t);
+     void sweep_deinit(sweep_t *);
+esp_err_t sweep_set(sweep_t *, uint32_t, const decision_params_t *);
+     void sweep_reset_state(sweep_t *);
+     void sweep_feed(sweep_t *, const bno055_vec3_t *, float, uint32_t, bool);
+     void sweep_feed_record(sweep_t *, const triplog_record_t *);
+esp_err_t sweep_get_result(const sweep_t *, uint32_t, sweep_result_t *);
+esp_err_t sweep_best(const sweep_t *, float, uint32_t *);
+
+#endif //SWEEP_H
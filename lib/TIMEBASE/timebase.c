@@ -0,0 +1,295 @@
+#include <string.h>
+#include "timebase.h"
+#include "triplog.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+    bool initialized;
+    portMUX_TYPE lock; //PPS edges come in on the ISR, fixes on the NMEA task, conversions from anywhere
+    gpio_num_t pps_gpio;
+    int64_t pps_local_us; //esp_timer time of the last PPS edge
+    uint32_t pps_edges;
+    timebase_source_t rate_source; //kind of edge the rate is being measured from
+    int64_t rate_local_us; //esp_timer time of the edge the rate measurement started on
+    int64_t rate_gps_us; //GPS time of that edge, as reported and not slewed
+    double fit_n, fit_x, fit_y, fit_xx, fit_xy; //NMEA edges since then, x is seconds on, y is GPS less local microseconds
+    timebase_status_t status;
+} timebase_state_t;
+
+static timebase_state_t x_timebase = { .lock = portMUX_INITIALIZER_UNLOCKED };
+
+static void IRAM_ATTR timebase_pps_isr(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL_ISR(&x_timebase.lock);
+    x_timebase.pps_local_us = now;
+    x_timebase.pps_edges++;
+    portEXIT_CRITICAL_ISR(&x_timebase.lock);
+}
+
+//adds an edge to the NMEA rate fit, both spans from the edge the fit started on
+static void timebase_fit_add(int64_t local_span, int64_t gps_span)
+{
+    double x = local_span * 1e-6, y = (double)(gps_span - local_span);
+
+    x_timebase.fit_n++;
+    x_timebase.fit_x += x;
+    x_timebase.fit_y += y;
+    x_timebase.fit_xx += x * x;
+    x_timebase.fit_xy += x * y;
+}
+
+//days from 2000-01-01 to a date, year is 0 - 99 as the RMC sentence has it
+static int64_t timebase_days(const gps_date_t *date)
+{
+    if(date->day == 0 || date->month == 0)
+        return 0; //no RMC yet, time of day only
+
+    int y = 2000 + date->year - (date->month <= 2);
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (date->month + (date->month > 2 ? -3 : 9)) + 2) / 5 + date->day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return (int64_t)era * 146097 + doe - 730425; //730425 days from 0000-03-01 to 2000-01-01
+}
+
+//the lock has to be held
+static int64_t timebase_convert(int64_t local_us)
+{
+    return x_timebase.status.anchor_gps_us + (int64_t)((local_us - x_timebase.status.anchor_local_us) * x_timebase.status.rate);
+}
+
+/**
+ * @name timebase_init
+ *
+ * @brief sets up the timebase. Fixes from the NMEA handler discipline it once it is running, against the PPS pulse if there is
+ * one and against when the fix sentences come in otherwise.
+ *
+ * @param pps_gpio GPIO the receiver's PPS output is wired to, GPIO_NUM_NC without one
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t timebase_init(gpio_num_t pps_gpio)
+{
+    esp_err_t err;
+
+    if(x_timebase.initialized)
+        return ESP_ERR_INVALID_STATE;
+
+    memset(&x_timebase.status, 0, sizeof(timebase_status_t));
+    x_timebase.status.rate = 1.0;
+    x_timebase.pps_gpio = pps_gpio;
+
+    if(pps_gpio != GPIO_NUM_NC)
+    {
+        gpio_config_t io_conf = {
+            .pin_bit_mask = 1ULL << pps_gpio,
+            .mode = GPIO_MODE_INPUT,
+            .pull_up_en = GPIO_PULLUP_DISABLE,
+            .pull_down_en = GPIO_PULLDOWN_ENABLE, //held low while the receiver has no fix and the output floats
+            .intr_type = GPIO_INTR_POSEDGE,
+        };
+
+        if((err = gpio_config(&io_conf)) != ESP_OK)
+        {
+            ESP_LOGD(TIMEBASE_TAG, "timebase_init(): gpio_config returned %s", esp_err_to_name(err));
+            return err;
+        }
+
+        //someone else may have installed the service already, that's fine
+        if((err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM)) != ESP_OK && err != ESP_ERR_INVALID_STATE)
+        {
+            ESP_LOGD(TIMEBASE_TAG, "timebase_init(): gpio_install_isr_service returned %s", esp_err_to_name(err));
+            return err;
+        }
+
+        if((err = gpio_isr_handler_add(pps_gpio, timebase_pps_isr, NULL)) != ESP_OK)
+        {
+            ESP_LOGD(TIMEBASE_TAG, "timebase_init(): gpio_isr_handler_add returned %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    x_timebase.initialized = true;
+
+    return ESP_OK;
+}
+
+/**
+ * @name timebase_gps_fix
+ *
+ * @brief disciplines the timebase with a fix. The PPS edge that came before the fix marks the start of the second the fix
+ * is for, exact to the ISR latency. Without one the fix's arrival less TIMEBASE_NMEA_LATENCY_US stands in for the edge and
+ * its jitter is averaged out. Every update is logged so trip log times can be turned into GPS time afterwards.
+ *
+ * @param gps fix as posted by the NMEA parser
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void timebase_gps_fix(const gps_t *gps)
+{
+    int64_t arrival = esp_timer_get_time();
+
+    if(!x_timebase.initialized || gps->fix == GPS_FIX_INVALID)
+        return;
+
+    int64_t epoch_us = (timebase_days(&gps->date) * 86400LL + gps->tim.hour * 3600LL + gps->tim.minute * 60LL + gps->tim.second) * 1000000LL +
+                       gps->tim.thousand * 1000LL;
+    timebase_status_t *status = &x_timebase.status;
+    timebase_source_t source;
+    int64_t edge_local, edge_gps;
+
+    portENTER_CRITICAL(&x_timebase.lock);
+
+    if(x_timebase.pps_edges != status->pps_edges && arrival - x_timebase.pps_local_us < TIMEBASE_PPS_WINDOW_US)
+    {
+        source = TIMEBASE_SOURCE_PPS;
+        edge_local = x_timebase.pps_local_us;
+        edge_gps = epoch_us - gps->tim.thousand * 1000LL; //the pulse is on the whole second
+    }
+    else
+    {
+        source = TIMEBASE_SOURCE_NMEA;
+        edge_local = arrival - TIMEBASE_NMEA_LATENCY_US;
+        edge_gps = epoch_us;
+    }
+    status->pps_edges = x_timebase.pps_edges;
+
+    bool restart_rate = true;
+
+    if(status->source != TIMEBASE_SOURCE_NONE)
+    {
+        int64_t error = edge_gps - timebase_convert(edge_local);
+        int64_t local_span = edge_local - status->anchor_local_us;
+        status->last_error_us = error > INT32_MAX ? INT32_MAX : (error < INT32_MIN ? INT32_MIN : error);
+
+        if(error > TIMEBASE_STEP_US || error < -TIMEBASE_STEP_US || local_span <= 0)
+        {
+            status->steps++;
+        }
+        else
+        {
+            //edges of the same kind are a measure of the crystal against GPS. A PPS edge is exact, so the span from the last
+            //one is enough. Sentence edges jitter by milliseconds, so a line is fitted through all of them from
+            //TIMEBASE_NMEA_RATE_SPAN_US on, and started over every TIMEBASE_NMEA_RATE_MAX_SPAN_US to follow the crystal warming up.
+            int64_t rate_span = edge_local - x_timebase.rate_local_us;
+            double measured = 0;
+
+            restart_rate = source != x_timebase.rate_source;
+            if(!restart_rate && source == TIMEBASE_SOURCE_PPS)
+            {
+                measured = (double)(edge_gps - x_timebase.rate_gps_us) / rate_span;
+                restart_rate = true;
+            }
+            else if(!restart_rate)
+            {
+                timebase_fit_add(rate_span, edge_gps - x_timebase.rate_gps_us);
+                if(rate_span >= TIMEBASE_NMEA_RATE_SPAN_US)
+                {
+                    double det = x_timebase.fit_n * x_timebase.fit_xx - x_timebase.fit_x * x_timebase.fit_x;
+
+                    measured = 1.0 + (x_timebase.fit_n * x_timebase.fit_xy - x_timebase.fit_x * x_timebase.fit_y) / det * 1e-6;
+                    restart_rate = rate_span >= TIMEBASE_NMEA_RATE_MAX_SPAN_US;
+                }
+            }
+
+            if(measured > 1.0 - TIMEBASE_MAX_RATE_PPM * 1e-6 && measured < 1.0 + TIMEBASE_MAX_RATE_PPM * 1e-6)
+                status->rate = source == TIMEBASE_SOURCE_PPS ? status->rate + TIMEBASE_PPS_GAIN * (measured - status->rate) : measured;
+
+            //sentence arrival jitters by milliseconds, only a share of the error is taken out each fix
+            if(source == TIMEBASE_SOURCE_NMEA)
+                edge_gps = timebase_convert(edge_local) + (int64_t)(error * TIMEBASE_NMEA_OFFSET_GAIN);
+        }
+    }
+
+    if(restart_rate)
+    {
+        x_timebase.rate_source = source;
+        x_timebase.rate_local_us = edge_local;
+        x_timebase.rate_gps_us = epoch_us - (source == TIMEBASE_SOURCE_PPS ? gps->tim.thousand * 1000LL : 0);
+        x_timebase.fit_n = x_timebase.fit_x = x_timebase.fit_y = x_timebase.fit_xx = x_timebase.fit_xy = 0;
+        timebase_fit_add(0, 0);
+    }
+
+    status->source = source;
+    status->anchor_local_us = edge_local;
+    status->anchor_gps_us = edge_gps;
+    status->updates++;
+
+    triplog_record_t record;
+    memset(&record, 0, sizeof(record));
+    record.timestamp_ms = (uint32_t)(arrival / 1000);
+    record.type = TRIPLOG_RECORD_TIMEBASE;
+    record.flags = source;
+    record.payload.timebase.local_us = edge_local;
+    record.payload.timebase.gps_us = edge_gps;
+    record.payload.timebase.rate_ppb = (int32_t)((status->rate - 1.0) * 1e9);
+
+    portEXIT_CRITICAL(&x_timebase.lock);
+
+    triplog_append(&record);
+}
+
+/**
+ * @name timebase_to_gps
+ *
+ * @brief turns an esp_timer time into GPS time
+ *
+ * @param local_us esp_timer_get_time() when the sample was taken
+ * @param gps_us set to the GPS time of the sample
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_STATE before the first fix, ESP_ERR_TIMEOUT if the last fix is older than TIMEBASE_HOLDOVER_US
+ * (gps_us is still set)
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t timebase_to_gps(int64_t local_us, int64_t *gps_us)
+{
+    esp_err_t err = ESP_OK;
+
+    portENTER_CRITICAL(&x_timebase.lock);
+    if(x_timebase.status.source == TIMEBASE_SOURCE_NONE)
+        err = ESP_ERR_INVALID_STATE;
+    else
+    {
+        *gps_us = timebase_convert(local_us);
+        if(local_us - x_timebase.status.anchor_local_us > TIMEBASE_HOLDOVER_US)
+            err = ESP_ERR_TIMEOUT;
+    }
+    portEXIT_CRITICAL(&x_timebase.lock);
+
+    return err;
+}
+
+esp_err_t timebase_now(int64_t *gps_us)
+{
+    return timebase_to_gps(esp_timer_get_time(), gps_us);
+}
+
+//GPS time of a sample for the trip log, 0 until the timebase has a fix
+int64_t timebase_stamp(int64_t local_us)
+{
+    int64_t gps_us = 0;
+    esp_err_t err = timebase_to_gps(local_us, &gps_us);
+
+    return err == ESP_OK || err == ESP_ERR_TIMEOUT ? gps_us : 0;
+}
+
+esp_err_t timebase_get_status(timebase_status_t *status)
+{
+    portENTER_CRITICAL(&x_timebase.lock);
+    *status = x_timebase.status;
+    portEXIT_CRITICAL(&x_timebase.lock);
+
+    return ESP_OK;
+}
@@ -0,0 +1,50 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+#include "nmea_parser.h"
+
+static const char* TIMEBASE_TAG = "Timebase";
+
+#define TIMEBASE_NMEA_LATENCY_US (70000) //fix sentence end to the second it belongs to, depends on the receiver's output rate and baud
+#define TIMEBASE_PPS_WINDOW_US (1100000) //a PPS edge further back than this from a fix isn't the one the fix belongs to
+#define TIMEBASE_PPS_GAIN (0.1) //weight of a new PPS rate measurement
+#define TIMEBASE_NMEA_RATE_SPAN_US (100000000) //shortest span the NMEA rate is fitted over, sentence timing jitters by milliseconds
+#define TIMEBASE_NMEA_RATE_MAX_SPAN_US (600000000) //longest, so the rate still follows the crystal warming up
+#define TIMEBASE_NMEA_OFFSET_GAIN (0.1) //share of an NMEA offset error taken out per fix
+#define TIMEBASE_STEP_US (500000) //offset errors over this are stepped out instead of slewed
+#define TIMEBASE_MAX_RATE_PPM (200) //crystal plus temperature, anything further off is a bad measurement
+#define TIMEBASE_HOLDOVER_US (60000000) //time since the last update the conversion is still trusted for
+
+typedef enum {
+    TIMEBASE_SOURCE_NONE = 0,
+    TIMEBASE_SOURCE_NMEA, //epoch edges taken from when the fix sentence came in
+    TIMEBASE_SOURCE_PPS, //receiver's pulse per second on a GPIO
+} timebase_source_t;
+
+/**
+ * @brief how esp_timer time maps onto GPS time. GPS time here is microseconds since 2000-01-01 00:00:00 UTC as the receiver
+ * reports it, leap seconds included.
+*/
+typedef struct {
+    timebase_source_t source;
+    int64_t anchor_local_us; //esp_timer time of the last epoch edge
+    int64_t anchor_gps_us; //GPS time of that edge
+    double rate; //GPS microseconds per esp_timer microsecond
+    uint32_t updates;
+    uint32_t pps_edges;
+    uint32_t steps; //times the offset was too far out to slew
+    int32_t last_error_us; //how far the conversion was off at the last edge, before correcting it
+} timebase_status_t;
+
+esp_err_t timebase_init(gpio_num_t);
+     void timebase_gps_fix(const gps_t *);
+esp_err_t timebase_to_gps(int64_t, int64_t *);
+esp_err_t timebase_now(int64_t *);
+esp_err_t timebase_get_status(timebase_status_t *);
+  int64_t timebase_stamp(int64_t);
+
+#endif //TIMEBASE_H
@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/**
+ * @brief one ring per core. Only code running on that core writes to it and a slot is claimed with one atomic add,
+ * so a task and an ISR that interrupts it never need a lock and never get the same slot.
+*/
+typedef struct {
+    uint32_t head; //events ever written, slot is head % TRACE_RING_SIZE
+    trace_event_t events[TRACE_RING_SIZE];
+} trace_ring_t;
+
+typedef struct {
+    bool enabled;
+    trace_ring_t rings[TRACE_CORES];
+} trace_t;
+
+static trace_t x_trace;
+
+static const char* x_trace_names[TRACE_POINT_COUNT][2] = { //name and category shown in the trace viewer
+    [TRACE_MAIN_LOOP] = {"main_loop", "main"},
+    [TRACE_LIGHT_READ] = {"light_read", "main"},
+    [TRACE_LED_ALARM] = {"led_alarm", "isr"},
+    [TRACE_I2C_READ] = {"i2c_read", "i2c"},
+    [TRACE_I2C_WRITE] = {"i2c_write", "i2c"},
+    [TRACE_NMEA_READ] = {"uart_read", "nmea"},
+    [TRACE_NMEA_DECODE] = {"gps_decode", "nmea"},
+    [TRACE_NMEA_EVENT] = {"event_loop", "nmea"},
+    [TRACE_TRIPLOG_FLUSH] = {"triplog_flush", "triplog"},
+};
+
+/**
+ * @name trace_enable
+ *
+ * @brief starts or stops recording. Stop before exporting so nothing is written to the rings while they are read.
+ *
+ * @param enable true to record
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void trace_enable(bool enable)
+{
+    __atomic_store_n(&x_trace.enabled, enable, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @name trace_record
+ *
+ * @brief puts an event in the ring of a core. Used by the trace points on the device and by the host simulation, which hands
+ * in its virtual time and tracks.
+ *
+ * @param point what is being traced
+ * @param phase begin, end or instant
+ * @param time_us time of the event
+ * @param core ring to put the event in
+ * @param track task or ISR the event belongs to
+ * @param arg extra value shown with the event
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void trace_record(trace_point_t point, trace_phase_t phase, uint32_t time_us, uint8_t core, uint32_t track, uint32_t arg)
+{
+    trace_ring_t *ring;
+    trace_event_t *event;
+
+    if(!x_trace.enabled || core >= TRACE_CORES)
+        return;
+
+    ring = &x_trace.rings[core];
+    event = &ring->events[__atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED) % TRACE_RING_SIZE];
+    event->time_us = time_us;
+    event->track = track;
+    event->arg = arg;
+    event->point = point;
+    event->phase = phase;
+    event->core = core;
+}
+
+static void trace_now(trace_point_t point, trace_phase_t phase, uint32_t arg)
+{
+    uint32_t track;
+
+    if(!x_trace.enabled)
+        return;
+
+    track = xPortInIsrContext() ? TRACE_TRACK_ISR : (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle();
+    trace_record(point, phase, (uint32_t)esp_timer_get_time(), xPortGetCoreID(), track, arg);
+}
+
+/**
+ * @name trace_begin
+ *
+ * @brief marks the start of a stage, safe to call from an ISR
+ *
+ * @param point what is being traced
+ * @param arg extra value shown with the event
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void trace_begin(trace_point_t point, uint32_t arg)
+{
+    trace_now(point, TRACE_PHASE_BEGIN, arg);
+}
+
+/**
+ * @name trace_end
+ *
+ * @brief marks the end of a stage started with trace_begin(), safe to call from an ISR
+ *
+ * @param point what is being traced
+ * @param arg extra value shown with the event
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void trace_end(trace_point_t point, uint32_t arg)
+{
+    trace_now(point, TRACE_PHASE_END, arg);
+}
+
+/**
+ * @name trace_instant
+ *
+ * @brief marks something that has no duration, safe to call from an ISR
+ *
+ * @param point what is being traced
+ * @param arg extra value shown with the event
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void trace_instant(trace_point_t point, uint32_t arg)
+{
+    trace_now(point, TRACE_PHASE_INSTANT, arg);
+}
+
+/**
+ * @name trace_clear
+ *
+ * @brief empties the rings, only call with recording stopped
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void trace_clear(void)
+{
+    for(int core = 0; core < TRACE_CORES; core++)
+        x_trace.rings[core].head = 0;
+}
+
+/**
+ * @name trace_get_stats
+ *
+ * @brief how many events have been recorded and how many the rings have dropped
+ *
+ * @param stats filled with the counts
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void trace_get_stats(trace_stats_t *stats)
+{
+    memset(stats, 0, sizeof(trace_stats_t));
+
+    for(int core = 0; core < TRACE_CORES; core++)
+    {
+        uint32_t head = __atomic_load_n(&x_trace.rings[core].head, __ATOMIC_RELAXED);
+        stats->recorded += head;
+        if(head > TRACE_RING_SIZE)
+            stats->overwritten += head - TRACE_RING_SIZE;
+    }
+}
+
+/**
+ * @name trace_export_chrome
+ *
+ * @brief writes what is in the rings out as Chrome trace event JSON, loads in chrome://tracing and ui.perfetto.dev.
+ * Each core shows up as a process and each task as a thread, ISRs share thread 0.
+ *
+ * @param write called with each piece of the JSON, e.g. to print it to the console or write it to a file
+ * @param ctx handed to write
+ *
+ * @return err variable from the first write that failed
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t trace_export_chrome(trace_write_fn_t write, void *ctx)
+{
+    esp_err_t err;
+    char line[192];
+    int len;
+    bool first = true;
+
+    if((err = write(ctx, "{\"traceEvents\":[\n", 17)) != ESP_OK)
+        return err;
+
+    for(int core = 0; core < TRACE_CORES; core++)
+    {
+        trace_ring_t *ring = &x_trace.rings[core];
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint32_t start = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+
+        len = snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"ISR\"}}",
+            first ? "" : ",\n", core, TRACE_TRACK_ISR);
+        if((err = write(ctx, line, len)) != ESP_OK)
+            return err;
+        first = false;
+
+        //oldest first
+        for(uint32_t i = start; i < head; i++)
+        {
+            const trace_event_t *event = &ring->events[i % TRACE_RING_SIZE];
+
+            if(event->point >= TRACE_POINT_COUNT)
+                continue;
+
+            len = snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",%s\"ts\":%lu,\"pid\":%u,\"tid\":%lu,\"args\":{\"arg\":%lu}}",
+                x_trace_names[event->point][0], x_trace_names[event->point][1], event->phase,
+                event->phase == TRACE_PHASE_INSTANT ? "\"s\":\"t\"," : "",
+                (unsigned long)event->time_us, event->core, (unsigned long)event->track, (unsigned long)event->arg);
+            if((err = write(ctx, line, len)) != ESP_OK)
+                return err;
+        }
+    }
+
+    return write(ctx, "\n]}\n", 4);
+}
+
+/**
+ * @name trace_write_console
+ *
+ * @brief trace_write_fn_t that prints to the console, save the JSON between the braces off the monitor to load it
+ *
+ * @param ctx unused
+ * @param data piece of the JSON
+ * @param len its length
+ *
+ * @return ESP_FAIL if the console didn't take all of it
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t trace_write_console(void *ctx, const char *data, size_t len)
+{
+    return fwrite(data, 1, len, stdout) == len ? ESP_OK : ESP_FAIL;
+}
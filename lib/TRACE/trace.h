@@ -0,0 +1,62 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+static const char* TRACE_TAG = "Trace";
+
+#define TRACE_CORES (2)
+#define TRACE_RING_SIZE (256) //events kept per core, oldest are overwritten, must be a power of 2
+#define TRACE_TRACK_ISR (0) //track ISR events are put on, task events go on a track per task
+
+typedef enum {
+    TRACE_MAIN_LOOP = 0,
+    TRACE_LIGHT_READ,
+    TRACE_LED_ALARM,
+    TRACE_I2C_READ,
+    TRACE_I2C_WRITE,
+    TRACE_NMEA_READ,
+    TRACE_NMEA_DECODE,
+    TRACE_NMEA_EVENT,
+    TRACE_TRIPLOG_FLUSH,
+    TRACE_POINT_COUNT,
+} trace_point_t;
+
+typedef enum {
+    TRACE_PHASE_BEGIN = 'B',
+    TRACE_PHASE_END = 'E',
+    TRACE_PHASE_INSTANT = 'i',
+} trace_phase_t;
+
+/**
+ * @brief one trace event as it sits in the ring, 16 bytes
+*/
+typedef struct {
+    uint32_t time_us; //esp_timer time, wraps after 71 minutes
+    uint32_t track; //task handle, TRACE_TRACK_ISR for ISRs
+    uint32_t arg; //whatever the trace point wants to show, register address, byte count...
+    uint8_t point; //trace_point_t
+    uint8_t phase; //trace_phase_t
+    uint8_t core;
+    uint8_t reserved;
+} trace_event_t;
+
+typedef struct {
+    uint64_t recorded;
+    uint64_t overwritten; //lost because the ring wrapped before an export
+} trace_stats_t;
+
+typedef esp_err_t (*trace_write_fn_t)(void *ctx, const char *data, size_t len);
+
+     void trace_enable(bool);
+     void trace_begin(trace_point_t, uint32_t);
+     void trace_end(trace_point_t, uint32_t);
+     void trace_instant(trace_point_t, uint32_t);
+     void trace_record(trace_point_t, trace_phase_t, uint32_t, uint8_t, uint32_t, uint32_t);
+     void trace_clear(void);
+     void trace_get_stats(trace_stats_t *);
+esp_err_t trace_export_chrome(trace_write_fn_t, void *);
+esp_err_t trace_write_console(void *, const char *, size_t);
+
+#endif //TRACE_H
@@ -0,0 +1,545 @@
+#include <string.h>
+#include <math.h>
+#include "tracecodec.h"
+#include "esp_log.h"
+
+#define TRACECODEC_KEYFRAME_FLAG (0x80)
+#define TRACECODEC_COUNT_MASK (0x3F)
+
+/**
+ * Frame layout
+ *
+ * | tag | length (16 bit LE) | keyframe only: first sample as varints | per channel: bit width, packed zig-zag deltas |
+ *
+ * tag bit 7 marks a keyframe, bits 0-5 hold the sample count - 1. The timestamp is channel 0 and is stored as the change
+ * in sample period (delta of delta) so a steady sample rate packs down to 0 bits. Every other channel is stored as the
+ * change from the previous sample. Each channel gets the smallest bit width that fits all its values in the frame.
+*/
+
+typedef struct {
+    uint8_t *out;
+    size_t size;
+    size_t pos;
+    uint64_t acc;
+    uint8_t bits;
+    bool overflow;
+} bit_writer_t;
+
+typedef struct {
+    const uint8_t *in;
+    size_t size;
+    size_t pos;
+    uint64_t acc;
+    uint8_t bits;
+    bool underflow;
+} bit_reader_t;
+
+static inline uint32_t zigzag_encode(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t zigzag_decode(uint32_t value)
+{
+    return (int32_t)((value >> 1) ^ (~(value & 1) + 1));
+}
+
+static inline int32_t wrapping_delta(int32_t current, int32_t previous)
+{
+    return (int32_t)((uint32_t)current - (uint32_t)previous);
+}
+
+static inline int32_t wrapping_add(int32_t previous, int32_t delta)
+{
+    return (int32_t)((uint32_t)previous + (uint32_t)delta);
+}
+
+static uint8_t bit_width(uint32_t value)
+{
+    uint8_t width = 0;
+    while(value)
+    {
+        width++;
+        value >>= 1;
+    }
+    return width;
+}
+
+static void writer_byte(bit_writer_t *w, uint8_t byte)
+{
+    if(w->pos >= w->size)
+    {
+        w->overflow = true;
+        return;
+    }
+    w->out[w->pos++] = byte;
+}
+
+static void writer_varint(bit_writer_t *w, uint32_t value)
+{
+    while(value >= 0x80)
+    {
+        writer_byte(w, (uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    writer_byte(w, (uint8_t)value);
+}
+
+static void writer_bits(bit_writer_t *w, uint32_t value, uint8_t width)
+{
+    if(width == 0)
+        return;
+
+    w->acc |= ((uint64_t)value) << w->bits;
+    w->bits += width;
+
+    while(w->bits >= 8)
+    {
+        writer_byte(w, (uint8_t)w->acc);
+        w->acc >>= 8;
+        w->bits -= 8;
+    }
+}
+
+//pads the packed bits out to a whole byte
+static void writer_align(bit_writer_t *w)
+{
+    if(w->bits)
+        writer_byte(w, (uint8_t)w->acc);
+    w->acc = 0;
+    w->bits = 0;
+}
+
+static uint8_t reader_byte(bit_reader_t *r)
+{
+    if(r->pos >= r->size)
+    {
+        r->underflow = true;
+        return 0;
+    }
+    return r->in[r->pos++];
+}
+
+static uint32_t reader_varint(bit_reader_t *r)
+{
+    uint32_t value = 0;
+    uint8_t byte;
+
+    for(uint8_t shift = 0; shift < 35; shift += 7)
+    {
+        byte = reader_byte(r);
+        value |= ((uint32_t)(byte & 0x7F)) << shift;
+        if(!(byte & 0x80))
+            return value;
+    }
+
+    r->underflow = true;
+    return 0;
+}
+
+static uint32_t reader_bits(bit_reader_t *r, uint8_t width)
+{
+    if(width == 0)
+        return 0;
+
+    while(r->bits < width)
+    {
+        r->acc |= ((uint64_t)reader_byte(r)) << r->bits;
+        r->bits += 8;
+    }
+
+    uint32_t value = (uint32_t)(r->acc & ((((uint64_t)1) << width) - 1));
+    r->acc >>= width;
+    r->bits -= width;
+
+    return value;
+}
+
+static void reader_align(bit_reader_t *r)
+{
+    r->acc = 0;
+    r->bits = 0;
+}
+
+/**
+ * @name tracecodec_encoder_init
+ *
+ * @brief sets up an encoder for a stream of samples with a fixed number of channels
+ *
+ * @param enc encoder to set up
+ * @param channels number of value channels per sample, TRACECODEC_IMU_CHANNELS or TRACECODEC_GPS_CHANNELS for the built in streams
+ * @param frames_per_keyframe how often a keyframe is written, 1 makes every frame a keyframe. Lower means faster seeking and a slightly bigger stream.
+ *
+ * @return err variable that lets you know if the encoder is ready or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t tracecodec_encoder_init(tracecodec_encoder_t *enc, uint8_t channels, uint8_t frames_per_keyframe)
+{
+    if(channels == 0 || channels > TRACECODEC_MAX_CHANNELS || frames_per_keyframe == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    memset(enc, 0, sizeof(tracecodec_encoder_t));
+    enc->channels = channels;
+    enc->frames_per_keyframe = frames_per_keyframe;
+
+    return ESP_OK;
+}
+
+/**
+ * @name tracecodec_encoder_flush
+ *
+ * @brief packs the samples waiting in the encoder into a frame, even if the frame isn't full
+ *
+ * @param enc encoder holding the samples
+ * @param out buffer the frame is written to, TRACECODEC_MAX_FRAME_SIZE always fits
+ * @param out_size size of out in bytes
+ * @param out_len set to the number of bytes written, 0 if there was nothing to flush
+ *
+ * @return err variable that lets you know if the frame fit in out or not. A frame that didn't fit is left in the encoder untouched.
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t tracecodec_encoder_flush(tracecodec_encoder_t *enc, uint8_t *out, size_t out_size, size_t *out_len)
+{
+    bit_writer_t w = { .out = out, .size = out_size };
+    bool keyframe = !enc->has_prev || (enc->frame_index % enc->frames_per_keyframe) == 0;
+    uint8_t first = 0;
+    uint32_t packed[TRACECODEC_FRAME_SAMPLES];
+
+    //delta state is only committed once the frame fits, a frame that doesn't can be flushed again into a bigger buffer
+    uint32_t prev_time = enc->prev_time, widest = 0;
+    int32_t prev_dt = enc->prev_dt;
+    int32_t prev[TRACECODEC_MAX_CHANNELS];
+    memcpy(prev, enc->prev, sizeof(prev));
+
+    *out_len = 0;
+
+    if(enc->count == 0)
+        return ESP_OK;
+
+    writer_byte(&w, (keyframe ? TRACECODEC_KEYFRAME_FLAG : 0) | ((enc->count - 1) & TRACECODEC_COUNT_MASK));
+    writer_byte(&w, 0); //length gets patched in once we know it
+    writer_byte(&w, 0);
+
+    //keyframe carries the first sample as is so decoding can start here
+    if(keyframe)
+    {
+        writer_varint(&w, enc->time[0]);
+        for(uint8_t c = 0; c < enc->channels; c++)
+            writer_varint(&w, zigzag_encode(enc->values[0][c]));
+
+        prev_time = enc->time[0];
+        prev_dt = 0;
+        memcpy(prev, enc->values[0], sizeof(prev));
+        first = 1;
+    }
+
+    //timestamp channel, delta of delta
+    for(uint8_t i = first; i < enc->count; i++)
+    {
+        int32_t dt = wrapping_delta((int32_t)enc->time[i], (int32_t)prev_time);
+        packed[i] = zigzag_encode(wrapping_delta(dt, prev_dt));
+        widest |= packed[i];
+        prev_dt = dt;
+        prev_time = enc->time[i];
+    }
+
+    if(first < enc->count)
+    {
+        uint8_t width = bit_width(widest);
+        writer_byte(&w, width);
+        for(uint8_t i = first; i < enc->count; i++)
+            writer_bits(&w, packed[i], width);
+        writer_align(&w);
+    }
+
+    //value channels, delta from the previous sample
+    for(uint8_t c = 0; c < enc->channels; c++)
+    {
+        widest = 0;
+
+        for(uint8_t i = first; i < enc->count; i++)
+        {
+            packed[i] = zigzag_encode(wrapping_delta(enc->values[i][c], prev[c]));
+            widest |= packed[i];
+            prev[c] = enc->values[i][c];
+        }
+
+        if(first < enc->count)
+        {
+            uint8_t width = bit_width(widest);
+            writer_byte(&w, width);
+            for(uint8_t i = first; i < enc->count; i++)
+                writer_bits(&w, packed[i], width);
+            writer_align(&w);
+        }
+    }
+
+    if(w.overflow)
+    {
+        ESP_LOGD(TRACECODEC_TAG, "tracecodec_encoder_flush(): frame does not fit in %u bytes", (unsigned)out_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    out[1] = (uint8_t)w.pos;
+    out[2] = (uint8_t)(w.pos >> 8);
+
+    enc->has_prev = true;
+    enc->prev_time = prev_time;
+    enc->prev_dt = prev_dt;
+    memcpy(enc->prev, prev, sizeof(prev));
+    enc->raw_bytes += (uint64_t)enc->count * sizeof(uint32_t) * (1 + enc->channels);
+    enc->encoded_bytes += w.pos;
+    enc->frame_index++;
+    enc->count = 0;
+    *out_len = w.pos;
+
+    return ESP_OK;
+}
+
+/**
+ * @name tracecodec_encode
+ *
+ * @brief adds a sample to the encoder. Once a frame worth of samples has built up the frame is written to out.
+ *
+ * @param enc encoder set up by tracecodec_encoder_init()
+ * @param time sample timestamp, any monotonic unit as long as the stream sticks to it
+ * @param values one value per channel
+ * @param out buffer the frame is written to, TRACECODEC_MAX_FRAME_SIZE always fits
+ * @param out_size size of out in bytes
+ * @param out_len set to the number of bytes written, 0 while the frame is still filling up
+ *
+ * @return err variable that lets you know if a full frame didn't fit in out. The frame stays in the encoder and is written
+ * ahead of the next sample, a sample that comes in while it still doesn't fit isn't taken.
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t tracecodec_encode(tracecodec_encoder_t *enc, uint32_t time, const int32_t *values, uint8_t *out, size_t out_size, size_t *out_len)
+{
+    esp_err_t err;
+
+    *out_len = 0;
+
+    //a full frame is still waiting because its flush failed, it goes out before there is room for the sample
+    if(enc->count >= TRACECODEC_FRAME_SAMPLES)
+    {
+        if((err = tracecodec_encoder_flush(enc, out, out_size, out_len)) != ESP_OK)
+        {
+            ESP_LOGD(TRACECODEC_TAG, "tracecodec_encode(): tracecodec_encoder_flush returned %s", esp_err_to_name(err));
+            return err;
+        }
+
+        enc->time[0] = time;
+        memcpy(enc->values[0], values, enc->channels * sizeof(int32_t));
+        enc->count = 1;
+        return ESP_OK;
+    }
+
+    enc->time[enc->count] = time;
+    memcpy(enc->values[enc->count], values, enc->channels * sizeof(int32_t));
+    enc->count++;
+
+    if(enc->count < TRACECODEC_FRAME_SAMPLES)
+        return ESP_OK;
+
+    return tracecodec_encoder_flush(enc, out, out_size, out_len);
+}
+
+/**
+ * @name tracecodec_decoder_init
+ *
+ * @brief sets up a decoder, it has to be given a keyframe before it can decode anything else
+ *
+ * @param dec decoder to set up
+ * @param channels number of value channels the stream was encoded with
+ *
+ * @return err variable that lets you know if the decoder is ready or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t tracecodec_decoder_init(tracecodec_decoder_t *dec, uint8_t channels)
+{
+    if(channels == 0 || channels > TRACECODEC_MAX_CHANNELS)
+        return ESP_ERR_INVALID_ARG;
+
+    memset(dec, 0, sizeof(tracecodec_decoder_t));
+    dec->channels = channels;
+
+    return ESP_OK;
+}
+
+/**
+ * @name tracecodec_decode_frame
+ *
+ * @brief decodes the frame at the start of in
+ *
+ * @param dec decoder holding the state left by the previous frame
+ * @param in encoded stream
+ * @param in_len bytes available in in
+ * @param consumed set to the size of the frame
+ * @param time filled with TRACECODEC_FRAME_SAMPLES timestamps at most
+ * @param values filled with TRACECODEC_FRAME_SAMPLES samples at most
+ * @param count set to the number of samples decoded
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if the stream doesn't start with a keyframe or TRACECODEC_ERR_CORRUPT
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t tracecodec_decode_frame(tracecodec_decoder_t *dec, const uint8_t *in, size_t in_len, size_t *consumed, uint32_t *time, int32_t (*values)[TRACECODEC_MAX_CHANNELS], uint8_t *count)
+{
+    *consumed = 0;
+    *count = 0;
+
+    if(in_len < TRACECODEC_FRAME_HEADER_SIZE)
+        return TRACECODEC_ERR_CORRUPT;
+
+    bool keyframe = in[0] & TRACECODEC_KEYFRAME_FLAG;
+    uint8_t n = (in[0] & TRACECODEC_COUNT_MASK) + 1;
+    size_t frame_len = in[1] | ((size_t)in[2] << 8);
+    uint8_t first = 0;
+
+    if(frame_len < TRACECODEC_FRAME_HEADER_SIZE || frame_len > in_len || n > TRACECODEC_FRAME_SAMPLES)
+        return TRACECODEC_ERR_CORRUPT;
+
+    if(!keyframe && !dec->has_prev)
+        return ESP_ERR_INVALID_STATE;
+
+    bit_reader_t r = { .in = in, .size = frame_len, .pos = TRACECODEC_FRAME_HEADER_SIZE };
+
+    if(keyframe)
+    {
+        dec->prev_time = reader_varint(&r);
+        dec->prev_dt = 0;
+        for(uint8_t c = 0; c < dec->channels; c++)
+            dec->prev[c] = zigzag_decode(reader_varint(&r));
+        dec->has_prev = true;
+
+        time[0] = dec->prev_time;
+        memcpy(values[0], dec->prev, sizeof(dec->prev));
+        first = 1;
+    }
+
+    if(first < n)
+    {
+        uint8_t width = reader_byte(&r);
+        if(width > 32)
+            return TRACECODEC_ERR_CORRUPT;
+
+        for(uint8_t i = first; i < n; i++)
+        {
+            dec->prev_dt = wrapping_add(dec->prev_dt, zigzag_decode(reader_bits(&r, width)));
+            dec->prev_time = (uint32_t)wrapping_add((int32_t)dec->prev_time, dec->prev_dt);
+            time[i] = dec->prev_time;
+        }
+        reader_align(&r);
+
+        for(uint8_t c = 0; c < dec->channels; c++)
+        {
+            width = reader_byte(&r);
+            if(width > 32)
+                return TRACECODEC_ERR_CORRUPT;
+
+            for(uint8_t i = first; i < n; i++)
+            {
+                dec->prev[c] = wrapping_add(dec->prev[c], zigzag_decode(reader_bits(&r, width)));
+                values[i][c] = dec->prev[c];
+            }
+            reader_align(&r);
+        }
+    }
+
+    if(r.underflow)
+        return TRACECODEC_ERR_CORRUPT;
+
+    *consumed = frame_len;
+    *count = n;
+
+    return ESP_OK;
+}
+
+/**
+ * @name tracecodec_seek
+ *
+ * @brief finds the last keyframe that starts at or before a timestamp. Only the frame headers are read, frames are skipped by their length.
+ *
+ * @param in encoded stream
+ * @param in_len size of the stream
+ * @param time timestamp to seek to
+ * @param offset set to the byte offset of the keyframe, hand in + offset to a fresh decoder
+ *
+ * @return ESP_OK or ESP_ERR_NOT_FOUND if no keyframe starts at or before time
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t tracecodec_seek(const uint8_t *in, size_t in_len, uint32_t time, size_t *offset)
+{
+    size_t pos = 0;
+    bool found = false;
+
+    while(pos + TRACECODEC_FRAME_HEADER_SIZE <= in_len)
+    {
+        size_t frame_len = in[pos + 1] | ((size_t)in[pos + 2] << 8);
+        if(frame_len < TRACECODEC_FRAME_HEADER_SIZE || pos + frame_len > in_len)
+            break;
+
+        if(in[pos] & TRACECODEC_KEYFRAME_FLAG)
+        {
+            bit_reader_t r = { .in = in + pos, .size = frame_len, .pos = TRACECODEC_FRAME_HEADER_SIZE };
+            uint32_t start = reader_varint(&r);
+
+            if(r.underflow || start > time)
+                break;
+
+            *offset = pos;
+            found = true;
+        }
+
+        pos += frame_len;
+    }
+
+    return found ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+/**
+ * @name tracecodec_imu_values
+ *
+ * @brief quantises euler angles back to the BNO055's 1/16 degree steps for the IMU stream
+ *
+ * @param euler angles from bno055_get_euler()
+ * @param values filled with TRACECODEC_IMU_CHANNELS values
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void tracecodec_imu_values(const bno055_vec3_t *euler, int32_t *values)
+{
+    values[0] = (int32_t)lround(euler->x * 16.0);
+    values[1] = (int32_t)lround(euler->y * 16.0);
+    values[2] = (int32_t)lround(euler->z * 16.0);
+}
+
+/**
+ * @name tracecodec_gps_values
+ *
+ * @brief converts a GPS fix to fixed point for the GPS stream
+ *
+ * @param gps fix posted by the NMEA parser
+ * @param values filled with TRACECODEC_GPS_CHANNELS values
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void tracecodec_gps_values(const gps_t *gps, int32_t *values)
+{
+    values[0] = (int32_t)lroundf(gps->latitude * 1e7f);
+    values[1] = (int32_t)lroundf(gps->longitude * 1e7f);
+    values[2] = (int32_t)lroundf(gps->altitude * 100.0f);
+    values[3] = (int32_t)lroundf(gps->speed * 100.0f);
+}
@@ -0,0 +1,56 @@
+#ifndef TRACECODEC_H
+#define TRACECODEC_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+#include "bno055.h"
+#include "nmea_parser.h"
+
+static const char* TRACECODEC_TAG = "Tracecodec";
+
+#define TRACECODEC_MAX_CHANNELS (6) //value channels per sample, the timestamp is always carried on top of these
+#define TRACECODEC_FRAME_SAMPLES (32) //samples packed together, the bit width of every channel is picked per frame
+#define TRACECODEC_FRAME_HEADER_SIZE (3) //tag byte and 16 bit frame length
+#define TRACECODEC_MAX_FRAME_SIZE (TRACECODEC_FRAME_HEADER_SIZE + 5 * (TRACECODEC_MAX_CHANNELS + 1) + (TRACECODEC_MAX_CHANNELS + 1) * (1 + 4 * TRACECODEC_FRAME_SAMPLES))
+
+#define TRACECODEC_IMU_CHANNELS (3) //euler x, y, z in 1/16 degree
+#define TRACECODEC_GPS_CHANNELS (4) //latitude and longitude in 1e-7 degree, altitude in cm, speed in cm/s
+
+#define TRACECODEC_ERR_CORRUPT (0x7200) //frame doesn't decode, wrong stream or truncated data
+
+typedef struct {
+    uint8_t channels;
+    uint8_t frames_per_keyframe; //a keyframe restarts the deltas so decoding can start there
+    uint8_t count; //samples waiting in the frame
+    uint32_t frame_index;
+    bool has_prev; //false until the first keyframe has been written
+    uint32_t prev_time;
+    int32_t prev_dt;
+    int32_t prev[TRACECODEC_MAX_CHANNELS];
+    uint32_t time[TRACECODEC_FRAME_SAMPLES];
+    int32_t values[TRACECODEC_FRAME_SAMPLES][TRACECODEC_MAX_CHANNELS];
+    uint64_t raw_bytes; //size the samples would have had as timestamp plus int32 per channel
+    uint64_t encoded_bytes;
+} tracecodec_encoder_t;
+
+typedef struct {
+    uint8_t channels;
+    bool has_prev; //false until a keyframe has been decoded
+    uint32_t prev_time;
+    int32_t prev_dt;
+    int32_t prev[TRACECODEC_MAX_CHANNELS];
+} tracecodec_decoder_t;
+
+esp_err_t tracecodec_encoder_init(tracecodec_encoder_t *, uint8_t, uint8_t);
+esp_err_t tracecodec_encode(tracecodec_encoder_t *, uint32_t, const int32_t *, uint8_t *, size_t, size_t *);
+esp_err_t tracecodec_encoder_flush(tracecodec_encoder_t *, uint8_t *, size_t, size_t *);
+
+esp_err_t tracecodec_decoder_init(tracecodec_decoder_t *, uint8_t);
+esp_err_t tracecodec_decode_frame(tracecodec_decoder_t *, const uint8_t *, size_t, size_t *, uint32_t *, int32_t (*)[TRACECODEC_MAX_CHANNELS], uint8_t *);
+esp_err_t tracecodec_seek(const uint8_t *, size_t, uint32_t, size_t *);
+
+     void tracecodec_imu_values(const bno055_vec3_t *, int32_t *);
+     void tracecodec_gps_values(const gps_t *, int32_t *);
+
+#endif //TRACECODEC_H
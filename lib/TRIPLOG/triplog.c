@@ -0,0 +1,1105 @@
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "triplog.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "trace.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define TRIPLOG_MAGIC (0x474F4C54) //"TLOG"
+#define TRIPLOG_VERSION (2) //2: GPS records carry the fix epoch, packed IMU frames a GPS time base
+#define TRIPLOG_ERASED (0xFF)
+
+_Static_assert(sizeof(triplog_record_t) == TRIPLOG_RECORD_SIZE, "triplog record must stay 32 bytes");
+_Static_assert(sizeof(triplog_sector_header_t) == TRIPLOG_RECORD_SIZE, "triplog sector header must fill one record slot");
+
+/**
+ * @brief runtime state of the log. There is only one log on the device so it lives here like the BNO055 device table.
+*/
+typedef struct {
+    bool is_open;
+    triplog_flash_t flash;
+    SemaphoreHandle_t lock; //records come from both app_main and the NMEA parser task
+    uint32_t sector_count;
+    uint32_t head; //byte offset of the next free slot in the partition
+    uint32_t head_sequence; //sequence number of the sector head sits in
+    uint32_t staged_base; //byte offset the first staged record will be written to
+    uint32_t staged_len; //bytes sitting in the staging buffer
+    uint16_t record_counter;
+    uint8_t staging[TRIPLOG_PAGE_SIZE]; //RAM copy of the page being filled, written out once the page is full
+    bool pack_imu; //IMU samples go through the codec instead of a record each
+    bool angle_pending; //IMU sample logged since the last decision, it goes into the next decision record
+    int16_t angle[2]; //x and y of that sample, 1/16 degree
+    uint16_t imu_frames;
+    tracecodec_encoder_t imu_codec;
+    uint32_t imu_frame_ms; //timestamp of the first sample in the frame being filled
+    int64_t imu_gps_base; //GPS time at imu_frame_ms, 0 until a sample in the frame has GPS time
+    uint8_t imu_frame[TRIPLOG_IMU_FRAME_BASE_SIZE + TRACECODEC_MAX_FRAME_SIZE]; //GPS time base then the tracecodec frame
+    triplog_stats_t stats;
+} triplog_t;
+
+static triplog_t x_triplog;
+
+static uint32_t triplog_crc(const void *data, size_t len)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)data, len);
+}
+
+static bool triplog_slot_is_erased(const uint8_t *slot)
+{
+    for(int i = 0; i < TRIPLOG_RECORD_SIZE; i++)
+    {
+        if(slot[i] != TRIPLOG_ERASED)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @name triplog_header_is_valid
+ *
+ * @brief checks if a sector header belongs to the log. Works on any copy of the header, e.g. a partition dump.
+ *
+ * @param header header as read from flash
+ * @param sequence filled with the sector sequence number if the header is valid
+ *
+ * @return bool true if the header is valid
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+bool triplog_header_is_valid(const triplog_sector_header_t *header, uint32_t *sequence)
+{
+    if(header->magic != TRIPLOG_MAGIC || header->version != TRIPLOG_VERSION || header->record_size != TRIPLOG_RECORD_SIZE)
+        return false;
+
+    if(header->crc != triplog_crc(header, offsetof(triplog_sector_header_t, crc)))
+        return false;
+
+    *sequence = header->sequence;
+    return true;
+}
+
+/**
+ * @name triplog_record_is_valid
+ *
+ * @brief checks the CRC of a record. Erased slots and records torn by a reset fail.
+ *
+ * @param record record as read from flash
+ *
+ * @return bool true if the record is intact
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+bool triplog_record_is_valid(const triplog_record_t *record)
+{
+    return record->type != TRIPLOG_ERASED && record->crc == triplog_crc(record, offsetof(triplog_record_t, crc));
+}
+
+/**
+ * @name triplog_read_header
+ *
+ * @brief reads the header of a sector and checks if it belongs to the log
+ *
+ * @param sector index of the sector in the partition
+ * @param sequence filled with the sector sequence number if the header is valid
+ *
+ * @return bool true if the sector holds a valid header
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+static bool triplog_read_header(uint32_t sector, uint32_t *sequence)
+{
+    triplog_sector_header_t header;
+
+    if(x_triplog.flash.read(x_triplog.flash.ctx, sector * TRIPLOG_SECTOR_SIZE, &header, sizeof(header)) != ESP_OK)
+        return false;
+
+    return triplog_header_is_valid(&header, sequence);
+}
+
+/**
+ * @name triplog_start_sector
+ *
+ * @brief erases a sector and stamps it with a header so it becomes the new head of the log. The oldest data in the log is lost here.
+ *
+ * @param sector index of the sector in the partition
+ * @param sequence sequence number to put in the header
+ *
+ * @return err variable that lets you know if the sector was prepared or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+static esp_err_t triplog_start_sector(uint32_t sector, uint32_t sequence)
+{
+    esp_err_t err;
+    triplog_sector_header_t header;
+
+    if((err = x_triplog.flash.erase(x_triplog.flash.ctx, sector * TRIPLOG_SECTOR_SIZE, TRIPLOG_SECTOR_SIZE)) != ESP_OK)
+    {
+        ESP_LOGD(TRIPLOG_TAG, "triplog_start_sector(): erase returned %s", esp_err_to_name(err));
+        return err;
+    }
+    x_triplog.stats.sector_erases++;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = TRIPLOG_MAGIC;
+    header.sequence = sequence;
+    header.version = TRIPLOG_VERSION;
+    header.record_size = TRIPLOG_RECORD_SIZE;
+    header.crc = triplog_crc(&header, offsetof(triplog_sector_header_t, crc));
+
+    if((err = x_triplog.flash.write(x_triplog.flash.ctx, sector * TRIPLOG_SECTOR_SIZE, &header, sizeof(header))) != ESP_OK)
+    {
+        ESP_LOGD(TRIPLOG_TAG, "triplog_start_sector(): header write returned %s", esp_err_to_name(err));
+        return err;
+    }
+    x_triplog.stats.flash_bytes_written += sizeof(header);
+
+    x_triplog.head = sector * TRIPLOG_SECTOR_SIZE + TRIPLOG_RECORD_SIZE;
+    x_triplog.head_sequence = sequence;
+    x_triplog.staged_base = x_triplog.head;
+    x_triplog.stats.head_sector = sector;
+    x_triplog.stats.head_sequence = sequence;
+
+    return ESP_OK;
+}
+
+/**
+ * @name triplog_recover
+ *
+ * @brief finds where the log left off before the last reset. The sector headers give us the newest sector and since records are only ever
+ * appended, the written slots in that sector are contiguous so a binary search finds the first free one in a handful of reads.
+ *
+ * @return err variable that lets you know if the head was found or a fresh log was started
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+static esp_err_t triplog_recover(void)
+{
+    esp_err_t err;
+    bool found = false;
+    uint32_t newest_sector = 0, newest_sequence = 0, sequence;
+    uint8_t slot[TRIPLOG_RECORD_SIZE];
+
+    for(uint32_t sector = 0; sector < x_triplog.sector_count; sector++)
+    {
+        if(triplog_read_header(sector, &sequence) && (!found || sequence > newest_sequence))
+        {
+            found = true;
+            newest_sector = sector;
+            newest_sequence = sequence;
+        }
+    }
+
+    //nothing on the partition yet, format the first sector
+    if(!found)
+    {
+        ESP_LOGI(TRIPLOG_TAG, "No log found, starting a new one");
+        return triplog_start_sector(0, 1);
+    }
+
+    //binary search for the first erased slot, slot 0 is the header
+    uint32_t low = 1, high = TRIPLOG_RECORDS_PER_SECTOR + 1;
+    while(low < high)
+    {
+        uint32_t mid = (low + high) / 2;
+
+        if((err = x_triplog.flash.read(x_triplog.flash.ctx, newest_sector * TRIPLOG_SECTOR_SIZE + mid * TRIPLOG_RECORD_SIZE, slot, sizeof(slot))) != ESP_OK)
+        {
+            ESP_LOGD(TRIPLOG_TAG, "triplog_recover(): read returned %s", esp_err_to_name(err));
+            return err;
+        }
+
+        if(triplog_slot_is_erased(slot))
+            high = mid;
+        else
+            low = mid + 1;
+    }
+
+    x_triplog.head = newest_sector * TRIPLOG_SECTOR_SIZE + low * TRIPLOG_RECORD_SIZE;
+    x_triplog.head_sequence = newest_sequence;
+    x_triplog.staged_base = x_triplog.head;
+    x_triplog.stats.head_sector = newest_sector;
+    x_triplog.stats.head_sequence = newest_sequence;
+
+    ESP_LOGI(TRIPLOG_TAG, "Log recovered at sector %lu slot %lu sequence %lu", (unsigned long)newest_sector, (unsigned long)low, (unsigned long)newest_sequence);
+
+    return ESP_OK;
+}
+
+/**
+ * @name triplog_flush_locked
+ *
+ * @brief writes whatever is in the staging buffer to flash. Staged records never cross a page so this is always a single program operation.
+ *
+ * @return err variable that lets you know if the staged records made it to flash or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+static esp_err_t triplog_flush_locked(void)
+{
+    esp_err_t err;
+
+    if(x_triplog.staged_len == 0)
+        return ESP_OK;
+
+    int64_t start = esp_timer_get_time();
+    uint32_t page_offset = x_triplog.staged_base % TRIPLOG_PAGE_SIZE;
+
+    trace_begin(TRACE_TRIPLOG_FLUSH, x_triplog.staged_len);
+    err = x_triplog.flash.write(x_triplog.flash.ctx, x_triplog.staged_base, x_triplog.staging + page_offset, x_triplog.staged_len);
+    trace_end(TRACE_TRIPLOG_FLUSH, err);
+    x_triplog.stats.flush_time_us += esp_timer_get_time() - start;
+
+    if(err != ESP_OK)
+    {
+        ESP_LOGD(TRIPLOG_TAG, "triplog_flush_locked(): write returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    x_triplog.stats.page_writes++;
+    x_triplog.stats.flash_bytes_written += x_triplog.staged_len;
+    x_triplog.staged_base += x_triplog.staged_len;
+    x_triplog.staged_len = 0;
+
+    return ESP_OK;
+}
+
+static void triplog_record_init(triplog_record_t *record, triplog_record_type_t type)
+{
+    memset(record, 0, sizeof(triplog_record_t));
+    record->timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    record->type = type;
+}
+
+//triplog_append() with the lock already held
+static esp_err_t triplog_append_locked(triplog_record_t *record)
+{
+    esp_err_t err = ESP_OK;
+
+    //head ran off the end of its sector, move to the next one (oldest in the ring)
+    if(x_triplog.head % TRIPLOG_SECTOR_SIZE == 0)
+    {
+        if((err = triplog_flush_locked()) != ESP_OK || (err = triplog_start_sector((x_triplog.head / TRIPLOG_SECTOR_SIZE) % x_triplog.sector_count, x_triplog.head_sequence + 1)) != ESP_OK)
+        {
+            x_triplog.stats.records_dropped++;
+            return err;
+        }
+    }
+
+    record->sequence = x_triplog.record_counter++;
+    record->crc = triplog_crc(record, offsetof(triplog_record_t, crc));
+
+    memcpy(x_triplog.staging + (x_triplog.head % TRIPLOG_PAGE_SIZE), record, TRIPLOG_RECORD_SIZE);
+    x_triplog.staged_len += TRIPLOG_RECORD_SIZE;
+    x_triplog.head += TRIPLOG_RECORD_SIZE;
+    x_triplog.stats.records_appended++;
+    x_triplog.stats.record_bytes += TRIPLOG_RECORD_SIZE;
+
+    //page is full, program it in one go
+    if(x_triplog.head % TRIPLOG_PAGE_SIZE == 0)
+    {
+        err = triplog_flush_locked();
+        memset(x_triplog.staging, TRIPLOG_ERASED, sizeof(x_triplog.staging));
+
+        if(err != ESP_OK) //the page is gone, don't try to write it again on top of whatever made it to flash
+        {
+            x_triplog.stats.records_dropped += x_triplog.staged_len / TRIPLOG_RECORD_SIZE;
+            x_triplog.staged_base = x_triplog.head;
+            x_triplog.staged_len = 0;
+        }
+    }
+
+    return err;
+}
+
+//puts the GPS time base in front of the tracecodec frame sitting in imu_frame and splits the two over as many records as it
+//takes, the lock has to be held
+static esp_err_t triplog_write_imu_frame_locked(size_t len, int64_t gps_base)
+{
+    esp_err_t err = ESP_OK, first_err = ESP_OK;
+    triplog_record_t record;
+
+    memcpy(x_triplog.imu_frame, &gps_base, TRIPLOG_IMU_FRAME_BASE_SIZE);
+    len += TRIPLOG_IMU_FRAME_BASE_SIZE;
+
+    uint8_t chunks = (len + TRIPLOG_FRAME_CHUNK - 1) / TRIPLOG_FRAME_CHUNK;
+
+    for(uint8_t chunk = 0; chunk < chunks; chunk++)
+    {
+        size_t offset = chunk * TRIPLOG_FRAME_CHUNK;
+
+        triplog_record_init(&record, TRIPLOG_RECORD_IMU_FRAME);
+        record.payload.imu_frame.frame = x_triplog.imu_frames;
+        record.payload.imu_frame.chunk = chunk;
+        record.payload.imu_frame.chunks = chunks;
+        record.payload.imu_frame.len = len - offset < TRIPLOG_FRAME_CHUNK ? len - offset : TRIPLOG_FRAME_CHUNK;
+        memcpy(record.payload.imu_frame.data, x_triplog.imu_frame + offset, record.payload.imu_frame.len);
+
+        //keep going, the reader drops a frame with a piece missing and picks up again at the next keyframe
+        if((err = triplog_append_locked(&record)) != ESP_OK && first_err == ESP_OK)
+            first_err = err;
+    }
+
+    x_triplog.imu_frames++;
+    x_triplog.stats.imu_frame_records += chunks;
+
+    return first_err;
+}
+
+//writes out the IMU samples waiting in the codec, even if the frame isn't full. The lock has to be held.
+static esp_err_t triplog_flush_imu_locked(void)
+{
+    esp_err_t err;
+    size_t len;
+
+    if(!x_triplog.pack_imu)
+        return ESP_OK;
+
+    if((err = tracecodec_encoder_flush(&x_triplog.imu_codec, x_triplog.imu_frame + TRIPLOG_IMU_FRAME_BASE_SIZE,
+                                       sizeof(x_triplog.imu_frame) - TRIPLOG_IMU_FRAME_BASE_SIZE, &len)) != ESP_OK)
+    {
+        ESP_LOGD(TRIPLOG_TAG, "triplog_flush_imu_locked(): tracecodec_encoder_flush returned %s", esp_err_to_name(err));
+        return err;
+    }
+
+    return len > 0 ? triplog_write_imu_frame_locked(len, x_triplog.imu_gps_base) : ESP_OK;
+}
+
+/**
+ * @name triplog_open
+ *
+ * @brief opens the log on any flash backend and recovers the head pointer
+ *
+ * @param flash flash access functions and size of the area the log can use
+ *
+ * @return err variable that lets you know if the log is ready or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t triplog_open(const triplog_flash_t *flash)
+{
+    esp_err_t err;
+
+    if(x_triplog.is_open)
+        return ESP_ERR_INVALID_STATE;
+
+    if(flash == NULL || flash->size < 2 * TRIPLOG_SECTOR_SIZE || flash->size % TRIPLOG_SECTOR_SIZE != 0)
+        return ESP_ERR_INVALID_SIZE;
+
+    memset(&x_triplog, 0, sizeof(x_triplog));
+    memset(x_triplog.staging, TRIPLOG_ERASED, sizeof(x_triplog.staging));
+    x_triplog.flash = *flash;
+    x_triplog.sector_count = flash->size / TRIPLOG_SECTOR_SIZE;
+
+    if((x_triplog.lock = xSemaphoreCreateMutex()) == NULL)
+        return ESP_ERR_NO_MEM;
+
+    if((err = triplog_recover()) != ESP_OK)
+    {
+        vSemaphoreDelete(x_triplog.lock);
+        return err;
+    }
+
+    x_triplog.is_open = true;
+
+    //mark the start of this power cycle so anything reading the log back knows state was reset here
+    triplog_record_t boot;
+    triplog_record_init(&boot, TRIPLOG_RECORD_BOOT);
+    triplog_append(&boot);
+
+    return ESP_OK;
+}
+
+static esp_err_t triplog_partition_read(void *ctx, size_t offset, void *dst, size_t len)
+{
+    return esp_partition_read((const esp_partition_t *)ctx, offset, dst, len);
+}
+
+static esp_err_t triplog_partition_write(void *ctx, size_t offset, const void *src, size_t len)
+{
+    return esp_partition_write((const esp_partition_t *)ctx, offset, src, len);
+}
+
+static esp_err_t triplog_partition_erase(void *ctx, size_t offset, size_t len)
+{
+    return esp_partition_erase_range((const esp_partition_t *)ctx, offset, len);
+}
+
+/**
+ * @name triplog_init
+ *
+ * @brief opens the log on the triplog flash partition
+ *
+ * Layout:
+ * The partition is used as a ring of 4 kB sectors. Every sector starts with a header holding a sequence number
+ * followed by 127 fixed size records. When the head reaches the end of the ring it erases the oldest sector and keeps going,
+ * so every sector sees the same number of erase cycles.
+ *
+ * @return err variable that lets you know if everything was successfully initialized or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+ *
+ * @cite https://docs.espressif.com/projects/esp-idf/en/v5.0/esp32s3/api-reference/storage/partition.html
+*/
+esp_err_t triplog_init(void)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, TRIPLOG_PARTITION_SUBTYPE, TRIPLOG_PARTITION_LABEL);
+
+    if(partition == NULL)
+    {
+        ESP_LOGD(TRIPLOG_TAG, "triplog_init(): esp_partition_find_first could not find the %s partition", TRIPLOG_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    triplog_flash_t flash = {
+        .ctx = (void *)partition,
+        .size = partition->size - (partition->size % TRIPLOG_SECTOR_SIZE),
+        .read = triplog_partition_read,
+        .write = triplog_partition_write,
+        .erase = triplog_partition_erase,
+    };
+
+    return triplog_open(&flash);
+}
+
+/**
+ * @name triplog_close
+ *
+ * @brief flushes the staging buffer and closes the log
+ *
+ * @return err variable that lets you know if the last records made it to flash or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t triplog_close(void)
+{
+    esp_err_t err;
+
+    if(!x_triplog.is_open)
+        return TRIPLOG_ERR_NOT_OPEN;
+
+    xSemaphoreTake(x_triplog.lock, portMAX_DELAY);
+    triplog_flush_imu_locked();
+    err = triplog_flush_locked();
+    x_triplog.is_open = false;
+    xSemaphoreGive(x_triplog.lock);
+
+    vSemaphoreDelete(x_triplog.lock);
+    return err;
+}
+
+/**
+ * @name triplog_append
+ *
+ * @brief stamps a record with its sequence number and CRC and puts it in the staging buffer. The buffer goes to flash once the page it maps to is full.
+ *
+ * @param record record to append, type, timestamp and payload have to be filled in by the caller
+ *
+ * @return err variable that lets you know if the record was accepted or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t triplog_append(triplog_record_t *record)
+{
+    esp_err_t err;
+
+    if(!x_triplog.is_open)
+        return TRIPLOG_ERR_NOT_OPEN;
+
+    xSemaphoreTake(x_triplog.lock, portMAX_DELAY);
+    err = triplog_append_locked(record);
+    xSemaphoreGive(x_triplog.lock);
+
+    return err;
+}
+
+/**
+ * @name triplog_flush
+ *
+ * @brief writes the partially filled staging page to flash. Later records continue in the same page so nothing is wasted,
+ * call it before reading the log back or before going to sleep. With IMU packing the frame being filled is written out first.
+ *
+ * @return err variable that lets you know if the staged records made it to flash or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t triplog_flush(void)
+{
+    esp_err_t err;
+
+    if(!x_triplog.is_open)
+        return TRIPLOG_ERR_NOT_OPEN;
+
+    xSemaphoreTake(x_triplog.lock, portMAX_DELAY);
+    triplog_flush_imu_locked();
+    err = triplog_flush_locked();
+    xSemaphoreGive(x_triplog.lock);
+
+    return err;
+}
+
+/**
+ * @name triplog_get_stats
+ *
+ * @brief copies the log counters. Write amplification is flash_bytes_written / record_bytes,
+ * records per second over flush_time_us gives the throughput of the flash path.
+ *
+ * @param stats filled with the current counters
+ *
+ * @return err variable that lets you know if the stats are valid or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t triplog_get_stats(triplog_stats_t *stats)
+{
+    if(!x_triplog.is_open)
+        return TRIPLOG_ERR_NOT_OPEN;
+
+    xSemaphoreTake(x_triplog.lock, portMAX_DELAY);
+    *stats = x_triplog.stats;
+    xSemaphoreGive(x_triplog.lock);
+
+    return ESP_OK;
+}
+
+/**
+ * @name triplog_set_imu_packing
+ *
+ * @brief turns IMU packing on or off for the rest of the power cycle. Packed IMU samples are delta coded by the tracecodec
+ * TRACECODEC_FRAME_SAMPLES to a frame and the frame is spread over IMU frame records, a fraction of the record each sample
+ * takes otherwise. The next decision record carries the x and y of the last sample so it can still be replayed on its own.
+ * Every frame carries the GPS time of its first sample and each sample its difference to that, so packed samples keep
+ * their GPS time to the microsecond.
+ *
+ * @param enable true to pack
+ *
+ * @return err variable that lets you know if the log is open, samples packed so far are written out when turning it off
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t triplog_set_imu_packing(bool enable)
+{
+    esp_err_t err = ESP_OK;
+
+    if(!x_triplog.is_open)
+        return TRIPLOG_ERR_NOT_OPEN;
+
+    xSemaphoreTake(x_triplog.lock, portMAX_DELAY);
+    if(enable && !x_triplog.pack_imu)
+        err = tracecodec_encoder_init(&x_triplog.imu_codec, TRIPLOG_IMU_FRAME_CHANNELS, TRIPLOG_IMU_KEYFRAME);
+    else if(!enable)
+        err = triplog_flush_imu_locked();
+    x_triplog.pack_imu = enable && err == ESP_OK;
+    x_triplog.angle_pending = false;
+    xSemaphoreGive(x_triplog.lock);
+
+    return err;
+}
+
+/**
+ * @name triplog_log_imu
+ *
+ * @brief appends an euler angle sample, stored in the BNO055's own 1/16 degree resolution so nothing is lost.
+ * With triplog_set_imu_packing() the sample goes into the IMU frame being filled instead.
+ *
+ * @param euler angles as returned by bno055_get_euler()
+ * @param gps_us GPS time the angles were read, from timebase_stamp(). Packed samples keep it against their frame's GPS
+ * time base, as what is left once the time since the frame's first sample is taken off.
+ *
+ * @return err variable from triplog_append(), or from writing out the frame the sample filled up
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t triplog_log_imu(const bno055_vec3_t *euler, int64_t gps_us)
+{
+    triplog_record_t record;
+
+    if(x_triplog.is_open && x_triplog.pack_imu)
+    {
+        int32_t values[TRIPLOG_IMU_FRAME_CHANNELS];
+        uint32_t time_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        esp_err_t err;
+        size_t len;
+
+        tracecodec_imu_values(euler, values);
+
+        xSemaphoreTake(x_triplog.lock, portMAX_DELAY);
+        x_triplog.angle[0] = (int16_t)values[0];
+        x_triplog.angle[1] = (int16_t)values[1];
+        x_triplog.angle_pending = true;
+        x_triplog.stats.imu_samples_packed++;
+
+        //a frame that couldn't be written yet goes out ahead of this sample with the base it was filled with
+        int64_t written_base = x_triplog.imu_gps_base;
+        if(x_triplog.imu_codec.count == 0 || x_triplog.imu_codec.count >= TRACECODEC_FRAME_SAMPLES)
+        {
+            x_triplog.imu_frame_ms = time_ms;
+            x_triplog.imu_gps_base = 0;
+        }
+
+        //the residual is the read jitter and the millisecond the timestamp drops, it delta codes to a dozen bits or so
+        int64_t since_frame_us = (int64_t)(time_ms - x_triplog.imu_frame_ms) * 1000;
+        if(gps_us == 0)
+            values[TRACECODEC_IMU_CHANNELS] = TRIPLOG_IMU_NO_GPS_TIME;
+        else
+        {
+            if(x_triplog.imu_gps_base == 0)
+                x_triplog.imu_gps_base = gps_us - since_frame_us;
+            values[TRACECODEC_IMU_CHANNELS] = (int32_t)(gps_us - x_triplog.imu_gps_base - since_frame_us);
+        }
+
+        if((err = tracecodec_encode(&x_triplog.imu_codec, time_ms, values, x_triplog.imu_frame + TRIPLOG_IMU_FRAME_BASE_SIZE,
+                                    sizeof(x_triplog.imu_frame) - TRIPLOG_IMU_FRAME_BASE_SIZE, &len)) == ESP_OK && len > 0)
+            err = triplog_write_imu_frame_locked(len, x_triplog.imu_codec.count == 0 ? x_triplog.imu_gps_base : written_base);
+        xSemaphoreGive(x_triplog.lock);
+
+        return err;
+    }
+
+    triplog_record_init(&record, TRIPLOG_RECORD_IMU);
+
+    record.payload.imu.x = (int16_t)lround(euler->x * 16.0);
+    record.payload.imu.y = (int16_t)lround(euler->y * 16.0);
+    record.payload.imu.z = (int16_t)lround(euler->z * 16.0);
+    record.payload.imu.gps_us = gps_us;
+
+    return triplog_append(&record);
+}
+
+/**
+ * @name triplog_log_gps
+ *
+ * @brief appends a GPS fix with the UTC time of day it is for. There is no room for a full GPS time, replay_gps_time() puts
+ * the time of day on the day the timebase records say the fix came in on.
+ *
+ * @param gps fix as posted by the NMEA parser
+ *
+ * @return err variable from triplog_append()
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t triplog_log_gps(const gps_t *gps)
+{
+    triplog_record_t record;
+    triplog_record_init(&record, TRIPLOG_RECORD_GPS);
+
+    record.flags = ((uint8_t)gps->fix << TRIPLOG_GPS_FIX_SHIFT) | (gps->sats_in_use > TRIPLOG_GPS_SATS_MASK ? TRIPLOG_GPS_SATS_MASK : gps->sats_in_use);
+
+    record.payload.gps.latitude = (int32_t)lroundf(gps->latitude * 1e7f);
+    record.payload.gps.longitude = (int32_t)lroundf(gps->longitude * 1e7f);
+    record.payload.gps.altitude_cm = (int32_t)lroundf(gps->altitude * 100.0f);
+    record.payload.gps.speed_cms = (uint16_t)lroundf(fminf(fmaxf(gps->speed * 100.0f, 0), UINT16_MAX));
+    record.payload.gps.cog_cdeg = (uint16_t)lroundf(fminf(fmaxf(gps->cog * 100.0f, 0), UINT16_MAX));
+    record.payload.gps.epoch_ms = (uint32_t)(((gps->tim.hour * 60 + gps->tim.minute) * 60 + gps->tim.second) * 1000 + gps->tim.thousand);
+
+    return triplog_append(&record);
+}
+
+/**
+ * @name triplog_log_light
+ *
+ * @brief appends an ambient light reading and the LED value it was mapped to
+ *
+ * @param adc_mv calibrated photoresistor voltage
+ * @param led_val duty value passed to the LED
+ * @param gps_us GPS time the ADC was read, from timebase_stamp()
+ *
+ * @return err variable from triplog_append()
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t triplog_log_light(int adc_mv, int led_val, int64_t gps_us)
+{
+    triplog_record_t record;
+    triplog_record_init(&record, TRIPLOG_RECORD_LIGHT);
+
+    record.payload.light.adc_mv = adc_mv;
+    record.payload.light.led_val = led_val;
+    record.payload.light.gps_us = gps_us;
+
+    return triplog_append(&record);
+}
+
+/**
+ * @name triplog_log_decision
+ *
+ * @brief appends the outcome of the out of level check along with the inputs it was made on
+ *
+ * @param out_of_level result of is_out_of_level()
+ * @param combined_angle combined pitch and roll angle in degrees
+ * @param speed speed in m/s
+ * @param flags TRIPLOG_FLAG_PREDICTED when combined_angle is the one decision_predict() gave, not the one from the IMU record
+ *
+ * @return err variable from triplog_append()
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t triplog_log_decision(bool out_of_level, float combined_angle, float speed, uint8_t flags)
+{
+    return triplog_log_decision_at((uint32_t)(esp_timer_get_time() / 1000), out_of_level, combined_angle, speed, 0, 0, flags);
+}
+
+//same as triplog_log_decision() stamped with the time the decision was made at, for decisions that depend on it (dwell),
+//the grade taken off the pitch when flags has TRIPLOG_FLAG_GRADE and the track offset the angle was turned by when it has TRIPLOG_FLAG_TRACK
+esp_err_t triplog_log_decision_at(uint32_t timestamp_ms, bool out_of_level, float combined_angle, float speed, float grade, float track_offset, uint8_t flags)
+{
+    triplog_record_t record;
+    esp_err_t err;
+    triplog_record_init(&record, TRIPLOG_RECORD_DECISION);
+
+    record.timestamp_ms = timestamp_ms;
+    record.flags = flags;
+    record.payload.decision.out_of_level = out_of_level;
+    record.payload.decision.grade = (int16_t)lround(grade * 16.0);
+    record.payload.decision.combined_angle = combined_angle;
+    record.payload.decision.speed = speed;
+    record.payload.decision.track_offset = (int16_t)lround(track_offset * 16.0);
+
+    if(!x_triplog.is_open)
+        return TRIPLOG_ERR_NOT_OPEN;
+
+    xSemaphoreTake(x_triplog.lock, portMAX_DELAY);
+    //a packed sample has no record of its own to pair with, the decision carries what it needs of it
+    if(x_triplog.angle_pending)
+    {
+        record.flags |= TRIPLOG_FLAG_ANGLE;
+        record.payload.decision.angle_x = x_triplog.angle[0];
+        record.payload.decision.angle_y = x_triplog.angle[1];
+        x_triplog.angle_pending = false;
+    }
+    err = triplog_append_locked(&record);
+    xSemaphoreGive(x_triplog.lock);
+
+    return err;
+}
+
+/**
+ * @name triplog_iter_begin
+ *
+ * @brief positions an iterator on the oldest record in the log. Only flushed records are visible, call triplog_flush() first.
+ *
+ * @param iter iterator to set up
+ *
+ * @return err variable that lets you know if the iterator is usable or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t triplog_iter_begin(triplog_iter_t *iter)
+{
+    if(!x_triplog.is_open)
+        return TRIPLOG_ERR_NOT_OPEN;
+
+    //the sector after the head is the oldest once the ring has wrapped, before that it is erased and gets skipped
+    iter->sector = (x_triplog.stats.head_sector + 1) % x_triplog.sector_count;
+    iter->slot = 0;
+    iter->sectors_left = x_triplog.sector_count;
+    iter->sequence = 0;
+
+    return ESP_OK;
+}
+
+/**
+ * @name triplog_iter_next
+ *
+ * @brief reads the next valid record. Records with a bad CRC (torn by a reset mid write) are skipped.
+ *
+ * @param iter iterator set up by triplog_iter_begin()
+ * @param record filled with the record
+ *
+ * @return ESP_OK when a record was read, ESP_ERR_NOT_FOUND at the end of the log
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t triplog_iter_next(triplog_iter_t *iter, triplog_record_t *record)
+{
+    esp_err_t err;
+
+    if(!x_triplog.is_open)
+        return TRIPLOG_ERR_NOT_OPEN;
+
+    while(true)
+    {
+        //opening a sector, skip it if it was never formatted
+        if(iter->slot == 0)
+        {
+            if(iter->sectors_left == 0)
+                return ESP_ERR_NOT_FOUND;
+            iter->sectors_left--;
+
+            if(!triplog_read_header(iter->sector, &iter->sequence))
+            {
+                iter->sector = (iter->sector + 1) % x_triplog.sector_count;
+                continue;
+            }
+            iter->slot = 1;
+        }
+
+        //end of a sector, the head sector is always walked last
+        if(iter->slot > TRIPLOG_RECORDS_PER_SECTOR)
+        {
+            if(iter->sector == x_triplog.stats.head_sector)
+                return ESP_ERR_NOT_FOUND;
+
+            iter->sector = (iter->sector + 1) % x_triplog.sector_count;
+            iter->slot = 0;
+            continue;
+        }
+
+        uint32_t offset = iter->sector * TRIPLOG_SECTOR_SIZE + iter->slot * TRIPLOG_RECORD_SIZE;
+        iter->slot++;
+
+        if((err = x_triplog.flash.read(x_triplog.flash.ctx, offset, record, sizeof(triplog_record_t))) != ESP_OK)
+        {
+            ESP_LOGD(TRIPLOG_TAG, "triplog_iter_next(): read returned %s", esp_err_to_name(err));
+            return err;
+        }
+
+        //rest of this sector was never written
+        if(triplog_slot_is_erased((const uint8_t *)record))
+        {
+            iter->slot = TRIPLOG_RECORDS_PER_SECTOR + 1;
+            continue;
+        }
+
+        if(triplog_record_is_valid(record))
+            return ESP_OK;
+    }
+}
+
+/**
+ * @name triplog_imu_unpack_begin
+ *
+ * @brief clears an unpacker before walking a log
+ *
+ * @param unpack unpacker to clear
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void triplog_imu_unpack_begin(triplog_imu_unpack_t *unpack)
+{
+    memset(unpack, 0, sizeof(triplog_imu_unpack_t));
+    tracecodec_decoder_init(&unpack->decoder, TRIPLOG_IMU_FRAME_CHANNELS);
+}
+
+/**
+ * @name triplog_imu_unpack_feed
+ *
+ * @brief takes in one record of a log in log order and decodes the packed IMU samples once the last piece of a frame is in.
+ * A frame with a piece missing is dropped, the decoder then waits for the next keyframe.
+ *
+ * @param unpack unpacker set up by triplog_imu_unpack_begin()
+ * @param record next record
+ * @param time filled with the timestamps of the samples in ms, TRACECODEC_FRAME_SAMPLES at most
+ * @param gps_us filled with the GPS time each sample was read, 0 for samples read before the timebase had a fix
+ * @param values filled with x, y and z of the samples in 1/16 degree
+ * @param count set to the number of samples decoded, 0 unless the record finished a frame
+ *
+ * @return err variable from tracecodec_decode_frame() for a finished frame that didn't decode, after a lost frame the delta frames
+ * return ESP_ERR_INVALID_STATE until the next keyframe, ESP_OK otherwise
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t triplog_imu_unpack_feed(triplog_imu_unpack_t *unpack, const triplog_record_t *record, uint32_t *time, int64_t *gps_us, int32_t (*values)[TRACECODEC_MAX_CHANNELS], uint8_t *count)
+{
+    esp_err_t err;
+    size_t consumed;
+
+    *count = 0;
+
+    //the encoder starts over with a keyframe every power cycle
+    if(record->type == TRIPLOG_RECORD_BOOT)
+    {
+        if(unpack->collecting)
+            unpack->lost_frames++;
+        unpack->collecting = false;
+        tracecodec_decoder_init(&unpack->decoder, TRIPLOG_IMU_FRAME_CHANNELS);
+        return ESP_OK;
+    }
+
+    if(record->type != TRIPLOG_RECORD_IMU_FRAME)
+        return ESP_OK;
+
+    //a piece out of order means one went missing, the frame it belonged to is gone and so are the deltas after it
+    if(record->payload.imu_frame.chunk != (unpack->collecting ? unpack->next_chunk : 0) ||
+        (unpack->collecting && record->payload.imu_frame.frame != unpack->frame) ||
+        record->payload.imu_frame.len > TRIPLOG_FRAME_CHUNK ||
+        unpack->len + record->payload.imu_frame.len > sizeof(unpack->data))
+    {
+        //the rest of a frame whose first piece went missing is only counted once
+        if(unpack->collecting || record->payload.imu_frame.frame != unpack->frame)
+            unpack->lost_frames++;
+        unpack->collecting = false;
+        unpack->frame = record->payload.imu_frame.frame;
+        tracecodec_decoder_init(&unpack->decoder, TRIPLOG_IMU_FRAME_CHANNELS);
+        if(record->payload.imu_frame.chunk != 0)
+            return ESP_OK;
+    }
+
+    if(!unpack->collecting)
+    {
+        unpack->collecting = true;
+        unpack->frame = record->payload.imu_frame.frame;
+        unpack->next_chunk = 0;
+        unpack->len = 0;
+    }
+
+    memcpy(unpack->data + unpack->len, record->payload.imu_frame.data, record->payload.imu_frame.len);
+    unpack->len += record->payload.imu_frame.len;
+    unpack->next_chunk++;
+
+    if(unpack->next_chunk < record->payload.imu_frame.chunks)
+        return ESP_OK;
+
+    unpack->collecting = false;
+    if(unpack->len < TRIPLOG_IMU_FRAME_BASE_SIZE)
+    {
+        unpack->lost_frames++;
+        return TRACECODEC_ERR_CORRUPT;
+    }
+
+    if((err = tracecodec_decode_frame(&unpack->decoder, unpack->data + TRIPLOG_IMU_FRAME_BASE_SIZE, unpack->len - TRIPLOG_IMU_FRAME_BASE_SIZE,
+                                      &consumed, time, values, count)) != ESP_OK)
+    {
+        unpack->lost_frames++;
+        *count = 0;
+        return err;
+    }
+
+    //each sample is the frame's GPS time base, the time since the frame's first sample and its residual
+    int64_t gps_base;
+    memcpy(&gps_base, unpack->data, TRIPLOG_IMU_FRAME_BASE_SIZE);
+    for(uint8_t i = 0; i < *count; i++)
+    {
+        int32_t residual = values[i][TRACECODEC_IMU_CHANNELS];
+
+        gps_us[i] = residual == TRIPLOG_IMU_NO_GPS_TIME ? 0 : gps_base + (int64_t)(time[i] - time[0]) * 1000 + residual;
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t triplog_sim_read(void *ctx, size_t offset, void *dst, size_t len)
+{
+    triplog_sim_t *sim = (triplog_sim_t *)ctx;
+
+    if(offset + len > sim->size)
+        return ESP_ERR_INVALID_SIZE;
+
+    memcpy(dst, sim->image + offset, len);
+    return ESP_OK;
+}
+
+static esp_err_t triplog_sim_write(void *ctx, size_t offset, const void *src, size_t len)
+{
+    triplog_sim_t *sim = (triplog_sim_t *)ctx;
+    const uint8_t *data = (const uint8_t *)src;
+
+    if(offset + len > sim->size)
+        return ESP_ERR_INVALID_SIZE;
+
+    //NOR flash can only clear bits, trying to set one means we wrote over data without erasing
+    for(size_t i = 0; i < len; i++)
+    {
+        if((sim->image[offset + i] & data[i]) != data[i])
+            return ESP_ERR_INVALID_STATE;
+    }
+
+    for(size_t i = 0; i < len; i++)
+        sim->image[offset + i] &= data[i];
+
+    sim->write_calls++;
+    return ESP_OK;
+}
+
+static esp_err_t triplog_sim_erase(void *ctx, size_t offset, size_t len)
+{
+    triplog_sim_t *sim = (triplog_sim_t *)ctx;
+
+    if(offset % TRIPLOG_SECTOR_SIZE != 0 || len % TRIPLOG_SECTOR_SIZE != 0 || offset + len > sim->size)
+        return ESP_ERR_INVALID_ARG;
+
+    memset(sim->image + offset, TRIPLOG_ERASED, len);
+    sim->erase_calls++;
+    return ESP_OK;
+}
+
+/**
+ * @name triplog_sim_init
+ *
+ * @brief creates an erased RAM partition image and the flash backend that goes with it. Used to try the log out without
+ * wearing the real flash, e.g. to measure throughput and write amplification for a given record mix.
+ *
+ * @param sim image to allocate
+ * @param flash filled with a backend that can be handed to triplog_open()
+ * @param size size of the image in bytes, multiple of TRIPLOG_SECTOR_SIZE
+ *
+ * @return err variable that lets you know if the image was allocated or not
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t triplog_sim_init(triplog_sim_t *sim, triplog_flash_t *flash, size_t size)
+{
+    if(size % TRIPLOG_SECTOR_SIZE != 0)
+        return ESP_ERR_INVALID_SIZE;
+
+    memset(sim, 0, sizeof(triplog_sim_t));
+
+    if((sim->image = malloc(size)) == NULL)
+        return ESP_ERR_NO_MEM;
+
+    memset(sim->image, TRIPLOG_ERASED, size);
+    sim->size = size;
+
+    flash->ctx = sim;
+    flash->size = size;
+    flash->read = triplog_sim_read;
+    flash->write = triplog_sim_write;
+    flash->erase = triplog_sim_erase;
+
+    return ESP_OK;
+}
+
+/**
+ * @name triplog_sim_deinit
+ *
+ * @brief frees a RAM partition image
+ *
+ * @param sim image to free
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void triplog_sim_deinit(triplog_sim_t *sim)
+{
+    free(sim->image);
+    sim->image = NULL;
+    sim->size = 0;
+}
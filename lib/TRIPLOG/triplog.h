@@ -0,0 +1,252 @@
+#ifndef TRIPLOG_H
+#define TRIPLOG_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+#include "bno055.h"
+#include "nmea_parser.h"
+#include "tracecodec.h"
+
+static const char* TRIPLOG_TAG = "Triplog";
+
+#define TRIPLOG_PARTITION_LABEL "triplog"
+#define TRIPLOG_PARTITION_SUBTYPE (0x40) //custom data subtype, has to match partitions.csv
+
+#define TRIPLOG_SECTOR_SIZE (4096) //smallest erasable unit of the SPI flash
+#define TRIPLOG_PAGE_SIZE (256) //largest unit the SPI flash programs in one go, the staging buffer is one page
+#define TRIPLOG_RECORD_SIZE (32)
+#define TRIPLOG_RECORDS_PER_PAGE (TRIPLOG_PAGE_SIZE / TRIPLOG_RECORD_SIZE)
+#define TRIPLOG_RECORDS_PER_SECTOR ((TRIPLOG_SECTOR_SIZE / TRIPLOG_RECORD_SIZE) - 1) //first slot of every sector holds the sector header
+
+#define TRIPLOG_FRAME_CHUNK (15) //bytes of a packed IMU frame carried by one record
+#define TRIPLOG_IMU_KEYFRAME (8) //packed IMU frames per keyframe, a lost record costs the samples up to the next keyframe
+#define TRIPLOG_IMU_FRAME_CHANNELS (TRACECODEC_IMU_CHANNELS + 1) //euler x, y, z and the GPS time residual
+#define TRIPLOG_IMU_FRAME_BASE_SIZE (8) //GPS time of the frame's first sample, in front of the tracecodec frame
+#define TRIPLOG_IMU_NO_GPS_TIME (INT32_MIN) //residual of a packed sample read before the timebase had a fix
+
+#define TRIPLOG_GPS_FIX_SHIFT (6) //GPS record flags: gps_fix_t in the top 2 bits
+#define TRIPLOG_GPS_SATS_MASK (0x3F) //GPS record flags: satellites in use in the bottom 6 bits
+
+#define TRIPLOG_ERR_NOT_OPEN (0x7100) //triplog_init() hasn't been called or failed
+
+#define TRIPLOG_FLAG_PREDICTED (0x01) //decision record: combined_angle is the predicted angle the decision was made on
+#define TRIPLOG_FLAG_AXES (0x02) //decision record: made with the per axis limits at the record's timestamp
+#define TRIPLOG_FLAG_GRADE (0x04) //decision record: grade was taken off the pitch before the decision
+#define TRIPLOG_FLAG_TRACK (0x08) //decision record: pitch and roll were turned into the direction of travel by track_offset first
+#define TRIPLOG_FLAG_ANGLE (0x10) //decision record: angle_x and angle_y hold the IMU sample, packed IMU samples have no record of their own
+
+typedef enum {
+    TRIPLOG_RECORD_IMU = 0x01,
+    TRIPLOG_RECORD_GPS = 0x02,
+    TRIPLOG_RECORD_LIGHT = 0x03,
+    TRIPLOG_RECORD_DECISION = 0x04,
+    TRIPLOG_RECORD_BOOT = 0x05, //written when the log is opened, everything after it belongs to one power cycle
+    TRIPLOG_RECORD_LED_TICK = 0x06, //LED timer alarm, only logged in capture mode
+    TRIPLOG_RECORD_HEALTH = 0x07, //heap and stack figures from the health sampler
+    TRIPLOG_RECORD_VIBRATION = 0x08, //band energies of one vibration window
+    TRIPLOG_RECORD_TIMEBASE = 0x09, //esp_timer to GPS time mapping, written on every fix that disciplines the timebase
+    TRIPLOG_RECORD_ZONE = 0x0A, //limits the decision switched to on entering or leaving a geofence zone
+    TRIPLOG_RECORD_TRIPSTATS = 0x0B, //running totals of the trip, written every tripstats_period_ms
+    TRIPLOG_RECORD_IMU_FRAME = 0x0C, //piece of a tracecodec frame of IMU samples, written instead of IMU records with triplog_set_imu_packing()
+    TRIPLOG_RECORD_HEALTH_TASK = 0x0D, //one task of a health sample, right after the sample's TRIPLOG_RECORD_HEALTH
+} triplog_record_type_t;
+
+/**
+ * @brief fixed size record as it sits on flash. Everything is stored as integers in the units the sensors hand them to us
+ * so a record is 32 bytes no matter what it holds and the log can be walked without any framing.
+*/
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp_ms; //milliseconds since boot
+    uint8_t type; //triplog_record_type_t, 0xFF means the slot was never written
+    uint8_t flags;
+    uint16_t sequence; //low 16 bits of the record counter, used to spot gaps when reading the log back
+    union {
+        struct __attribute__((packed)) {
+            int16_t x; //1 degree = 16 LSB, same as the BNO055 euler registers
+            int16_t y;
+            int16_t z;
+            int64_t gps_us; //GPS time the sample was read, 0 before the timebase had a fix
+        } imu;
+        struct {
+            int32_t latitude; //degrees * 1e7
+            int32_t longitude; //degrees * 1e7
+            int32_t altitude_cm;
+            uint16_t speed_cms;
+            uint16_t cog_cdeg; //course over ground in 1/100 degree
+            uint32_t epoch_ms; //UTC time of day the fix is for, replay_gps_time() puts it on its day. The flags hold fix and satellites.
+        } gps;
+        struct __attribute__((packed)) {
+            int32_t adc_mv;
+            int32_t led_val;
+            int64_t gps_us; //GPS time the ADC was read, 0 before the timebase had a fix
+        } light;
+        struct {
+            uint8_t out_of_level;
+            uint8_t reserved;
+            int16_t grade; //road grade taken off the pitch, 1 degree = 16 LSB, with TRIPLOG_FLAG_GRADE
+            float combined_angle;
+            float speed;
+            int16_t track_offset; //direction of travel minus board heading, 1 degree = 16 LSB, with TRIPLOG_FLAG_TRACK
+            int16_t angle_x; //IMU sample the decision started from, 1 degree = 16 LSB, with TRIPLOG_FLAG_ANGLE
+            int16_t angle_y;
+        } decision;
+        struct {
+            uint8_t led_on;
+            uint8_t is_led_on;
+            uint8_t reserved[2];
+            int32_t led_on_val;
+            int32_t duty;
+        } led_tick;
+        struct {
+            uint32_t heap_free;
+            uint32_t heap_min_free; //lowest free heap since boot
+            uint32_t heap_largest_block;
+            uint16_t min_stack_free; //bytes of stack never touched by the task closest to overflowing
+            uint16_t idle_permille[2]; //idle time of each core since the last sample
+            uint16_t heap_fragmentation_permille; //free heap that isn't part of the largest block. The flags hold the task count.
+        } health;
+        struct {
+            char name[12]; //cut short if longer, not terminated if it fills the field
+            uint8_t index; //place in the sample's task list
+            uint8_t priority;
+            uint16_t cpu_permille; //share of both cores since the last sample
+            uint32_t stack_free; //bytes of stack never touched
+        } health_task;
+        struct {
+            float road_rms; //m/s^2
+            float engine_rms;
+            uint16_t peak_chz; //strongest frequency in 1/100 Hz
+            uint16_t reserved;
+            uint32_t cycles; //CPU cycles the window took
+        } vibration;
+        struct __attribute__((packed)) {
+            int64_t local_us; //esp_timer time of an epoch edge
+            int64_t gps_us; //GPS time of that edge, microseconds since 2000-01-01 UTC
+            int32_t rate_ppb; //GPS time gained per esp_timer second, in parts per billion. The flags hold the timebase_source_t.
+        } timebase;
+        struct {
+            uint16_t id; //zone id, 0xFFFF outside every zone and the rest of the record is unused
+            int16_t threshold; //1 degree = 16 LSB, same as the zone table
+            int16_t pitch_upper;
+            int16_t pitch_lower;
+            int16_t roll_upper;
+            int16_t roll_lower;
+            float lower_speed;
+            float upper_speed;
+        } zone;
+        struct {
+            uint32_t distance_m;
+            uint32_t moving_s;
+            uint32_t tilt_ms; //time the warning was on
+            uint32_t over_threshold_ms; //time the combined angle was over the threshold
+            uint16_t tilt_events;
+            uint16_t max_speed_cs; //speed * 100
+        } tripstats;
+        struct {
+            uint16_t frame; //low 16 bits of the frame counter, every piece of a frame has the same one
+            uint8_t chunk; //piece of the frame, 0 first
+            uint8_t chunks;
+            uint8_t len; //bytes of data used
+            uint8_t data[TRIPLOG_FRAME_CHUNK];
+        } imu_frame;
+        uint8_t raw[20];
+    } payload;
+    uint32_t crc; //crc32 of everything above
+} triplog_record_t;
+
+/**
+ * @brief header written to the first slot of every sector right after it is erased. The sequence number tells us which
+ * sector is the newest on boot without having to walk the records.
+*/
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t sequence;
+    uint16_t version;
+    uint16_t record_size;
+    uint8_t reserved[16];
+    uint32_t crc;
+} triplog_sector_header_t;
+
+/**
+ * @brief flash access used by the log. Lets the same log code run against the triplog partition or a RAM image.
+*/
+typedef struct {
+    void *ctx;
+    size_t size; //must be a multiple of TRIPLOG_SECTOR_SIZE
+    esp_err_t (*read)(void *ctx, size_t offset, void *dst, size_t len);
+    esp_err_t (*write)(void *ctx, size_t offset, const void *src, size_t len);
+    esp_err_t (*erase)(void *ctx, size_t offset, size_t len);
+} triplog_flash_t;
+
+/**
+ * @brief RAM image of a partition that behaves like NOR flash: programming can only clear bits and erasing is per sector.
+*/
+typedef struct {
+    uint8_t *image;
+    size_t size;
+    uint32_t write_calls;
+    uint32_t erase_calls;
+} triplog_sim_t;
+
+typedef struct {
+    uint32_t records_appended;
+    uint32_t records_dropped; //couldn't be staged because a flush failed
+    uint32_t imu_samples_packed; //IMU samples that went into frames instead of a record each
+    uint32_t imu_frame_records; //records those frames took up
+    uint32_t page_writes;
+    uint32_t sector_erases;
+    uint64_t record_bytes; //bytes handed to the log
+    uint64_t flash_bytes_written; //bytes actually programmed including sector headers
+    uint32_t head_sector;
+    uint32_t head_sequence;
+    int64_t flush_time_us; //total time spent programming pages
+} triplog_stats_t;
+
+/**
+ * @brief puts packed IMU frames back together while walking the log, one per log being read
+*/
+typedef struct {
+    tracecodec_decoder_t decoder;
+    bool collecting; //pieces of a frame have come in
+    uint16_t frame;
+    uint8_t next_chunk;
+    size_t len;
+    uint8_t data[TRIPLOG_IMU_FRAME_BASE_SIZE + TRACECODEC_MAX_FRAME_SIZE];
+    uint32_t lost_frames; //frames missing a piece, or delta frames after one that can't be decoded until the next keyframe
+} triplog_imu_unpack_t;
+
+typedef struct {
+    uint32_t sector; //sector being walked
+    uint32_t slot;
+    uint32_t sectors_left;
+    uint32_t sequence; //sequence of the sector being walked
+} triplog_iter_t;
+
+esp_err_t triplog_init(void);
+esp_err_t triplog_open(const triplog_flash_t *);
+esp_err_t triplog_close(void);
+esp_err_t triplog_append(triplog_record_t *);
+esp_err_t triplog_flush(void);
+esp_err_t triplog_get_stats(triplog_stats_t *);
+esp_err_t triplog_set_imu_packing(bool);
+
+esp_err_t triplog_log_imu(const bno055_vec3_t *, int64_t);
+esp_err_t triplog_log_gps(const gps_t *);
+esp_err_t triplog_log_light(int, int, int64_t);
+esp_err_t triplog_log_decision(bool, float, float, uint8_t);
+esp_err_t triplog_log_decision_at(uint32_t, bool, float, float, float, float, uint8_t);
+
+     bool triplog_header_is_valid(const triplog_sector_header_t *, uint32_t *);
+     bool triplog_record_is_valid(const triplog_record_t *);
+
+esp_err_t triplog_iter_begin(triplog_iter_t *);
+esp_err_t triplog_iter_next(triplog_iter_t *, triplog_record_t *);
+
+     void triplog_imu_unpack_begin(triplog_imu_unpack_t *);
+esp_err_t triplog_imu_unpack_feed(triplog_imu_unpack_t *, const triplog_record_t *, uint32_t *, int64_t *, int32_t (*)[TRACECODEC_MAX_CHANNELS], uint8_t *);
+
+esp_err_t triplog_sim_init(triplog_sim_t *, triplog_flash_t *, size_t);
+     void triplog_sim_deinit(triplog_sim_t *);
+
+#endif //TRIPLOG_H
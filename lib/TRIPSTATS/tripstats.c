@@ -0,0 +1,374 @@
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "tripstats.h"
+#include "triplog.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+
+#define TRIPSTATS_E7_TO_RAD (1.745329252e-9f) //pi / 180 / 1e7
+
+/**
+ * @brief copy of the totals in RTC memory, which keeps its contents through sleep and resets but not a power cut
+*/
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    tripstats_t stats;
+    uint32_t crc; //crc32 of everything above, anything else is what RTC memory powers up with
+} tripstats_rtc_t;
+
+typedef struct {
+    bool initialized;
+    portMUX_TYPE lock; //fixes come in on the NMEA task, decisions from the main loop
+} tripstats_state_t;
+
+static RTC_NOINIT_ATTR tripstats_rtc_t x_tripstats_rtc;
+static tripstats_state_t x_tripstats = { .lock = portMUX_INITIALIZER_UNLOCKED };
+
+static uint32_t tripstats_rtc_crc(void)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)&x_tripstats_rtc, offsetof(tripstats_rtc_t, crc));
+}
+
+/**
+ * @name tripstats_begin
+ *
+ * @brief starts a trip from nothing
+ *
+ * @param stats totals to clear
+ * @param moving_speed slowest speed that counts as moving
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void tripstats_begin(tripstats_t *stats, float moving_speed)
+{
+    memset(stats, 0, sizeof(tripstats_t));
+    stats->moving_speed = moving_speed;
+}
+
+/**
+ * @name tripstats_resume
+ *
+ * @brief carries a trip on after a boot. The totals stay, the last fix and decision are forgotten since esp_timer started over,
+ * and a warning that was on is closed off where it was last seen.
+ *
+ * @param stats totals to carry on
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void tripstats_resume(tripstats_t *stats)
+{
+    stats->boots++;
+    stats->has_fix = false;
+    stats->has_decision = false;
+    stats->tilted = false;
+    stats->over = false;
+}
+
+/**
+ * @name tripstats_haversine_mm
+ *
+ * @brief great circle distance between two positions. The differences are taken in integers, so a step of a few meters is as exact
+ * as single precision allows even far from the equator.
+ *
+ * @param lat1 latitude of the first position in 1e-7 degrees
+ * @param lon1 longitude of the first position
+ * @param lat2 latitude of the second position
+ * @param lon2 longitude of the second position
+ *
+ * @return distance in millimeters
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+uint32_t tripstats_haversine_mm(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2)
+{
+    int64_t dlon_e7 = (int64_t)lon2 - lon1;
+
+    //the short way round across the antimeridian
+    if(dlon_e7 > 1800000000)
+        dlon_e7 -= 3600000000LL;
+    else if(dlon_e7 < -1800000000)
+        dlon_e7 += 3600000000LL;
+
+    float half_dlat = (float)((int64_t)lat2 - lat1) * TRIPSTATS_E7_TO_RAD * 0.5f;
+    float half_dlon = (float)dlon_e7 * TRIPSTATS_E7_TO_RAD * 0.5f;
+    float s_lat = sinf(half_dlat), s_lon = sinf(half_dlon);
+    float a = s_lat * s_lat + cosf(lat1 * TRIPSTATS_E7_TO_RAD) * cosf(lat2 * TRIPSTATS_E7_TO_RAD) * s_lon * s_lon;
+    float distance = 2.0f * TRIPSTATS_EARTH_RADIUS_MM * asinf(sqrtf(fminf(a, 1.0f)));
+
+    return distance >= (float)UINT32_MAX ? UINT32_MAX : (uint32_t)lroundf(distance);
+}
+
+/**
+ * @name tripstats_add_fix
+ *
+ * @brief adds the stretch since the last fix. Fixes further apart than TRIPSTATS_MAX_GAP_MS start a new stretch, and a fix without a position
+ * ends the current one.
+ *
+ * @param stats totals to add to
+ * @param lat latitude in 1e-7 degrees
+ * @param lon longitude in 1e-7 degrees
+ * @param speed speed over ground
+ * @param valid fix has a position
+ * @param time_ms time of the fix
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void tripstats_add_fix(tripstats_t *stats, int32_t lat, int32_t lon, float speed, bool valid, uint32_t time_ms)
+{
+    if(!valid)
+    {
+        stats->has_fix = false;
+        return;
+    }
+
+    if(stats->has_fix)
+    {
+        uint32_t dt = time_ms - stats->fix_ms;
+
+        if(dt <= TRIPSTATS_MAX_GAP_MS)
+        {
+            stats->tracked_ms += dt;
+            if(speed >= stats->moving_speed)
+            {
+                stats->moving_ms += dt;
+                stats->distance_mm += tripstats_haversine_mm(stats->fix_lat, stats->fix_lon, lat, lon);
+            }
+        }
+    }
+
+    if(speed > stats->max_speed)
+        stats->max_speed = speed;
+
+    stats->fixes++;
+    stats->has_fix = true;
+    stats->fix_lat = lat;
+    stats->fix_lon = lon;
+    stats->fix_ms = time_ms;
+}
+
+/**
+ * @name tripstats_add_decision
+ *
+ * @brief adds the time since the last decision to the tilt totals, the state of the last decision holds until this one
+ *
+ * @param stats totals to add to
+ * @param combined_angle angle the decision was made on
+ * @param threshold threshold it was judged against
+ * @param out_of_level whether the warning is on
+ * @param time_ms time of the decision
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void tripstats_add_decision(tripstats_t *stats, float combined_angle, float threshold, bool out_of_level, uint32_t time_ms)
+{
+    if(stats->has_decision)
+    {
+        uint32_t dt = time_ms - stats->decision_ms;
+
+        if(dt <= TRIPSTATS_MAX_GAP_MS)
+        {
+            if(stats->tilted)
+                stats->tilt_ms += dt;
+            if(stats->over)
+                stats->over_threshold_ms += dt;
+        }
+    }
+
+    if(out_of_level && !stats->tilted)
+    {
+        stats->tilt_events++;
+        stats->tilt_since_ms = time_ms;
+    }
+
+    if(stats->tilted && time_ms - stats->tilt_since_ms > stats->longest_tilt_ms)
+        stats->longest_tilt_ms = time_ms - stats->tilt_since_ms;
+
+    if(combined_angle > stats->max_angle)
+        stats->max_angle = combined_angle;
+
+    stats->decisions++;
+    stats->has_decision = true;
+    stats->tilted = out_of_level;
+    stats->over = combined_angle > threshold;
+    stats->decision_ms = time_ms;
+}
+
+/**
+ * @name tripstats_init
+ *
+ * @brief picks the trip up from RTC memory if it holds one, otherwise starts a new one
+ *
+ * @param moving_speed slowest speed that counts as moving, only used for a new trip
+ *
+ * @return ESP_OK or ESP_ERR_INVALID_STATE if already running
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t tripstats_init(float moving_speed)
+{
+    bool resumed;
+
+    if(x_tripstats.initialized)
+        return ESP_ERR_INVALID_STATE;
+
+    portENTER_CRITICAL(&x_tripstats.lock);
+    resumed = x_tripstats_rtc.magic == TRIPSTATS_MAGIC && x_tripstats_rtc.version == TRIPSTATS_VERSION &&
+              x_tripstats_rtc.size == sizeof(tripstats_rtc_t) && x_tripstats_rtc.crc == tripstats_rtc_crc();
+
+    if(resumed)
+        tripstats_resume(&x_tripstats_rtc.stats);
+    else
+    {
+        memset(&x_tripstats_rtc, 0, sizeof(tripstats_rtc_t));
+        x_tripstats_rtc.magic = TRIPSTATS_MAGIC;
+        x_tripstats_rtc.version = TRIPSTATS_VERSION;
+        x_tripstats_rtc.size = sizeof(tripstats_rtc_t);
+        tripstats_begin(&x_tripstats_rtc.stats, moving_speed);
+    }
+    x_tripstats_rtc.crc = tripstats_rtc_crc();
+    x_tripstats.initialized = true;
+    portEXIT_CRITICAL(&x_tripstats.lock);
+
+    if(resumed)
+        ESP_LOGI(TRIPSTATS_TAG, "resuming the trip from RTC memory, boot %lu \n", (unsigned long)x_tripstats_rtc.stats.boots);
+    else
+        ESP_LOGI(TRIPSTATS_TAG, "starting a new trip \n");
+
+    return ESP_OK;
+}
+
+/**
+ * @name tripstats_gps_fix
+ *
+ * @brief takes a fix from the NMEA parser. Does nothing before tripstats_init().
+ *
+ * @param gps fix as posted by the NMEA parser
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void tripstats_gps_fix(const gps_t *gps)
+{
+    if(!x_tripstats.initialized)
+        return;
+
+    //same rounding the trip log does
+    int32_t lat = (int32_t)lroundf(gps->latitude * 1e7f);
+    int32_t lon = (int32_t)lroundf(gps->longitude * 1e7f);
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    portENTER_CRITICAL(&x_tripstats.lock);
+    tripstats_add_fix(&x_tripstats_rtc.stats, lat, lon, gps->speed, gps->fix != GPS_FIX_INVALID, now_ms);
+    x_tripstats_rtc.crc = tripstats_rtc_crc();
+    portEXIT_CRITICAL(&x_tripstats.lock);
+}
+
+/**
+ * @name tripstats_decision
+ *
+ * @brief takes a decision from the main loop. Does nothing before tripstats_init().
+ *
+ * @param combined_angle angle the decision was made on
+ * @param threshold threshold it was judged against
+ * @param out_of_level whether the warning is on
+ * @param time_ms time of the decision
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+void tripstats_decision(float combined_angle, float threshold, bool out_of_level, uint32_t time_ms)
+{
+    if(!x_tripstats.initialized)
+        return;
+
+    portENTER_CRITICAL(&x_tripstats.lock);
+    tripstats_add_decision(&x_tripstats_rtc.stats, combined_angle, threshold, out_of_level, time_ms);
+    x_tripstats_rtc.crc = tripstats_rtc_crc();
+    portEXIT_CRITICAL(&x_tripstats.lock);
+}
+
+esp_err_t tripstats_get(tripstats_t *stats)
+{
+    if(!x_tripstats.initialized)
+        return ESP_ERR_INVALID_STATE;
+
+    portENTER_CRITICAL(&x_tripstats.lock);
+    *stats = x_tripstats_rtc.stats;
+    portEXIT_CRITICAL(&x_tripstats.lock);
+
+    return ESP_OK;
+}
+
+/**
+ * @name tripstats_reset
+ *
+ * @brief ends the trip and starts a new one with the same moving speed
+ *
+ * @return ESP_OK or ESP_ERR_INVALID_STATE before tripstats_init()
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t tripstats_reset(void)
+{
+    if(!x_tripstats.initialized)
+        return ESP_ERR_INVALID_STATE;
+
+    portENTER_CRITICAL(&x_tripstats.lock);
+    tripstats_begin(&x_tripstats_rtc.stats, x_tripstats_rtc.stats.moving_speed);
+    x_tripstats_rtc.crc = tripstats_rtc_crc();
+    portEXIT_CRITICAL(&x_tripstats.lock);
+
+    return ESP_OK;
+}
+
+void tripstats_print(const tripstats_t *stats)
+{
+    ESP_LOGI(TRIPSTATS_TAG, "distance %.3f km, moving %lu s of %lu s tracked, max speed %.1f, boots %lu",
+        stats->distance_mm / 1e6, (unsigned long)(stats->moving_ms / 1000), (unsigned long)(stats->tracked_ms / 1000),
+        stats->max_speed, (unsigned long)stats->boots);
+    ESP_LOGI(TRIPSTATS_TAG, "%lu tilt events, %lu s warning on (longest %lu s), %lu s over the threshold, max angle %.1f",
+        (unsigned long)stats->tilt_events, (unsigned long)(stats->tilt_ms / 1000), (unsigned long)(stats->longest_tilt_ms / 1000),
+        (unsigned long)(stats->over_threshold_ms / 1000), stats->max_angle);
+}
+
+/**
+ * @name tripstats_log
+ *
+ * @brief writes the totals to the trip log, so the trip can be read off a log dump without replaying the samples
+ *
+ * @param stats totals to log
+ *
+ * @return err variable from triplog_append()
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t tripstats_log(const tripstats_t *stats)
+{
+    triplog_record_t record;
+
+    memset(&record, 0, sizeof(record));
+    record.timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    record.type = TRIPLOG_RECORD_TRIPSTATS;
+    record.payload.tripstats.distance_m = stats->distance_mm / 1000 > UINT32_MAX ? UINT32_MAX : (uint32_t)(stats->distance_mm / 1000);
+    record.payload.tripstats.moving_s = (uint32_t)(stats->moving_ms / 1000);
+    record.payload.tripstats.tilt_ms = stats->tilt_ms > UINT32_MAX ? UINT32_MAX : (uint32_t)stats->tilt_ms;
+    record.payload.tripstats.over_threshold_ms = stats->over_threshold_ms > UINT32_MAX ? UINT32_MAX : (uint32_t)stats->over_threshold_ms;
+    record.payload.tripstats.tilt_events = stats->tilt_events > UINT16_MAX ? UINT16_MAX : stats->tilt_events;
+    record.payload.tripstats.max_speed_cs = stats->max_speed * 100 > UINT16_MAX ? UINT16_MAX : (uint16_t)(stats->max_speed * 100);
+
+    return triplog_append(&record);
+}
@@ -0,0 +1,63 @@
+#ifndef TRIPSTATS_H
+#define TRIPSTATS_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+#include "nmea_parser.h"
+
+static const char* TRIPSTATS_TAG = "Tripstats";
+
+#define TRIPSTATS_MAGIC (0x54524950) //"TRIP", marks the RTC copy as written by this firmware
+#define TRIPSTATS_VERSION (1) //bump when tripstats_t changes, an old RTC copy is then dropped
+#define TRIPSTATS_MAX_GAP_MS (5000) //longer between two fixes or two decisions and the time between them isn't counted
+#define TRIPSTATS_EARTH_RADIUS_MM (6371008800.0f) //mean radius
+
+/**
+ * @brief running totals of a trip. Everything is added to as fixes and decisions come in, nothing is kept per sample,
+ * so the struct stays the same size however long the trip is.
+*/
+typedef struct {
+    float moving_speed; //slowest speed that counts as moving, distance isn't added below it so GPS wander doesn't add up while parked
+    uint32_t boots; //power cycles and sleeps the trip carried across
+
+    uint32_t fixes;
+    uint64_t distance_mm;
+    uint64_t tracked_ms; //time with a usable fix
+    uint64_t moving_ms;
+    float max_speed;
+
+    uint32_t decisions;
+    uint32_t tilt_events; //times the warning came on
+    uint64_t tilt_ms; //time the warning was on
+    uint32_t longest_tilt_ms;
+    uint64_t over_threshold_ms; //time the combined angle was over the threshold, whether or not the speed let the warning come on
+    float max_angle;
+
+    //where the last fix and decision left off, cleared on every boot
+    bool has_fix;
+    int32_t fix_lat; //1e-7 degrees
+    int32_t fix_lon;
+    uint32_t fix_ms;
+    bool has_decision;
+    bool tilted;
+    bool over;
+    uint32_t decision_ms;
+    uint32_t tilt_since_ms;
+} tripstats_t;
+
+     void tripstats_begin(tripstats_t *, float);
+     void tripstats_resume(tripstats_t *);
+ uint32_t tripstats_haversine_mm(int32_t, int32_t, int32_t, int32_t);
+     void tripstats_add_fix(tripstats_t *, int32_t, int32_t, float, bool, uint32_t);
+     void tripstats_add_decision(tripstats_t *, float, float, bool, uint32_t);
+
+esp_err_t tripstats_init(float);
+     void tripstats_gps_fix(const gps_t *);
+     void tripstats_decision(float, float, bool, uint32_t);
+esp_err_t tripstats_get(tripstats_t *);
+esp_err_t tripstats_reset(void);
+     void tripstats_print(const tripstats_t *);
+esp_err_t tripstats_log(const tripstats_t *);
+
+#endif //TRIPSTATS_H
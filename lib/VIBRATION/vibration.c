@@ -0,0 +1,364 @@
+#include <string.h>
+#include <math.h>
+#include "vibration.h"
+#include "triplog.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+//same split as the tilt filter: esp-dsp's radix-2 FFT where the component is there, the plain C one below elsewhere
+#if defined(ESP_PLATFORM) && __has_include("dsps_fft2r.h")
+#include "dsps_fft2r.h"
+#define VIBRATION_ESP_DSP 1
+#else
+#define VIBRATION_ESP_DSP 0
+#endif
+
+typedef struct {
+    i2c_number_t i2c_num;
+    float rate_hz;
+    bool running;
+    TaskHandle_t task;
+    portMUX_TYPE lock; //guards latest and stats
+    bool has_latest;
+    vibration_features_t latest;
+    vibration_stats_t stats;
+    float samples[VIBRATION_WINDOW];
+} vibration_state_t;
+
+static vibration_state_t x_vibration = { .lock = portMUX_INITIALIZER_UNLOCKED };
+
+//tables are built on the first window and never change, the size is fixed at compile time
+static bool x_tables_ready = false;
+static float x_hann[VIBRATION_WINDOW];
+static float x_hann_power; //sum of the window squared, scales the band energy back to the signal's
+static float x_fft[2 * VIBRATION_WINDOW]; //interleaved re/im, only ever used by one analysis at a time
+#if !VIBRATION_ESP_DSP
+static float x_twiddle[VIBRATION_WINDOW]; //cos/sin pairs for k < N/2
+#endif
+
+static esp_err_t vibration_tables_init(void)
+{
+    if(x_tables_ready)
+        return ESP_OK;
+
+#if VIBRATION_ESP_DSP
+    esp_err_t err;
+    if((err = dsps_fft2r_init_fc32(NULL, VIBRATION_WINDOW)) != ESP_OK)
+    {
+        ESP_LOGD(VIBRATION_TAG, "vibration_tables_init(): dsps_fft2r_init_fc32 returned %s", esp_err_to_name(err));
+        return err;
+    }
+#else
+    for(int k = 0; k < VIBRATION_WINDOW / 2; k++)
+    {
+        x_twiddle[2 * k] = cosf(2.0f * (float)M_PI * k / VIBRATION_WINDOW);
+        x_twiddle[2 * k + 1] = -sinf(2.0f * (float)M_PI * k / VIBRATION_WINDOW);
+    }
+#endif
+
+    x_hann_power = 0;
+    for(int i = 0; i < VIBRATION_WINDOW; i++)
+    {
+        x_hann[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / VIBRATION_WINDOW);
+        x_hann_power += x_hann[i] * x_hann[i];
+    }
+
+    x_tables_ready = true;
+    return ESP_OK;
+}
+
+//in place complex FFT of VIBRATION_WINDOW points, output in natural order
+static void vibration_fft(float *data)
+{
+#if VIBRATION_ESP_DSP
+    dsps_fft2r_fc32(data, VIBRATION_WINDOW);
+    dsps_bit_rev_fc32(data, VIBRATION_WINDOW);
+#else
+    const int n = VIBRATION_WINDOW;
+
+    for(int i = 1, j = 0; i < n; i++)
+    {
+        int bit = n >> 1;
+        for(; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+
+        if(i < j)
+        {
+            float re = data[2 * i], im = data[2 * i + 1];
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j] = re;
+            data[2 * j + 1] = im;
+        }
+    }
+
+    for(int len = 2; len <= n; len <<= 1)
+    {
+        int step = n / len;
+        for(int i = 0; i < n; i += len)
+        {
+            for(int k = 0; k < len / 2; k++)
+            {
+                float wr = x_twiddle[2 * k * step], wi = x_twiddle[2 * k * step + 1];
+                float *a = &data[2 * (i + k)], *b = &data[2 * (i + k + len / 2)];
+                float tr = b[0] * wr - b[1] * wi;
+                float ti = b[0] * wi + b[1] * wr;
+
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+#endif
+}
+
+/**
+ * @name vibration_analyze
+ *
+ * @brief splits one window of acceleration into band energies. Takes the mean out, applies a Hann window and runs the FFT.
+ *
+ * @param samples VIBRATION_WINDOW samples in m/s^2, oldest first
+ * @param rate_hz rate the samples were taken at
+ * @param features filled with the band RMS values and the cycles the analysis took
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t vibration_analyze(const float *samples, float rate_hz, vibration_features_t *features)
+{
+    esp_cpu_cycle_count_t cycles = esp_cpu_get_cycle_count();
+    float mean = 0, road = 0, engine = 0, total = 0, peak = 0;
+    float bin_hz = rate_hz / VIBRATION_WINDOW;
+    esp_err_t err;
+
+    if(rate_hz <= 0)
+        return ESP_ERR_INVALID_ARG;
+
+    if((err = vibration_tables_init()) != ESP_OK)
+        return err;
+
+    for(int i = 0; i < VIBRATION_WINDOW; i++)
+        mean += samples[i];
+    mean /= VIBRATION_WINDOW;
+
+    for(int i = 0; i < VIBRATION_WINDOW; i++)
+    {
+        x_fft[2 * i] = (samples[i] - mean) * x_hann[i];
+        x_fft[2 * i + 1] = 0;
+    }
+
+    vibration_fft(x_fft);
+
+    //one sided, bin 0 is the mean that was taken out
+    features->peak_hz = 0;
+    for(int k = 1; k < VIBRATION_WINDOW / 2; k++)
+    {
+        float power = x_fft[2 * k] * x_fft[2 * k] + x_fft[2 * k + 1] * x_fft[2 * k + 1];
+        float hz = k * bin_hz;
+
+        total += power;
+        if(hz >= VIBRATION_ROAD_LO_HZ && hz < VIBRATION_ROAD_HI_HZ)
+            road += power;
+        else if(hz >= VIBRATION_ENGINE_LO_HZ && hz < VIBRATION_ENGINE_HI_HZ)
+            engine += power;
+
+        if(hz >= VIBRATION_ROAD_LO_HZ && power > peak)
+        {
+            peak = power;
+            features->peak_hz = hz;
+        }
+    }
+
+    //Parseval, a one sided bin holds half of a sine's energy and the window takes x_hann_power / N of it
+    float scale = 2.0f / (VIBRATION_WINDOW * x_hann_power);
+    features->road_rms = sqrtf(road * scale);
+    features->engine_rms = sqrtf(engine * scale);
+    features->total_rms = sqrtf(total * scale);
+    features->cycles = esp_cpu_get_cycle_count() - cycles;
+
+    return ESP_OK;
+}
+
+/**
+ * @name vibration_cutoff_scale
+ *
+ * @brief how far to bring the tilt filter cutoff down for the road under the car. Smooth roads keep the configured cutoff,
+ * past VIBRATION_ROUGH_RMS it comes down in proportion so the angle stays as steady as on a smooth road.
+ *
+ * @param features window to go by
+ *
+ * @return share of the configured cutoff to use, VIBRATION_MIN_CUTOFF_SCALE - 1
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+float vibration_cutoff_scale(const vibration_features_t *features)
+{
+    if(features->road_rms <= VIBRATION_ROUGH_RMS)
+        return 1.0f;
+
+    float scale = VIBRATION_ROUGH_RMS / features->road_rms;
+    return scale < VIBRATION_MIN_CUTOFF_SCALE ? VIBRATION_MIN_CUTOFF_SCALE : scale;
+}
+
+static void vibration_task_entry(void *arg)
+{
+    TickType_t wake = xTaskGetTickCount();
+    TickType_t period = pdMS_TO_TICKS(1000 / x_vibration.rate_hz);
+    vibration_features_t features;
+    bno055_vec3_t lin_accel;
+    uint32_t fill = 0;
+
+    while(true)
+    {
+        vTaskDelayUntil(&wake, period);
+
+        //vertical in the car's frame, the IMU is remapped by the mount. Road and engine both come through the body as bounce.
+        if(bno055_get_lin_accel(x_vibration.i2c_num, &lin_accel) != ESP_OK)
+        {
+            portENTER_CRITICAL(&x_vibration.lock);
+            x_vibration.stats.read_failures++;
+            portEXIT_CRITICAL(&x_vibration.lock);
+            continue;
+        }
+
+        x_vibration.samples[fill++] = lin_accel.z;
+        if(fill < VIBRATION_WINDOW)
+            continue;
+        fill = 0;
+
+        if(vibration_analyze(x_vibration.samples, x_vibration.rate_hz, &features) != ESP_OK)
+            continue;
+        features.time_us = esp_timer_get_time();
+
+        portENTER_CRITICAL(&x_vibration.lock);
+        features.window = ++x_vibration.stats.windows;
+        x_vibration.stats.total_cycles += features.cycles;
+        if(features.cycles > x_vibration.stats.max_cycles)
+            x_vibration.stats.max_cycles = features.cycles;
+        if(x_vibration.stats.budget_cycles && features.cycles > x_vibration.stats.budget_cycles)
+            x_vibration.stats.over_budget++;
+        x_vibration.latest = features;
+        x_vibration.has_latest = true;
+        portEXIT_CRITICAL(&x_vibration.lock);
+
+        if(x_vibration.stats.budget_cycles && features.cycles > x_vibration.stats.budget_cycles)
+            ESP_LOGW(VIBRATION_TAG, "window %lu took %lu cycles, budget is %lu", (unsigned long)features.window,
+                     (unsigned long)features.cycles, (unsigned long)x_vibration.stats.budget_cycles);
+
+        vibration_log(&features);
+    }
+}
+
+/**
+ * @name vibration_start
+ *
+ * @brief samples linear acceleration in the background and analyses every VIBRATION_WINDOW samples. Needs the IMU in a
+ * fusion mode, AMG has no linear acceleration.
+ *
+ * @param i2c_num IMU to read
+ * @param rate_hz samples per second, 1 - VIBRATION_MAX_RATE_HZ and no faster than the FreeRTOS tick
+ * @param budget_cycles CPU cycles a window is allowed, windows over it are counted and warned about. 0 for no budget.
+ *
+ * @return esp_err_t
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t vibration_start(i2c_number_t i2c_num, uint32_t rate_hz, uint32_t budget_cycles)
+{
+    bno055_opmode_t mode;
+    esp_err_t err;
+
+    if(x_vibration.running)
+        return ESP_ERR_INVALID_STATE;
+    if(rate_hz == 0 || rate_hz > VIBRATION_MAX_RATE_HZ || pdMS_TO_TICKS(1000 / rate_hz) == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    if((err = bno055_get_opmode(i2c_num, &mode)) != ESP_OK)
+    {
+        ESP_LOGD(VIBRATION_TAG, "vibration_start(): bno055_get_opmode returned %s", esp_err_to_name(err));
+        return err;
+    }
+    if(mode < OPERATION_MODE_IMUPLUS)
+        return BNO_ERR_WRONG_OPMODE;
+
+    if((err = vibration_tables_init()) != ESP_OK)
+        return err;
+
+    memset(&x_vibration.stats, 0, sizeof(vibration_stats_t));
+    x_vibration.stats.budget_cycles = budget_cycles;
+    x_vibration.i2c_num = i2c_num;
+    x_vibration.rate_hz = rate_hz;
+    x_vibration.has_latest = false;
+
+    if(xTaskCreate(vibration_task_entry, "vibration", VIBRATION_TASK_STACK_SIZE, NULL, VIBRATION_TASK_PRIORITY, &x_vibration.task) != pdPASS)
+    {
+        ESP_LOGD(VIBRATION_TAG, "vibration_start(): xTaskCreate failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    x_vibration.running = true;
+    ESP_LOGI(VIBRATION_TAG, "%lu point %s FFT every %.2f s \n", (unsigned long)VIBRATION_WINDOW,
+             VIBRATION_ESP_DSP ? "esp-dsp" : "scalar", (float)VIBRATION_WINDOW / rate_hz);
+
+    return ESP_OK;
+}
+
+esp_err_t vibration_get_latest(vibration_features_t *features)
+{
+    esp_err_t err = ESP_OK;
+
+    portENTER_CRITICAL(&x_vibration.lock);
+    if(x_vibration.has_latest)
+        *features = x_vibration.latest;
+    else
+        err = ESP_ERR_INVALID_STATE;
+    portEXIT_CRITICAL(&x_vibration.lock);
+
+    return err;
+}
+
+esp_err_t vibration_get_stats(vibration_stats_t *stats)
+{
+    portENTER_CRITICAL(&x_vibration.lock);
+    *stats = x_vibration.stats;
+    portEXIT_CRITICAL(&x_vibration.lock);
+
+    return ESP_OK;
+}
+
+/**
+ * @name vibration_log
+ *
+ * @brief writes the features of a window to the trip log
+ *
+ * @param features window to log
+ *
+ * @return err variable from triplog_append()
+ *
+ * @authors Ryan Leahy
+ * @date 10/17/2026
+*/
+esp_err_t vibration_log(const vibration_features_t *features)
+{
+    triplog_record_t record;
+
+    memset(&record, 0, sizeof(record));
+    record.timestamp_ms = (uint32_t)(features->time_us / 1000);
+    record.type = TRIPLOG_RECORD_VIBRATION;
+    record.payload.vibration.road_rms = features->road_rms;
+    record.payload.vibration.engine_rms = features->engine_rms;
+    record.payload.vibration.peak_chz = features->peak_hz * 100 > UINT16_MAX ? UINT16_MAX : (uint16_t)(features->peak_hz * 100);
+    record.payload.vibration.cycles = features->cycles;
+
+    return triplog_append(&record);
+}
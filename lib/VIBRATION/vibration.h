@@ -0,0 +1,55 @@
+#ifndef VIBRATION_H
+#define VIBRATION_H
+
+#include "esp_types.h"
+#include "esp_err.h"
+
+#include "bno055.h"
+
+static const char* VIBRATION_TAG = "Vibration";
+
+#define VIBRATION_WINDOW (128) //samples per FFT, a power of 2. 1.28 s at 100 Hz, 0.78 Hz per bin
+#define VIBRATION_MAX_RATE_HZ (100) //linear acceleration only updates at 100 Hz in the fusion modes
+#define VIBRATION_TASK_STACK_SIZE (3072)
+#define VIBRATION_TASK_PRIORITY (1) //same as app_main, so a window being analysed shares the core with the loop instead of holding it up
+
+//bands the spectrum is split into, Hz. Body and wheel motion from the road sits low, engine firing above it.
+#define VIBRATION_ROAD_LO_HZ (1.0f)
+#define VIBRATION_ROAD_HI_HZ (15.0f)
+#define VIBRATION_ENGINE_LO_HZ (15.0f)
+#define VIBRATION_ENGINE_HI_HZ (50.0f)
+
+#define VIBRATION_ROUGH_RMS (0.5f) //road band RMS in m/s^2 where the tilt filter cutoff starts coming down
+#define VIBRATION_MIN_CUTOFF_SCALE (0.25f) //lowest the cutoff is taken, as a share of the configured cutoff
+
+/**
+ * @brief what one window of linear acceleration looked like. RMS values are m/s^2 over the band, the window's mean taken out.
+*/
+typedef struct {
+    uint32_t window; //windows analysed since vibration_start()
+    int64_t time_us; //end of the window
+    float road_rms;
+    float engine_rms;
+    float total_rms;
+    float peak_hz; //strongest bin above VIBRATION_ROAD_LO_HZ
+    uint32_t cycles; //CPU cycles the analysis of this window took
+} vibration_features_t;
+
+typedef struct {
+    uint32_t windows;
+    uint32_t read_failures;
+    uint32_t over_budget; //windows that took more than the cycle budget
+    uint32_t budget_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+} vibration_stats_t;
+
+esp_err_t vibration_analyze(const float *, float, vibration_features_t *);
+     float vibration_cutoff_scale(const vibration_features_t *);
+
+esp_err_t vibration_start(i2c_number_t, uint32_t, uint32_t);
+esp_err_t vibration_get_latest(vibration_features_t *);
+esp_err_t vibration_get_stats(vibration_stats_t *);
+esp_err_t vibration_log(const vibration_features_t *);
+
+#endif //VIBRATION_H
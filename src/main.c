@@ -32,14 +32,39 @@ void app_main()
     esp_err_t err;
 
     //Application specific variables
-    bno055_vec3_t angle;
+    bno055_vec3_t angle = {0};
     float speed = 0;
+    float current_speed = 0;
     bool led_on = false;
     bool is_led_on = false;
     int led_on_val = 0;
 
     //Device specific variables
     i2c_number_t i2c_num = I2C_NUMBER_0; //I2C number for the BNO055 IMU
+    i2c_number_t i2c_num_b = I2C_NUMBER_MAX; //second BNO055 when dual_imu is set
+    bool imu_parallel = dual_imu_sda_gpio >= 0 && dual_imu_scl_gpio >= 0; //second BNO055 on its own port, the two are read at the same time
+    imupair_t imu_pair; //reads one or both IMUs as one sensor
+    mount_t mount; //placement of the board and its level reference
+    imufilter_t tilt; //filter between the IMU and the decision
+    bool mcu_fusion = false; //angle comes from the filter on the ESP instead of the BNO055
+    bool vibration = false; //road roughness analyzer is running and steers the tilt filter cutoff
+    vibration_features_t road = {0};
+    predict_params_t predict_params; //extrapolates the tilt so the warning comes on before the angle gets there
+    predict_state_t predict_state = {0};
+    decision_axes_params_t axes_params; //separate pitch and roll limits, used instead of threshold_angle with axis_limits
+    decision_axes_state_t axes_state = {0};
+    decision_params_t params; //combined angle limits, the geofence zone's inside one and parameters.h outside
+    bool zones = false; //geofence is loaded and switches the limits
+    geofence_zone_t zone;
+    uint16_t zone_id = GEOFENCE_NO_ZONE; //zone the limits in use belong to
+    bno055_vec3_t decided; //angle the decision is made on, the predicted one with prediction on
+    cadence_t cadence; //picks the loop delay from how close the tilt is to the threshold
+    bool adaptive = false;
+    bool track = false; //pitch and roll are turned into the direction of travel once the heading offset is known
+    uint32_t delay_ms = loop_delay_ms;
+    uint32_t trip_report_ms = 0; //last time the trip totals were printed and logged
+    bool trace_exported = false; //trace_mode rings have been printed, recording is off from then on
+    uint8_t led_outputs = led_pwm_output ? LED_OUTPUT_PWM : 0; //outputs the LED timer flashes
     nmea_parser_handle_t nmea_handle; //used to interact with the event handle for the NMEA.
     adc_oneshot_unit_handle_t adc_handle; //used to grab data from ADC for photoresistor
     adc_cali_handle_t adc_calibration_handle; //used to calibrate the ADC so the difference between chips is mitigated
@@ -53,15 +78,162 @@ void app_main()
 
     if((BNO055_init(&i2c_num)) != ESP_OK)
         goto end_prog;
+
+    //the second IMU is only there to cross check the first, keep running on one if it doesn't come up
+    if(dual_imu)
+    {
+        bno055_config_t bno_conf_b;
+        bno055_set_default_conf(&bno_conf_b);
+        if(imu_parallel) //own port, read by the pair's worker task while main reads the first
+        {
+            bno_conf_b.i2c_port = I2C_NUM_1;
+            bno_conf_b.sda_io_num = dual_imu_sda_gpio;
+            bno_conf_b.scl_io_num = dual_imu_scl_gpio;
+        }
+        else
+            bno_conf_b.i2c_address = BNO055_ADDRESS_B;
+
+        if((err = BNO055_init_conf(I2C_NUMBER_1, &bno_conf_b)) == ESP_OK)
+            i2c_num_b = I2C_NUMBER_1;
+        else
+            ESP_LOGW(BNO055_TAG, "BNO055_init_conf() returned %s for the second IMU, running on one", esp_err_to_name(err));
+    }
+
+    decision_default_params(&params);
+    decision_default_predict_params(&predict_params);
+    decision_default_axes_params(&axes_params);
+
+    //the heading comes from the magnetometer, which only the BNO055's own fusion uses
+    if(track_frame && mcu_fusion_rate_hz == 0 && heading_init(heading_budget_cycles) == ESP_OK)
+        track = true;
+
+    //fixes reach the estimator from the NMEA handler once it is running, until then nothing is taken off the pitch
+    if(slope_compensation)
+        slope_init(slope_budget_cycles);
+
+    //the loop runs at loop_delay_ms when level and still and speeds up to loop_min_delay_ms near the threshold
+    if(loop_min_delay_ms > 0)
+    {
+        cadence_params_t cadence_params = {
+            .min_delay_ms = loop_min_delay_ms,
+            .max_delay_ms = loop_delay_ms,
+            .near_deg = cadence_near_deg,
+            .far_deg = cadence_far_deg,
+            .motion_dps = cadence_motion_dps,
+            .avoid_period_ms = LED_ALARM_PERIOD_MS,
+            .tick_ms = portTICK_PERIOD_MS,
+        };
+
+        if((err = cadence_init(&cadence, &cadence_params)) == ESP_OK)
+            adaptive = true;
+        else
+            ESP_LOGW(CADENCE_TAG, "cadence_init() returned %s, running the loop at loop_delay_ms", esp_err_to_name(err));
+    }
+
+    imupair_init(&imu_pair, i2c_num, i2c_num_b, imu_parallel, imu_agree_deg);
+
+    //without a level reference the board is taken to be bolted in level
+    if((err = mount_init(&mount, mount_placement)) != ESP_OK)
+        ESP_LOGW(MOUNT_TAG, "mount_init() returned %s, running without a level reference", esp_err_to_name(err));
+
+    if((err = mount_remap_imu(&mount, i2c_num)) != ESP_OK)
+        ESP_LOGW(MOUNT_TAG, "mount_remap_imu() returned %s", esp_err_to_name(err));
+
+    if(i2c_num_b != I2C_NUMBER_MAX && (err = mount_remap_imu(&mount, i2c_num_b)) != ESP_OK)
+        ESP_LOGW(MOUNT_TAG, "mount_remap_imu() returned %s for the second IMU", esp_err_to_name(err));
+
+    if(capture_level_reference && (err = mount_capture_reference(&mount, i2c_num)) != ESP_OK)
+        ESP_LOGW(MOUNT_TAG, "mount_capture_reference() returned %s", esp_err_to_name(err));
+
+    //the filter runs at the rate the angle is produced, in the fusion task with mcu fusion and once a loop without
+    float tilt_sample_hz = mcu_fusion_rate_hz > 0 ? mcu_fusion_rate_hz : 1000.0f / loop_delay_ms;
+    float tilt_cutoff_hz = tilt_filter_cutoff_hz;
+    if((err = imufilter_init(&tilt, tilt_filter, tilt_sample_hz, tilt_cutoff_hz, tilt_filter_median)) != ESP_OK)
+    {
+        ESP_LOGW(IMUFILTER_TAG, "imufilter_init() returned %s, running without the tilt filter", esp_err_to_name(err));
+        imufilter_init(&tilt, IMUFILTER_NONE, 0, 0, 0);
+    }
+
+    //after the capture, the level reference needs the BNO055 in a fusion mode
+    if(mcu_fusion_rate_hz > 0)
+    {
+        if(tilt.type != IMUFILTER_NONE)
+            fusion_set_filter(&tilt);
+
+        if((err = fusion_start(i2c_num, mcu_fusion_mahony ? FUSION_MAHONY : FUSION_MADGWICK, mcu_fusion_rate_hz)) == ESP_OK)
+            mcu_fusion = true;
+        else
+            ESP_LOGW(FUSION_TAG, "fusion_start() returned %s, staying on the BNO055 fusion", esp_err_to_name(err));
+    }
+    
+    //the analyzer reads linear acceleration, which the BNO055 only has in its own fusion modes
+    if(vibration_rate_hz > 0 && !mcu_fusion)
+    {
+        if((err = vibration_start(i2c_num, vibration_rate_hz, vibration_budget_cycles)) == ESP_OK)
+            vibration = true;
+        else
+            ESP_LOGW(VIBRATION_TAG, "vibration_start() returned %s, running without the analyzer", esp_err_to_name(err));
+    }
     
+    //has to be up before the NMEA handler starts handing it fixes
+    if((err = timebase_init(pps_gpio)) != ESP_OK)
+        ESP_LOGW(TIMEBASE_TAG, "timebase_init() returned %s, samples won't carry GPS time", esp_err_to_name(err));
+
+    //totals carry on from RTC memory after sleep or a reset, a power cut starts a new trip
+    if((err = tripstats_init(tripstats_moving_speed)) != ESP_OK)
+        ESP_LOGW(TRIPSTATS_TAG, "tripstats_init() returned %s, running without the trip totals", esp_err_to_name(err));
+
+    //same goes for the geofence, its zone is looked up on every fix
+    if(geofence_zones)
+    {
+        if((err = geofence_init()) == ESP_OK)
+            zones = true;
+        else
+            ESP_LOGW(GEOFENCE_TAG, "geofence_init() returned %s, using the limits in parameters.h everywhere", esp_err_to_name(err));
+    }
+
     if((M20048_init(&nmea_handle, &speed)) != ESP_OK)
         goto end_prog;
 
     if((photoresist_init(&adc_handle, &adc_calibration_handle)) != ESP_OK)
         goto end_prog;
 
-    if((led_init(&led_timer_handle, &event_handler_args)) != ESP_OK)
+    //the strip is an extra output, the single LED still warns without it
+    if(led_strip_gpio >= 0)
+    {
+        if((err = ledstrip_init(led_strip_gpio, led_strip_pixels)) == ESP_OK)
+            led_outputs |= LED_OUTPUT_STRIP;
+        else
+            ESP_LOGW(LEDSTRIP_TAG, "ledstrip_init() returned %s, running without the LED strip", esp_err_to_name(err));
+    }
+
+    if((led_init(&led_timer_handle, &event_handler_args, led_outputs)) != ESP_OK)
         goto end_prog;
+
+    //the trip log is only there for looking at incidents after the fact, keep running without it
+    if((err = triplog_init()) != ESP_OK)
+        ESP_LOGW(TRIPLOG_TAG, "triplog_init() returned %s, running without a trip log", esp_err_to_name(err));
+    else if(triplog_pack_imu && (err = triplog_set_imu_packing(true)) != ESP_OK)
+        ESP_LOGW(TRIPLOG_TAG, "triplog_set_imu_packing() returned %s, logging IMU samples one per record", esp_err_to_name(err));
+
+    //capture mode adds the LED timer alarms to the log so a session can be replayed with replay_run_triplog()
+    replay_capture_enable(capture_mode);
+
+    //prints task, stack and heap figures every health_period_ms and adds them to the trip log
+    if((err = health_init(health_period_ms)) != ESP_OK)
+        ESP_LOGW(HEALTH_TAG, "health_init() returned %s, running without the health sampler", esp_err_to_name(err));
+
+    //trace mode keeps the last few hundred stage timings per core in RAM, see trace.h
+    trace_enable(trace_mode);
+
+    if(trace_mode)
+    {
+        imufilter_bench_t bench;
+        imufilter_bench(IMUFILTER_BENCH_LEN, &bench);
+
+        ledstrip_bench_t strip_bench;
+        ledstrip_bench(led_outputs & LED_OUTPUT_STRIP ? led_strip_pixels : LEDSTRIP_MAX_PIXELS, &strip_bench);
+    }
     
     /**
      * 
@@ -85,13 +257,131 @@ void app_main()
 
 
        //PROD CODE
+       trace_begin(TRACE_MAIN_LOOP, 0);
        if(is_led_on == false) //ensure that the ambient light reading is only read when the led is off to ensure no feedback occurs
-        led_on_val = raw_ADC_to_LED_val(photoresist_read(adc_handle, adc_calibration_handle));
+       {
+        trace_begin(TRACE_LIGHT_READ, 0);
+        int64_t light_us = esp_timer_get_time();
+        int light_mv = photoresist_read(adc_handle, adc_calibration_handle);
+        trace_end(TRACE_LIGHT_READ, light_mv);
+        led_on_val = raw_ADC_to_LED_val(light_mv);
+        triplog_log_light(light_mv, led_on_val, timebase_stamp(light_us));
+       }
+
+       int64_t imu_us = esp_timer_get_time(); //samples are stamped when they are read, GPS time is worked out from it
+       if(mcu_fusion)
+        fusion_get_latest(&angle, &imu_us); //level until the first update, the BNO055 has no euler output in AMG
+       else
+       {
+        imupair_get_euler(&imu_pair, &angle, NULL);
 
-       bno055_get_euler(i2c_num, &angle);
-       led_on = is_out_of_level(&angle, &speed);
+        //rougher road, lower cutoff. Only moved when a new window is in, it keeps the delay line either way.
+        vibration_features_t latest;
+        if(vibration && tilt.type == IMUFILTER_BIQUAD && vibration_get_latest(&latest) == ESP_OK && latest.window != road.window)
+        {
+            road = latest;
+            tilt_cutoff_hz = tilt_filter_cutoff_hz * vibration_cutoff_scale(&road);
+            imufilter_set_cutoff(&tilt, tilt_sample_hz, tilt_cutoff_hz);
+        }
+        imufilter_apply(&tilt, &angle);
+       }
+       //the filter and the MCU fusion come out between steps, rounded the way the log keeps a sample so replay decides on the same angle
+       angle.x = lround(angle.x * 16.0) / 16.0;
+       angle.y = lround(angle.y * 16.0) / 16.0;
+       angle.z = lround(angle.z * 16.0) / 16.0;
+       mount_apply(&mount, &angle);
+       current_speed = speed; //speed is written by the NMEA task, take one copy so the log holds exactly what the decision saw
+       uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+       //inside a zone its limits replace the ones in parameters.h, the switch is logged ahead of the first decision made with them
+       if(zones && geofence_get_active(&zone) == ESP_OK && zone.id != zone_id)
+       {
+        decision_default_params(&params);
+        decision_default_axes_params(&axes_params);
+        if(zone.id != GEOFENCE_NO_ZONE)
+            geofence_apply_zone(&zone, &params, &axes_params);
+        decision_set_params(&params);
+        zone_id = zone.id;
+        geofence_log(&zone);
+       }
+
+       uint8_t decision_flags = 0;
+       float grade = 0;
+       float track_offset = 0;
+       decided = angle;
+
+       //grade along the direction of travel and lean across it, the offset rounded the way the log keeps it so replay turns the angle the same
+       if(track && heading_update(&angle, now_ms, &track_offset))
+       {
+        track_offset = lround(track_offset * 16.0) / 16.0;
+        heading_rotate(&angle, track_offset, &decided);
+        decision_flags |= TRIPLOG_FLAG_TRACK;
+       }
+
+       //on a known hill the decision looks at the lean alone, rounded the way the log keeps it so replay takes off the same grade
+       if(slope_compensation && slope_update(decided.x, current_speed, now_ms, &grade))
+       {
+        grade = lround(grade * 16.0) / 16.0;
+        decided.x -= grade;
+        decision_flags |= TRIPLOG_FLAG_GRADE;
+       }
+
+       if(axis_limits)
+       {
+        led_on = decision_axes_step(&axes_state, &axes_params, &decided, current_speed, now_ms);
+        decision_flags |= TRIPLOG_FLAG_AXES;
+       }
+       else
+       {
+        if(predict_params.horizon_ms > 0)
+        {
+         bno055_vec3_t lean = decided;
+         decision_predict(&predict_state, &predict_params, &lean, now_ms, &decided);
+         decision_flags |= TRIPLOG_FLAG_PREDICTED;
+        }
+        led_on = is_out_of_level(&decided, &current_speed);
+       }
+       triplog_log_imu(&angle, timebase_stamp(imu_us));
+       triplog_log_decision_at(now_ms, led_on, decision_combined_angle(&decided), current_speed, grade, track_offset, decision_flags);
+       tripstats_decision(decision_combined_angle(&decided), params.threshold_angle, led_on, now_ms);
+
+       //colour by how far over the limit and an arrow towards the low side, shown on the strip's next lit alarm
+       if(led_outputs & LED_OUTPUT_STRIP)
+        ledstrip_set_state(decision_combined_angle(&decided) - params.threshold_angle >= led_strip_severe_deg ? LEDSTRIP_SEVERE : LEDSTRIP_WARN,
+                           decided.y > led_strip_lean_deg ? LEDSTRIP_LEAN_RIGHT : decided.y < -led_strip_lean_deg ? LEDSTRIP_LEAN_LEFT : LEDSTRIP_LEAN_NONE);
+
+       tripstats_t trip;
+       if(tripstats_period_ms > 0 && now_ms - trip_report_ms >= tripstats_period_ms && tripstats_get(&trip) == ESP_OK)
+       {
+        tripstats_print(&trip);
+        tripstats_log(&trip);
+        trip_report_ms = now_ms;
+       }
+       replay_capture_drain();
+
+       //stopped first so nothing lands in the rings while they are read, the print takes a while at the console's baud rate
+       if(trace_mode && !trace_exported && now_ms >= trace_export_ms)
+       {
+        trace_enable(false);
+        if((err = trace_export_chrome(trace_write_console, NULL)) != ESP_OK)
+            ESP_LOGW(TRACE_TAG, "trace_export_chrome() returned %s", esp_err_to_name(err));
+        trace_exported = true;
+       }
        ESP_LOGI(TAG, "Angle x = %f  y = %f Speed: %f LED on value: %i", angle.x, angle.y, speed, led_on_val);
-       vTaskDelay(600/ portTICK_PERIOD_MS); //Ensure that the delay value is not divisible by the alarm clock value in led.c or you'll introduce feedback to the photocell from the LED.
+       trace_end(TRACE_MAIN_LOOP, led_on);
+
+       if(adaptive)
+       {
+        delay_ms = cadence_next(&cadence, decision_combined_angle(&decided), params.threshold_angle);
+
+        //the biquad is designed for the spacing of its samples, move it with the loop so the cutoff stays put
+        if(!mcu_fusion && tilt.type == IMUFILTER_BIQUAD && 1000.0f / delay_ms != tilt_sample_hz)
+        {
+            tilt_sample_hz = 1000.0f / delay_ms;
+            imufilter_set_cutoff(&tilt, tilt_sample_hz, tilt_cutoff_hz);
+        }
+       }
+       vTaskDelay(delay_ms/ portTICK_PERIOD_MS); //Ensure that the delay value is not divisible by the alarm clock value in led.c or you'll introduce feedback to the photocell from the LED.
     }
 
     /**
@@ -100,9 +390,18 @@ void app_main()
      * 
     */
 end_prog:
+    err = triplog_close();
+    ESP_LOGI(TRIPLOG_TAG, "triplog_close() returned %s \n", esp_err_to_name(err));
+
     err = bno055_close(i2c_num);
     ESP_LOGI(BNO055_TAG, "bno055_close() returned %s \n", esp_err_to_name(err));
 
+    if(i2c_num_b != I2C_NUMBER_MAX)
+    {
+        err = bno055_close(i2c_num_b);
+        ESP_LOGI(BNO055_TAG, "bno055_close() returned %s for the second IMU \n", esp_err_to_name(err));
+    }
+
     err = nmea_parser_remove_handler(nmea_handle, M20048_event_handler);
     ESP_LOGI(M20048_TAG, "nmea_parser_remove_handler() returned %s \n", esp_err_to_name(err));
 
@@ -115,83 +414,12 @@ end_prog:
     err = led_deinit(led_timer_handle);
     ESP_LOGI(LED_TAG, "led_deinit() returned %s \n", esp_err_to_name(err));
 
+    if(led_outputs & LED_OUTPUT_STRIP)
+    {
+        err = ledstrip_deinit();
+        ESP_LOGI(LEDSTRIP_TAG, "ledstrip_deinit() returned %s \n", esp_err_to_name(err));
+    }
+
     ESP_LOGI(TAG, "Finished\n");
  
 }
-
-/**
- * @name raw_ADC_to_percent
- * 
- * @brief function takes in a calibrated ADC voltage reading and converts it to a int value between 0 - 1023
- * 
- * @param raw_ADC_reading integer value with a range of 150 - 2450 (most liekly) pulled from the ADC and calibrated
- * 
- * @return int value with a range of 0 - 1023
- * 
- * @authors Ryan Leahy
- * @date 02/28/2023
-*/
-int raw_ADC_to_LED_val(int raw_ADC_reading)
-{
-    //TODO: refine formula
-    float intermediate = (raw_ADC_reading - 500)/2598.0; //reduces the raw adc value range down to 0.0 - 1.0
-
-    if(intermediate > 1) //make sure that we can't get more than 1.0
-        intermediate = 1;
-    
-    if(intermediate < 0.1) //make sure we have a minimum on value of 10%
-        intermediate = 0.1;
-
-    return intermediate*1023; //scale it back up to 0 - 1023
-}
-
-/**
- * @name is_out_of_level
- * 
- * @brief function analyzes input values to determine if the device is out of level
- * 
- * @param angle bno055_vect3_t structure pointer holding the current angle data
- * @param speed float pointer holding the current speed data
- * 
- * @return bool indicating if the device is out of level
- * 
- * @authors Ryan Leahy
- * @date 02/28/2023
-*/
-bool is_out_of_level(bno055_vec3_t* angle, float* speed)
-{
-    static uint8_t state;
-    bool out_of_level = false;
-    float x = angle->x, y = angle->y;
-    float combined_angle = sqrt(pow(x, 2) + pow(y, 2));
-
-    //first time entering this function state will be initialized to 0
-    if(state == 0)
-        state = initial_state;
-
-    switch(state)
-    {
-        case initial_state: //nothing is on
-            if(combined_angle >= threshold_angle && (*speed >= lower_speed && *speed <= upper_speed)) //if the angle and speed are in the ranges, led turns on
-            {
-                state = threshold_angle_and_speed;
-                out_of_level = true;
-            }
-            else //if no state change occurs, keep led off
-                out_of_level = false;
-            break;
-        case threshold_angle_and_speed:
-            if(combined_angle < threshold_angle && (*speed < lower_speed && *speed > upper_speed)) //both the angle and speed need to return to normal to turn led off and return to initial state
-            {
-                state = initial_state;
-                out_of_level = false;
-            }
-            else //if no state change occurs, keep led on
-                out_of_level = true;
-            break;
-        default:
-            out_of_level = false;
-    }
-    
-    return out_of_level;
-}
\ No newline at end of file
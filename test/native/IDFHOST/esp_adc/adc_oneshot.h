@@ -0,0 +1,12 @@
+#pragma once
+#include "esp_err.h"
+typedef void* adc_oneshot_unit_handle_t;
+typedef enum { ADC_UNIT_1 } adc_unit_t; typedef enum { ADC_ULP_MODE_DISABLE } adc_ulp_mode_t;
+typedef enum { ADC_BITWIDTH_DEFAULT } adc_bitwidth_t; typedef enum { ADC_ATTEN_DB_11=3 } adc_atten_t;
+typedef enum { ADC_CHANNEL_0 } adc_channel_t;
+typedef struct { adc_unit_t unit_id; adc_ulp_mode_t ulp_mode; } adc_oneshot_unit_init_cfg_t;
+typedef struct { adc_atten_t atten; adc_bitwidth_t bitwidth; } adc_oneshot_chan_cfg_t;
+esp_err_t adc_oneshot_new_unit(const adc_oneshot_unit_init_cfg_t*, adc_oneshot_unit_handle_t*);
+esp_err_t adc_oneshot_config_channel(adc_oneshot_unit_handle_t, adc_channel_t, const adc_oneshot_chan_cfg_t*);
+esp_err_t adc_oneshot_read(adc_oneshot_unit_handle_t, adc_channel_t, int*);
+esp_err_t adc_oneshot_del_unit(adc_oneshot_unit_handle_t);
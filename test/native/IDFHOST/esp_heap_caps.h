@@ -0,0 +1,10 @@
+#pragma once
+#include <stddef.h>
+#define MALLOC_CAP_8BIT (1<<2)
+size_t heap_caps_get_free_size(unsigned caps);
+size_t heap_caps_get_minimum_free_size(unsigned caps);
+size_t heap_caps_get_largest_free_block(unsigned caps);
+#define MALLOC_CAP_DMA (1<<3)
+#define MALLOC_CAP_INTERNAL (1<<11)
+void *heap_caps_calloc(size_t, size_t, unsigned);
+void heap_caps_free(void*);
@@ -0,0 +1,10 @@
+#pragma once
+#include "esp_err.h"
+typedef enum {ESP_LOG_NONE,ESP_LOG_ERROR,ESP_LOG_WARN,ESP_LOG_INFO,ESP_LOG_DEBUG,ESP_LOG_VERBOSE} esp_log_level_t;
+void esp_log_level_set(const char*, esp_log_level_t);
+void esp_log_write(esp_log_level_t, const char*, const char*, ...) __attribute__((format(printf,3,4)));
+#define ESP_LOGE(t, ...) esp_log_write(ESP_LOG_ERROR,t,__VA_ARGS__)
+#define ESP_LOGW(t, ...) esp_log_write(ESP_LOG_WARN,t,__VA_ARGS__)
+#define ESP_LOGI(t, ...) esp_log_write(ESP_LOG_INFO,t,__VA_ARGS__)
+#define ESP_LOGD(t, ...) esp_log_write(ESP_LOG_DEBUG,t,__VA_ARGS__)
+#define ESP_LOGV(t, ...) esp_log_write(ESP_LOG_VERBOSE,t,__VA_ARGS__)
@@ -0,0 +1,13 @@
+#pragma once
+#include "esp_err.h"
+typedef enum { ESP_PARTITION_TYPE_APP=0, ESP_PARTITION_TYPE_DATA=1, ESP_PARTITION_TYPE_ANY=0xff } esp_partition_type_t;
+typedef enum { ESP_PARTITION_SUBTYPE_ANY=0xff } esp_partition_subtype_t;
+typedef struct { void* flash_chip; esp_partition_type_t type; esp_partition_subtype_t subtype; uint32_t address; uint32_t size; uint32_t erase_size; char label[17]; bool encrypted; } esp_partition_t;
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t, esp_partition_subtype_t, const char*);
+esp_err_t esp_partition_read(const esp_partition_t*, size_t, void*, size_t);
+esp_err_t esp_partition_write(const esp_partition_t*, size_t, const void*, size_t);
+esp_err_t esp_partition_erase_range(const esp_partition_t*, size_t, size_t);
+typedef uint32_t esp_partition_mmap_handle_t;
+typedef enum { ESP_PARTITION_MMAP_DATA, ESP_PARTITION_MMAP_INST } esp_partition_mmap_memory_t;
+esp_err_t esp_partition_mmap(const esp_partition_t*, size_t, size_t, esp_partition_mmap_memory_t, const void**, esp_partition_mmap_handle_t*);
+void esp_partition_munmap(esp_partition_mmap_handle_t);
@@ -0,0 +1,4 @@
+#pragma once
+#include "esp_err.h"
+typedef struct { int max_freq_mhz; int min_freq_mhz; bool light_sleep_enable; } esp_pm_config_esp32s3_t;
+esp_err_t esp_pm_configure(const void*);
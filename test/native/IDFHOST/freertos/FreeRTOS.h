@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+typedef uint32_t TickType_t; typedef int BaseType_t; typedef unsigned UBaseType_t;
+#define portTICK_PERIOD_MS 10
+#define pdMS_TO_TICKS(x) ((x)/10)
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffff
+typedef struct { int x; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portMUX_INITIALIZE(m) ((m)->x = 0)
+void vPortEnterCritical(portMUX_TYPE*); void vPortExitCritical(portMUX_TYPE*);
+#define portENTER_CRITICAL(m) vPortEnterCritical(m)
+#define portEXIT_CRITICAL(m) vPortExitCritical(m)
+#define portENTER_CRITICAL_ISR(m) vPortEnterCritical(m)
+#define portEXIT_CRITICAL_ISR(m) vPortExitCritical(m)
+#define IRAM_ATTR
+#define configMAX_TASK_NAME_LEN 16
+#define portNUM_PROCESSORS 2
+#define portYIELD_FROM_ISR(x) (void)(x)
+int xPortInIsrContext(void);
+int xPortGetCoreID(void);
@@ -0,0 +1,5 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+typedef void* QueueHandle_t;
+BaseType_t xQueueReceive(QueueHandle_t, void*, TickType_t);
+BaseType_t xQueueReset(QueueHandle_t);
@@ -0,0 +1,20 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+typedef void* TaskHandle_t; typedef void (*TaskFunction_t)(void*);
+void vTaskDelay(TickType_t); void vTaskDelete(TaskHandle_t);
+BaseType_t xTaskCreate(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t*);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t*, BaseType_t);
+TickType_t xTaskGetTickCount(void);
+void vTaskDelayUntil(TickType_t*, TickType_t);
+BaseType_t xTaskDelayUntil(TickType_t*, TickType_t);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+typedef enum {eRunning,eReady,eBlocked,eSuspended,eDeleted,eInvalid} eTaskState;
+typedef struct { TaskHandle_t xHandle; const char *pcTaskName; UBaseType_t xTaskNumber; eTaskState eCurrentState; UBaseType_t uxCurrentPriority; UBaseType_t uxBasePriority; uint32_t ulRunTimeCounter; void* pxStackBase; uint32_t usStackHighWaterMark; BaseType_t xCoreID; } TaskStatus_t;
+UBaseType_t uxTaskGetNumberOfTasks(void);
+UBaseType_t uxTaskGetSystemState(TaskStatus_t*, UBaseType_t, uint32_t*);
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t);
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t*);
+BaseType_t xTaskNotifyGive(TaskHandle_t);
+char *pcTaskGetName(TaskHandle_t);
+TaskHandle_t xTaskGetIdleTaskHandleForCPU(UBaseType_t);
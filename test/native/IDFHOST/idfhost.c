@@ -0,0 +1,506 @@
+//Just enough of ESP-IDF for the libraries to build and link on the host for `pio test -e native`. The logic under test
+//only needs the log, CRC, timer and lock calls, every peripheral driver here reports ESP_ERR_NOT_SUPPORTED except GPIO
+//interrupts, which idfhost_gpio_edge() fires, I2C, which talks to the register device in idfhost_i2c_bus(), and NVS, which is
+//kept in RAM until nvs_flash_erase(). Heap and task figures are whatever idfhost_set_heap() and idfhost_set_tasks() last set.
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "idfhost.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_rom_crc.h"
+#include "esp_rom_sys.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_event.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "driver/gpio.h"
+#include "driver/gptimer.h"
+#include "driver/i2c.h"
+#include "driver/ledc.h"
+#include "driver/rmt_tx.h"
+#include "driver/uart.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+static esp_log_level_t x_idfhost_log_level = ESP_LOG_NONE;
+static int64_t x_idfhost_time_us = -1;
+static gpio_isr_t x_idfhost_isr[64];
+static void *x_idfhost_isr_arg[64];
+static size_t x_idfhost_heap[3]; //free, minimum free, largest block
+static TaskStatus_t x_idfhost_tasks[32];
+static UBaseType_t x_idfhost_task_count;
+static uint32_t x_idfhost_run_time;
+static idfhost_i2c_bus_t x_idfhost_i2c;
+#define IDFHOST_NVS_SPACES (4)
+#define IDFHOST_NVS_ENTRIES (8)
+typedef struct {
+    nvs_handle_t handle; //0 for a free entry
+    char key[16];
+    uint8_t blob[64];
+    size_t len;
+} idfhost_nvs_entry_t;
+static char x_idfhost_nvs_spaces[IDFHOST_NVS_SPACES][16];
+static idfhost_nvs_entry_t x_idfhost_nvs[IDFHOST_NVS_ENTRIES];
+static uint32_t x_idfhost_holds; //times a recursive mutex went from free to taken
+static uint32_t x_idfhost_held;  //which of those is still going, 0 once it is given back
+
+void idfhost_set_time(int64_t us)
+{
+    x_idfhost_time_us = us;
+}
+
+void idfhost_set_heap(size_t free_bytes, size_t min_free, size_t largest_block)
+{
+    x_idfhost_heap[0] = free_bytes;
+    x_idfhost_heap[1] = min_free;
+    x_idfhost_heap[2] = largest_block;
+}
+
+void idfhost_set_tasks(const TaskStatus_t *tasks, UBaseType_t count, uint32_t total_run_time)
+{
+    x_idfhost_task_count = count > 32 ? 32 : count;
+    memcpy(x_idfhost_tasks, tasks, x_idfhost_task_count * sizeof(TaskStatus_t));
+    x_idfhost_task_count = count;
+    x_idfhost_run_time = total_run_time;
+}
+
+void idfhost_gpio_edge(gpio_num_t gpio)
+{
+    if(gpio >= 0 && gpio < 64 && x_idfhost_isr[gpio])
+        x_idfhost_isr[gpio](x_idfhost_isr_arg[gpio]);
+}
+
+const char *esp_err_to_name(esp_err_t err)
+{
+    static char name[16];
+
+    snprintf(name, sizeof(name), "0x%x", err);
+    return name;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    x_idfhost_log_level = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    va_list args;
+
+    if(level > x_idfhost_log_level)
+        return;
+    va_start(args, format);
+    printf("[%s] ", tag);
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    crc = ~crc;
+    while(len--)
+    {
+        crc ^= *buf++;
+        for(int i = 0; i < 8; i++)
+            crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    }
+    return ~crc;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+
+    if(x_idfhost_time_us >= 0)
+        return x_idfhost_time_us;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+//nanoseconds, the benches only compare cycle counts with each other
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (esp_cpu_cycle_count_t)(ts.tv_sec * 1000000000LL + ts.tv_nsec);
+}
+
+void esp_rom_delay_us(uint32_t us) {}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t handle, uint64_t period) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t esp_timer_stop(esp_timer_handle_t handle) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t esp_timer_delete(esp_timer_handle_t handle) { return ESP_ERR_NOT_SUPPORTED; }
+
+void *heap_caps_calloc(size_t n, size_t size, unsigned caps) { return calloc(n, size); }
+void heap_caps_free(void *ptr) { free(ptr); }
+size_t heap_caps_get_free_size(unsigned caps) { return x_idfhost_heap[0]; }
+size_t heap_caps_get_minimum_free_size(unsigned caps) { return x_idfhost_heap[1]; }
+size_t heap_caps_get_largest_free_block(unsigned caps) { return x_idfhost_heap[2]; }
+
+//no partition table, the trip log tests run on triplog_sim_init()
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label) { return NULL; }
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset, const void *src, size_t size) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t esp_partition_mmap(const esp_partition_t *part, size_t offset, size_t size, esp_partition_mmap_memory_t memory, const void **ptr, esp_partition_mmap_handle_t *handle) { return ESP_ERR_NOT_SUPPORTED; }
+void esp_partition_munmap(esp_partition_mmap_handle_t handle) {}
+
+esp_err_t esp_event_loop_create(const esp_event_loop_args_t *args, esp_event_loop_handle_t *loop) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t esp_event_loop_delete(esp_event_loop_handle_t loop) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t esp_event_loop_run(esp_event_loop_handle_t loop, TickType_t ticks) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t esp_event_post_to(esp_event_loop_handle_t loop, esp_event_base_t base, int32_t id, const void *data, size_t size, TickType_t ticks) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t esp_event_handler_register_with(esp_event_loop_handle_t loop, esp_event_base_t base, int32_t id, esp_event_handler_t handler, void *arg) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t esp_event_handler_unregister_with(esp_event_loop_handle_t loop, esp_event_base_t base, int32_t id, esp_event_handler_t handler) { return ESP_ERR_NOT_SUPPORTED; }
+
+esp_err_t nvs_flash_init(void) { return ESP_OK; }
+esp_err_t nvs_flash_erase(void)
+{
+    memset(x_idfhost_nvs_spaces, 0, sizeof(x_idfhost_nvs_spaces));
+    memset(x_idfhost_nvs, 0, sizeof(x_idfhost_nvs));
+    return ESP_OK;
+}
+//the handle is the namespace's slot + 1, a namespace only comes into being when it is opened for writing
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle)
+{
+    int free_slot = -1;
+
+    for(int i = 0; i < IDFHOST_NVS_SPACES; i++)
+    {
+        if(strcmp(x_idfhost_nvs_spaces[i], name) == 0)
+        {
+            *handle = i + 1;
+            return ESP_OK;
+        }
+        if(free_slot < 0 && x_idfhost_nvs_spaces[i][0] == '\0')
+            free_slot = i;
+    }
+    if(mode == NVS_READONLY)
+        return ESP_ERR_NVS_NOT_FOUND;
+    if(free_slot < 0)
+        return ESP_ERR_NO_MEM;
+    snprintf(x_idfhost_nvs_spaces[free_slot], sizeof(x_idfhost_nvs_spaces[free_slot]), "%s", name);
+    *handle = free_slot + 1;
+    return ESP_OK;
+}
+void nvs_close(nvs_handle_t handle) {}
+static idfhost_nvs_entry_t *idfhost_nvs_find(nvs_handle_t handle, const char *key)
+{
+    for(int i = 0; i < IDFHOST_NVS_ENTRIES; i++)
+        if(x_idfhost_nvs[i].handle == handle && strcmp(x_idfhost_nvs[i].key, key) == 0)
+            return &x_idfhost_nvs[i];
+    return NULL;
+}
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value, size_t *length)
+{
+    idfhost_nvs_entry_t *entry = idfhost_nvs_find(handle, key);
+
+    if(entry == NULL)
+        return ESP_ERR_NVS_NOT_FOUND;
+    if(value != NULL && *length < entry->len)
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    if(value != NULL)
+        memcpy(value, entry->blob, entry->len);
+    *length = entry->len;
+    return ESP_OK;
+}
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    idfhost_nvs_entry_t *entry = idfhost_nvs_find(handle, key);
+
+    if(length > sizeof(entry->blob))
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    if(entry == NULL && (entry = idfhost_nvs_find(0, "")) == NULL)
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    entry->handle = handle;
+    snprintf(entry->key, sizeof(entry->key), "%s", key);
+    memcpy(entry->blob, value, length);
+    entry->len = length;
+    return ESP_OK;
+}
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    idfhost_nvs_entry_t *entry = idfhost_nvs_find(handle, key);
+
+    if(entry == NULL)
+        return ESP_ERR_NVS_NOT_FOUND;
+    memset(entry, 0, sizeof(idfhost_nvs_entry_t));
+    return ESP_OK;
+}
+esp_err_t nvs_commit(nvs_handle_t handle) { return ESP_OK; }
+
+esp_err_t gpio_config(const gpio_config_t *config) { return config->mode == GPIO_MODE_INPUT ? ESP_OK : ESP_ERR_NOT_SUPPORTED; }
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level) { return ESP_ERR_NOT_SUPPORTED; }
+int gpio_get_level(gpio_num_t gpio) { return 1; }
+esp_err_t gpio_set_direction(gpio_num_t gpio, gpio_mode_t mode) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t gpio_install_isr_service(int flags) { return ESP_OK; }
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, gpio_isr_t handler, void *arg)
+{
+    if(gpio < 0 || gpio >= 64)
+        return ESP_ERR_INVALID_ARG;
+    x_idfhost_isr[gpio] = handler;
+    x_idfhost_isr_arg[gpio] = arg;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio)
+{
+    if(gpio < 0 || gpio >= 64)
+        return ESP_ERR_INVALID_ARG;
+    x_idfhost_isr[gpio] = NULL;
+    return ESP_OK;
+}
+esp_err_t gpio_reset_pin(gpio_num_t gpio) { return ESP_ERR_NOT_SUPPORTED; }
+
+esp_err_t gptimer_new_timer(const gptimer_config_t *config, gptimer_handle_t *timer) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t gptimer_del_timer(gptimer_handle_t timer) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t gptimer_set_alarm_action(gptimer_handle_t timer, const gptimer_alarm_config_t *config) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t gptimer_register_event_callbacks(gptimer_handle_t timer, const gptimer_event_callbacks_t *cbs, void *arg) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t gptimer_enable(gptimer_handle_t timer) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t gptimer_disable(gptimer_handle_t timer) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t gptimer_start(gptimer_handle_t timer) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t gptimer_stop(gptimer_handle_t timer) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t gptimer_get_raw_count(gptimer_handle_t timer, uint64_t *value) { return ESP_ERR_NOT_SUPPORTED; }
+
+//what i2c_cmd_link_create() hands out, the steps of one transaction in order
+#define IDFHOST_I2C_STEPS (8)
+typedef enum { IDFHOST_I2C_START, IDFHOST_I2C_STOP, IDFHOST_I2C_WRITE, IDFHOST_I2C_READ } idfhost_i2c_step_kind_t;
+typedef struct {
+    idfhost_i2c_step_kind_t kind;
+    uint8_t byte;            //a single byte write is copied, like the driver does
+    const uint8_t *src;
+    uint8_t *dst;
+    size_t len;
+} idfhost_i2c_step_t;
+typedef struct {
+    int n_steps;
+    idfhost_i2c_step_t steps[IDFHOST_I2C_STEPS];
+} idfhost_i2c_cmd_t;
+
+idfhost_i2c_bus_t *idfhost_i2c_bus(void)
+{
+    return &x_idfhost_i2c;
+}
+
+static esp_err_t idfhost_i2c_add(i2c_cmd_handle_t cmd, idfhost_i2c_step_t step)
+{
+    idfhost_i2c_cmd_t *c = cmd;
+
+    if(c == NULL || c->n_steps == IDFHOST_I2C_STEPS)
+        return ESP_ERR_NO_MEM;
+    c->steps[c->n_steps++] = step;
+    return ESP_OK;
+}
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t *config)
+{
+    if(port < 0 || port >= I2C_NUM_MAX)
+        return ESP_ERR_INVALID_ARG;
+    x_idfhost_i2c.clk_speed[port] = config->master.clk_speed;
+    return ESP_OK;
+}
+esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t rx_len, size_t tx_len, int flags) { return ESP_OK; }
+esp_err_t i2c_driver_delete(i2c_port_t port) { return ESP_OK; }
+esp_err_t i2c_set_timeout(i2c_port_t port, int timeout)
+{
+    if(port < 0 || port >= I2C_NUM_MAX)
+        return ESP_ERR_INVALID_ARG;
+    x_idfhost_i2c.timeout[port] = timeout;
+    return ESP_OK;
+}
+esp_err_t i2c_get_timeout(i2c_port_t port, int *timeout)
+{
+    if(port < 0 || port >= I2C_NUM_MAX)
+        return ESP_ERR_INVALID_ARG;
+    *timeout = x_idfhost_i2c.timeout[port];
+    return ESP_OK;
+}
+i2c_cmd_handle_t i2c_cmd_link_create(void) { return calloc(1, sizeof(idfhost_i2c_cmd_t)); }
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd) { free(cmd); }
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd) { return idfhost_i2c_add(cmd, (idfhost_i2c_step_t){ .kind = IDFHOST_I2C_START }); }
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd) { return idfhost_i2c_add(cmd, (idfhost_i2c_step_t){ .kind = IDFHOST_I2C_STOP }); }
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd, uint8_t data, bool ack) { return idfhost_i2c_add(cmd, (idfhost_i2c_step_t){ .kind = IDFHOST_I2C_WRITE, .byte = data, .len = 1 }); }
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd, const uint8_t *data, size_t len, bool ack) { return idfhost_i2c_add(cmd, (idfhost_i2c_step_t){ .kind = IDFHOST_I2C_WRITE, .src = data, .len = len }); }
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd, uint8_t *data, i2c_ack_type_t ack) { return idfhost_i2c_add(cmd, (idfhost_i2c_step_t){ .kind = IDFHOST_I2C_READ, .dst = data, .len = 1 }); }
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd, uint8_t *data, size_t len, i2c_ack_type_t ack) { return idfhost_i2c_add(cmd, (idfhost_i2c_step_t){ .kind = IDFHOST_I2C_READ, .dst = data, .len = len }); }
+
+//plays the steps against the device: the first byte after a start is the address, the first byte written after that the
+//register pointer, then data in or out from the pointer on. The time moves on by 9 bits a byte and 1 per start and stop.
+esp_err_t i2c_master_cmd_begin(i2c_port_t port, i2c_cmd_handle_t cmd, TickType_t ticks)
+{
+    idfhost_i2c_cmd_t *c = cmd;
+    idfhost_i2c_bus_t *bus = &x_idfhost_i2c;
+    idfhost_i2c_xfer_t xfer = { .port = port, .page = bus->page, .hold = x_idfhost_held };
+    bool addressed = false, has_reg = false;
+    uint32_t bits = 0;
+
+    if(port < 0 || port >= I2C_NUM_MAX || c == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    for(int i = 0; i < c->n_steps; i++)
+    {
+        idfhost_i2c_step_t *step = &c->steps[i];
+        size_t j = 0;
+
+        if(step->kind == IDFHOST_I2C_START || step->kind == IDFHOST_I2C_STOP)
+        {
+            addressed = false;
+            bits++;
+            continue;
+        }
+        bits += 9 * step->len;
+        if(step->kind == IDFHOST_I2C_WRITE && !addressed)
+        {
+            xfer.addr = step->byte >> 1;
+            if(xfer.addr != bus->addr)
+                return ESP_FAIL;
+            addressed = true;
+            continue;
+        }
+        if(step->kind == IDFHOST_I2C_WRITE && !has_reg)
+        {
+            xfer.reg = step->src ? step->src[0] : step->byte;
+            has_reg = true;
+            j = 1;
+        }
+        for(; j < step->len; j++)
+        {
+            uint8_t reg = (xfer.reg + xfer.len) & 0x7F, *val = &bus->regs[bus->page][reg];
+
+            if(step->kind == IDFHOST_I2C_READ)
+            {
+                xfer.read = true;
+                step->dst[j] = reg == IDFHOST_I2C_PAGE_REG ? bus->page : *val;
+            }
+            else if(reg == IDFHOST_I2C_PAGE_REG)
+                bus->page = (step->src ? step->src[j] : step->byte) & 1;
+            else
+                *val = step->src ? step->src[j] : step->byte;
+            if(xfer.len < sizeof(xfer.data))
+                xfer.data[xfer.len] = step->kind == IDFHOST_I2C_READ ? step->dst[j] : (step->src ? step->src[j] : step->byte);
+            xfer.len++;
+        }
+    }
+
+    if(bus->n_xfers < IDFHOST_I2C_XFERS)
+        bus->xfers[bus->n_xfers] = xfer;
+    bus->n_xfers++;
+    if(x_idfhost_time_us >= 0 && bus->clk_speed[port] > 0)
+        x_idfhost_time_us += (int64_t)bits * 1000000 / bus->clk_speed[port];
+    return ESP_OK;
+}
+esp_err_t i2c_reset_tx_fifo(i2c_port_t port) { return ESP_OK; }
+esp_err_t i2c_reset_rx_fifo(i2c_port_t port) { return ESP_OK; }
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *config) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t ledc_channel_config(const ledc_channel_config_t *config) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel) { return ESP_ERR_NOT_SUPPORTED; }
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *config, rmt_channel_handle_t *channel) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t rmt_new_bytes_encoder(const rmt_bytes_encoder_config_t *config, rmt_encoder_handle_t *encoder) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t rmt_enable(rmt_channel_handle_t channel) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t rmt_disable(rmt_channel_handle_t channel) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t rmt_del_channel(rmt_channel_handle_t channel) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t rmt_transmit(rmt_channel_handle_t channel, rmt_encoder_handle_t encoder, const void *data, size_t size, const rmt_transmit_config_t *config) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t channel, int timeout_ms) { return ESP_ERR_NOT_SUPPORTED; }
+
+esp_err_t uart_set_baudrate(uart_port_t port, uint32_t baud) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t uart_driver_install(uart_port_t port, int rx_size, int tx_size, int queue_size, QueueHandle_t *queue, int flags) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t uart_driver_delete(uart_port_t port) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t *config) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t uart_enable_pattern_det_baud_intr(uart_port_t port, char chr, uint8_t num, int chr_tout, int post_idle, int pre_idle) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t uart_pattern_queue_reset(uart_port_t port, int queue_length) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t uart_flush(uart_port_t port) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t uart_flush_input(uart_port_t port) { return ESP_ERR_NOT_SUPPORTED; }
+int uart_pattern_pop_pos(uart_port_t port) { return -1; }
+int uart_read_bytes(uart_port_t port, void *buf, uint32_t length, TickType_t ticks) { return -1; }
+
+esp_err_t adc_oneshot_new_unit(const adc_oneshot_unit_init_cfg_t *config, adc_oneshot_unit_handle_t *unit) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t adc_oneshot_config_channel(adc_oneshot_unit_handle_t unit, adc_channel_t channel, const adc_oneshot_chan_cfg_t *config) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t adc_oneshot_read(adc_oneshot_unit_handle_t unit, adc_channel_t channel, int *raw) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t adc_oneshot_del_unit(adc_oneshot_unit_handle_t unit) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t adc_cali_create_scheme_curve_fitting(const adc_cali_curve_fitting_config_t *config, adc_cali_handle_t *handle) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t adc_cali_delete_scheme_curve_fitting(adc_cali_handle_t handle) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int *voltage) { return ESP_ERR_NOT_SUPPORTED; }
+
+//one thread and no scheduler, locks always succeed and tasks never start
+void vPortEnterCritical(portMUX_TYPE *mux) {}
+void vPortExitCritical(portMUX_TYPE *mux) {}
+int xPortInIsrContext(void) { return 0; }
+int xPortGetCoreID(void) { return 0; }
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) { return (SemaphoreHandle_t)1; }
+SemaphoreHandle_t xSemaphoreCreateBinary(void) { return (SemaphoreHandle_t)1; }
+//counts its depth so the I2C log can tell which transactions ran under one hold of the lock, the tests only use one
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void) { return calloc(1, sizeof(int)); }
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    if((*(int *)sem)++ == 0)
+        x_idfhost_held = ++x_idfhost_holds;
+    return pdTRUE;
+}
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem)
+{
+    if(*(int *)sem == 0)
+        return pdFALSE;
+    if(--(*(int *)sem) == 0)
+        x_idfhost_held = 0;
+    return pdTRUE;
+}
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) { return pdTRUE; }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) { return pdTRUE; }
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken) { return pdTRUE; }
+void vSemaphoreDelete(SemaphoreHandle_t sem) {}
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) { return pdFALSE; }
+BaseType_t xQueueReset(QueueHandle_t queue) { return pdPASS; }
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t priority, TaskHandle_t *task) { return pdFALSE; }
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t priority, TaskHandle_t *task, BaseType_t core) { return pdFALSE; }
+void vTaskDelete(TaskHandle_t task) {}
+void vTaskDelay(TickType_t ticks) {}
+void vTaskDelayUntil(TickType_t *wake, TickType_t ticks) {}
+BaseType_t xTaskDelayUntil(TickType_t *wake, TickType_t ticks) { return pdTRUE; }
+TickType_t xTaskGetTickCount(void) { return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS); }
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return (TaskHandle_t)0x3fc80000; }
+TaskHandle_t xTaskGetIdleTaskHandleForCPU(UBaseType_t cpu)
+{
+    for(UBaseType_t i = 0; i < x_idfhost_task_count && i < 32; i++)
+    {
+        if(strncmp(x_idfhost_tasks[i].pcTaskName, "IDLE", 4) == 0 && x_idfhost_tasks[i].pcTaskName[4] == '0' + cpu)
+            return x_idfhost_tasks[i].xHandle;
+    }
+    return NULL;
+}
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) { return 0; }
+UBaseType_t uxTaskGetNumberOfTasks(void) { return x_idfhost_task_count; }
+
+//like FreeRTOS, nothing at all if the array is too small
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t size, uint32_t *runtime)
+{
+    if(x_idfhost_task_count > size || x_idfhost_task_count > 32)
+        return 0;
+    memcpy(status, x_idfhost_tasks, x_idfhost_task_count * sizeof(TaskStatus_t));
+    if(runtime)
+        *runtime = x_idfhost_run_time;
+    return x_idfhost_task_count;
+}
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) { return 0; }
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {}
+BaseType_t xTaskNotifyGive(TaskHandle_t task) { return pdPASS; }
+char *pcTaskGetName(TaskHandle_t task) { return "host"; }
@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+#include "driver/gpio.h"
+#include "driver/i2c.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+//hooks for the host tests to play the parts of the device the stubs stand in for, not part of ESP-IDF
+void idfhost_set_time(int64_t us); //esp_timer_get_time() returns this until set again, a negative time goes back to the host clock
+void idfhost_gpio_edge(gpio_num_t gpio); //runs the ISR handler added for the pin, as an edge on it would
+void idfhost_set_heap(size_t free_bytes, size_t min_free, size_t largest_block); //what the heap_caps_get_*() calls report
+void idfhost_set_tasks(const TaskStatus_t *tasks, UBaseType_t count, uint32_t total_run_time); //what uxTaskGetSystemState() hands back, tasks named IDLE0 and IDLE1 are the idle tasks
+
+#define IDFHOST_I2C_PAGE_REG (0x07) //register that picks the page, it sits on both
+#define IDFHOST_I2C_XFERS (256)
+typedef struct {
+    i2c_port_t port;
+    uint8_t addr;            //7 bit address the transaction went to
+    uint8_t page;            //page the device was on when it started
+    uint8_t reg;             //register pointer it started at
+    bool read;
+    uint8_t len;             //data bytes read or written after the register pointer
+    uint8_t data[16];        //the first of them
+    uint32_t hold;           //which take of a recursive mutex it ran under, 0 if none was held
+} idfhost_i2c_xfer_t;
+//the one register device on the host I2C bus, a BNO055 style map of two pages the register pointer increments through
+typedef struct {
+    uint8_t addr;                        //answers here on every port, anything else is a NACK
+    uint8_t page;
+    uint8_t regs[2][128];
+    uint32_t clk_speed[I2C_NUM_MAX];     //last i2c_param_config(), each transaction moves a set time on by its bits at this speed
+    int timeout[I2C_NUM_MAX];            //last i2c_set_timeout()
+    size_t n_xfers;                      //transactions logged in xfers, later ones are counted but not kept
+    idfhost_i2c_xfer_t xfers[IDFHOST_I2C_XFERS];
+} idfhost_i2c_bus_t;
+idfhost_i2c_bus_t *idfhost_i2c_bus(void); //the device and its transaction log, for a test to set up and check
@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <unity.h>
+#include "analysis.h"
+
+#define TEST_DECISIONS (12000)
+
+static triplog_sim_t x_sim;
+static uint32_t x_on, x_triggers;
+
+//one session of random tilt and speed judged with the default limits, the way main logs it
+void setUp(void)
+{
+    triplog_flash_t flash;
+    decision_params_t params;
+    decision_state_t state = {0};
+    bool prev = false;
+
+    decision_default_params(&params);
+    x_on = x_triggers = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_sim_init(&x_sim, &flash, 256 * TRIPLOG_SECTOR_SIZE));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_open(&flash));
+    srand(3);
+    for(int i = 0; i < TEST_DECISIONS; i++)
+    {
+        bno055_vec3_t angle = { (rand() % 200 - 100) / 16.0, (rand() % 200 - 100) / 16.0, 0 };
+        float speed = (rand() % 200 - 50) / 10.0f;
+        bool on = is_out_of_level_r(&state, &params, &angle, speed);
+
+        triplog_log_imu(&angle, 0);
+        triplog_log_decision_at(i * 10, on, decision_combined_angle(&angle), speed, 0, 0, 0);
+        x_on += on;
+        x_triggers += on && !prev;
+        prev = on;
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_close());
+}
+
+void tearDown(void)
+{
+    triplog_sim_deinit(&x_sim);
+}
+
+static void test_scan_agrees_with_device(void)
+{
+    analysis_stats_t stats;
+    decision_params_t params;
+
+    decision_default_params(&params);
+    analysis_stats_init(&stats);
+    TEST_ASSERT_EQUAL(ESP_OK, analysis_scan_image(x_sim.image, x_sim.size, &params, &stats));
+
+    TEST_ASSERT_EQUAL(1, stats.units);
+    TEST_ASSERT_EQUAL(1, stats.sessions);
+    TEST_ASSERT_EQUAL(0, stats.corrupt_records);
+    TEST_ASSERT_EQUAL(TEST_DECISIONS, stats.imu_samples);
+    TEST_ASSERT_EQUAL(TEST_DECISIONS, stats.decisions);
+    TEST_ASSERT_EQUAL(0, stats.disagreements);
+    TEST_ASSERT_EQUAL(x_triggers, stats.triggers);
+    TEST_ASSERT_EQUAL(x_triggers, stats.logged_triggers);
+    TEST_ASSERT_EQUAL(x_on, stats.out_of_level_samples);
+}
+
+static void test_other_limits(void)
+{
+    analysis_stats_t stats;
+    decision_params_t params;
+
+    //limits nothing reaches never trigger, and every decision the device warned on is a disagreement
+    decision_default_params(&params);
+    params.threshold_angle = 100;
+    analysis_stats_init(&stats);
+    TEST_ASSERT_EQUAL(ESP_OK, analysis_scan_image(x_sim.image, x_sim.size, &params, &stats));
+
+    TEST_ASSERT_GREATER_THAN(0, x_on);
+    TEST_ASSERT_EQUAL(0, stats.triggers);
+    TEST_ASSERT_EQUAL(x_triggers, stats.logged_triggers);
+    TEST_ASSERT_EQUAL(x_on, stats.disagreements);
+}
+
+static void test_corrupt_record(void)
+{
+    analysis_stats_t stats;
+    decision_params_t params;
+
+    //second record of the first sector, the header before it is left alone
+    x_sim.image[2 * TRIPLOG_RECORD_SIZE + 8] ^= 0x01;
+    decision_default_params(&params);
+    analysis_stats_init(&stats);
+    TEST_ASSERT_EQUAL(ESP_OK, analysis_scan_image(x_sim.image, x_sim.size, &params, &stats));
+
+    TEST_ASSERT_EQUAL(1, stats.corrupt_records);
+    TEST_ASSERT_EQUAL(2 * TEST_DECISIONS, stats.records - 1 + stats.corrupt_records);
+}
+
+static void test_merge(void)
+{
+    analysis_stats_t total, unit;
+    decision_params_t params;
+
+    decision_default_params(&params);
+    analysis_stats_init(&total);
+    analysis_stats_init(&unit);
+    TEST_ASSERT_EQUAL(ESP_OK, analysis_scan_image(x_sim.image, x_sim.size, &params, &unit));
+    analysis_merge(&total, &unit);
+    analysis_merge(&total, &unit);
+
+    TEST_ASSERT_EQUAL(2, total.units);
+    TEST_ASSERT_EQUAL(2 * TEST_DECISIONS, total.decisions);
+    TEST_ASSERT_EQUAL(2 * x_triggers, total.triggers);
+    TEST_ASSERT_EQUAL_FLOAT(unit.max_combined_angle, total.max_combined_angle);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_scan_agrees_with_device);
+    RUN_TEST(test_other_limits);
+    RUN_TEST(test_corrupt_record);
+    RUN_TEST(test_merge);
+    return UNITY_END();
+}
@@ -0,0 +1,241 @@
+#include <string.h>
+#include <unity.h>
+#include "idfhost.h"
+#include "bno055.h"
+
+#define TEST_SCLK_HZ (40000000) //the S3 I2C timeout counts cycles of the 40 MHz XTAL
+
+//register addresses from the datasheet, table 4-2
+#define TEST_REG_CHIP_ID (0x00)
+#define TEST_REG_UNIT_SEL (0x3B)
+#define TEST_REG_AXIS_MAP_CONFIG (0x41)
+#define TEST_REG_AXIS_MAP_SIGN (0x42)
+#define TEST_REG_PAGE_ID (0x07)
+#define TEST_REG_OPR_MODE (0x3D)
+#define TEST_REG_ACC_CONFIG (0x08) //page 1 from here on
+#define TEST_REG_MAG_CONFIG (0x09)
+#define TEST_REG_GYR_CONFIG_0 (0x0A)
+#define TEST_REG_GYR_CONFIG_1 (0x0B)
+#define TEST_REG_INT_MSK (0x0F)
+#define TEST_REG_INT_EN (0x10)
+#define TEST_REG_ACC_AM_THRES (0x11)
+#define TEST_REG_ACC_INT_SETTINGS (0x12)
+#define TEST_REG_ACC_NM_THRES (0x15)
+#define TEST_REG_ACC_NM_SET (0x16)
+
+static idfhost_i2c_bus_t *x_bus;
+static bno055_config_t x_conf;
+
+//a BNO055 at address A with its reset register content, as far as the driver reads it
+void setUp(void)
+{
+    x_bus = idfhost_i2c_bus();
+    memset(x_bus, 0, sizeof(idfhost_i2c_bus_t));
+    x_bus->addr = BNO055_ADDRESS_A;
+    x_bus->regs[0][TEST_REG_CHIP_ID] = BNO055_ID;
+    x_bus->regs[0][TEST_REG_UNIT_SEL] = 0x80;
+    x_bus->regs[0][TEST_REG_AXIS_MAP_CONFIG] = REMAP_CONFIG_P1;
+    x_bus->regs[0][TEST_REG_AXIS_MAP_SIGN] = REMAP_SIGN_P1;
+    bno055_set_default_conf(&x_conf);
+    idfhost_set_time(0);
+}
+
+void tearDown(void)
+{
+    bno055_close(I2C_NUMBER_0);
+    idfhost_set_time(-1);
+}
+
+static void test_stretch_timeout(void)
+{
+    const uint32_t timeouts_us[] = { 0, 1, 10 * 1000, 26214, 26215, 200 * 1000 };
+
+    //the smallest power of 2 of XTAL cycles that still gives the BNO055 the whole time, capped at the 2^22 the register holds
+    for(size_t i = 0; i < sizeof(timeouts_us) / sizeof(timeouts_us[0]); i++) {
+        uint64_t cycles = (uint64_t)timeouts_us[i] * (TEST_SCLK_HZ / 1000000);
+
+        x_conf.timeout_us = timeouts_us[i];
+        TEST_ASSERT_EQUAL(ESP_OK, bno055_open(I2C_NUMBER_0, &x_conf));
+        int exp = x_bus->timeout[x_conf.i2c_port];
+        TEST_ASSERT_TRUE(exp >= 1 && exp <= 22);
+        if(exp < 22)
+            TEST_ASSERT_TRUE((1ULL << exp) >= cycles);
+        if(exp > 1)
+            TEST_ASSERT_TRUE((1ULL << (exp - 1)) < cycles);
+        bno055_close(I2C_NUMBER_0);
+    }
+
+    //10 ms is 400000 cycles, 2^19 = 524288 is the first power of 2 over it
+    x_conf.timeout_us = 10 * 1000;
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_open(I2C_NUMBER_0, &x_conf));
+    TEST_ASSERT_EQUAL(19, x_bus->timeout[x_conf.i2c_port]);
+    bno055_close(I2C_NUMBER_0);
+    x_conf.timeout_us = 200 * 1000;
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_open(I2C_NUMBER_0, &x_conf));
+    TEST_ASSERT_EQUAL(22, x_bus->timeout[x_conf.i2c_port]);
+}
+
+static void test_read_timing(void)
+{
+    bno055_bus_stats_t stats;
+
+    //an Euler read is 84 bits on the wire: two starts, a stop, both address bytes, the register and the 6 data bytes
+    x_conf.clk_speed = 100000;
+    TEST_ASSERT_EQUAL(ESP_OK, BNO055_init_conf(I2C_NUMBER_0, &x_conf));
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_get_bus_stats(I2C_NUMBER_0, &stats));
+    TEST_ASSERT_EQUAL(840, stats.euler_read_us_100k);
+    TEST_ASSERT_EQUAL(210, stats.euler_read_us_400k);
+
+    //and the bus goes back to the configured speed afterwards
+    TEST_ASSERT_EQUAL(100000, x_bus->clk_speed[x_conf.i2c_port]);
+}
+
+//checks one logged transaction
+static void assert_xfer(size_t i, uint8_t page, uint8_t reg, bool read, uint8_t len)
+{
+    TEST_ASSERT_TRUE(i < x_bus->n_xfers);
+    TEST_ASSERT_EQUAL(page, x_bus->xfers[i].page);
+    TEST_ASSERT_EQUAL_HEX8(reg, x_bus->xfers[i].reg);
+    TEST_ASSERT_EQUAL(read, x_bus->xfers[i].read);
+    TEST_ASSERT_EQUAL(len, x_bus->xfers[i].len);
+}
+
+//every transaction logged ran under the same hold of the bus lock
+static void assert_one_hold(void)
+{
+    TEST_ASSERT_TRUE(x_bus->n_xfers > 0);
+    TEST_ASSERT_NOT_EQUAL(0, x_bus->xfers[0].hold);
+    for(size_t i = 1; i < x_bus->n_xfers; i++)
+        TEST_ASSERT_EQUAL(x_bus->xfers[0].hold, x_bus->xfers[i].hold);
+}
+
+static void test_script_holds_lock(void)
+{
+    bno055_sensor_conf_t conf = { .acc_range = BNO055_ACC_RANGE_8G, .acc_bw = BNO055_ACC_BW_125HZ, .gyr_range = BNO055_GYR_RANGE_500DPS,
+                                  .gyr_bw = BNO055_GYR_BW_47HZ, .mag_rate = BNO055_MAG_RATE_20HZ, .mag_opr = BNO055_MAG_OPR_REGULAR };
+    bno055_bus_stats_t before, after;
+
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_open(I2C_NUMBER_0, &x_conf));
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_set_opmode(I2C_NUMBER_0, OPERATION_MODE_AMG));
+    x_bus->n_xfers = 0;
+
+    //CONFIGMODE, page 1, one burst of the four settings, back to page 0 and AMG, all without letting go of the bus
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_set_sensor_conf(I2C_NUMBER_0, &conf));
+    TEST_ASSERT_EQUAL(5, x_bus->n_xfers);
+    assert_xfer(0, 0, TEST_REG_OPR_MODE, false, 1);
+    TEST_ASSERT_EQUAL_HEX8(OPERATION_MODE_CONFIG, x_bus->xfers[0].data[0]);
+    assert_xfer(1, 0, TEST_REG_PAGE_ID, false, 1);
+    assert_xfer(2, 1, TEST_REG_ACC_CONFIG, false, 4);
+    assert_xfer(3, 1, TEST_REG_PAGE_ID, false, 1);
+    assert_xfer(4, 0, TEST_REG_OPR_MODE, false, 1);
+    TEST_ASSERT_EQUAL_HEX8(OPERATION_MODE_AMG, x_bus->xfers[4].data[0]);
+    assert_one_hold();
+    TEST_ASSERT_EQUAL(0, x_bus->page);
+
+    //the lock is given back, the next read is a hold of its own
+    uint32_t script_hold = x_bus->xfers[0].hold;
+    bno055_vec3_t euler;
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_get_euler(I2C_NUMBER_0, &euler));
+    TEST_ASSERT_NOT_EQUAL(script_hold, x_bus->xfers[5].hold);
+
+    //the shadow holds what was written, so the same settings again cost no transactions
+    x_bus->n_xfers = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_get_bus_stats(I2C_NUMBER_0, &before));
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_set_sensor_conf(I2C_NUMBER_0, &conf));
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_get_bus_stats(I2C_NUMBER_0, &after));
+    TEST_ASSERT_EQUAL(0, x_bus->n_xfers);
+    TEST_ASSERT_EQUAL(before.shadow_hits + 7, after.shadow_hits);
+}
+
+static void test_sensor_conf_read_holds_lock(void)
+{
+    bno055_sensor_conf_t conf;
+
+    //reading the settings back switches to page 1 and back under one hold too, and the shadow takes what was read
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_open(I2C_NUMBER_0, &x_conf));
+    x_bus->regs[1][TEST_REG_ACC_CONFIG] = 0x0D;
+    x_bus->n_xfers = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_get_sensor_conf(I2C_NUMBER_0, &conf));
+    TEST_ASSERT_EQUAL(3, x_bus->n_xfers);
+    assert_xfer(0, 0, TEST_REG_PAGE_ID, false, 1);
+    assert_xfer(1, 1, TEST_REG_ACC_CONFIG, true, 4);
+    assert_xfer(2, 1, TEST_REG_PAGE_ID, false, 1);
+    assert_one_hold();
+    TEST_ASSERT_EQUAL(BNO055_ACC_RANGE_4G, conf.acc_range);
+    TEST_ASSERT_EQUAL(BNO055_ACC_BW_62_5HZ, conf.acc_bw);
+
+    //0x0D is the 4G, 62.5 Hz the chip holds now, writing it is a shadow hit and needs no CONFIGMODE
+    x_bus->n_xfers = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_set_sensor_conf(I2C_NUMBER_0, &conf));
+    TEST_ASSERT_EQUAL(0, x_bus->n_xfers);
+}
+
+static void test_sensor_conf_encoding(void)
+{
+    bno055_sensor_conf_t conf = { .acc_range = BNO055_ACC_RANGE_8G, .acc_bw = BNO055_ACC_BW_125HZ, .acc_pwr = BNO055_ACC_PWR_NORMAL,
+                                  .gyr_range = BNO055_GYR_RANGE_500DPS, .gyr_bw = BNO055_GYR_BW_47HZ, .gyr_pwr = BNO055_GYR_PWR_NORMAL,
+                                  .mag_rate = BNO055_MAG_RATE_20HZ, .mag_opr = BNO055_MAG_OPR_REGULAR, .mag_pwr = BNO055_MAG_PWR_NORMAL };
+
+    //the bytes worked out by hand from the datasheet bit fields, section 4.3.1 onwards
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_open(I2C_NUMBER_0, &x_conf));
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_set_sensor_conf(I2C_NUMBER_0, &conf));
+    TEST_ASSERT_EQUAL_HEX8(0x12, x_bus->regs[1][TEST_REG_ACC_CONFIG]);   //pwr 000, bw 100, range 10
+    TEST_ASSERT_EQUAL_HEX8(0x0D, x_bus->regs[1][TEST_REG_MAG_CONFIG]);   //pwr 00, opr 01, rate 101
+    TEST_ASSERT_EQUAL_HEX8(0x1A, x_bus->regs[1][TEST_REG_GYR_CONFIG_0]); //bw 011, range 010
+    TEST_ASSERT_EQUAL_HEX8(0x00, x_bus->regs[1][TEST_REG_GYR_CONFIG_1]);
+
+    //the power fields sit at the top of each byte
+    conf.acc_pwr = BNO055_ACC_PWR_LOW_POWER_1;
+    conf.mag_pwr = BNO055_MAG_PWR_SLEEP;
+    conf.gyr_pwr = BNO055_GYR_PWR_ADVANCED_POWERSAVE;
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_set_sensor_conf(I2C_NUMBER_0, &conf));
+    TEST_ASSERT_EQUAL_HEX8(0x52, x_bus->regs[1][TEST_REG_ACC_CONFIG]);
+    TEST_ASSERT_EQUAL_HEX8(0x2D, x_bus->regs[1][TEST_REG_MAG_CONFIG]);
+    TEST_ASSERT_EQUAL_HEX8(0x04, x_bus->regs[1][TEST_REG_GYR_CONFIG_1]);
+    TEST_ASSERT_EQUAL(0, x_bus->page);
+}
+
+static void test_motion_int_encoding(void)
+{
+    bno055_sensor_conf_t sensor_conf = { .acc_range = BNO055_ACC_RANGE_2G };
+    bno055_motion_int_conf_t conf = { .any_motion = true, .no_motion = true, .am_threshold_mg = 80, .am_samples = 3,
+                                      .nm_threshold_mg = 40, .nm_duration = 4, .axes = BNO055_AXIS_X | BNO055_AXIS_Z };
+
+    //a fusion mode runs the accelerometer at 4G, a threshold step of 7.82 mg
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_open(I2C_NUMBER_0, &x_conf));
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_set_opmode(I2C_NUMBER_0, OPERATION_MODE_NDOF));
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_set_motion_int(I2C_NUMBER_0, &conf));
+    TEST_ASSERT_EQUAL_HEX8(10, x_bus->regs[1][TEST_REG_ACC_AM_THRES]);
+    TEST_ASSERT_EQUAL_HEX8(0x16, x_bus->regs[1][TEST_REG_ACC_INT_SETTINGS]); //axes x and z in bits 2-4, 3 samples is 10
+    TEST_ASSERT_EQUAL_HEX8(5, x_bus->regs[1][TEST_REG_ACC_NM_THRES]);
+    TEST_ASSERT_EQUAL_HEX8(0x09, x_bus->regs[1][TEST_REG_ACC_NM_SET]);       //4 s is 0100 in bits 1-6, bit 0 picks no motion
+    TEST_ASSERT_EQUAL_HEX8(0xC0, x_bus->regs[1][TEST_REG_INT_MSK]);
+    TEST_ASSERT_EQUAL_HEX8(0xC0, x_bus->regs[1][TEST_REG_INT_EN]);
+    TEST_ASSERT_EQUAL(0, x_bus->page);
+
+    //outside the fusion modes the step follows the range set, 3.91 mg at 2G, and a threshold past the top is held at 255
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_set_opmode(I2C_NUMBER_0, OPERATION_MODE_AMG));
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_set_sensor_conf(I2C_NUMBER_0, &sensor_conf));
+    conf.no_motion = false;
+    conf.nm_threshold_mg = 5000;
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_set_motion_int(I2C_NUMBER_0, &conf));
+    TEST_ASSERT_EQUAL_HEX8(20, x_bus->regs[1][TEST_REG_ACC_AM_THRES]);
+    TEST_ASSERT_EQUAL_HEX8(255, x_bus->regs[1][TEST_REG_ACC_NM_THRES]);
+    TEST_ASSERT_EQUAL_HEX8(0x40, x_bus->regs[1][TEST_REG_INT_EN]);
+
+    //settings the registers can't hold are turned away before anything is written
+    conf.am_samples = 5;
+    TEST_ASSERT_EQUAL(BNO_ERR_NOT_IN_RANGE, bno055_set_motion_int(I2C_NUMBER_0, &conf));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_stretch_timeout);
+    RUN_TEST(test_read_timing);
+    RUN_TEST(test_script_holds_lock);
+    RUN_TEST(test_sensor_conf_read_holds_lock);
+    RUN_TEST(test_sensor_conf_encoding);
+    RUN_TEST(test_motion_int_encoding);
+    return UNITY_END();
+}
@@ -0,0 +1,144 @@
+#include <unity.h>
+#include "cadence.h"
+
+#define TEST_THRESHOLD (5.0f)
+
+static cadence_params_t x_params;
+static cadence_t x_cadence;
+
+void setUp(void)
+{
+    x_params = (cadence_params_t){
+        .min_delay_ms = 100,
+        .max_delay_ms = 500,
+        .near_deg = 1,
+        .far_deg = 4,
+        .motion_dps = 4,
+        .avoid_period_ms = 0,
+        .tick_ms = 10,
+    };
+}
+
+void tearDown(void) {}
+
+//the delay for an angle on a scheduler with no rate to go by yet
+static uint32_t first_delay(float angle)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, cadence_init(&x_cadence, &x_params));
+    return cadence_next(&x_cadence, angle, TEST_THRESHOLD);
+}
+
+static void test_init(void)
+{
+    cadence_params_t params = x_params;
+
+    params.min_delay_ms = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, cadence_init(&x_cadence, &params));
+    params.min_delay_ms = 600;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, cadence_init(&x_cadence, &params));
+    params = x_params;
+    params.far_deg = params.near_deg;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, cadence_init(&x_cadence, &params));
+    params = x_params;
+    params.motion_dps = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, cadence_init(&x_cadence, &params));
+    params = x_params;
+    params.tick_ms = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, cadence_init(&x_cadence, &params));
+
+    //every tick step would land on the period again, the nudge would never get off it
+    params = x_params;
+    params.avoid_period_ms = 5;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, cadence_init(&x_cadence, &params));
+}
+
+static void test_proximity(void)
+{
+    //slowest from far_deg under the threshold, fastest from near_deg under it and over it, a straight line between
+    TEST_ASSERT_EQUAL(500, first_delay(0));
+    TEST_ASSERT_EQUAL(500, first_delay(1));
+    TEST_ASSERT_EQUAL(300, first_delay(2.5f));
+    TEST_ASSERT_EQUAL(100, first_delay(4));
+    TEST_ASSERT_EQUAL(100, first_delay(7));
+}
+
+static void test_motion(void)
+{
+    //level, then a degree a loop: 2 dps smoothed to 1 is a quarter of the way
+    TEST_ASSERT_EQUAL(500, first_delay(0));
+    TEST_ASSERT_EQUAL(400, cadence_next(&x_cadence, 1, TEST_THRESHOLD));
+
+    //2.5 dps over the 400 ms just waited smooths to 1.75 dps, 325 ms rounded to the tick
+    TEST_ASSERT_EQUAL(330, cadence_next(&x_cadence, 2, TEST_THRESHOLD));
+
+    //held still the rate halves each loop and the closeness takes over, a third of the way is 366.7 ms
+    TEST_ASSERT_EQUAL(370, cadence_next(&x_cadence, 2, TEST_THRESHOLD));
+    TEST_ASSERT_EQUAL(370, cadence_next(&x_cadence, 2, TEST_THRESHOLD));
+
+    //back level and staying there, the rate dies away and the loop goes back to its slowest
+    cadence_next(&x_cadence, 0, TEST_THRESHOLD);
+    for(int i = 0; i < 40; i++)
+        cadence_next(&x_cadence, 0, TEST_THRESHOLD);
+    TEST_ASSERT_EQUAL(500, cadence_next(&x_cadence, 0, TEST_THRESHOLD));
+
+    //a fast tip runs the loop flat out while it is still well under the threshold, 10 dps smooths to 5
+    TEST_ASSERT_EQUAL(500, first_delay(0));
+    TEST_ASSERT_EQUAL(100, cadence_next(&x_cadence, 5, 4 * TEST_THRESHOLD));
+}
+
+static void test_tick_rounding(void)
+{
+    //300 ms to the nearest 40 ms tick
+    x_params.tick_ms = 40;
+    TEST_ASSERT_EQUAL(320, first_delay(2.5f));
+
+    //rounding never goes under the shortest delay
+    x_params.min_delay_ms = 90;
+    TEST_ASSERT_EQUAL(90, first_delay(4));
+}
+
+static void test_avoid_period(void)
+{
+    //a multiple of the LED alarm period is moved a tick on, and on again while it is still a multiple
+    x_params.avoid_period_ms = 250;
+    TEST_ASSERT_EQUAL(510, first_delay(0));
+    TEST_ASSERT_EQUAL(260, first_delay(2.875f));
+    TEST_ASSERT_EQUAL(300, first_delay(2.5f));
+
+    x_params.avoid_period_ms = 20;
+    TEST_ASSERT_EQUAL(310, first_delay(2.5f));
+}
+
+static void test_counters(void)
+{
+    cadence_stats_t stats;
+
+    //only loops within near_deg of the threshold, or past it, count towards the delay near the threshold
+    TEST_ASSERT_EQUAL(ESP_OK, cadence_init(&x_cadence, &x_params));
+    cadence_next(&x_cadence, 0, TEST_THRESHOLD);
+    cadence_next(&x_cadence, 0, TEST_THRESHOLD);
+    cadence_next(&x_cadence, 3.5f, TEST_THRESHOLD);
+    cadence_next(&x_cadence, 4, TEST_THRESHOLD);
+    cadence_next(&x_cadence, 6, TEST_THRESHOLD);
+    cadence_get_stats(&x_cadence, &stats);
+
+    TEST_ASSERT_EQUAL(5, stats.loops);
+    TEST_ASSERT_EQUAL(2, stats.max_loops);
+    TEST_ASSERT_EQUAL(2, stats.near_loops);
+    TEST_ASSERT_EQUAL(200, stats.near_delay_ms);
+    TEST_ASSERT_EQUAL(100, stats.last_delay_ms);
+    TEST_ASSERT_EQUAL(2, stats.min_loops);
+    TEST_ASSERT_EQUAL(500 + 500 + 150 + 100 + 100, stats.elapsed_ms);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_init);
+    RUN_TEST(test_proximity);
+    RUN_TEST(test_motion);
+    RUN_TEST(test_tick_rounding);
+    RUN_TEST(test_avoid_period);
+    RUN_TEST(test_counters);
+    return UNITY_END();
+}
@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unity.h>
+#include "decision.h"
+
+#define TEST_SAMPLES (100000)
+
+static float x_pitch[TEST_SAMPLES], x_roll[TEST_SAMPLES], x_speed[TEST_SAMPLES];
+static uint32_t x_time[TEST_SAMPLES];
+static uint8_t x_block[TEST_SAMPLES];
+
+static decision_axes_params_t x_params;
+static decision_axes_state_t x_state;
+
+void setUp(void)
+{
+    decision_default_axes_params(&x_params);
+    memset(&x_state, 0, sizeof(x_state));
+}
+
+void tearDown(void) {}
+
+static bool step(float pitch, float roll, float speed, uint32_t time_ms)
+{
+    bno055_vec3_t angle = { pitch, roll, 0 };
+
+    return decision_axes_step(&x_state, &x_params, &angle, speed, time_ms);
+}
+
+static void test_block_matches_step(void)
+{
+    uint32_t on = 0;
+
+    //slow swings through both limits with noise, and stretches too fast to judge
+    srand(1);
+    for(int i = 0; i < TEST_SAMPLES; i++)
+    {
+        x_pitch[i] = 8 * sinf(i * 0.001f) + (rand() % 100 - 50) * 0.05f;
+        x_roll[i] = 5.5f * sinf(i * 0.0007f);
+        x_speed[i] = (i / 5000) % 3 == 2 ? 20 : 5;
+        x_time[i] = i * 10;
+    }
+    decision_axes_block(&x_state, &x_params, x_pitch, x_roll, x_speed, x_time, x_block, TEST_SAMPLES);
+
+    memset(&x_state, 0, sizeof(x_state));
+    for(int i = 0; i < TEST_SAMPLES; i++)
+    {
+        TEST_ASSERT_EQUAL(x_block[i], step(x_pitch[i], x_roll[i], x_speed[i], x_time[i]));
+        on += x_block[i];
+    }
+    TEST_ASSERT_GREATER_THAN(0, on);
+    TEST_ASSERT_LESS_THAN(TEST_SAMPLES, on);
+}
+
+static void test_pitch_dwell_and_hysteresis(void)
+{
+    //past the pitch limit, the warning waits out the dwell
+    for(uint32_t t = 0; t < x_params.axis[DECISION_AXIS_PITCH].dwell_ms; t += 100)
+        TEST_ASSERT_FALSE(step(x_params.axis[DECISION_AXIS_PITCH].upper + 1, 0, 5, t));
+    TEST_ASSERT_TRUE(step(x_params.axis[DECISION_AXIS_PITCH].upper + 1, 0, 5, x_params.axis[DECISION_AXIS_PITCH].dwell_ms));
+
+    //just back inside the limit isn't enough, it has to come back by the hysteresis
+    TEST_ASSERT_TRUE(step(x_params.axis[DECISION_AXIS_PITCH].upper - 0.5f, 0, 5, 1100));
+    TEST_ASSERT_FALSE(step(x_params.axis[DECISION_AXIS_PITCH].upper - x_params.axis[DECISION_AXIS_PITCH].hysteresis - 0.1f, 0, 5, 1200));
+}
+
+static void test_separate_limits(void)
+{
+    float between = (x_params.axis[DECISION_AXIS_ROLL].upper + x_params.axis[DECISION_AXIS_PITCH].upper) / 2;
+
+    //an angle past the roll limit but inside the pitch limit only warns as roll
+    for(uint32_t t = 0; t <= 2000; t += 100)
+        TEST_ASSERT_FALSE(step(between, 0, 5, t));
+
+    memset(&x_state, 0, sizeof(x_state));
+    for(uint32_t t = 0; t < x_params.axis[DECISION_AXIS_ROLL].dwell_ms; t += 100)
+        TEST_ASSERT_FALSE(step(0, -between, 5, t));
+    TEST_ASSERT_TRUE(step(0, -between, 5, x_params.axis[DECISION_AXIS_ROLL].dwell_ms));
+}
+
+static void test_speed_range(void)
+{
+    //outside its speed range an axis counts as within its limits
+    for(uint32_t t = 0; t <= 2000; t += 100)
+        TEST_ASSERT_FALSE(step(0, 2 * x_params.axis[DECISION_AXIS_ROLL].upper, x_params.axis[DECISION_AXIS_ROLL].upper_speed + 1, t));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_block_matches_step);
+    RUN_TEST(test_pitch_dwell_and_hysteresis);
+    RUN_TEST(test_separate_limits);
+    RUN_TEST(test_speed_range);
+    return UNITY_END();
+}
@@ -0,0 +1,160 @@
+#include <stdlib.h>
+#include <math.h>
+#include <unity.h>
+#include "fusion.h"
+
+#define TEST_SAMPLES (12000) //a minute at 200 Hz
+#define TEST_DT (1.0 / 200)
+
+static bno055_amg_raw_t x_samples[TEST_SAMPLES];
+static bno055_vec3_t x_reference[TEST_SAMPLES];
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static double gaussian(void)
+{
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+//slow rocking about every axis starting 3 degrees over, with sensor noise, 35 Hz road vibration and 0.2 dps of gyro bias.
+//The true attitude is integrated in double precision and kept as the reference.
+static void make_samples(void)
+{
+    double q[4] = { cos(0.5 * 3 * M_PI / 180), sin(0.5 * 3 * M_PI / 180), 0, 0 };
+
+    srand(1);
+    for(int i = 0; i < TEST_SAMPLES; i++)
+    {
+        double t = i * TEST_DT, n = 0;
+        double w[3] = { 0.3 * sin(2 * M_PI * 0.2 * t), 0.2 * sin(2 * M_PI * 0.13 * t + 1), 0.1 * cos(2 * M_PI * 0.05 * t) };
+        double qd[4] = { 0.5 * (-q[1]*w[0] - q[2]*w[1] - q[3]*w[2]), 0.5 * (q[0]*w[0] + q[2]*w[2] - q[3]*w[1]),
+                         0.5 * (q[0]*w[1] - q[1]*w[2] + q[3]*w[0]), 0.5 * (q[0]*w[2] + q[1]*w[1] - q[2]*w[0]) };
+
+        for(int k = 0; k < 4; k++)
+        {
+            q[k] += qd[k] * TEST_DT;
+            n += q[k] * q[k];
+        }
+        for(int k = 0; k < 4; k++)
+            q[k] /= sqrt(n);
+
+        double g[3] = { 2 * (q[1]*q[3] - q[0]*q[2]), 2 * (q[0]*q[1] + q[2]*q[3]), q[0]*q[0] - q[1]*q[1] - q[2]*q[2] + q[3]*q[3] };
+        for(int k = 0; k < 3; k++)
+        {
+            x_samples[i].accel[k] = (int16_t)lround((9.81 * g[k] + 0.3 * gaussian() + 0.5 * sin(2 * M_PI * 35 * t + k)) * FUSION_ACC_LSB);
+            x_samples[i].gyro[k] = (int16_t)lround((w[k] * 180 / M_PI + 0.2 + 0.1 * gaussian()) * FUSION_GYR_LSB);
+        }
+        x_reference[i].x = atan2(2 * (q[0]*q[1] + q[2]*q[3]), 1 - 2 * (q[1]*q[1] + q[2]*q[2])) * 180 / M_PI;
+        x_reference[i].y = asin(2 * (q[0]*q[2] - q[3]*q[1])) * 180 / M_PI;
+    }
+}
+
+static void test_madgwick_accuracy(void)
+{
+    fusion_t fusion;
+    fusion_accuracy_t accuracy;
+
+    fusion_init(&fusion, FUSION_MADGWICK, FUSION_MADGWICK_BETA, 0);
+    fusion_accuracy(&fusion, x_samples, x_reference, TEST_SAMPLES, TEST_DT, &accuracy);
+
+    TEST_ASSERT_EQUAL(TEST_SAMPLES, accuracy.samples);
+    TEST_ASSERT_FLOAT_WITHIN(1.5f, 0, accuracy.rms_deg);
+}
+
+static void test_mahony_accuracy(void)
+{
+    fusion_t fusion;
+    fusion_accuracy_t accuracy;
+
+    fusion_init(&fusion, FUSION_MAHONY, FUSION_MAHONY_KP, 0.05f);
+    fusion_accuracy(&fusion, x_samples, x_reference, TEST_SAMPLES, TEST_DT, &accuracy);
+
+    TEST_ASSERT_EQUAL(TEST_SAMPLES, accuracy.samples);
+    TEST_ASSERT_FLOAT_WITHIN(1.5f, 0, accuracy.rms_deg);
+}
+
+static void test_align(void)
+{
+    fusion_t fusion;
+    bno055_vec3_t euler;
+    float accel[3] = { 0, 9.81f * sinf(10 * (float)M_PI / 180), 9.81f * cosf(10 * (float)M_PI / 180) };
+
+    //the first sample puts the filter straight onto the accelerometer tilt, no settling
+    fusion_init(&fusion, FUSION_MADGWICK, FUSION_MADGWICK_BETA, 0);
+    fusion_align(&fusion, accel);
+    fusion_get_euler(&fusion, &euler);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 10, euler.x);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0, euler.y);
+}
+
+static void test_still(void)
+{
+    fusion_t fusion;
+    bno055_vec3_t euler;
+    bno055_amg_raw_t level = { .accel = { 0, 0, (int16_t)(9.81f * FUSION_ACC_LSB) } };
+
+    //a still, level board stays level
+    for(int algo = FUSION_MADGWICK; algo <= FUSION_MAHONY; algo++)
+    {
+        fusion_init(&fusion, algo, algo == FUSION_MAHONY ? FUSION_MAHONY_KP : FUSION_MADGWICK_BETA, 0);
+        for(int i = 0; i < 2000; i++)
+            fusion_update_raw(&fusion, &level, TEST_DT);
+        fusion_get_euler(&fusion, &euler);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, 0, euler.x);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, 0, euler.y);
+    }
+}
+
+static void test_gyro_bias(void)
+{
+    fusion_t fusion;
+    bno055_vec3_t euler;
+    const float bias[3] = { 1.0f, -0.5f, 0.75f }; //dps, what AMG mode passes through
+    bno055_amg_raw_t still = { .accel = { 0, 0, (int16_t)(9.81f * FUSION_ACC_LSB) } }, moving = still;
+
+    for(int i = 0; i < 3; i++)
+        still.gyro[i] = (int16_t)(bias[i] * FUSION_GYR_LSB);
+    moving.gyro[2] = (int16_t)(10 * FUSION_GYR_LSB);
+
+    //a turn half way through the still run starts it again
+    for(int algo = FUSION_MADGWICK; algo <= FUSION_MAHONY; algo++)
+    {
+        fusion_init(&fusion, algo, algo == FUSION_MAHONY ? FUSION_MAHONY_KP : FUSION_MADGWICK_BETA, 0);
+        for(int i = 0; i < 100; i++)
+            fusion_update_raw(&fusion, &still, TEST_DT);
+        fusion_update_raw(&fusion, &moving, TEST_DT);
+        for(int i = 0; i < 150; i++)
+            fusion_update_raw(&fusion, &still, TEST_DT);
+        TEST_ASSERT_FALSE(fusion.has_bias);
+        for(int i = 0; i < 60; i++)
+            fusion_update_raw(&fusion, &still, TEST_DT);
+        TEST_ASSERT_TRUE(fusion.has_bias);
+        for(int i = 0; i < 3; i++)
+            TEST_ASSERT_FLOAT_WITHIN(1e-3f, bias[i], fusion.gyro_bias[i] * 180 / M_PI);
+
+        //with the bias out, a minute still keeps the heading, it would have turned 45 degrees on the raw gyro
+        fusion_get_euler(&fusion, &euler);
+        float heading = euler.z;
+        for(int i = 0; i < TEST_SAMPLES; i++)
+            fusion_update_raw(&fusion, &still, TEST_DT);
+        fusion_get_euler(&fusion, &euler);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, heading, euler.z);
+        TEST_ASSERT_FLOAT_WITHIN(0.1f, 0, euler.x);
+        TEST_ASSERT_FLOAT_WITHIN(0.1f, 0, euler.y);
+    }
+}
+
+int main(void)
+{
+    make_samples();
+    UNITY_BEGIN();
+    RUN_TEST(test_madgwick_accuracy);
+    RUN_TEST(test_mahony_accuracy);
+    RUN_TEST(test_align);
+    RUN_TEST(test_still);
+    RUN_TEST(test_gyro_bias);
+    return UNITY_END();
+}
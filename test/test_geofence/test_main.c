@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unity.h>
+#include "geofence.h"
+
+#define TEST_ZONES (8)
+#define TEST_POLYGONS (2000)
+#define TEST_LOOKUPS (20000)
+
+static geofence_zone_t x_zones[TEST_ZONES];
+static uint16_t x_polygon_zone[TEST_POLYGONS];
+static uint32_t x_polygon_vertices[TEST_POLYGONS];
+static geofence_point_t x_vertices[TEST_POLYGONS * 16];
+static uint32_t x_vertex_count;
+static uint8_t *x_image;
+static size_t x_image_size;
+
+static const double x_sites[3][2] = { {45.5, -122.6}, {-33.9, 151.2}, {51.5, -0.1} };
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static double frand(void)
+{
+    return rand() / (RAND_MAX + 1.0);
+}
+
+static geofence_point_t near_site(int site)
+{
+    geofence_point_t point = { (int32_t)lround((x_sites[site][0] + (frand() - 0.5) * 0.52) * 1e7),
+                               (int32_t)lround((x_sites[site][1] + (frand() - 0.5) * 0.52) * 1e7) };
+
+    return point;
+}
+
+//small irregular polygons of 3 to 16 vertices clustered around three sites, overlapping here and there
+static void make_image(void)
+{
+    srand(1);
+    for(int z = 0; z < TEST_ZONES; z++)
+    {
+        x_zones[z].id = 100 + z;
+        x_zones[z].priority = z % 3;
+        x_zones[z].threshold = 16 * (3 + z);
+        x_zones[z].lower_speed = -1;
+        x_zones[z].upper_speed = 10 + z;
+    }
+    for(int p = 0; p < TEST_POLYGONS; p++)
+    {
+        double lat = x_sites[p % 3][0] + (frand() - 0.5) * 0.5, lon = x_sites[p % 3][1] + (frand() - 0.5) * 0.5;
+        double radius = 0.001 + frand() * 0.01;
+
+        x_polygon_zone[p] = rand() % TEST_ZONES;
+        x_polygon_vertices[p] = 3 + rand() % 14;
+        for(uint32_t k = 0; k < x_polygon_vertices[p]; k++, x_vertex_count++)
+        {
+            double angle = 2 * M_PI * k / x_polygon_vertices[p], r = radius * (0.4 + 0.6 * frand());
+
+            x_vertices[x_vertex_count].lat = (int32_t)lround((lat + r * sin(angle)) * 1e7);
+            x_vertices[x_vertex_count].lon = (int32_t)lround((lon + r * cos(angle)) * 1e7);
+        }
+    }
+
+    x_image_size = geofence_image_size(TEST_ZONES, TEST_POLYGONS, x_vertex_count);
+    x_image = malloc(x_image_size);
+    TEST_ASSERT_EQUAL(ESP_OK, geofence_image_build(x_zones, TEST_ZONES, x_polygon_zone, x_polygon_vertices, TEST_POLYGONS,
+                                                   x_vertices, x_vertex_count, x_image, x_image_size));
+}
+
+static void test_lookup_matches_brute_force(void)
+{
+    geofence_t fence;
+    uint32_t hits = 0;
+
+    //the R-tree finds the same zone as walking every polygon, the highest priority one where they overlap
+    TEST_ASSERT_EQUAL(ESP_OK, geofence_load(&fence, x_image, x_image_size));
+    TEST_ASSERT_EQUAL(TEST_POLYGONS, fence.polygon_count);
+    for(int i = 0; i < TEST_LOOKUPS; i++)
+    {
+        geofence_point_t point = near_site(i % 3);
+        int32_t best = -1, got;
+
+        for(uint32_t p = 0; p < fence.polygon_count; p++)
+        {
+            const geofence_polygon_t *polygon = &fence.polygons[p];
+            int32_t zone = polygon->zone;
+
+            if(geofence_point_in_polygon(&fence.vertices[polygon->first_vertex], polygon->vertex_count, point) &&
+               (best < 0 || x_zones[zone].priority > x_zones[best].priority || (x_zones[zone].priority == x_zones[best].priority && zone < best)))
+                best = zone;
+        }
+        got = geofence_lookup(&fence, point, NULL, NULL);
+        TEST_ASSERT_EQUAL(best, got);
+        hits += got >= 0;
+    }
+    TEST_ASSERT_GREATER_THAN(0, hits);
+    TEST_ASSERT_LESS_THAN(TEST_LOOKUPS, hits);
+    geofence_free(&fence);
+}
+
+static void test_point_in_polygon(void)
+{
+    geofence_point_t square[4] = { {0, 0}, {0, 100}, {100, 100}, {100, 0} };
+
+    TEST_ASSERT_TRUE(geofence_point_in_polygon(square, 4, (geofence_point_t){50, 50}));
+    TEST_ASSERT_FALSE(geofence_point_in_polygon(square, 4, (geofence_point_t){150, 50}));
+    TEST_ASSERT_FALSE(geofence_point_in_polygon(square, 4, (geofence_point_t){50, -1}));
+}
+
+static void test_corrupt_image(void)
+{
+    geofence_t fence;
+    uint8_t *image = malloc(x_image_size);
+
+    memcpy(image, x_image, x_image_size);
+    image[x_image_size - 1] ^= 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, geofence_load(&fence, image, x_image_size));
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, geofence_load(&fence, image, sizeof(geofence_header_t) - 1));
+    free(image);
+}
+
+static void test_apply_zone(void)
+{
+    decision_params_t params = { 10, 0, 50 };
+    decision_axes_params_t axes;
+    geofence_zone_t zone = { .id = 7, .threshold = 40, .pitch_upper = 80, .pitch_lower = -64, .roll_upper = 48, .roll_lower = -48,
+                             .lower_speed = 1, .upper_speed = 20 };
+
+    //the zone's limits replace the ones they cover, dwell and hysteresis stay
+    decision_default_axes_params(&axes);
+    uint32_t dwell = axes.axis[DECISION_AXIS_ROLL].dwell_ms;
+    geofence_apply_zone(&zone, &params, &axes);
+
+    TEST_ASSERT_EQUAL_FLOAT(2.5f, params.threshold_angle);
+    TEST_ASSERT_EQUAL_FLOAT(20, params.upper_speed);
+    TEST_ASSERT_EQUAL_FLOAT(5, axes.axis[DECISION_AXIS_PITCH].upper);
+    TEST_ASSERT_EQUAL_FLOAT(-4, axes.axis[DECISION_AXIS_PITCH].lower);
+    TEST_ASSERT_EQUAL_FLOAT(-3, axes.axis[DECISION_AXIS_ROLL].lower);
+    TEST_ASSERT_EQUAL_FLOAT(1, axes.axis[DECISION_AXIS_ROLL].lower_speed);
+    TEST_ASSERT_EQUAL(dwell, axes.axis[DECISION_AXIS_ROLL].dwell_ms);
+}
+
+int main(void)
+{
+    make_image();
+    UNITY_BEGIN();
+    RUN_TEST(test_lookup_matches_brute_force);
+    RUN_TEST(test_point_in_polygon);
+    RUN_TEST(test_corrupt_image);
+    RUN_TEST(test_apply_zone);
+    return UNITY_END();
+}
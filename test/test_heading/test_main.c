@@ -0,0 +1,76 @@
+#include <math.h>
+#include <unity.h>
+#include "idfhost.h"
+#include "heading.h"
+
+#define TEST_YAW (30.0f) //board points this far left of the direction of travel
+#define TEST_VARIATION (10.0f) //east
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_wrap180(void)
+{
+    TEST_ASSERT_EQUAL_FLOAT(-170, heading_wrap180(190));
+    TEST_ASSERT_EQUAL_FLOAT(170, heading_wrap180(-190));
+    TEST_ASSERT_EQUAL_FLOAT(-180, heading_wrap180(540));
+    TEST_ASSERT_EQUAL_FLOAT(45, heading_wrap180(45));
+}
+
+static void test_rotate(void)
+{
+    float yaw = TEST_YAW * (float)M_PI / 180;
+    bno055_vec3_t board = { 4 * cosf(yaw), -4 * sinf(yaw), 0 }, track;
+
+    //a 4 degree grade seen by a board yawed off the track comes back as all grade and no lean
+    heading_rotate(&board, TEST_YAW, &track);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 4, track.x);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0, track.y);
+}
+
+static void test_offset(void)
+{
+    heading_estimate_t estimate;
+    gps_t gps = {0};
+    int64_t now_us = 0;
+    float course = 0, offset;
+
+    //two minutes driving with the IMU at 3 Hz and a fix every second, the course swinging slowly then one sharp turn that
+    //has to be left out
+    TEST_ASSERT_EQUAL(ESP_OK, heading_init(0));
+    gps.fix = GPS_FIX_GPS;
+    gps.speed = 15;
+    gps.variation = TEST_VARIATION;
+    for(int t = 0; t < 120; t++)
+    {
+        course = t < 60 ? t * 0.5f : (t < 63 ? 30 + (t - 59) * 30 : 120);
+        for(int k = 0; k < 3; k++)
+        {
+            bno055_vec3_t angle = { 0, 0, fmodf(course - TEST_YAW - TEST_VARIATION + 720, 360) };
+
+            now_us += 333000;
+            idfhost_set_time(now_us);
+            heading_update(&angle, (uint32_t)(now_us / 1000), &offset);
+        }
+        gps.cog = fmodf(course + 360, 360);
+        heading_gps_fix(&gps);
+    }
+    idfhost_set_time(-1);
+    TEST_ASSERT_EQUAL(ESP_OK, heading_get(&estimate));
+
+    TEST_ASSERT_TRUE(estimate.calibrated);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, TEST_YAW, estimate.offset);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, course, estimate.heading);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, course - TEST_YAW, estimate.mag_heading);
+    TEST_ASSERT_GREATER_THAN(0, estimate.turning);
+    TEST_ASSERT_EQUAL(120 - estimate.turning, estimate.gps_updates);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_wrap180);
+    RUN_TEST(test_rotate);
+    RUN_TEST(test_offset);
+    return UNITY_END();
+}
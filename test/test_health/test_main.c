@@ -0,0 +1,142 @@
+#include <string.h>
+#include <unity.h>
+#include "idfhost.h"
+#include "health.h"
+#include "triplog.h"
+
+#define TEST_TASKS (4)
+#define TEST_SECOND_US (1000000)
+
+static TaskStatus_t x_tasks[HEALTH_MAX_TASKS + 4];
+static triplog_sim_t x_sim;
+static triplog_flash_t x_flash;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void set_task(int i, const char *name, UBaseType_t priority, uint32_t stack_free, uint32_t run_time)
+{
+    x_tasks[i].xHandle = (TaskHandle_t)(uintptr_t)(0x3fc80000 + i * 0x100);
+    x_tasks[i].pcTaskName = name;
+    x_tasks[i].uxCurrentPriority = priority;
+    x_tasks[i].usStackHighWaterMark = stack_free;
+    x_tasks[i].ulRunTimeCounter = run_time;
+}
+
+//both idle tasks, main and the NMEA task, with run time counters after a second of running. The total counts one core's time.
+static void set_tasks(uint32_t second)
+{
+    set_task(0, "IDLE0", 0, 1000, second * 700000);
+    set_task(1, "IDLE1", 0, 1000, second * 900000);
+    set_task(2, "main", 1, 500, second * 300000);
+    set_task(3, "nmea_parser_task", 5, 300, second * 100000);
+    idfhost_set_tasks(x_tasks, TEST_TASKS, second * TEST_SECOND_US);
+}
+
+static void test_not_started(void)
+{
+    health_t health;
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, health_sample(&health));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, health_get(&health));
+}
+
+static void test_sample(void)
+{
+    health_t health, latest;
+
+    //the first sample is only the run time baseline, CPU figures come from the difference to the next
+    idfhost_set_heap(200000, 150000, 50000);
+    set_tasks(0);
+    TEST_ASSERT_EQUAL(ESP_OK, health_init(0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, health_init(0));
+    set_tasks(1);
+    TEST_ASSERT_EQUAL(ESP_OK, health_sample(&health));
+
+    TEST_ASSERT_EQUAL(2, health.sample);
+    TEST_ASSERT_EQUAL(200000, health.heap_free);
+    TEST_ASSERT_EQUAL(150000, health.heap_min_free);
+    TEST_ASSERT_EQUAL(50000, health.heap_largest_block);
+    TEST_ASSERT_EQUAL(750, health.heap_fragmentation_permille);
+
+    TEST_ASSERT_EQUAL(TEST_TASKS, health.task_count);
+    TEST_ASSERT_EQUAL(700, health.idle_permille[0]);
+    TEST_ASSERT_EQUAL(900, health.idle_permille[1]);
+    TEST_ASSERT_EQUAL(350, health.tasks[0].cpu_permille);
+    TEST_ASSERT_EQUAL(150, health.tasks[2].cpu_permille);
+    TEST_ASSERT_EQUAL(50, health.tasks[3].cpu_permille);
+    TEST_ASSERT_EQUAL(5, health.tasks[3].priority);
+    TEST_ASSERT_EQUAL_STRING("nmea_parser_tas", health.tasks[3].name);
+    TEST_ASSERT_EQUAL(300, health.min_stack_free);
+    TEST_ASSERT_EQUAL_STRING("nmea_parser_tas", health.min_stack_task);
+
+    TEST_ASSERT_EQUAL(ESP_OK, health_get(&latest));
+    TEST_ASSERT_EQUAL_MEMORY(&health, &latest, sizeof(health_t));
+}
+
+static void test_too_many_tasks(void)
+{
+    health_t health;
+
+    //FreeRTOS hands back nothing when the array is too small, the heap figures still come through
+    for(int i = 0; i < HEALTH_MAX_TASKS + 1; i++)
+        set_task(i, "worker", 1, 800, 0);
+    idfhost_set_tasks(x_tasks, HEALTH_MAX_TASKS + 1, 2 * TEST_SECOND_US);
+    TEST_ASSERT_EQUAL(ESP_OK, health_sample(&health));
+
+    TEST_ASSERT_EQUAL(HEALTH_MAX_TASKS + 1, health.task_count);
+    TEST_ASSERT_EQUAL(0, health.tasks[0].name[0]);
+    TEST_ASSERT_EQUAL(200000, health.heap_free);
+}
+
+static void test_log(void)
+{
+    health_t health;
+    triplog_iter_t iter;
+    triplog_record_t record, last_task;
+    int tasks = 0;
+
+    //the system figures and then a record per task, in the order the console prints them
+    set_tasks(3);
+    TEST_ASSERT_EQUAL(ESP_OK, health_sample(&health));
+    set_tasks(4);
+    TEST_ASSERT_EQUAL(ESP_OK, health_sample(&health));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_sim_init(&x_sim, &x_flash, 8 * TRIPLOG_SECTOR_SIZE));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_open(&x_flash));
+    TEST_ASSERT_EQUAL(ESP_OK, health_log(&health));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_flush());
+
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_iter_begin(&iter));
+    while(triplog_iter_next(&iter, &record) == ESP_OK && record.type != TRIPLOG_RECORD_HEALTH);
+    TEST_ASSERT_EQUAL(TRIPLOG_RECORD_HEALTH, record.type);
+    TEST_ASSERT_EQUAL(TEST_TASKS, record.flags);
+    TEST_ASSERT_EQUAL(200000, record.payload.health.heap_free);
+    TEST_ASSERT_EQUAL(750, record.payload.health.heap_fragmentation_permille);
+    TEST_ASSERT_EQUAL(300, record.payload.health.min_stack_free);
+    TEST_ASSERT_EQUAL(700, record.payload.health.idle_permille[0]);
+
+    while(triplog_iter_next(&iter, &record) == ESP_OK && record.type == TRIPLOG_RECORD_HEALTH_TASK)
+    {
+        TEST_ASSERT_EQUAL(tasks, record.payload.health_task.index);
+        TEST_ASSERT_EQUAL(health.tasks[tasks].stack_free, record.payload.health_task.stack_free);
+        TEST_ASSERT_EQUAL(health.tasks[tasks].cpu_permille, record.payload.health_task.cpu_permille);
+        TEST_ASSERT_EQUAL(health.tasks[tasks].priority, record.payload.health_task.priority);
+        last_task = record;
+        tasks++;
+    }
+    TEST_ASSERT_EQUAL(TEST_TASKS, tasks);
+    TEST_ASSERT_EQUAL_MEMORY("nmea_parser_", last_task.payload.health_task.name, 12);
+
+    triplog_close();
+    triplog_sim_deinit(&x_sim);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_not_started);
+    RUN_TEST(test_sample);
+    RUN_TEST(test_too_many_tasks);
+    RUN_TEST(test_log);
+    return UNITY_END();
+}
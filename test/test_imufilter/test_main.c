@@ -0,0 +1,113 @@
+#include <math.h>
+#include <unity.h>
+#include "imufilter.h"
+
+#define TEST_SAMPLE_HZ (100.0f)
+#define TEST_LEN (200)
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_biquad_step(void)
+{
+    imufilter_t filter;
+    float in[TEST_LEN], out[TEST_LEN];
+
+    //starts on the first sample instead of climbing up from 0, then settles on the new level. Butterworth overshoots a
+    //step by a little over 4%.
+    for(int i = 0; i < TEST_LEN; i++)
+        in[i] = i < 10 ? 2 : 7;
+    TEST_ASSERT_EQUAL(ESP_OK, imufilter_init(&filter, IMUFILTER_BIQUAD, TEST_SAMPLE_HZ, 5, 0));
+    TEST_ASSERT_EQUAL(ESP_OK, imufilter_process(&filter, 0, in, out, TEST_LEN));
+
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 2, out[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 2, out[9]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 7, out[TEST_LEN - 1]);
+    for(int i = 0; i < TEST_LEN; i++)
+        TEST_ASSERT_FLOAT_WITHIN(7 + 0.05f * 5, 0, out[i]);
+}
+
+static void test_biquad_vibration(void)
+{
+    imufilter_t filter;
+    float in[TEST_LEN], out[TEST_LEN], peak = 0;
+
+    //35 Hz engine vibration on a 3 degree lean comes out well under a tenth of its size
+    for(int i = 0; i < TEST_LEN; i++)
+        in[i] = 3 + sinf(2 * (float)M_PI * 35 * i / TEST_SAMPLE_HZ);
+    TEST_ASSERT_EQUAL(ESP_OK, imufilter_init(&filter, IMUFILTER_BIQUAD, TEST_SAMPLE_HZ, 5, 0));
+    TEST_ASSERT_EQUAL(ESP_OK, imufilter_process(&filter, 1, in, out, TEST_LEN));
+
+    for(int i = TEST_LEN / 2; i < TEST_LEN; i++)
+        peak = fabsf(out[i] - 3) > peak ? fabsf(out[i] - 3) : peak;
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 0, peak);
+}
+
+static void test_blocks_carry_state(void)
+{
+    imufilter_t whole, blocks;
+    float in[64], out_whole[64], out_blocks[64];
+
+    //a block at a time gives the same samples as one long block
+    for(int i = 0; i < 64; i++)
+        in[i] = sinf(i * 0.3f) * 4;
+    TEST_ASSERT_EQUAL(ESP_OK, imufilter_init(&whole, IMUFILTER_BIQUAD, TEST_SAMPLE_HZ, 8, 0));
+    TEST_ASSERT_EQUAL(ESP_OK, imufilter_init(&blocks, IMUFILTER_BIQUAD, TEST_SAMPLE_HZ, 8, 0));
+    TEST_ASSERT_EQUAL(ESP_OK, imufilter_process(&whole, 0, in, out_whole, 64));
+    for(int i = 0; i < 64; i += 8)
+        TEST_ASSERT_EQUAL(ESP_OK, imufilter_process(&blocks, 0, in + i, out_blocks + i, 8));
+
+    TEST_ASSERT_EQUAL_MEMORY(out_whole, out_blocks, sizeof(out_whole));
+}
+
+static void test_median_spike(void)
+{
+    imufilter_t filter;
+    float in[6] = {1, 1, 50, 1, 2, 2}, out[6];
+
+    //a single bad sample never reaches the output, a real change does a sample later
+    TEST_ASSERT_EQUAL(ESP_OK, imufilter_init(&filter, IMUFILTER_MEDIAN, 0, 0, 3));
+    TEST_ASSERT_EQUAL(ESP_OK, imufilter_process(&filter, 1, in, out, 6));
+    for(int i = 0; i < 6; i++)
+        TEST_ASSERT_LESS_THAN(50, out[i]);
+    TEST_ASSERT_EQUAL_FLOAT(2, out[5]);
+}
+
+static void test_apply(void)
+{
+    imufilter_t filter;
+    bno055_vec3_t angle = {1.5, -2.25, 123};
+
+    //heading goes through untouched, so does everything with no filter
+    TEST_ASSERT_EQUAL(ESP_OK, imufilter_init(&filter, IMUFILTER_NONE, 0, 0, 0));
+    imufilter_apply(&filter, &angle);
+    TEST_ASSERT_EQUAL_FLOAT(1.5f, angle.x);
+    TEST_ASSERT_EQUAL_FLOAT(-2.25f, angle.y);
+    TEST_ASSERT_EQUAL_FLOAT(123, angle.z);
+
+    TEST_ASSERT_EQUAL(ESP_OK, imufilter_init(&filter, IMUFILTER_BIQUAD, TEST_SAMPLE_HZ, 5, 0));
+    imufilter_apply(&filter, &angle);
+    TEST_ASSERT_EQUAL_FLOAT(123, angle.z);
+}
+
+static void test_bad_config(void)
+{
+    imufilter_t filter;
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, imufilter_init(&filter, IMUFILTER_BIQUAD, 10, 5, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, imufilter_init(&filter, IMUFILTER_MEDIAN, 0, 0, IMUFILTER_MEDIAN_MAX + 1));
+    TEST_ASSERT_EQUAL(ESP_OK, imufilter_init(&filter, IMUFILTER_BIQUAD, TEST_SAMPLE_HZ, 5, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, imufilter_set_cutoff(&filter, TEST_SAMPLE_HZ, TEST_SAMPLE_HZ / 2));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_biquad_step);
+    RUN_TEST(test_biquad_vibration);
+    RUN_TEST(test_blocks_carry_state);
+    RUN_TEST(test_median_spike);
+    RUN_TEST(test_apply);
+    RUN_TEST(test_bad_config);
+    return UNITY_END();
+}
@@ -0,0 +1,105 @@
+#include <math.h>
+#include <unity.h>
+#include "imupair.h"
+
+#define TEST_AGREE_DEG (2.0f)
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_agree_average(void)
+{
+    bno055_vec3_t a = { 1, -2, 90 }, b = { 2, -1, 91 }, angle;
+
+    //the three axes together count towards the agreement, sqrt(3) apart is within 2 degrees
+    TEST_ASSERT_EQUAL(IMUPAIR_BOTH, imupair_vote(&a, ESP_OK, &b, ESP_OK, NULL, TEST_AGREE_DEG, &angle));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.5f, angle.x);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, -1.5f, angle.y);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 90.5f, angle.z);
+
+    b.z = 92;
+    TEST_ASSERT_EQUAL(IMUPAIR_DISAGREE, imupair_vote(&a, ESP_OK, &b, ESP_OK, NULL, TEST_AGREE_DEG, &angle));
+}
+
+static void test_agree_across_wrap(void)
+{
+    bno055_vec3_t a = { 179.5f, -179.5f, 359.5f }, b = { -179.5f, 179.5f, 0.5f }, angle;
+
+    //the halfway point is taken the short way round and put back in the BNO055 ranges, not averaged to 0 or 180
+    TEST_ASSERT_EQUAL(IMUPAIR_BOTH, imupair_vote(&a, ESP_OK, &b, ESP_OK, NULL, TEST_AGREE_DEG, &angle));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 180, fabsf(angle.x));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 180, fabsf(angle.y));
+    TEST_ASSERT_TRUE(angle.z < 1e-4f || angle.z > 360 - 1e-4f);
+
+    a.x = 179;
+    b.x = -177;
+    a.y = b.y = 0;
+    a.z = 358.5f;
+    b.z = 0.5f;
+    TEST_ASSERT_EQUAL(IMUPAIR_BOTH, imupair_vote(&a, ESP_OK, &b, ESP_OK, NULL, 5, &angle));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, -179, angle.x);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 359.5f, angle.z);
+}
+
+static void test_disagree_nearest_last(void)
+{
+    bno055_vec3_t a = { 10, 0, 90 }, b = { 1, 0, 90 }, last = { 0.5f, 0, 90 }, angle;
+
+    //the one that jumped is the one further from the last angle handed out
+    TEST_ASSERT_EQUAL(IMUPAIR_DISAGREE, imupair_vote(&a, ESP_OK, &b, ESP_OK, &last, TEST_AGREE_DEG, &angle));
+    TEST_ASSERT_EQUAL_FLOAT(1, angle.x);
+    last.x = 9;
+    TEST_ASSERT_EQUAL(IMUPAIR_DISAGREE, imupair_vote(&a, ESP_OK, &b, ESP_OK, &last, TEST_AGREE_DEG, &angle));
+    TEST_ASSERT_EQUAL_FLOAT(10, angle.x);
+
+    //the last angle is compared the short way round too
+    a.z = 300;
+    b.z = 5;
+    last.x = 5;
+    last.z = 355;
+    TEST_ASSERT_EQUAL(IMUPAIR_DISAGREE, imupair_vote(&a, ESP_OK, &b, ESP_OK, &last, TEST_AGREE_DEG, &angle));
+    TEST_ASSERT_EQUAL_FLOAT(5, angle.z);
+
+    //nothing to go on, the primary wins
+    TEST_ASSERT_EQUAL(IMUPAIR_DISAGREE, imupair_vote(&a, ESP_OK, &b, ESP_OK, NULL, TEST_AGREE_DEG, &angle));
+    TEST_ASSERT_EQUAL_FLOAT(10, angle.x);
+}
+
+static void test_failed_reads(void)
+{
+    bno055_vec3_t a = { 1, 2, 3 }, b = { 4, 5, 6 }, angle = { 7, 8, 9 };
+
+    TEST_ASSERT_EQUAL(IMUPAIR_NONE, imupair_vote(&a, ESP_FAIL, &b, ESP_ERR_TIMEOUT, NULL, TEST_AGREE_DEG, &angle));
+    TEST_ASSERT_EQUAL_FLOAT(7, angle.x);
+    TEST_ASSERT_EQUAL(IMUPAIR_PRIMARY_ONLY, imupair_vote(&a, ESP_OK, &b, ESP_ERR_TIMEOUT, NULL, TEST_AGREE_DEG, &angle));
+    TEST_ASSERT_EQUAL_FLOAT(1, angle.x);
+    TEST_ASSERT_EQUAL(IMUPAIR_SECONDARY_ONLY, imupair_vote(&a, ESP_FAIL, &b, ESP_OK, NULL, TEST_AGREE_DEG, &angle));
+    TEST_ASSERT_EQUAL_FLOAT(4, angle.x);
+}
+
+static void test_init(void)
+{
+    imupair_t pair;
+
+    //one IMU, or the same one twice, is not a pair
+    TEST_ASSERT_EQUAL(ESP_OK, imupair_init(&pair, I2C_NUMBER_0, I2C_NUMBER_MAX, true, TEST_AGREE_DEG));
+    TEST_ASSERT_FALSE(pair.dual);
+    TEST_ASSERT_EQUAL(ESP_OK, imupair_init(&pair, I2C_NUMBER_0, I2C_NUMBER_0, true, TEST_AGREE_DEG));
+    TEST_ASSERT_FALSE(pair.dual);
+
+    //with no task to read the second IMU on its own port, both are read one after the other
+    TEST_ASSERT_EQUAL(ESP_OK, imupair_init(&pair, I2C_NUMBER_0, I2C_NUMBER_1, true, TEST_AGREE_DEG));
+    TEST_ASSERT_TRUE(pair.dual);
+    TEST_ASSERT_FALSE(pair.parallel);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_agree_average);
+    RUN_TEST(test_agree_across_wrap);
+    RUN_TEST(test_disagree_nearest_last);
+    RUN_TEST(test_failed_reads);
+    RUN_TEST(test_init);
+    return UNITY_END();
+}
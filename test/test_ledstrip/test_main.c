@@ -0,0 +1,113 @@
+#include <string.h>
+#include <unity.h>
+#include "ledstrip.h"
+
+#define TEST_PIXELS (8)
+
+static uint8_t x_pixels[LEDSTRIP_MAX_PIXELS * LEDSTRIP_BYTES_PER_PIXEL];
+static ledstrip_frame_t x_frame;
+
+void setUp(void)
+{
+    memset(x_pixels, 0xAA, sizeof(x_pixels));
+    x_frame.lit = true;
+    x_frame.severity = LEDSTRIP_SEVERE;
+    x_frame.lean = LEDSTRIP_LEAN_NONE;
+    x_frame.brightness = 1023;
+}
+
+void tearDown(void) {}
+
+//red channel of a pixel, the bytes go out green, red, blue
+static uint8_t red(int pixel)
+{
+    return x_pixels[pixel * LEDSTRIP_BYTES_PER_PIXEL + 1];
+}
+
+static void test_dark(void)
+{
+    //an off frame clears the strip and nothing past it
+    x_frame.lit = false;
+    ledstrip_render(&x_frame, x_pixels, TEST_PIXELS);
+    for(int i = 0; i < TEST_PIXELS * LEDSTRIP_BYTES_PER_PIXEL; i++)
+        TEST_ASSERT_EQUAL_HEX8(0, x_pixels[i]);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, x_pixels[TEST_PIXELS * LEDSTRIP_BYTES_PER_PIXEL]);
+}
+
+static void test_severity_and_brightness(void)
+{
+    ledstrip_render(&x_frame, x_pixels, TEST_PIXELS);
+    for(int i = 0; i < TEST_PIXELS; i++)
+    {
+        TEST_ASSERT_EQUAL(0, x_pixels[i * LEDSTRIP_BYTES_PER_PIXEL]);
+        TEST_ASSERT_EQUAL(255, red(i));
+        TEST_ASSERT_EQUAL(0, x_pixels[i * LEDSTRIP_BYTES_PER_PIXEL + 2]);
+    }
+
+    //a warning is amber, dimmed with the duty the photoresistor gives the single LED
+    x_frame.severity = LEDSTRIP_WARN;
+    x_frame.brightness = 511;
+    ledstrip_render(&x_frame, x_pixels, TEST_PIXELS);
+    TEST_ASSERT_EQUAL(0x30, x_pixels[0]);
+    TEST_ASSERT_EQUAL(127, red(0));
+
+    //brightness out of range is clamped
+    x_frame.brightness = -5;
+    ledstrip_render(&x_frame, x_pixels, TEST_PIXELS);
+    TEST_ASSERT_EQUAL(0, red(TEST_PIXELS - 1));
+    x_frame.brightness = 5000;
+    ledstrip_render(&x_frame, x_pixels, TEST_PIXELS);
+    TEST_ASSERT_EQUAL(255, red(0));
+}
+
+static void test_lean_arrow(void)
+{
+    uint8_t right[TEST_PIXELS];
+
+    //leaning right the arrow ramps up towards the last pixel, the near half is dark
+    x_frame.lean = LEDSTRIP_LEAN_RIGHT;
+    ledstrip_render(&x_frame, x_pixels, TEST_PIXELS);
+    for(int i = 0; i < TEST_PIXELS / 2; i++)
+        TEST_ASSERT_EQUAL(0, red(i));
+    for(int i = TEST_PIXELS / 2; i < TEST_PIXELS - 1; i++)
+        TEST_ASSERT_LESS_THAN(red(i + 1), red(i));
+    TEST_ASSERT_EQUAL(255, red(TEST_PIXELS - 1));
+    for(int i = 0; i < TEST_PIXELS; i++)
+        right[i] = red(i);
+
+    //leaning left is the mirror image
+    x_frame.lean = LEDSTRIP_LEAN_LEFT;
+    ledstrip_render(&x_frame, x_pixels, TEST_PIXELS);
+    for(int i = 0; i < TEST_PIXELS; i++)
+        TEST_ASSERT_EQUAL(right[TEST_PIXELS - 1 - i], red(i));
+
+    //a one pixel strip still shows something
+    x_frame.lean = LEDSTRIP_LEAN_RIGHT;
+    ledstrip_render(&x_frame, x_pixels, 1);
+    TEST_ASSERT_EQUAL(255, red(0));
+}
+
+static void test_bad_config(void)
+{
+    ledstrip_bench_t bench;
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, ledstrip_bench(0, &bench));
+    TEST_ASSERT_EQUAL(ESP_OK, ledstrip_bench(TEST_PIXELS, &bench));
+    TEST_ASSERT_EQUAL(LEDSTRIP_SYMBOLS(TEST_PIXELS) * LEDSTRIP_BIT_NS / 1000 + LEDSTRIP_RESET_US, bench.wire_us);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, ledstrip_init(5, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, ledstrip_init(5, LEDSTRIP_MAX_PIXELS + 1));
+
+    //no RMT on the host, the failed init cleans up after itself
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, ledstrip_init(5, TEST_PIXELS));
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, ledstrip_init(5, TEST_PIXELS));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_dark);
+    RUN_TEST(test_severity_and_brightness);
+    RUN_TEST(test_lean_arrow);
+    RUN_TEST(test_bad_config);
+    return UNITY_END();
+}
@@ -0,0 +1,207 @@
+#include <string.h>
+#include <math.h>
+#include <unity.h>
+#include "idfhost.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "mount.h"
+
+#define TEST_PLACEMENT (3)
+#define TEST_TILT_X (8.0) //the board as bolted in, not level with the car
+#define TEST_TILT_Y (-6.0)
+#define TEST_DEG_TO_RAD (M_PI / 180.0)
+
+//register addresses from the datasheet, table 4-2
+#define TEST_REG_CHIP_ID (0x00)
+#define TEST_REG_EUL_HEADING (0x1A) //heading, then y, then x, 16 LSB per degree
+#define TEST_REG_AXIS_MAP_CONFIG (0x41)
+#define TEST_REG_AXIS_MAP_SIGN (0x42)
+
+static idfhost_i2c_bus_t *x_bus;
+
+void setUp(void)
+{
+    bno055_config_t conf;
+
+    nvs_flash_erase();
+    x_bus = idfhost_i2c_bus();
+    memset(x_bus, 0, sizeof(idfhost_i2c_bus_t));
+    x_bus->addr = BNO055_ADDRESS_A;
+    x_bus->regs[0][TEST_REG_CHIP_ID] = BNO055_ID;
+    bno055_set_default_conf(&conf);
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_open(I2C_NUMBER_0, &conf));
+    TEST_ASSERT_EQUAL(ESP_OK, bno055_set_opmode(I2C_NUMBER_0, OPERATION_MODE_NDOF));
+}
+
+void tearDown(void)
+{
+    bno055_close(I2C_NUMBER_0);
+}
+
+//rotation matrix of an euler reading, worked out apart from the quaternions under test: heading clockwise about z, then y, then x
+static void rotation(double x, double y, double z, double m[3][3])
+{
+    double cx = cos(x * TEST_DEG_TO_RAD), sx = sin(x * TEST_DEG_TO_RAD), cy = cos(y * TEST_DEG_TO_RAD), sy = sin(y * TEST_DEG_TO_RAD);
+    double cz = cos(-z * TEST_DEG_TO_RAD), sz = sin(-z * TEST_DEG_TO_RAD);
+    double r[3][3] = {
+        { cz*cy, cz*sy*sx - sz*cx, cz*sy*cx + sz*sx },
+        { sz*cy, sz*sy*sx + cz*cx, sz*sy*cx - cz*sx },
+        { -sy, cy*sx, cy*cx },
+    };
+
+    memcpy(m, r, sizeof(r));
+}
+
+//what the IMU reads with the car at x, y, heading z and the board tilted in it, on the 1/16 degree grid the BNO055 reports in
+static bno055_vec3_t reading(double x, double y, double z)
+{
+    double car[3][3], board[3][3], m[3][3];
+    bno055_vec3_t euler;
+
+    rotation(x, y, z, car);
+    rotation(TEST_TILT_X, TEST_TILT_Y, 0, board);
+    for(int i = 0; i < 3; i++)
+        for(int j = 0; j < 3; j++)
+            m[i][j] = car[i][0] * board[0][j] + car[i][1] * board[1][j] + car[i][2] * board[2][j];
+
+    double heading = -atan2(m[1][0], m[0][0]) / TEST_DEG_TO_RAD;
+    euler.x = lround(atan2(m[2][1], m[2][2]) / TEST_DEG_TO_RAD * 16) / 16.0;
+    euler.y = lround(asin(-m[2][0]) / TEST_DEG_TO_RAD * 16) / 16.0;
+    euler.z = lround((heading < 0 ? heading + 360 : heading) * 16) / 16.0;
+    return euler;
+}
+
+//puts a reading in the chip's euler registers
+static void set_euler(const bno055_vec3_t *euler)
+{
+    int16_t v[3] = { (int16_t)lround(euler->z * 16), (int16_t)lround(euler->y * 16), (int16_t)lround(euler->x * 16) };
+
+    for(int i = 0; i < 3; i++)
+    {
+        x_bus->regs[0][TEST_REG_EUL_HEADING + 2 * i] = v[i] & 0xFF;
+        x_bus->regs[0][TEST_REG_EUL_HEADING + 2 * i + 1] = (uint16_t)v[i] >> 8;
+    }
+}
+
+//captures with the car level, facing somewhere other than north
+static void capture(mount_t *mount)
+{
+    bno055_vec3_t level = reading(0, 0, 123);
+
+    set_euler(&level);
+    TEST_ASSERT_EQUAL(ESP_OK, mount_init(mount, TEST_PLACEMENT));
+    TEST_ASSERT_FALSE(mount->has_reference);
+    TEST_ASSERT_EQUAL(ESP_OK, mount_capture_reference(mount, I2C_NUMBER_0));
+    TEST_ASSERT_TRUE(mount->has_reference);
+}
+
+static void test_remap(void)
+{
+    mount_t mount;
+
+    //P3 and P6 from the datasheet, section 3.4
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, mount_init(&mount, 8));
+    TEST_ASSERT_EQUAL(ESP_OK, mount_init(&mount, 3));
+    TEST_ASSERT_EQUAL(ESP_OK, mount_remap_imu(&mount, I2C_NUMBER_0));
+    TEST_ASSERT_EQUAL_HEX8(0x21, x_bus->regs[0][TEST_REG_AXIS_MAP_CONFIG]);
+    TEST_ASSERT_EQUAL_HEX8(0x02, x_bus->regs[0][TEST_REG_AXIS_MAP_SIGN]);
+    TEST_ASSERT_EQUAL(ESP_OK, mount_init(&mount, 6));
+    TEST_ASSERT_EQUAL(ESP_OK, mount_remap_imu(&mount, I2C_NUMBER_0));
+    TEST_ASSERT_EQUAL_HEX8(0x21, x_bus->regs[0][TEST_REG_AXIS_MAP_CONFIG]);
+    TEST_ASSERT_EQUAL_HEX8(0x07, x_bus->regs[0][TEST_REG_AXIS_MAP_SIGN]);
+}
+
+static void test_apply_rotates(void)
+{
+    const double cars[][3] = { { 0, 0, 123 }, { 0, 20, 70 }, { 15, 0, 200 }, { 10, -15, 40 }, { -25, 12, 359 } };
+    mount_t mount;
+
+    //the car's own angles come back whatever it leans and faces. Taking the board's angles off one another would be a
+    //third of a degree out at 10 and -15, and grows with the lean.
+    capture(&mount);
+    for(size_t i = 0; i < sizeof(cars) / sizeof(cars[0]); i++)
+    {
+        bno055_vec3_t angle = reading(cars[i][0], cars[i][1], cars[i][2]);
+
+        mount_apply(&mount, &angle);
+        TEST_ASSERT_FLOAT_WITHIN(0.1, cars[i][0], angle.x);
+        TEST_ASSERT_FLOAT_WITHIN(0.1, cars[i][1], angle.y);
+        TEST_ASSERT_FLOAT_WITHIN(0.1, 0, remainder(angle.z - cars[i][2], 360));
+
+        //and the result is back on the grid the trip log keeps
+        TEST_ASSERT_EQUAL_FLOAT(lround(angle.x * 16) / 16.0, angle.x);
+        TEST_ASSERT_EQUAL_FLOAT(lround(angle.y * 16) / 16.0, angle.y);
+    }
+
+    //nothing is done without a reference
+    bno055_vec3_t angle = { 1.5, 2.5, 3.5 };
+    TEST_ASSERT_EQUAL(ESP_OK, mount_clear_reference(&mount));
+    mount_apply(&mount, &angle);
+    TEST_ASSERT_EQUAL_FLOAT(1.5, angle.x);
+}
+
+static void test_nvs_blob(void)
+{
+    mount_t captured, loaded;
+    nvs_handle_t handle;
+    uint8_t blob[16];
+    size_t size = sizeof(blob);
+
+    //the stored quaternion is what the capture applies, to the last bit, so a reboot corrects exactly the same
+    capture(&captured);
+    TEST_ASSERT_EQUAL(ESP_OK, mount_init(&loaded, TEST_PLACEMENT));
+    TEST_ASSERT_TRUE(loaded.has_reference);
+    TEST_ASSERT_EQUAL_MEMORY(&captured.reference, &loaded.reference, sizeof(bno055_quaternion_t));
+
+    //version, placement and w x y z in 1/2^14 steps
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_open(MOUNT_NVS_NAMESPACE, NVS_READONLY, &handle));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_get_blob(handle, MOUNT_NVS_KEY, blob, &size));
+    TEST_ASSERT_EQUAL(10, size);
+    TEST_ASSERT_EQUAL(MOUNT_NVS_VERSION, blob[0]);
+    TEST_ASSERT_EQUAL(TEST_PLACEMENT, blob[1]);
+    int16_t w;
+    memcpy(&w, blob + 2, sizeof(w));
+    TEST_ASSERT_EQUAL(lround(cos(TEST_TILT_X * TEST_DEG_TO_RAD / 2) * cos(TEST_TILT_Y * TEST_DEG_TO_RAD / 2) * MOUNT_QUAT_LSB), w);
+
+    //a reference from another placement means nothing here
+    TEST_ASSERT_EQUAL(ESP_OK, mount_init(&loaded, TEST_PLACEMENT + 1));
+    TEST_ASSERT_FALSE(loaded.has_reference);
+
+    //cleared, there is nothing to load
+    TEST_ASSERT_EQUAL(ESP_OK, mount_clear_reference(&captured));
+    TEST_ASSERT_EQUAL(ESP_OK, mount_init(&loaded, TEST_PLACEMENT));
+    TEST_ASSERT_FALSE(loaded.has_reference);
+}
+
+static void test_nvs_version(void)
+{
+    mount_t mount;
+    nvs_handle_t handle;
+    uint8_t blob[16];
+    size_t size = sizeof(blob);
+    //the euler offsets the firmware kept before, version 2: placement then x and y in 1/16 degree
+    const uint8_t old[6] = { 2, TEST_PLACEMENT, 0x80, 0x00, 0xa0, 0xff };
+
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_open(MOUNT_NVS_NAMESPACE, NVS_READWRITE, &handle));
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_set_blob(handle, MOUNT_NVS_KEY, old, sizeof(old)));
+    TEST_ASSERT_EQUAL(ESP_OK, mount_init(&mount, TEST_PLACEMENT));
+    TEST_ASSERT_FALSE(mount.has_reference);
+
+    //a blob of the right size with another version is ignored too
+    capture(&mount);
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_get_blob(handle, MOUNT_NVS_KEY, blob, &size));
+    blob[0] = MOUNT_NVS_VERSION + 1;
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_set_blob(handle, MOUNT_NVS_KEY, blob, size));
+    TEST_ASSERT_EQUAL(ESP_OK, mount_init(&mount, TEST_PLACEMENT));
+    TEST_ASSERT_FALSE(mount.has_reference);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_remap);
+    RUN_TEST(test_apply_rotates);
+    RUN_TEST(test_nvs_blob);
+    RUN_TEST(test_nvs_version);
+    return UNITY_END();
+}
@@ -0,0 +1,291 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unity.h>
+#include "idfhost.h"
+#include "replay.h"
+#include "analysis.h"
+#include "sweep.h"
+#include "heading.h"
+#include "geofence.h"
+
+#define TEST_SAMPLES (2000) //per session
+#define TEST_SECTORS (64)
+#define TEST_PERIOD_MS (10)
+#define TEST_SPEED (5.0f) //inside the parameters.h speed range
+#define TEST_HORIZON_MS (220.0f)
+#define TEST_MIDNIGHT_US (845078400000000LL) //GPS time of a midnight UTC
+
+static triplog_sim_t x_sim;
+static triplog_flash_t x_flash;
+
+void setUp(void) {}
+
+void tearDown(void)
+{
+    triplog_close();
+    triplog_sim_deinit(&x_sim);
+}
+
+//logs a session the way the live loop does, with every input a decision can carry: zone limits switched in and out, grade
+//taken off the pitch on every other sample, the board turned to the track on every other, and either the combined angle or
+//the per axis decision
+static void drive(bool axes)
+{
+    decision_params_t params;
+    decision_axes_params_t axes_params;
+    decision_state_t state = {0};
+    decision_axes_state_t axes_state = {0};
+    geofence_zone_t zone = { .id = 7, .threshold = 3 * 16, .pitch_upper = 2 * 16, .pitch_lower = -2 * 16, .roll_upper = 2 * 16,
+                             .roll_lower = -2 * 16, .lower_speed = 0, .upper_speed = 100 };
+
+    decision_default_params(&params);
+    decision_default_axes_params(&axes_params);
+    for(int i = 0; i < TEST_SAMPLES; i++)
+    {
+        if(i % 400 == 100 || i % 400 == 300)
+        {
+            geofence_zone_t active = zone;
+
+            decision_default_params(&params);
+            decision_default_axes_params(&axes_params);
+            if(i % 400 == 300)
+                active.id = GEOFENCE_NO_ZONE;
+            else
+                geofence_apply_zone(&active, &params, &axes_params);
+            geofence_log(&active);
+        }
+
+        bno055_vec3_t angle = { (rand() % 200 - 100) / 16.0f, (rand() % 200 - 100) / 16.0f, rand() % 360 }, judged = angle;
+        float speed = (rand() % 200) / 10.0f, track = 0, grade = 0;
+        uint8_t flags = 0;
+        bool on;
+
+        //the log keeps track and grade to 1/16 degree, so only those are used
+        if(i & 1)
+        {
+            track = lroundf((rand() % 90 - 45) * 16.0f / 7) / 16.0f;
+            heading_rotate(&angle, track, &judged);
+            flags |= TRIPLOG_FLAG_TRACK;
+        }
+        if(i & 2)
+        {
+            grade = (rand() % 64 - 32) / 16.0f;
+            judged.x -= grade;
+            flags |= TRIPLOG_FLAG_GRADE;
+        }
+        if(axes)
+        {
+            on = decision_axes_step(&axes_state, &axes_params, &judged, speed, i * 10);
+            flags |= TRIPLOG_FLAG_AXES;
+        }
+        else
+            on = is_out_of_level_r(&state, &params, &judged, speed);
+
+        triplog_log_imu(&angle, 0);
+        triplog_log_decision_at(i * 10, on, decision_combined_angle(&judged), speed, grade, track, flags);
+    }
+}
+
+static void test_replay_and_analysis(void)
+{
+    replay_t replay;
+    analysis_stats_t stats;
+    decision_params_t params;
+
+    //a combined angle session then a per axis one, both re-judged exactly from the log alone
+    srand(5);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_sim_init(&x_sim, &x_flash, TEST_SECTORS * TRIPLOG_SECTOR_SIZE));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_open(&x_flash));
+    drive(false);
+    triplog_close();
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_open(&x_flash));
+    drive(true);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_flush());
+
+    TEST_ASSERT_EQUAL(ESP_OK, replay_run_triplog(&replay));
+    TEST_ASSERT_EQUAL(2 * TEST_SAMPLES, replay.decisions_checked);
+    TEST_ASSERT_EQUAL(0, replay.decision_mismatches);
+
+    decision_default_params(&params);
+    analysis_stats_init(&stats);
+    TEST_ASSERT_EQUAL(ESP_OK, analysis_scan_image(x_sim.image, x_sim.size, &params, &stats));
+    TEST_ASSERT_EQUAL(2 * TEST_SAMPLES, stats.decisions);
+    TEST_ASSERT_EQUAL(0, stats.disagreements);
+}
+
+static void test_sweep_skips_zones(void)
+{
+    sweep_t sweep;
+    sweep_result_t result;
+    triplog_iter_t iter;
+    triplog_record_t record;
+
+    //the sweep's sets are combined angle limits, decisions made under a zone's limits are counted and left out
+    srand(5);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_sim_init(&x_sim, &x_flash, TEST_SECTORS * TRIPLOG_SECTOR_SIZE));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_open(&x_flash));
+    drive(false);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_flush());
+
+    TEST_ASSERT_EQUAL(ESP_OK, sweep_init(&sweep, 2));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_iter_begin(&iter));
+    while(triplog_iter_next(&iter, &record) == ESP_OK)
+        sweep_feed_record(&sweep, &record);
+    TEST_ASSERT_EQUAL(ESP_OK, sweep_get_result(&sweep, 0, &result));
+
+    TEST_ASSERT_EQUAL(TEST_SAMPLES / 2, sweep.zone_decisions);
+    TEST_ASSERT_EQUAL(TEST_SAMPLES / 2, sweep.samples);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0, result.false_positive_rate);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0, result.false_negative_rate);
+}
+
+//one sample of roll in 1/16 degree, logged the way the live loop does with the IMU and decision read at the same time
+static void roll_sample(uint32_t *time_ms, int roll)
+{
+    bno055_vec3_t angle = { 0, roll / 16.0f, 0 };
+
+    idfhost_set_time(*time_ms * 1000LL);
+    triplog_log_imu(&angle, 0);
+    triplog_log_decision_at(*time_ms, false, decision_combined_angle(&angle), TEST_SPEED, 0, 0, 0);
+    *time_ms += TEST_PERIOD_MS;
+}
+
+//rolls from one angle to another a step per sample, in 1/16 degree
+static void roll_ramp(uint32_t *time_ms, int from, int to, int step)
+{
+    for(int roll = from; step > 0 ? roll < to : roll > to; roll += step)
+        roll_sample(time_ms, roll);
+}
+
+//a slow roll over the threshold and back, a bump that tips towards it and comes straight back, and a pothole jolt
+static void roll_over_and_bump(void)
+{
+    uint32_t time_ms = 0;
+
+    for(int i = 0; i < 50; i++)
+        roll_sample(&time_ms, 0);
+    roll_ramp(&time_ms, 0, 8 * 16, 1); //6.25 dps up to 8 degrees
+    for(int i = 0; i < 50; i++)
+        roll_sample(&time_ms, 8 * 16);
+    roll_ramp(&time_ms, 8 * 16, 0, -1);
+    for(int i = 0; i < 100; i++)
+        roll_sample(&time_ms, 0);
+    roll_ramp(&time_ms, 0, 4 * 16, 2); //12.5 dps up to 4 degrees and back, never over the threshold
+    roll_ramp(&time_ms, 4 * 16, 0, -2);
+    for(int i = 0; i < 100; i++)
+        roll_sample(&time_ms, 0);
+    roll_sample(&time_ms, 72); //4.5 degrees in one sample is 450 dps, over the rate limit
+    for(int i = 0; i < 50; i++)
+        roll_sample(&time_ms, 0);
+    idfhost_set_time(-1);
+}
+
+static void test_predict_lead(void)
+{
+    replay_predict_t bench;
+    predict_params_t predict;
+
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_sim_init(&x_sim, &x_flash, TEST_SECTORS * TRIPLOG_SECTOR_SIZE));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_open(&x_flash));
+    roll_over_and_bump();
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_flush());
+
+    //1.375 degrees ahead at 6.25 dps, on at 3.625 degrees, 22 samples before the roll gets to 5
+    decision_default_predict_params(&predict);
+    predict.horizon_ms = TEST_HORIZON_MS;
+    replay_predict_begin(&bench, &predict);
+    TEST_ASSERT_EQUAL(ESP_OK, replay_predict_run_triplog(&bench));
+    TEST_ASSERT_EQUAL(1, bench.events);
+    TEST_ASSERT_EQUAL(1, bench.early);
+    TEST_ASSERT_EQUAL(TEST_HORIZON_MS, bench.lead_ms);
+    TEST_ASSERT_EQUAL(TEST_HORIZON_MS, bench.max_lead_ms);
+
+    //the bump's rate takes the prediction over and it comes back off unconfirmed, the jolt is thrown out as a glitch
+    TEST_ASSERT_EQUAL(2, bench.alarms);
+    TEST_ASSERT_EQUAL(1, bench.false_alarms);
+    TEST_ASSERT_GREATER_THAN(0, bench.false_alarm_ms);
+
+    //without the rate limit the jolt is a false alarm of its own
+    predict.max_rate_dps = 1000;
+    replay_predict_begin(&bench, &predict);
+    TEST_ASSERT_EQUAL(ESP_OK, replay_predict_run_triplog(&bench));
+    TEST_ASSERT_EQUAL(3, bench.alarms);
+    TEST_ASSERT_EQUAL(2, bench.false_alarms);
+
+    //with no horizon the prediction is the angle, nothing comes early and nothing is false
+    decision_default_predict_params(&predict);
+    predict.horizon_ms = 0;
+    replay_predict_begin(&bench, &predict);
+    TEST_ASSERT_EQUAL(ESP_OK, replay_predict_run_triplog(&bench));
+    TEST_ASSERT_EQUAL(1, bench.events);
+    TEST_ASSERT_EQUAL(0, bench.early);
+    TEST_ASSERT_EQUAL(0, bench.lead_ms);
+    TEST_ASSERT_EQUAL(1, bench.alarms);
+    TEST_ASSERT_EQUAL(0, bench.false_alarms);
+}
+
+//logs a fix that came in at local_ms for the UTC time of day given, and feeds the log to a replay
+static void gps_fix_at(replay_t *replay, uint32_t local_ms, int hour, int minute, int second, int thousand, triplog_record_t *logged)
+{
+    gps_t gps = { .fix = GPS_FIX_DGPS, .sats_in_use = 9, .tim = { .hour = hour, .minute = minute, .second = second, .thousand = thousand } };
+    triplog_iter_t iter;
+
+    idfhost_set_time(local_ms * 1000LL);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_log_gps(&gps));
+    idfhost_set_time(-1);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_flush());
+
+    replay_begin(replay);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_iter_begin(&iter));
+    while(triplog_iter_next(&iter, logged) == ESP_OK)
+    {
+        replay_feed(replay, logged);
+        if(logged->type == TRIPLOG_RECORD_GPS && logged->timestamp_ms == local_ms)
+            break;
+    }
+    TEST_ASSERT_EQUAL(TRIPLOG_RECORD_GPS, logged->type);
+}
+
+static void test_gps_epoch(void)
+{
+    triplog_record_t timebase, record;
+    replay_t replay;
+    int64_t gps_us;
+
+    //esp_timer 10 s is 200 ms before midnight
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_sim_init(&x_sim, &x_flash, TEST_SECTORS * TRIPLOG_SECTOR_SIZE));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_open(&x_flash));
+    memset(&timebase, 0, sizeof(timebase));
+    timebase.type = TRIPLOG_RECORD_TIMEBASE;
+    timebase.timestamp_ms = 10000;
+    timebase.payload.timebase.local_us = 10000000;
+    timebase.payload.timebase.gps_us = TEST_MIDNIGHT_US - 200000;
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_append(&timebase));
+
+    //the fix type and satellites ride in the flags, the epoch is the time of day the fix is for
+    gps_fix_at(&replay, 10100, 23, 59, 59, 800, &record);
+    TEST_ASSERT_EQUAL(GPS_FIX_DGPS, record.flags >> TRIPLOG_GPS_FIX_SHIFT);
+    TEST_ASSERT_EQUAL(9, record.flags & TRIPLOG_GPS_SATS_MASK);
+    TEST_ASSERT_EQUAL(86399800, record.payload.gps.epoch_ms);
+    TEST_ASSERT_EQUAL(ESP_OK, replay_gps_time(&replay, &record, &gps_us));
+    TEST_ASSERT_EQUAL(TEST_MIDNIGHT_US - 200000, gps_us);
+
+    //the 23:59:59.9 fix comes in after midnight and stays on the day before, the 00:00:00.1 one is on the new day
+    gps_fix_at(&replay, 10300, 23, 59, 59, 900, &record);
+    TEST_ASSERT_EQUAL(ESP_OK, replay_gps_time(&replay, &record, &gps_us));
+    TEST_ASSERT_EQUAL(TEST_MIDNIGHT_US - 100000, gps_us);
+    gps_fix_at(&replay, 10350, 0, 0, 0, 100, &record);
+    TEST_ASSERT_EQUAL(ESP_OK, replay_gps_time(&replay, &record, &gps_us));
+    TEST_ASSERT_EQUAL(TEST_MIDNIGHT_US + 100000, gps_us);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_and_analysis);
+    RUN_TEST(test_sweep_skips_zones);
+    RUN_TEST(test_predict_lead);
+    RUN_TEST(test_gps_epoch);
+    return UNITY_END();
+}
@@ -0,0 +1,80 @@
+#include <string.h>
+#include <unity.h>
+#include "sim.h"
+
+#define TEST_RUN_MS (3600u * 1000u)
+
+void setUp(void) {}
+void tearDown(void) {}
+
+//level driving at a steady speed with a 3 s lean in the middle of every 10 minutes, the light changes slowly
+static void drive(void *ctx, int64_t time_us, sim_world_t *world)
+{
+    int64_t s = time_us / 1000000;
+
+    world->angle.x = s % 600 >= 300 && s % 600 < 303 ? 12 : 1;
+    world->angle.y = 0;
+    world->angle.z = 0;
+    world->speed = 5;
+    world->ambient_mv = 1200 + (int)(s % 100);
+}
+
+static void run(uint32_t loop_delay_ms, sim_t *sim)
+{
+    sim_config_t config;
+
+    sim_default_config(&config);
+    config.loop_delay_ms = loop_delay_ms;
+    TEST_ASSERT_EQUAL(ESP_OK, sim_init(sim, &config, drive, NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, sim_run(sim, TEST_RUN_MS));
+}
+
+static void test_hour(void)
+{
+    static sim_t sim;
+
+    run(600, &sim);
+
+    //every timer and GPS event of the hour ran, and the main loop kept to its delay
+    TEST_ASSERT_EQUAL(TEST_RUN_MS * 1000 / sim.config.alarm_period_us, sim.stats.alarms);
+    TEST_ASSERT_EQUAL(TEST_RUN_MS / sim.config.gps_period_ms, sim.stats.gps_updates);
+    TEST_ASSERT_UINT32_WITHIN(TEST_RUN_MS / 600 / 100, TEST_RUN_MS / 600, sim.stats.loops);
+
+    //each lean lit the LED within a loop, and the light was never read while the LED was on
+    TEST_ASSERT_EQUAL(6, sim.stats.tilt_events);
+    TEST_ASSERT_EQUAL(6, sim.stats.tilt_detected);
+    TEST_ASSERT_EQUAL(0, sim.stats.tilt_missed);
+    TEST_ASSERT_LESS_OR_EQUAL(600, sim.stats.max_detect_latency_ms);
+    TEST_ASSERT_GREATER_THAN(0, sim.stats.light_reads);
+    TEST_ASSERT_EQUAL(0, sim.stats.feedback_reads);
+}
+
+static void test_deterministic(void)
+{
+    static sim_t first, second;
+
+    run(610, &first);
+    run(610, &second);
+    TEST_ASSERT_EQUAL_MEMORY(&first.stats, &second.stats, sizeof(sim_stats_t));
+}
+
+static void test_slower_loop(void)
+{
+    static sim_t fast, slow;
+
+    //a slower loop doesn't lose any leans but the brightness goes longer between updates
+    run(600, &fast);
+    run(650, &slow);
+    TEST_ASSERT_EQUAL(fast.stats.tilt_detected, slow.stats.tilt_detected);
+    TEST_ASSERT_LESS_THAN(fast.stats.loops, slow.stats.loops);
+    TEST_ASSERT_GREATER_THAN(fast.stats.max_light_gap_ms, slow.stats.max_light_gap_ms);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_hour);
+    RUN_TEST(test_deterministic);
+    RUN_TEST(test_slower_loop);
+    return UNITY_END();
+}
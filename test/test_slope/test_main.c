@@ -0,0 +1,111 @@
+#include <math.h>
+#include <unity.h>
+#include "slope.h"
+
+#define TEST_RUN_MS (120000)
+#define TEST_LEAN_DEG (6.0f)
+
+void setUp(void)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, slope_init(0));
+}
+
+void tearDown(void) {}
+
+static void fix(float altitude, float speed, uint32_t time_ms)
+{
+    gps_t gps = {0};
+    uint32_t s = time_ms / 1000;
+
+    gps.altitude = altitude;
+    gps.speed = speed;
+    gps.fix = GPS_FIX_GPS;
+    gps.fix_mode = GPS_MODE_3D;
+    gps.tim.hour = s / 3600;
+    gps.tim.minute = (s / 60) % 60;
+    gps.tim.second = s % 60;
+    slope_gps_fix(&gps);
+}
+
+//drives two minutes at speed up a road of the given grade with a 1 Hz GPS, the IMU at 10 Hz reads the grade plus a
+//steady lean. Returns the pitch left once the grade is taken off, which is what the decision sees.
+static float drive(float grade_deg, float lean_deg, float speed, bool *confident)
+{
+    float altitude = 100, grade = 0;
+
+    for(uint32_t ms = 0; ms < TEST_RUN_MS; ms += 100)
+    {
+        if(ms % 1000 == 0)
+        {
+            altitude += speed * sinf(grade_deg * (float)M_PI / 180);
+            fix(altitude, speed, ms);
+        }
+        *confident = slope_update(grade_deg + lean_deg, speed, ms, &grade);
+    }
+    return grade_deg + lean_deg - grade;
+}
+
+static void test_flat_with_lean(void)
+{
+    slope_estimate_t estimate;
+    bool confident;
+
+    //moving on the flat the whole lean is kept, none of it is mistaken for grade
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, TEST_LEAN_DEG, drive(0, TEST_LEAN_DEG, 10, &confident));
+    TEST_ASSERT_TRUE(confident);
+    TEST_ASSERT_EQUAL(ESP_OK, slope_get(&estimate));
+    TEST_ASSERT_EQUAL(0, estimate.imu_updates);
+    TEST_ASSERT_GREATER_THAN(0, estimate.imu_gated);
+}
+
+static void test_hill_with_lean(void)
+{
+    slope_estimate_t estimate;
+    bool confident;
+
+    //up a 5 degree hill the grade comes off and the lean is what's left
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, TEST_LEAN_DEG, drive(5, TEST_LEAN_DEG, 10, &confident));
+    TEST_ASSERT_TRUE(confident);
+    TEST_ASSERT_EQUAL(ESP_OK, slope_get(&estimate));
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 5, estimate.grade);
+    TEST_ASSERT_LESS_THAN(SLOPE_CONFIDENT_DEG * SLOPE_CONFIDENT_DEG * 1000, estimate.variance * 1000);
+    TEST_ASSERT_EQUAL(0, estimate.imu_updates);
+}
+
+static void test_hill_level(void)
+{
+    slope_estimate_t estimate;
+    float gps_variance;
+    bool confident;
+
+    //sat level up the hill the pitch agrees with GPS and narrows the grade down between fixes
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, TEST_LEAN_DEG, drive(5, TEST_LEAN_DEG, 10, &confident));
+    TEST_ASSERT_EQUAL(ESP_OK, slope_get(&estimate));
+    gps_variance = estimate.variance;
+
+    TEST_ASSERT_EQUAL(ESP_OK, slope_init(0));
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 0, drive(5, 0, 10, &confident));
+    TEST_ASSERT_TRUE(confident);
+    TEST_ASSERT_EQUAL(ESP_OK, slope_get(&estimate));
+    TEST_ASSERT_GREATER_THAN(0, estimate.imu_updates);
+    TEST_ASSERT_LESS_THAN(gps_variance * 1000, estimate.variance * 1000);
+}
+
+static void test_too_slow(void)
+{
+    bool confident;
+
+    //crawling, climb over distance says nothing, so nothing is taken off the pitch
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 5 + TEST_LEAN_DEG, drive(5, TEST_LEAN_DEG, SLOPE_MIN_SPEED / 2, &confident));
+    TEST_ASSERT_FALSE(confident);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_flat_with_lean);
+    RUN_TEST(test_hill_with_lean);
+    RUN_TEST(test_hill_level);
+    RUN_TEST(test_too_slow);
+    return UNITY_END();
+}
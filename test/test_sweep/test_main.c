@@ -0,0 +1,154 @@
+#include <stdlib.h>
+#include <unity.h>
+#include "sweep.h"
+
+#define TEST_SAMPLES (20000)
+#define TEST_SESSION (1000) //samples between power cycles, a warning stays on until the next one
+
+static bno055_vec3_t x_angle[TEST_SAMPLES];
+static float x_speed[TEST_SAMPLES];
+static bool x_reference[TEST_SAMPLES];
+
+void setUp(void) {}
+void tearDown(void) {}
+
+//random tilt and speed around the limits, judged by is_out_of_level_r() with the defaults as the reference
+static void make_samples(void)
+{
+    decision_params_t params;
+    decision_state_t state = {0};
+
+    decision_default_params(&params);
+    srand(5);
+    for(int i = 0; i < TEST_SAMPLES; i++)
+    {
+        if(i % TEST_SESSION == 0)
+            state.state = 0;
+        x_angle[i] = (bno055_vec3_t){ (rand() % 200 - 100) / 16.0, (rand() % 200 - 100) / 16.0, 0 };
+        x_speed[i] = (rand() % 300 - 50) / 10.0f;
+        x_reference[i] = is_out_of_level_r(&state, &params, &x_angle[i], x_speed[i]);
+    }
+}
+
+static void test_grid_matches_is_out_of_level_r(void)
+{
+    decision_params_t first = { .threshold_angle = 1, .lower_speed = -5, .upper_speed = 5 };
+    decision_params_t step = { .threshold_angle = 0.75, .lower_speed = 2, .upper_speed = 4 };
+    sweep_t sweep;
+
+    TEST_ASSERT_EQUAL(ESP_OK, sweep_init_grid(&sweep, &first, &step, 8, 4, 4));
+    TEST_ASSERT_EQUAL(8 * 4 * 4, sweep.count);
+    for(int i = 0; i < TEST_SAMPLES; i++)
+    {
+        if(i % TEST_SESSION == 0)
+            sweep_reset_state(&sweep);
+        sweep_feed(&sweep, &x_angle[i], x_speed[i], i * 10, x_reference[i]);
+    }
+
+    //every set scores exactly what the device's own rule gives with the same limits
+    for(uint32_t set = 0; set < sweep.count; set++)
+    {
+        sweep_result_t result;
+        decision_state_t state = {0};
+        uint32_t false_positives = 0, false_negatives = 0;
+
+        TEST_ASSERT_EQUAL(ESP_OK, sweep_get_result(&sweep, set, &result));
+        for(int i = 0; i < TEST_SAMPLES; i++)
+        {
+            bool on;
+
+            if(i % TEST_SESSION == 0)
+                state.state = 0;
+            on = is_out_of_level_r(&state, &result.params, &x_angle[i], x_speed[i]);
+            false_positives += on && !x_reference[i];
+            false_negatives += !on && x_reference[i];
+        }
+        TEST_ASSERT_EQUAL(false_positives, sweep.false_positives[set]);
+        TEST_ASSERT_EQUAL(false_negatives, sweep.false_negatives[set]);
+    }
+    sweep_deinit(&sweep);
+}
+
+static void test_default_set(void)
+{
+    decision_params_t params;
+    sweep_result_t result;
+    sweep_t sweep;
+    uint32_t best;
+
+    //the limits the reference was made with catch every event straight away
+    decision_default_params(&params);
+    TEST_ASSERT_EQUAL(ESP_OK, sweep_init(&sweep, 2));
+    params.threshold_angle += 2;
+    TEST_ASSERT_EQUAL(ESP_OK, sweep_set(&sweep, 1, &params));
+    for(int i = 0; i < TEST_SAMPLES; i++)
+    {
+        if(i % TEST_SESSION == 0)
+            sweep_reset_state(&sweep);
+        sweep_feed(&sweep, &x_angle[i], x_speed[i], i * 10, x_reference[i]);
+    }
+
+    TEST_ASSERT_EQUAL(ESP_OK, sweep_get_result(&sweep, 0, &result));
+    TEST_ASSERT_GREATER_THAN(0, sweep.events);
+    TEST_ASSERT_EQUAL_FLOAT(0, result.false_positive_rate);
+    TEST_ASSERT_EQUAL_FLOAT(0, result.false_negative_rate);
+    TEST_ASSERT_EQUAL_FLOAT(0, result.mean_latency_ms);
+    TEST_ASSERT_EQUAL(sweep.events, result.detected);
+
+    TEST_ASSERT_EQUAL(ESP_OK, sweep_get_result(&sweep, 1, &result));
+    TEST_ASSERT_GREATER_THAN(0, sweep.false_negatives[1]);
+    TEST_ASSERT_EQUAL(ESP_OK, sweep_best(&sweep, 0, &best));
+    TEST_ASSERT_EQUAL(0, best);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, sweep_get_result(&sweep, 2, &result));
+    sweep_deinit(&sweep);
+}
+
+static void test_feed_record(void)
+{
+    triplog_sim_t sim;
+    triplog_flash_t flash;
+    triplog_iter_t iter;
+    triplog_record_t record;
+    sweep_result_t result;
+    sweep_t sweep;
+
+    //the device's decisions out of a trip log are the reference, the default set agrees with all of them.
+    //Each session starts with a boot record, which is where sweep_feed_record() resets the sets.
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_sim_init(&sim, &flash, 128 * TRIPLOG_SECTOR_SIZE));
+    for(int i = 0; i < 5 * TEST_SESSION; i++)
+    {
+        if(i % TEST_SESSION == 0)
+        {
+            if(i > 0)
+                TEST_ASSERT_EQUAL(ESP_OK, triplog_close());
+            TEST_ASSERT_EQUAL(ESP_OK, triplog_open(&flash));
+        }
+        triplog_log_imu(&x_angle[i], 0);
+        triplog_log_decision_at(i * 10, x_reference[i], decision_combined_angle(&x_angle[i]), x_speed[i], 0, 0, 0);
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_flush());
+
+    TEST_ASSERT_EQUAL(ESP_OK, sweep_init(&sweep, 1));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_iter_begin(&iter));
+    while(triplog_iter_next(&iter, &record) == ESP_OK)
+        sweep_feed_record(&sweep, &record);
+
+    TEST_ASSERT_EQUAL(5 * TEST_SESSION, sweep.samples);
+    TEST_ASSERT_GREATER_OR_EQUAL(5, sweep.events);
+    TEST_ASSERT_EQUAL(ESP_OK, sweep_get_result(&sweep, 0, &result));
+    TEST_ASSERT_EQUAL_FLOAT(0, result.false_positive_rate);
+    TEST_ASSERT_EQUAL_FLOAT(0, result.false_negative_rate);
+    sweep_deinit(&sweep);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_close());
+    triplog_sim_deinit(&sim);
+}
+
+int main(void)
+{
+    make_samples();
+    UNITY_BEGIN();
+    RUN_TEST(test_grid_matches_is_out_of_level_r);
+    RUN_TEST(test_default_set);
+    RUN_TEST(test_feed_record);
+    return UNITY_END();
+}
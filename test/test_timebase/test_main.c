@@ -0,0 +1,132 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include "idfhost.h"
+#include "timebase.h"
+
+#define TEST_PPS_GPIO (5)
+#define TEST_PPM (50) //how fast the local clock runs against GPS, so GPS time runs that much slower than it
+#define TEST_DAYS (9786) //2026-10-17
+#define TEST_START_S (36000)
+
+static int x_second; //GPS seconds into the day of the next fix
+
+void setUp(void) {}
+void tearDown(void) {}
+
+//local time of the start of a GPS second
+static int64_t local_edge(int second)
+{
+    return (int64_t)(3.3e6 + (second - TEST_START_S) * 1e6 * (1 + TEST_PPM * 1e-6));
+}
+
+static int64_t gps_time(int second, int64_t us)
+{
+    return ((int64_t)TEST_DAYS * 86400 + second) * 1000000LL + us;
+}
+
+//a second of GPS, the pulse at the edge 3 us late for the ISR, then the fix sentence 70 ms on with 10 ms of jitter either
+//way. The receiver reports the second off by off_s.
+static void run_second(bool pps, int off_s)
+{
+    gps_t gps;
+
+    if(pps)
+    {
+        idfhost_set_time(local_edge(x_second) + 3);
+        idfhost_gpio_edge(TEST_PPS_GPIO);
+    }
+    idfhost_set_time(local_edge(x_second) + TIMEBASE_NMEA_LATENCY_US + rand() % 20000 - 10000);
+
+    memset(&gps, 0, sizeof(gps));
+    gps.fix = GPS_FIX_GPS;
+    gps.tim.hour = (x_second + off_s) / 3600;
+    gps.tim.minute = (x_second + off_s) / 60 % 60;
+    gps.tim.second = (x_second + off_s) % 60;
+    gps.date.day = 17;
+    gps.date.month = 10;
+    gps.date.year = 26;
+    timebase_gps_fix(&gps);
+    x_second++;
+}
+
+//how far off the timebase puts the middle of the last second
+static int64_t mid_second_error(void)
+{
+    int64_t gps_us;
+
+    TEST_ASSERT_EQUAL(ESP_OK, timebase_to_gps(local_edge(x_second - 1) + 500000 * (1 + TEST_PPM * 1e-6), &gps_us));
+    return gps_us - gps_time(x_second - 1, 500000);
+}
+
+static void test_before_fix(void)
+{
+    int64_t gps_us;
+
+    TEST_ASSERT_EQUAL(ESP_OK, timebase_init(TEST_PPS_GPIO));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, timebase_to_gps(0, &gps_us));
+    TEST_ASSERT_EQUAL(0, timebase_stamp(0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, timebase_init(TEST_PPS_GPIO));
+}
+
+static void test_nmea(void)
+{
+    timebase_status_t status;
+
+    //sentence timing alone, the jitter averages out to within a couple of milliseconds and the rate is found
+    srand(1);
+    x_second = TEST_START_S;
+    for(int i = 0; i < 300; i++)
+        run_second(false, 0);
+    TEST_ASSERT_EQUAL(ESP_OK, timebase_get_status(&status));
+
+    TEST_ASSERT_EQUAL(TIMEBASE_SOURCE_NMEA, status.source);
+    TEST_ASSERT_EQUAL(300, status.updates);
+    TEST_ASSERT_EQUAL(0, status.steps);
+    TEST_ASSERT_INT_WITHIN(2000, 0, mid_second_error());
+    TEST_ASSERT_INT_WITHIN(15, -TEST_PPM, (int)((status.rate - 1) * 1e6));
+}
+
+static void test_pps(void)
+{
+    timebase_status_t status;
+
+    //with the pulse the same clock comes in to within a few microseconds
+    for(int i = 0; i < 60; i++)
+        run_second(true, 0);
+    TEST_ASSERT_EQUAL(ESP_OK, timebase_get_status(&status));
+
+    TEST_ASSERT_EQUAL(TIMEBASE_SOURCE_PPS, status.source);
+    TEST_ASSERT_EQUAL(60, status.pps_edges);
+    TEST_ASSERT_INT_WITHIN(10, 0, mid_second_error());
+    TEST_ASSERT_INT_WITHIN(1, -TEST_PPM, (int)((status.rate - 1) * 1e6 - 0.5));
+}
+
+static void test_step_and_holdover(void)
+{
+    timebase_status_t status;
+    int64_t gps_us;
+
+    //a fix a whole second out is stepped to rather than slewed, and stepped back from at the next good one
+    run_second(true, 1);
+    TEST_ASSERT_EQUAL(ESP_OK, timebase_get_status(&status));
+    TEST_ASSERT_EQUAL(1, status.steps);
+    run_second(true, 0);
+    TEST_ASSERT_EQUAL(ESP_OK, timebase_get_status(&status));
+    TEST_ASSERT_EQUAL(2, status.steps);
+    TEST_ASSERT_INT_WITHIN(10, 0, mid_second_error());
+
+    //still converted but no longer trusted once the fixes stop
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, timebase_to_gps(local_edge(x_second) + TIMEBASE_HOLDOVER_US, &gps_us));
+    TEST_ASSERT_NOT_EQUAL(0, timebase_stamp(local_edge(x_second) + TIMEBASE_HOLDOVER_US));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_before_fix);
+    RUN_TEST(test_nmea);
+    RUN_TEST(test_pps);
+    RUN_TEST(test_step_and_holdover);
+    return UNITY_END();
+}
@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include "trace.h"
+
+#define TEST_OVERFILL (10) //events past a full ring on core 0
+#define TEST_CORE1_EVENTS (3)
+
+static char x_json[64 * 1024];
+static size_t x_json_len;
+static int x_writes_left; //writes before the sink fails, -1 for never
+static int x_failed_writes;
+
+void setUp(void)
+{
+    trace_enable(false);
+    trace_clear();
+    x_json_len = 0;
+    x_writes_left = -1;
+    x_failed_writes = 0;
+}
+
+void tearDown(void) {}
+
+static esp_err_t sink(void *ctx, const char *data, size_t len)
+{
+    if(x_writes_left == 0 || x_json_len + len >= sizeof(x_json))
+    {
+        x_failed_writes++;
+        return ESP_FAIL;
+    }
+    if(x_writes_left > 0)
+        x_writes_left--;
+    memcpy(x_json + x_json_len, data, len);
+    x_json_len += len;
+    x_json[x_json_len] = '\0';
+    return ESP_OK;
+}
+
+//one begin/end per arg on core 0 past a full ring, and a few instants on core 1
+static void fill(void)
+{
+    trace_enable(true);
+    for(uint32_t i = 0; i < TRACE_RING_SIZE + TEST_OVERFILL; i++)
+        trace_record(TRACE_I2C_READ, i % 2 ? TRACE_PHASE_END : TRACE_PHASE_BEGIN, 1000 + i, 0, 0x3fc80000, i);
+    for(uint32_t i = 0; i < TEST_CORE1_EVENTS; i++)
+        trace_record(TRACE_LED_ALARM, TRACE_PHASE_INSTANT, 5000 + i, 1, TRACE_TRACK_ISR, 1000 + i);
+    trace_enable(false);
+}
+
+static int count(const char *needle)
+{
+    int n = 0;
+
+    for(const char *p = x_json; (p = strstr(p, needle)) != NULL; p++)
+        n++;
+    return n;
+}
+
+static void test_wrap_stats(void)
+{
+    trace_stats_t stats;
+
+    fill();
+    trace_get_stats(&stats);
+    TEST_ASSERT_EQUAL(TRACE_RING_SIZE + TEST_OVERFILL + TEST_CORE1_EVENTS, (uint32_t)stats.recorded);
+    TEST_ASSERT_EQUAL(TEST_OVERFILL, (uint32_t)stats.overwritten);
+
+    //nothing goes in while recording is stopped, or for a core that doesn't exist
+    trace_record(TRACE_MAIN_LOOP, TRACE_PHASE_BEGIN, 0, 0, 0, 0);
+    trace_enable(true);
+    trace_record(TRACE_MAIN_LOOP, TRACE_PHASE_BEGIN, 0, TRACE_CORES, 0, 0);
+    trace_enable(false);
+    trace_get_stats(&stats);
+    TEST_ASSERT_EQUAL(TRACE_RING_SIZE + TEST_OVERFILL + TEST_CORE1_EVENTS, (uint32_t)stats.recorded);
+}
+
+static void test_export_order(void)
+{
+    const char *p = x_json;
+    long last = -1;
+    int events = 0;
+
+    //the overwritten events are gone and the rest come out oldest first, core 0 then core 1
+    fill();
+    TEST_ASSERT_EQUAL(ESP_OK, trace_export_chrome(sink, NULL));
+    while((p = strstr(p, "\"args\":{\"arg\":")) != NULL)
+    {
+        long arg = strtol(p + 14, NULL, 10);
+
+        if(events == 0)
+            TEST_ASSERT_EQUAL(TEST_OVERFILL, arg);
+        TEST_ASSERT_GREATER_THAN(last, arg);
+        last = arg;
+        events++;
+        p++;
+    }
+    TEST_ASSERT_EQUAL(TRACE_RING_SIZE + TEST_CORE1_EVENTS, events);
+    TEST_ASSERT_EQUAL(1000 + TEST_CORE1_EVENTS - 1, last);
+}
+
+static void test_export_shape(void)
+{
+    int depth = 0;
+
+    fill();
+    TEST_ASSERT_EQUAL(ESP_OK, trace_export_chrome(sink, NULL));
+
+    //one object holding the event array, a thread name per core, instants scoped to their thread
+    TEST_ASSERT_EQUAL_STRING_LEN("{\"traceEvents\":[\n", x_json, 17);
+    TEST_ASSERT_EQUAL_STRING("\n]}\n", x_json + x_json_len - 4);
+    for(size_t i = 0; i < x_json_len; i++)
+    {
+        depth += x_json[i] == '{' || x_json[i] == '[';
+        depth -= x_json[i] == '}' || x_json[i] == ']';
+        TEST_ASSERT_TRUE(depth >= 0);
+    }
+    TEST_ASSERT_EQUAL(0, depth);
+    TEST_ASSERT_EQUAL(TRACE_CORES, count("\"ph\":\"M\""));
+    TEST_ASSERT_EQUAL(TRACE_RING_SIZE / 2, count("\"name\":\"i2c_read\",\"cat\":\"i2c\",\"ph\":\"B\""));
+    TEST_ASSERT_EQUAL(TRACE_RING_SIZE / 2, count("\"ph\":\"E\""));
+    TEST_ASSERT_EQUAL(TEST_CORE1_EVENTS, count("\"ph\":\"i\",\"s\":\"t\",\"ts\":"));
+    TEST_ASSERT_EQUAL(TEST_CORE1_EVENTS, count("\"pid\":1,\"tid\":0,\"args\":{\"arg\""));
+    TEST_ASSERT_EQUAL(0, count(",,"));
+}
+
+static void test_write_error(void)
+{
+    //the first failed write is handed back and nothing more is written
+    fill();
+    x_writes_left = 5;
+    TEST_ASSERT_EQUAL(ESP_FAIL, trace_export_chrome(sink, NULL));
+    TEST_ASSERT_EQUAL(1, x_failed_writes);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_wrap_stats);
+    RUN_TEST(test_export_order);
+    RUN_TEST(test_export_shape);
+    RUN_TEST(test_write_error);
+    return UNITY_END();
+}
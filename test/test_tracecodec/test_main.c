@@ -0,0 +1,267 @@
+#include <stdlib.h>
+#include <math.h>
+#include <unity.h>
+#include "idfhost.h"
+#include "tracecodec.h"
+#include "triplog.h"
+#include "replay.h"
+
+#define TEST_SAMPLES (20000)
+#define TEST_GPS_SAMPLES (3200)
+#define TEST_NO_FIX_SAMPLES (50) //logged before the timebase had a fix
+#define TEST_GPS_EPOCH_US (845000000000000LL) //GPS time at boot, late October 2026
+
+static uint32_t x_time[TEST_SAMPLES];
+static int32_t x_values[TEST_SAMPLES][TRACECODEC_MAX_CHANNELS];
+static uint8_t x_stream[TEST_SAMPLES * 16];
+
+void setUp(void) {}
+void tearDown(void) {}
+
+//slow drift with a jump now and then, jittered sample period and both int32 ends
+static void make_samples(void)
+{
+    uint32_t time = 1000;
+    int32_t a = 0, b = 0, c = 0;
+
+    srand(1);
+    for(int i = 0; i < TEST_SAMPLES; i++)
+    {
+        time += 10 + (rand() % 20 == 0);
+        a += rand() % 5 - 2;
+        b += rand() % 3 - 1;
+        c += rand() % 7 - 3;
+        if(i % 5000 == 0)
+            a += 100000;
+        x_time[i] = time;
+        x_values[i][0] = a;
+        x_values[i][1] = b;
+        x_values[i][2] = c;
+    }
+    x_values[7][0] = INT32_MIN;
+    x_values[8][0] = INT32_MAX;
+}
+
+static size_t encode_all(tracecodec_encoder_t *enc)
+{
+    size_t len = 0, n;
+
+    TEST_ASSERT_EQUAL(ESP_OK, tracecodec_encoder_init(enc, TRACECODEC_IMU_CHANNELS, 8));
+    for(int i = 0; i < TEST_SAMPLES; i++)
+    {
+        TEST_ASSERT_EQUAL(ESP_OK, tracecodec_encode(enc, x_time[i], x_values[i], x_stream + len, TRACECODEC_MAX_FRAME_SIZE, &n));
+        len += n;
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, tracecodec_encoder_flush(enc, x_stream + len, TRACECODEC_MAX_FRAME_SIZE, &n));
+    return len + n;
+}
+
+static void test_round_trip(void)
+{
+    tracecodec_encoder_t enc;
+    tracecodec_decoder_t dec;
+    uint32_t time[TRACECODEC_FRAME_SAMPLES];
+    int32_t values[TRACECODEC_FRAME_SAMPLES][TRACECODEC_MAX_CHANNELS];
+    uint8_t count;
+    size_t len = encode_all(&enc), pos = 0, used;
+    int k = 0;
+
+    TEST_ASSERT_EQUAL(ESP_OK, tracecodec_decoder_init(&dec, TRACECODEC_IMU_CHANNELS));
+    while(pos < len)
+    {
+        TEST_ASSERT_EQUAL(ESP_OK, tracecodec_decode_frame(&dec, x_stream + pos, len - pos, &used, time, values, &count));
+        for(int i = 0; i < count; i++, k++)
+        {
+            TEST_ASSERT_EQUAL_UINT32(x_time[k], time[i]);
+            TEST_ASSERT_EQUAL_INT32_ARRAY(x_values[k], values[i], TRACECODEC_IMU_CHANNELS);
+        }
+        pos += used;
+    }
+    TEST_ASSERT_EQUAL(TEST_SAMPLES, k);
+    TEST_ASSERT_GREATER_THAN(4 * enc.encoded_bytes, enc.raw_bytes);
+}
+
+static void test_seek(void)
+{
+    tracecodec_encoder_t enc;
+    tracecodec_decoder_t dec;
+    uint32_t time[TRACECODEC_FRAME_SAMPLES];
+    int32_t values[TRACECODEC_FRAME_SAMPLES][TRACECODEC_MAX_CHANNELS];
+    uint8_t count;
+    size_t len = encode_all(&enc), offset, used;
+    uint32_t target = x_time[TEST_SAMPLES / 2];
+    int k = 0;
+
+    TEST_ASSERT_EQUAL(ESP_OK, tracecodec_seek(x_stream, len, target, &offset));
+    TEST_ASSERT_EQUAL(ESP_OK, tracecodec_decoder_init(&dec, TRACECODEC_IMU_CHANNELS));
+    TEST_ASSERT_EQUAL(ESP_OK, tracecodec_decode_frame(&dec, x_stream + offset, len - offset, &used, time, values, &count));
+
+    //the keyframe at or before the target, no more than one keyframe interval back
+    TEST_ASSERT_LESS_OR_EQUAL(target, time[0]);
+    while(x_time[k] != time[0])
+        k++;
+    TEST_ASSERT_LESS_THAN(8 * TRACECODEC_FRAME_SAMPLES, TEST_SAMPLES / 2 - k);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(x_values[k], values[0], TRACECODEC_IMU_CHANNELS);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, tracecodec_seek(x_stream, len, x_time[0] - 1, &offset));
+}
+
+static void test_full_output(void)
+{
+    tracecodec_encoder_t enc;
+    tracecodec_decoder_t dec;
+    uint32_t time[TRACECODEC_FRAME_SAMPLES];
+    int32_t values[TRACECODEC_FRAME_SAMPLES][TRACECODEC_MAX_CHANNELS];
+    uint8_t count, small[8];
+    size_t len = 0, pos = 0, n, used;
+    int decoded = 0;
+
+    //a frame that doesn't fit is held for the next call, only the sample that arrives while it is stuck is dropped
+    TEST_ASSERT_EQUAL(ESP_OK, tracecodec_encoder_init(&enc, TRACECODEC_IMU_CHANNELS, 2));
+    for(int i = 0; i < 200; i++)
+    {
+        int32_t v[TRACECODEC_IMU_CHANNELS] = { i * 3, -i, (i * i) % 1000 };
+
+        if(i == 31 || i == 32)
+        {
+            TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, tracecodec_encode(&enc, i * 10, v, small, sizeof(small), &n));
+            continue;
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, tracecodec_encode(&enc, i * 10, v, x_stream + len, sizeof(x_stream) - len, &n));
+        len += n;
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, tracecodec_encoder_flush(&enc, small, 1, &n));
+    TEST_ASSERT_EQUAL(ESP_OK, tracecodec_encoder_flush(&enc, x_stream + len, sizeof(x_stream) - len, &n));
+    len += n;
+
+    TEST_ASSERT_EQUAL(ESP_OK, tracecodec_decoder_init(&dec, TRACECODEC_IMU_CHANNELS));
+    while(pos < len)
+    {
+        TEST_ASSERT_EQUAL(ESP_OK, tracecodec_decode_frame(&dec, x_stream + pos, len - pos, &used, time, values, &count));
+        for(int i = 0; i < count; i++, decoded++)
+        {
+            int32_t s = time[i] / 10;
+
+            TEST_ASSERT_EQUAL_INT32(s * 3, values[i][0]);
+            TEST_ASSERT_EQUAL_INT32(-s, values[i][1]);
+            TEST_ASSERT_EQUAL_INT32((s * s) % 1000, values[i][2]);
+        }
+        pos += used;
+    }
+    TEST_ASSERT_EQUAL(199, decoded);
+}
+
+static void log_session(triplog_sim_t *sim, bool pack, int samples)
+{
+    triplog_flash_t flash;
+    decision_params_t params;
+    decision_state_t state = {0};
+
+    decision_default_params(&params);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_sim_init(sim, &flash, 128 * TRIPLOG_SECTOR_SIZE));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_open(&flash));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_set_imu_packing(pack));
+    srand(9);
+    for(int i = 0; i < samples; i++)
+    {
+        bno055_vec3_t angle = { lround((6 * sin(i / 50.0) + (rand() % 5 - 2) / 16.0) * 16) / 16.0,
+                                lround((3 * cos(i / 70.0) + (rand() % 5 - 2) / 16.0) * 16) / 16.0,
+                                lround(fmod(i * 0.1, 360) * 16) / 16.0 };
+        bool on = is_out_of_level_r(&state, &params, &angle, 10);
+
+        triplog_log_imu(&angle, 0);
+        triplog_log_decision_at(i * 10, on, decision_combined_angle(&angle), 10, 0, 0, 0);
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_flush());
+}
+
+static void test_triplog_packing(void)
+{
+    triplog_sim_t plain, packed;
+    triplog_stats_t plain_stats, packed_stats;
+    replay_t replay;
+
+    log_session(&plain, false, 3200);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_get_stats(&plain_stats));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_close());
+    triplog_sim_deinit(&plain);
+
+    //every decision still replays from the angle it carries, and the samples take about an eighth of the records. The frame
+    //timestamps come from the host clock, so a frame can run a byte long now and then.
+    log_session(&packed, true, 3200);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_get_stats(&packed_stats));
+    TEST_ASSERT_EQUAL(3200, packed_stats.imu_samples_packed);
+    TEST_ASSERT_LESS_THAN(3200 / 7, packed_stats.imu_frame_records);
+    TEST_ASSERT_LESS_THAN(plain_stats.records_appended * 6 / 10, packed_stats.records_appended);
+    TEST_ASSERT_EQUAL(ESP_OK, replay_run_triplog(&replay));
+    TEST_ASSERT_EQUAL(3200, replay.decisions_checked);
+    TEST_ASSERT_EQUAL(0, replay.decision_mismatches);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_close());
+    triplog_sim_deinit(&packed);
+}
+
+static void test_triplog_packing_gps_time(void)
+{
+    triplog_sim_t sim;
+    triplog_flash_t flash;
+    triplog_stats_t stats;
+    triplog_iter_t iter;
+    triplog_record_t record;
+    triplog_imu_unpack_t unpack;
+    static int64_t sent[TEST_GPS_SAMPLES];
+    uint32_t time[TRACECODEC_FRAME_SAMPLES];
+    int64_t gps_us[TRACECODEC_FRAME_SAMPLES];
+    int32_t values[TRACECODEC_FRAME_SAMPLES][TRACECODEC_MAX_CHANNELS];
+    uint8_t count;
+    int unpacked = 0;
+
+    //read every 10 ms give or take a few hundred microseconds, on a crystal 80 ppm fast, with the log call a moment after
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_sim_init(&sim, &flash, 128 * TRIPLOG_SECTOR_SIZE));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_open(&flash));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_set_imu_packing(true));
+    srand(3);
+    for(int i = 0; i < TEST_GPS_SAMPLES; i++)
+    {
+        int64_t read_us = 1000000 + i * 10000LL + rand() % 600;
+        bno055_vec3_t angle = { (i % 40) / 16.0, -(i % 24) / 16.0, 90 };
+
+        sent[i] = i < TEST_NO_FIX_SAMPLES ? 0 : TEST_GPS_EPOCH_US + read_us + read_us * 80 / 1000000;
+        idfhost_set_time(read_us + 150 + rand() % 100);
+        TEST_ASSERT_EQUAL(ESP_OK, triplog_log_imu(&angle, sent[i]));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_flush());
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_get_stats(&stats));
+    idfhost_set_time(-1);
+
+    //every sample comes back with the GPS time it was logged with, to the microsecond
+    triplog_imu_unpack_begin(&unpack);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_iter_begin(&iter));
+    while(triplog_iter_next(&iter, &record) == ESP_OK)
+    {
+        TEST_ASSERT_EQUAL(ESP_OK, triplog_imu_unpack_feed(&unpack, &record, time, gps_us, values, &count));
+        for(uint8_t i = 0; i < count; i++, unpacked++)
+        {
+            TEST_ASSERT_EQUAL(sent[unpacked], gps_us[i]);
+            TEST_ASSERT_EQUAL(unpacked % 40, values[i][0]);
+        }
+    }
+    TEST_ASSERT_EQUAL(TEST_GPS_SAMPLES, unpacked);
+    TEST_ASSERT_EQUAL(0, unpack.lost_frames);
+
+    //the residual carries the read jitter, a dozen bits a sample here, and four samples still share a record
+    TEST_ASSERT_LESS_THAN(TEST_GPS_SAMPLES * 3 / 10, stats.imu_frame_records);
+
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_close());
+    triplog_sim_deinit(&sim);
+}
+
+int main(void)
+{
+    make_samples();
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_seek);
+    RUN_TEST(test_full_output);
+    RUN_TEST(test_triplog_packing);
+    RUN_TEST(test_triplog_packing_gps_time);
+    return UNITY_END();
+}
@@ -0,0 +1,154 @@
+#include <unity.h>
+#include "triplog.h"
+
+#define TEST_SECTORS (8)
+
+static triplog_sim_t x_sim;
+static triplog_flash_t x_flash;
+
+void setUp(void)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_sim_init(&x_sim, &x_flash, TEST_SECTORS * TRIPLOG_SECTOR_SIZE));
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_open(&x_flash));
+}
+
+void tearDown(void)
+{
+    triplog_close();
+    triplog_sim_deinit(&x_sim);
+}
+
+//light records numbered from first, the number is what the reads below check the order with
+static void log_numbered(int first, int count)
+{
+    for(int i = first; i < first + count; i++)
+        TEST_ASSERT_EQUAL(ESP_OK, triplog_log_light(i, 0, 0));
+}
+
+//walks the log, checks the light records are consecutive and returns how many there were and the last one
+static int read_numbered(int *last)
+{
+    triplog_iter_t iter;
+    triplog_record_t record;
+    int count = 0, prev = -1;
+
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_iter_begin(&iter));
+    while(triplog_iter_next(&iter, &record) == ESP_OK)
+    {
+        if(record.type != TRIPLOG_RECORD_LIGHT)
+            continue;
+        if(prev >= 0)
+            TEST_ASSERT_EQUAL(prev + 1, record.payload.light.adc_mv);
+        prev = record.payload.light.adc_mv;
+        count++;
+    }
+    *last = prev;
+    return count;
+}
+
+static void test_round_trip_across_reboots(void)
+{
+    int last;
+
+    log_numbered(0, 300);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_close());
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_open(&x_flash));
+    log_numbered(300, 5);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_flush());
+
+    TEST_ASSERT_EQUAL(305, read_numbered(&last));
+    TEST_ASSERT_EQUAL(304, last);
+}
+
+static void test_wrap_keeps_newest(void)
+{
+    int last, count;
+
+    //ten times round the ring, only the oldest sector's worth is lost to make room for the head
+    log_numbered(0, 10 * TEST_SECTORS * TRIPLOG_RECORDS_PER_SECTOR);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_flush());
+
+    count = read_numbered(&last);
+    TEST_ASSERT_EQUAL(10 * TEST_SECTORS * TRIPLOG_RECORDS_PER_SECTOR - 1, last);
+    TEST_ASSERT_GREATER_OR_EQUAL((TEST_SECTORS - 1) * TRIPLOG_RECORDS_PER_SECTOR - 1, count);
+    TEST_ASSERT_LESS_OR_EQUAL(TEST_SECTORS * TRIPLOG_RECORDS_PER_SECTOR, count);
+}
+
+static void test_even_wear(void)
+{
+    triplog_stats_t stats;
+    uint32_t low = UINT32_MAX, high = 0, sequence;
+
+    log_numbered(0, 10 * TEST_SECTORS * TRIPLOG_RECORDS_PER_SECTOR);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_flush());
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_get_stats(&stats));
+
+    //sectors are taken in turn, so their sequence numbers are consecutive and each was erased as often as the others
+    for(int sector = 0; sector < TEST_SECTORS; sector++)
+    {
+        TEST_ASSERT_TRUE(triplog_header_is_valid((const triplog_sector_header_t *)(x_sim.image + sector * TRIPLOG_SECTOR_SIZE), &sequence));
+        low = sequence < low ? sequence : low;
+        high = sequence > high ? sequence : high;
+    }
+    TEST_ASSERT_EQUAL(TEST_SECTORS - 1, high - low);
+    TEST_ASSERT_UINT32_WITHIN(1, 10 * TEST_SECTORS, stats.sector_erases);
+
+    //full pages and one header per sector, nothing is programmed twice
+    TEST_ASSERT_LESS_THAN(stats.record_bytes * 102 / 100, stats.flash_bytes_written);
+}
+
+static void test_corrupt_record_skipped(void)
+{
+    triplog_iter_t iter;
+    triplog_record_t record;
+    int count = 0;
+
+    //a record torn by power loss fails its CRC and is the only one missing
+    log_numbered(0, 100);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_flush());
+    for(size_t offset = 0; offset < x_sim.size; offset += TRIPLOG_RECORD_SIZE)
+    {
+        triplog_record_t *slot = (triplog_record_t *)(x_sim.image + offset);
+
+        if(slot->type == TRIPLOG_RECORD_LIGHT && slot->payload.light.adc_mv == 50)
+            slot->payload.light.led_val = 1;
+    }
+
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_iter_begin(&iter));
+    while(triplog_iter_next(&iter, &record) == ESP_OK)
+    {
+        if(record.type != TRIPLOG_RECORD_LIGHT)
+            continue;
+        TEST_ASSERT_NOT_EQUAL(50, record.payload.light.adc_mv);
+        count++;
+    }
+    TEST_ASSERT_EQUAL(99, count);
+}
+
+static void test_reopen_after_partial_page(void)
+{
+    int last;
+
+    //a flush with a part filled page, the next boot carries on after it rather than writing over it
+    log_numbered(0, 3);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_flush());
+    log_numbered(3, 2);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_close());
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_open(&x_flash));
+    log_numbered(5, 1);
+    TEST_ASSERT_EQUAL(ESP_OK, triplog_flush());
+
+    TEST_ASSERT_EQUAL(6, read_numbered(&last));
+    TEST_ASSERT_EQUAL(5, last);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_across_reboots);
+    RUN_TEST(test_wrap_keeps_newest);
+    RUN_TEST(test_even_wear);
+    RUN_TEST(test_corrupt_record_skipped);
+    RUN_TEST(test_reopen_after_partial_page);
+    return UNITY_END();
+}
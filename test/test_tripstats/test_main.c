@@ -0,0 +1,104 @@
+#include <math.h>
+#include <unity.h>
+#include "tripstats.h"
+
+#define TEST_M_PER_DEG (111195.08) //along a meridian, at TRIPSTATS_EARTH_RADIUS_MM
+#define TEST_LON (-1220000000)
+
+static tripstats_t x_stats;
+
+void setUp(void)
+{
+    tripstats_begin(&x_stats, 1.0f);
+}
+
+void tearDown(void) {}
+
+static void test_haversine(void)
+{
+    TEST_ASSERT_UINT32_WITHIN(1000, (uint32_t)(TEST_M_PER_DEG * 1000), tripstats_haversine_mm(0, 0, 10000000, 0));
+
+    //a 10 m step east far north is still right to the millimeters
+    TEST_ASSERT_UINT32_WITHIN(5, 10000, tripstats_haversine_mm(600000000, 0, 600000000, (int32_t)lround(10 / (TEST_M_PER_DEG * 0.5) * 1e7)));
+
+    //across the antimeridian is the short way round
+    TEST_ASSERT_UINT32_WITHIN(5, (uint32_t)(TEST_M_PER_DEG * 0.0002 * 1000), tripstats_haversine_mm(0, 1799999000, 0, -1799999000));
+}
+
+static void test_add_fix(void)
+{
+    double lat = 45.0;
+    uint32_t ms = 0;
+
+    //ten minutes north at 20 m/s, then parked with the fix wandering, which adds no distance
+    for(int i = 0; i < 600; i++, ms += 1000)
+    {
+        tripstats_add_fix(&x_stats, (int32_t)lround(lat * 1e7), TEST_LON, 20, true, ms);
+        lat += 20 / TEST_M_PER_DEG;
+    }
+    for(int i = 0; i < 100; i++, ms += 1000)
+        tripstats_add_fix(&x_stats, (int32_t)lround(lat * 1e7) + (i % 3) * 30, TEST_LON, 0.3f, true, ms);
+
+    TEST_ASSERT_UINT32_WITHIN(1000, 599 * 20 * 1000, (uint32_t)x_stats.distance_mm);
+    TEST_ASSERT_EQUAL(599000, (uint32_t)x_stats.moving_ms);
+    TEST_ASSERT_EQUAL(699000, (uint32_t)x_stats.tracked_ms);
+    TEST_ASSERT_EQUAL_FLOAT(20, x_stats.max_speed);
+    TEST_ASSERT_EQUAL(700, x_stats.fixes);
+}
+
+static void test_fix_gap(void)
+{
+    //time across a gap in the fixes isn't counted, nor is the distance across it
+    tripstats_add_fix(&x_stats, 450000000, TEST_LON, 20, true, 0);
+    tripstats_add_fix(&x_stats, 450010000, TEST_LON, 20, true, TRIPSTATS_MAX_GAP_MS + 1000);
+    TEST_ASSERT_EQUAL(0, (uint32_t)x_stats.tracked_ms);
+    TEST_ASSERT_EQUAL(0, (uint32_t)x_stats.distance_mm);
+
+    tripstats_add_fix(&x_stats, 450010000, TEST_LON + 1000, 20, true, TRIPSTATS_MAX_GAP_MS + 2000);
+    TEST_ASSERT_EQUAL(1000, (uint32_t)x_stats.tracked_ms);
+    TEST_ASSERT_GREATER_THAN(0, (uint32_t)x_stats.distance_mm);
+}
+
+static void test_add_decision(void)
+{
+    //two warnings, 6 s and 3 s long from the first sample on to the first sample off
+    for(int i = 0; i < 100; i++)
+    {
+        bool on = (i >= 10 && i < 20) || (i >= 50 && i < 55);
+
+        tripstats_add_decision(&x_stats, on ? 7 : 2, 5, on, i * 600);
+    }
+
+    TEST_ASSERT_EQUAL(100, x_stats.decisions);
+    TEST_ASSERT_EQUAL(2, x_stats.tilt_events);
+    TEST_ASSERT_EQUAL(9000, (uint32_t)x_stats.tilt_ms);
+    TEST_ASSERT_EQUAL(6000, x_stats.longest_tilt_ms);
+    TEST_ASSERT_EQUAL(9000, (uint32_t)x_stats.over_threshold_ms);
+    TEST_ASSERT_EQUAL_FLOAT(7, x_stats.max_angle);
+}
+
+static void test_resume(void)
+{
+    //the totals carry across a boot, a warning on at the time is closed off where it was last seen
+    tripstats_add_decision(&x_stats, 7, 5, true, 0);
+    tripstats_add_decision(&x_stats, 7, 5, true, 600);
+    tripstats_resume(&x_stats);
+    tripstats_add_decision(&x_stats, 2, 5, false, 100);
+
+    TEST_ASSERT_EQUAL(1, x_stats.boots);
+    TEST_ASSERT_EQUAL(3, x_stats.decisions);
+    TEST_ASSERT_EQUAL(1, x_stats.tilt_events);
+    TEST_ASSERT_EQUAL(600, (uint32_t)x_stats.tilt_ms);
+    TEST_ASSERT_FALSE(x_stats.tilted);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_haversine);
+    RUN_TEST(test_add_fix);
+    RUN_TEST(test_fix_gap);
+    RUN_TEST(test_add_decision);
+    RUN_TEST(test_resume);
+    return UNITY_END();
+}
@@ -0,0 +1,78 @@
+#include <math.h>
+#include <unity.h>
+#include "vibration.h"
+
+#define TEST_RATE_HZ (100.0f)
+#define TEST_ROAD_HZ (7 * TEST_RATE_HZ / VIBRATION_WINDOW) //on a bin, about 5.5 Hz
+#define TEST_ENGINE_HZ (39 * TEST_RATE_HZ / VIBRATION_WINDOW) //about 30.5 Hz
+
+static float x_samples[VIBRATION_WINDOW];
+
+void setUp(void) {}
+void tearDown(void) {}
+
+//gravity left in plus a road and an engine tone, amplitudes in m/s^2
+static void make_window(float road, float engine)
+{
+    for(int i = 0; i < VIBRATION_WINDOW; i++)
+        x_samples[i] = 9.8f + road * sinf(2 * (float)M_PI * TEST_ROAD_HZ * i / TEST_RATE_HZ) +
+                       engine * sinf(2 * (float)M_PI * TEST_ENGINE_HZ * i / TEST_RATE_HZ);
+}
+
+static void test_bands(void)
+{
+    vibration_features_t features;
+
+    //each tone lands in its own band at its RMS, the mean doesn't count
+    make_window(1, 0.5f);
+    TEST_ASSERT_EQUAL(ESP_OK, vibration_analyze(x_samples, TEST_RATE_HZ, &features));
+
+    TEST_ASSERT_FLOAT_WITHIN(0.03f, 1 / sqrtf(2), features.road_rms);
+    TEST_ASSERT_FLOAT_WITHIN(0.03f, 0.5f / sqrtf(2), features.engine_rms);
+    TEST_ASSERT_FLOAT_WITHIN(0.03f, sqrtf(0.5f + 0.125f), features.total_rms);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, TEST_ROAD_HZ, features.peak_hz);
+}
+
+static void test_engine_only(void)
+{
+    vibration_features_t features;
+
+    make_window(0, 1);
+    TEST_ASSERT_EQUAL(ESP_OK, vibration_analyze(x_samples, TEST_RATE_HZ, &features));
+
+    TEST_ASSERT_FLOAT_WITHIN(0.03f, 0, features.road_rms);
+    TEST_ASSERT_FLOAT_WITHIN(0.03f, 1 / sqrtf(2), features.engine_rms);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, TEST_ENGINE_HZ, features.peak_hz);
+    TEST_ASSERT_EQUAL_FLOAT(1, vibration_cutoff_scale(&features));
+}
+
+static void test_cutoff_scale(void)
+{
+    vibration_features_t features = {0};
+
+    //the filter cutoff comes down in proportion once the road is rough, and no lower than the floor
+    features.road_rms = VIBRATION_ROUGH_RMS;
+    TEST_ASSERT_EQUAL_FLOAT(1, vibration_cutoff_scale(&features));
+    features.road_rms = 2 * VIBRATION_ROUGH_RMS;
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, vibration_cutoff_scale(&features));
+    features.road_rms = 100 * VIBRATION_ROUGH_RMS;
+    TEST_ASSERT_EQUAL_FLOAT(VIBRATION_MIN_CUTOFF_SCALE, vibration_cutoff_scale(&features));
+}
+
+static void test_bad_rate(void)
+{
+    vibration_features_t features;
+
+    make_window(1, 0);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, vibration_analyze(x_samples, 0, &features));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bands);
+    RUN_TEST(test_engine_only);
+    RUN_TEST(test_cutoff_scale);
+    RUN_TEST(test_bad_rate);
+    return UNITY_END();
+}